@@ -43,7 +43,7 @@
 #include <functional>
 #include <iterator>
 
- vigra {
+namespace vigra {
 
 /** \addtogroup MathFunctions
 */
@@ -65,7 +65,7 @@
         Namespace: vigra
     */
 template <class Iterator>
-vigra::Iterator argMin(Iterator first, Iterator last)
+Iterator argMin(Iterator first, Iterator last)
 {
     if(first == last)
         return last;
@@ -93,7 +93,7 @@ vigra::Iterator argMin(Iterator first, Iterator last)
         Namespace: vigra
     */
 template <class Iterator>
-vigra::Iterator argMax(Iterator first, Iterator last)
+Iterator argMax(Iterator first, Iterator last)
 {
     if(first == last)
         return last;
@@ -126,7 +126,7 @@ vigra::Iterator argMax(Iterator first, Iterator last)
         Namespace: vigra
     */
 template <class Iterator, class UnaryFunctor>
-vigra::Iterator argMinIf(Iterator first, Iterator last, UnaryFunctor condition)
+Iterator argMinIf(Iterator first, Iterator last, UnaryFunctor condition)
 {
     for(; first != last; ++first)
         if(condition(*first))
@@ -162,7 +162,7 @@ vigra::Iterator argMinIf(Iterator first, Iterator last, UnaryFunctor condition)
         Namespace: vigra
     */
 template <class Iterator, class UnaryFunctor>
-vigra::Iterator argMaxIf(Iterator first, Iterator last, UnaryFunctor condition)
+Iterator argMaxIf(Iterator first, Iterator last, UnaryFunctor condition)
 {
     for(; first != last; ++first)
         if(condition(*first))
@@ -0,0 +1,320 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014 by Ullrich Koethe                       */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_BLOCKWISE_DISTANCE_HXX
+#define VIGRA_BLOCKWISE_DISTANCE_HXX
+
+#include "threadpool.hxx"
+#include "multi_array.hxx"
+#include "multi_array_chunked.hxx"
+#include "multi_distance.hxx"
+#include "functorexpression.hxx"
+
+namespace vigra
+{
+
+namespace blockwise_distance_detail
+{
+
+    // Call f(start, stop) for each pencil of chunks of 'array', i.e. for the
+    // chunk-aligned boxes that span the entire array along axis 'd'.
+template <unsigned int N, class T, class Functor>
+void forEachPencil(ChunkedArray<N, T> const & array, unsigned int d, Functor f)
+{
+    typedef typename ChunkedArray<N, T>::shape_type Shape;
+
+    Shape shape = array.shape(),
+          chunk_shape = array.chunkShape(),
+          pencils = array.chunkArrayShape();
+    pencils[d] = 1;
+
+    MultiCoordinateIterator<N> it(pencils),
+                               end(it.getEndIterator());
+    for(; it != end; ++it)
+    {
+        Shape start = *it * chunk_shape,
+              stop = min(start + chunk_shape, shape);
+        start[d] = 0;
+        stop[d] = shape[d];
+        f(start, stop);
+    }
+}
+
+    // The separable distance transform of 'source' with the intermediate results
+    // stored in 'tmp' (which may be 'dest' itself). The first pass thresholds
+    // the source, the last pass converts to the destination type, so that the
+    // element-wise operations are the same as in separableMultiDistSquared()
+    // and separableMultiDistance().
+template <unsigned int N, class T1, class T2, class Tmp, class Array>
+void
+separableMultiDistBlockwiseImpl(ChunkedArray<N, T1> const & source,
+                                ChunkedArray<N, T2> & dest,
+                                ChunkedArray<N, Tmp> & tmp,
+                                bool background, Array const & pixelPitch,
+                                Tmp maxDist, bool takeSqrt,
+                                ParallelOptions const & options)
+{
+    typedef typename ChunkedArray<N, T1>::shape_type Shape;
+
+    using namespace vigra::functor;
+
+    T1 zero = NumericTraits<T1>::zero();
+    Tmp rzero = NumericTraits<Tmp>::zero();
+
+    for(unsigned int d = 0; d < N; ++d)
+    {
+        forEachPencil(source, d,
+            [&](Shape const & start, Shape const & stop)
+            {
+                MultiArray<N, Tmp> pencil(stop - start);
+                if(d == 0)
+                {
+                    MultiArray<N, T1> src(stop - start);
+                    source.checkoutSubarray(start, src, options);
+                    if(background)
+                        transformMultiArray(src, pencil,
+                            ifThenElse( Arg1() == Param(zero), Param(maxDist), Param(rzero) ));
+                    else
+                        transformMultiArray(src, pencil,
+                            ifThenElse( Arg1() != Param(zero), Param(maxDist), Param(rzero) ));
+                }
+                else
+                {
+                    tmp.checkoutSubarray(start, pencil, options);
+                }
+
+                detail::internalSeparableMultiArrayDistAxis(
+                    pencil.traverser_begin(), pencil.shape(),
+                    typename AccessorTraits<Tmp>::default_accessor(),
+                    d, pixelPitch[d], options);
+
+                if(d < N-1)
+                {
+                    tmp.commitSubarray(start, pencil, options);
+                }
+                else
+                {
+                    MultiArray<N, T2> res(pencil.shape());
+                    copyMultiArray(pencil, res);
+                    if(takeSqrt)
+                        transformMultiArray(res, res, sqrt(Arg1()));
+                    dest.commitSubarray(start, res, options);
+                }
+            });
+    }
+}
+
+template <unsigned int N, class T1, class T2, class Array>
+void
+separableMultiDistBlockwise(ChunkedArray<N, T1> const & source,
+                            ChunkedArray<N, T2> & dest,
+                            bool background, Array const & pixelPitch,
+                            bool takeSqrt, ParallelOptions const & options)
+{
+    typedef typename ChunkedArray<N, T1>::shape_type Shape;
+    typedef typename NumericTraits<T2>::RealPromote Real;
+
+    Shape shape = source.shape();
+    vigra_precondition(shape == dest.shape(),
+        "separableMultiDistanceBlockwise(): shape mismatch between input and output.");
+    vigra_precondition(source.chunkShape() == dest.chunkShape(),
+        "separableMultiDistanceBlockwise(): chunk shapes do not match.");
+
+    // choose the intermediate type as in separableMultiDistSquared()
+    double dmax = 0.0;
+    bool pixelPitchIsReal = false;
+    for(unsigned int k = 0; k < N; ++k)
+    {
+        if(int(pixelPitch[k]) != pixelPitch[k])
+            pixelPitchIsReal = true;
+        dmax += sq(pixelPitch[k]*shape[k]);
+    }
+
+    if(dmax > NumericTraits<T2>::toRealPromote(NumericTraits<T2>::max())
+       || pixelPitchIsReal) // need a temporary array to avoid overflows
+    {
+        // keep the chunks outside the current pencil compressed, so that
+        // the entire volume needn't fit into memory
+        ChunkedArrayCompressed<N, Real> tmp(shape, source.chunkShape(),
+                           ChunkedArrayOptions().cacheMax(max(source.chunkArrayShape())));
+        separableMultiDistBlockwiseImpl(source, dest, tmp, background, pixelPitch,
+                                        (Real)dmax, takeSqrt, options);
+    }
+    else
+    {
+        separableMultiDistBlockwiseImpl(source, dest, dest, background, pixelPitch,
+                                        T2(std::ceil(dmax)), takeSqrt, options);
+    }
+}
+
+} // namespace blockwise_distance_detail
+
+/** \addtogroup DistanceTransform
+*/
+//@{
+
+/*************************************************************/
+
+/** \weakgroup ParallelProcessing
+    \sa separableMultiDistanceBlockwise <B>(...)</B>
+*/
+
+/** \brief Euclidean distance transform for ChunkedArrays.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class T2, class Array>
+        void
+        separableMultiDistanceBlockwise(ChunkedArray<N, T1> const & source,
+                                        ChunkedArray<N, T2> & dest,
+                                        bool background,
+                                        Array const & pixelPitch,
+                                        ParallelOptions const & options = ParallelOptions());
+
+        template <unsigned int N, class T1, class T2>
+        void
+        separableMultiDistanceBlockwise(ChunkedArray<N, T1> const & source,
+                                        ChunkedArray<N, T2> & dest,
+                                        bool background,
+                                        ParallelOptions const & options = ParallelOptions());
+
+        // squared distances, as in separableMultiDistSquared()
+        template <unsigned int N, class T1, class T2, class Array>
+        void
+        separableMultiDistSquaredBlockwise(ChunkedArray<N, T1> const & source,
+                                           ChunkedArray<N, T2> & dest,
+                                           bool background,
+                                           Array const & pixelPitch,
+                                           ParallelOptions const & options = ParallelOptions());
+
+        template <unsigned int N, class T1, class T2>
+        void
+        separableMultiDistSquaredBlockwise(ChunkedArray<N, T1> const & source,
+                                           ChunkedArray<N, T2> & dest,
+                                           bool background,
+                                           ParallelOptions const & options = ParallelOptions());
+    }
+    \endcode
+
+    These functions compute the exact Euclidean distance transform of a \ref ChunkedArray,
+    which need not fit into memory. The separable algorithm of \ref separableMultiDistSquared()
+    processes one axis at a time. For each axis, the array is traversed in pencils of
+    chunks, i.e. chunk-aligned boxes that span the entire array along the present axis.
+    Each pencil is checked out into a temporary \ref MultiArray, all its lines along the
+    axis are transformed in parallel according to <tt>options</tt>, and the pencil is
+    committed back. At any time, only one pencil must be held in memory (plus the
+    chunks in the arrays' caches). The intermediate results are written to <tt>dest</tt>,
+    or to a temporary \ref ChunkedArrayCompressed of type <tt>NumericTraits<T2>::RealPromote</tt>
+    when the in-memory version would also use a temporary array (i.e. when
+    <tt>dest</tt>'s type may overflow or the pixel pitch is not integer). The cache of
+    the temporary array holds one pencil, and the other chunks are kept compressed.
+
+    The results are identical to those of \ref separableMultiDistance() and
+    \ref separableMultiDistSquared() applied to the entire array. <tt>source</tt> and
+    <tt>dest</tt> must have the same shape and chunk shape.
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/blockwise_distance.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    Shape3 shape(1000), chunk_shape(64);
+    ChunkedArrayCompressed<3, UInt8> mask(shape, chunk_shape);
+    // fill mask ...
+
+    ChunkedArrayCompressed<3, float> distances(shape, chunk_shape);
+
+    // distance of every background pixel to the nearest object pixel
+    separableMultiDistanceBlockwise(mask, distances, true);
+    \endcode
+
+    \see vigra::separableMultiDistance()
+*/
+doxygen_overloaded_function(template <...> void separableMultiDistanceBlockwise)
+
+template <unsigned int N, class T1, class T2, class Array>
+inline void
+separableMultiDistanceBlockwise(ChunkedArray<N, T1> const & source,
+                                ChunkedArray<N, T2> & dest,
+                                bool background,
+                                Array const & pixelPitch,
+                                ParallelOptions const & options = ParallelOptions())
+{
+    blockwise_distance_detail::separableMultiDistBlockwise(source, dest, background, pixelPitch,
+                                                           true, options);
+}
+
+template <unsigned int N, class T1, class T2>
+inline void
+separableMultiDistanceBlockwise(ChunkedArray<N, T1> const & source,
+                                ChunkedArray<N, T2> & dest,
+                                bool background,
+                                ParallelOptions const & options = ParallelOptions())
+{
+    separableMultiDistanceBlockwise(source, dest, background, TinyVector<double, N>(1.0), options);
+}
+
+doxygen_overloaded_function(template <...> void separableMultiDistSquaredBlockwise)
+
+template <unsigned int N, class T1, class T2, class Array>
+inline void
+separableMultiDistSquaredBlockwise(ChunkedArray<N, T1> const & source,
+                                   ChunkedArray<N, T2> & dest,
+                                   bool background,
+                                   Array const & pixelPitch,
+                                   ParallelOptions const & options = ParallelOptions())
+{
+    blockwise_distance_detail::separableMultiDistBlockwise(source, dest, background, pixelPitch,
+                                                           false, options);
+}
+
+template <unsigned int N, class T1, class T2>
+inline void
+separableMultiDistSquaredBlockwise(ChunkedArray<N, T1> const & source,
+                                   ChunkedArray<N, T2> & dest,
+                                   bool background,
+                                   ParallelOptions const & options = ParallelOptions())
+{
+    separableMultiDistSquaredBlockwise(source, dest, background, TinyVector<double, N>(1.0), options);
+}
+
+//@}
+
+} // namespace vigra
+
+#endif // VIGRA_BLOCKWISE_DISTANCE_HXX
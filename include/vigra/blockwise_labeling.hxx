@@ -103,6 +103,12 @@ public:
         BlockwiseOptions::numThreads(n);
         return *this;
     }
+
+    BlockwiseLabelOptions & pool(ThreadPool & pool)
+    {
+        BlockwiseOptions::pool(pool);
+        return *this;
+    }
 };
 
 namespace blockwise_labeling_detail
@@ -173,7 +179,7 @@ blockwiseLabeling(DataBlocksIterator data_blocks_begin, DataBlocksIterator data_
         //std::vector<int> ids(d);
         //std::iota(ids.begin(), ids.end(), 0 );
 
-        parallel_foreach(options.getNumThreads(), d,
+        parallel_foreach(options, d,
             [&](const int /*threadId*/, const uint64_t i){
                 Label resVal = labelMultiArray(data_blocks_it[i], label_blocks_it[i],
                                                options, equal);
@@ -40,32 +40,137 @@
 #include "config.hxx"
 #include "error.hxx"
 #include "array_vector.hxx"
+#include <memory>
+#include <string>
 #include <vector>
 
 namespace vigra {
 
+/** Compression methods.
+
+    A method consists of a codec (the values up to <tt>USER_COMPRESSION+63</tt>)
+    and optionally a pre-filter (<tt>SHUFFLE</tt> or <tt>BITSHUFFLE</tt>), which
+    are combined via <tt>operator|</tt>, e.g. <tt>LZ4 | SHUFFLE</tt>. The filters
+    rearrange the data such that bytes (resp. bits) of equal significance are
+    stored next to each other. For smooth multi-byte data (e.g. 16-bit
+    microscopy images), this exposes long runs of similar high-order bytes
+    to the codec, which typically improves both compression ratio and speed.
+    Filters have no effect on NO_COMPRESSION and DEFAULT_COMPRESSION.
+*/
 enum CompressionMethod {  DEFAULT_COMPRESSION=-2,  // use default method (depending on context)
                           NO_COMPRESSION=-1,       // don't compress
                           ZLIB_NONE=0, // no compression using zlib
                           ZLIB_FAST=1, // fastest compression using zlib
                           ZLIB=6,      // zlib default compression level
                           ZLIB_BEST=9, // highest compression using zlib
-                          LZ4          // very fast LZ4 algorithm
+                          LZ4,         // very fast LZ4 algorithm
+                          ZSTD_FAST,   // fast compression using Zstandard (level 1, requires libzstd)
+                          ZSTD,        // Zstandard default compression (level 3, requires libzstd)
+                          ZSTD_BEST,   // high compression using Zstandard (level 19, requires libzstd)
+                          USER_COMPRESSION=64,  // first ID for codecs added via registerCompressionCodec()
+                          SHUFFLE=0x100,        // pre-filter: group bytes of equal significance
+                          BITSHUFFLE=0x200,     // pre-filter: group bits of equal significance
+                          LZ4_SHUFFLE=LZ4|SHUFFLE,
+                          LZ4_BITSHUFFLE=LZ4|BITSHUFFLE,
+                          ZSTD_SHUFFLE=ZSTD|SHUFFLE
                        };
 
+inline CompressionMethod operator|(CompressionMethod a, CompressionMethod b)
+{
+    return CompressionMethod(int(a) | int(b));
+}
+
+/** Strip the pre-filter from a compression method.
+*/
+inline CompressionMethod compressionCodecMethod(CompressionMethod method)
+{
+    return method < 0
+              ? method
+              : CompressionMethod(method & ~(SHUFFLE | BITSHUFFLE));
+}
+
+/** Get the pre-filter of a compression method (SHUFFLE, BITSHUFFLE, or 0).
+*/
+inline int compressionFilter(CompressionMethod method)
+{
+    return method < 0
+              ? 0
+              : method & (SHUFFLE | BITSHUFFLE);
+}
+
+/** Base class of compression codecs.
+
+    Additional codecs can be made available to \ref compress(), \ref uncompress()
+    and \ref ChunkedArrayCompressed via \ref registerCompressionCodec().
+    Pre-filters are applied by the calling functions, so codecs only need to
+    implement the plain compression.
+*/
+class VIGRA_EXPORT CompressionCodec
+{
+  public:
+    virtual ~CompressionCodec() {}
+
+        /** The codec's name (used in error messages and
+            <tt>ChunkedArray::backend()</tt>).
+        */
+    virtual std::string name() const = 0;
+
+        /** Upper bound for the compressed size of 'size' input bytes.
+        */
+    virtual std::size_t compressBound(std::size_t size) const = 0;
+
+        /** Compress 'size' bytes from 'source' into 'dest', which has room
+            for <tt>compressBound(size)</tt> bytes. Returns the compressed size.
+        */
+    virtual std::size_t compress(char const * source, std::size_t size,
+                                 char * dest, std::size_t destCapacity) const = 0;
+
+        /** Uncompress 'srcSize' bytes from 'source' into 'dest'. The uncompressed
+            size 'destSize' is known.
+        */
+    virtual void uncompress(char const * source, std::size_t srcSize,
+                            char * dest, std::size_t destSize) const = 0;
+};
+
+/** Make 'codec' available under the ID 'method'.
+
+    'method' must be in the range <tt>[USER_COMPRESSION, USER_COMPRESSION+63]</tt>.
+    Registration is not thread-safe and should happen before any data are
+    compressed with the codec (e.g. at program start).
+*/
+VIGRA_EXPORT void registerCompressionCodec(CompressionMethod method,
+                                           VIGRA_SHARED_PTR<CompressionCodec> codec);
+
+/** Get the codec implementing 'method' (the pre-filter is ignored).
+
+    Throws a <tt>PreconditionViolation</tt> if the method is unknown or
+    VIGRA was compiled without the respective library.
+*/
+VIGRA_EXPORT CompressionCodec const & getCompressionCodec(CompressionMethod method);
+
+/** Get the name of a compression method, e.g. "LZ4|SHUFFLE".
+*/
+VIGRA_EXPORT std::string compressionMethodName(CompressionMethod method);
+
 /** Compress the source buffer.
 
-    The destination array will be resized as required.
+    The destination array will be resized as required. 'elementSize' is the
+    size of the data's scalar type in bytes, which is needed by the
+    pre-filters.
 */
-VIGRA_EXPORT void compress(char const * source, std::size_t size, ArrayVector<char> & dest, CompressionMethod method);
-VIGRA_EXPORT void compress(char const * source, std::size_t size, std::vector<char> & dest, CompressionMethod method);
+VIGRA_EXPORT void compress(char const * source, std::size_t size, ArrayVector<char> & dest,
+                           CompressionMethod method, std::size_t elementSize = 1);
+VIGRA_EXPORT void compress(char const * source, std::size_t size, std::vector<char> & dest,
+                           CompressionMethod method, std::size_t elementSize = 1);
 
 /** Uncompress the source buffer when the uncompressed size is known.
 
     The destination buffer must be allocated to the correct size.
+    'method' and 'elementSize' must be the same as during compression.
 */
-VIGRA_EXPORT void uncompress(char const * source, std::size_t srcSize, 
-                             char * dest, std::size_t destSize, CompressionMethod method);
+VIGRA_EXPORT void uncompress(char const * source, std::size_t srcSize,
+                             char * dest, std::size_t destSize, CompressionMethod method,
+                             std::size_t elementSize = 1);
 
 
 } // namespace vigra
@@ -1453,6 +1453,41 @@ class HDF5File
         return shape;
     }
 
+        /** \brief Get the byte offset of a dataset's data within the HDF5 file.
+
+            This is only possible when the dataset is stored contiguously (i.e.
+            neither chunked nor compressed) in the machine's native byte order,
+            and its data have already been written. Otherwise, a
+            <tt>PreconditionViolation</tt> is raised. The offset allows to
+            memory-map the dataset directly, see \ref ChunkedArrayMappedFile.
+
+            If the first character is a "/", the path will be interpreted as absolute path,
+            otherwise it will be interpreted as path relative to the current group.
+        */
+    hsize_t getDatasetFileOffset(std::string datasetName) const
+    {
+        // make datasetName clean
+        datasetName = get_absolute_path(datasetName);
+
+        std::string errorMessage = "HDF5File::getDatasetFileOffset(): Unable to open dataset '" + datasetName + "'.";
+        HDF5Handle datasetHandle = HDF5Handle(getDatasetHandle_(datasetName), &H5Dclose, errorMessage.c_str());
+        HDF5Handle properties(H5Dget_create_plist(datasetHandle),
+                             &H5Pclose, "HDF5File::getDatasetFileOffset(): failed to get property list");
+        vigra_precondition(H5Pget_layout(properties) == H5D_CONTIGUOUS,
+            "HDF5File::getDatasetFileOffset(): dataset is not stored contiguously.");
+
+        HDF5Handle datatypeHandle(H5Dget_type(datasetHandle), &H5Tclose,
+                                  "HDF5File::getDatasetFileOffset(): unable to get dataset type.");
+        H5T_order_t order = H5Tget_order(datatypeHandle);
+        vigra_precondition(order == H5T_ORDER_NONE || order == H5Tget_order(H5T_NATIVE_INT),
+            "HDF5File::getDatasetFileOffset(): dataset is not stored in native byte order.");
+
+        haddr_t offset = H5Dget_offset(datasetHandle);
+        vigra_precondition(offset != HADDR_UNDEF,
+            "HDF5File::getDatasetFileOffset(): dataset has no storage in the file.");
+        return offset;
+    }
+
         /** Query the pixel type of the dataset.
 
             Possible values are:
@@ -40,6 +40,8 @@
 #include <vigra/multi_pointoperators.hxx>
 #include <vigra/utilities.hxx>
 #include <vigra/functorexpression.hxx>
+#include <vigra/array_vector.hxx>
+#include <vigra/threadpool.hxx>
 
 namespace vigra {
 
@@ -68,97 +70,238 @@ cumulativeSum(MultiArrayView<N, T1, S1> const & image,
     }
 }
 
+namespace detail {
+
+    // Integral array computed in a single pass over the lines along axis 0 in
+    // scan order. Each line's prefix sum is added to the sums over axes 0...k of
+    // the previous line along axis k, for k = 1...N-1. For k < N-1, these sums
+    // are kept in buffers (as in a hand-written 3D implementation, where a single
+    // line is buffered); for k = N-1 they are read back from the result.
 template <unsigned int N, class T1, class S1, class T2, class S2, class FUNCTOR>
-void 
-integralMultiArrayImpl(MultiArrayView<N, T1, S1> const & array, 
-                       MultiArrayView<N, T2, S2> intarray,
-                       FUNCTOR const & f)
+void
+integralMultiArraySequential(MultiArrayView<N, T1, S1> const & array,
+                             MultiArrayView<N, T2, S2> intarray,
+                             FUNCTOR const & functor)
 {
-    vigra_precondition(array.shape() == intarray.shape(),
-        "integralMultiArray(): shape mismatch between input and output.");
-        
-    cumulativeSum(array, intarray, 0, f);
-    
-    for(unsigned axis=1; axis < N; ++axis)
-        cumulativeSum(intarray, intarray, axis, functor::Identity());
-}
+    typedef typename MultiArrayShape<N>::type ShapeN;
 
-template <class T1, class S1, class T2, class S2, class FUNCTOR>
-void 
-integralMultiArrayImpl(MultiArrayView<2, T1, S1> const & image, 
-                       MultiArrayView<2, T2, S2> intimage,
-                       FUNCTOR const & functor)
-{
-    vigra_precondition(image.shape() == intimage.shape(),
-        "integralMultiArray(): shape mismatch between input and output.");
-        
-    int width = image.shape(0);
-    int height = image.shape(1);
+    ShapeN lines(array.shape());
+    lines[0] = 1;
+    MultiArrayIndex width = array.shape(0),
+                    s1 = array.stride(0),
+                    s2 = intarray.stride(0);
 
-    T2 s = T2();
-    for (int x=0; x<width; ++x)
+    // partial[k-1] holds the sums for axis k, indexed by the coordinates along axes 0...k-1
+    ArrayVector<ArrayVector<T2> > partial;
+    MultiArrayIndex size = width;
+    for(unsigned int k = 1; k + 1 < N; ++k)
     {
-        s += functor(image(x, 0));
-        intimage(x, 0) = s;
+        partial.push_back(ArrayVector<T2>(size));
+        size *= array.shape(k);
     }
-    for (int y=1; y<height; ++y)
+    ArrayVector<T2> line(width);
+
+    MultiCoordinateIterator<N> i(lines),
+                               end(i.getEndIterator());
+    for(; i != end; ++i)
     {
-        s = T2();
-        for (int x=0; x<width; ++x)
+        T1 const * in = &array[*i];
+        T2 * out = &intarray[*i];
+
+        T2 s = T2();
+        for(MultiArrayIndex x = 0; x < width; ++x)
         {
-            s += functor(image(x, y));
-            intimage(x, y) = s + intimage(x, y-1);
+            s += functor(in[x*s1]);
+            line[x] = s;
+        }
+
+        MultiArrayIndex offset = 0;
+        size = width;
+        for(unsigned int k = 1; k + 1 < N; ++k)
+        {
+            T2 * p = partial[k-1].begin() + offset;
+            if((*i)[k] > 0)
+                for(MultiArrayIndex x = 0; x < width; ++x)
+                    line[x] += p[x];
+            std::copy(line.begin(), line.end(), p);
+            offset += (*i)[k] * size;
+            size *= array.shape(k);
+        }
+
+        if(N > 1 && (*i)[N-1] > 0)
+        {
+            T2 const * prev = out - intarray.stride(N-1);
+            for(MultiArrayIndex x = 0; x < width; ++x)
+                out[x*s2] = line[x] + prev[x*s2];
+        }
+        else
+        {
+            for(MultiArrayIndex x = 0; x < width; ++x)
+                out[x*s2] = line[x];
         }
     }
 }
 
-template <class T1, class S1, class T2, class S2, class FUNCTOR>
-void 
-integralMultiArrayImpl(MultiArrayView<3, T1, S1> const & volume, 
-                       MultiArrayView<3, T2, S2> intvolume,
-                       FUNCTOR const & functor)
+    // The array is split into one slab per thread along the outermost non-singleton
+    // axis, and the integral of each slab is computed in parallel. Then the carries
+    // (i.e. the totals of all preceding slabs, which are the last hyperplanes of the
+    // preceding slabs accumulated in turn) are added to the slabs, again in parallel.
+template <unsigned int N, class T1, class S1, class T2, class S2, class FUNCTOR>
+void
+integralMultiArrayImpl(MultiArrayView<N, T1, S1> const & array,
+                       MultiArrayView<N, T2, S2> intarray,
+                       FUNCTOR const & functor,
+                       ParallelOptions const & options)
 {
-    vigra_precondition(volume.shape() == intvolume.shape(),
+    typedef typename MultiArrayShape<N>::type ShapeN;
+
+    vigra_precondition(array.shape() == intarray.shape(),
         "integralMultiArray(): shape mismatch between input and output.");
-        
-    int nx = volume.shape(0);
-    int ny = volume.shape(1);
-    int nz = volume.shape(2);
 
-    //this vector will store s2(x, y-1) for all values of x
-    MultiArray<1, T2> s2_temp(nx);
-    
-    T2 s1 = T2();
-    T2 s2 = T2();
+    if(array.size() == 0)
+        return;
+
+    int axis = N-1;
+    while(axis > 0 && array.shape(axis) < 2)
+        --axis;
+    MultiArrayIndex extent = array.shape(axis),
+                    nSlabs = std::min<MultiArrayIndex>(extent, options.getActualNumThreads());
+    if(nSlabs < 2)
+    {
+        integralMultiArraySequential(array, intarray, functor);
+        return;
+    }
+
+    ArrayVector<MultiArrayIndex> bounds(nSlabs + 1);
+    for(MultiArrayIndex k = 0; k <= nSlabs; ++k)
+        bounds[k] = parallel_slab_bound(k, nSlabs, extent);
+
+    auto plane = [&](MultiArrayIndex from, MultiArrayIndex to) -> std::pair<ShapeN, ShapeN>
+    {
+        ShapeN start, stop(array.shape());
+        start[axis] = from;
+        stop[axis]  = to;
+        return std::make_pair(start, stop);
+    };
+
+    parallel_foreach(options, nSlabs,
+        [&](size_t /* thread_id */, std::ptrdiff_t k)
+        {
+            std::pair<ShapeN, ShapeN> slab = plane(bounds[k], bounds[k+1]);
+            integralMultiArraySequential(array.subarray(slab.first, slab.second),
+                                         intarray.subarray(slab.first, slab.second), functor);
+        });
 
-    for (int iy=0; iy<ny; ++iy)
+    ShapeN carryShape(array.shape());
+    carryShape[axis] = nSlabs;
+    MultiArray<N, T2> carries(carryShape);
+    for(MultiArrayIndex k = 1; k < nSlabs; ++k)
     {
-        s1 = T2();
-        for (int ix=0; ix<nx; ++ix)
+        std::pair<ShapeN, ShapeN> c = plane(k, k+1),
+                                  last = plane(bounds[k] - 1, bounds[k]);
+        MultiArrayView<N, T2, StridedArrayTag> carry(carries.subarray(c.first, c.second));
+        if(k > 1)
         {
-            s1 += functor(volume(ix, iy, 0));
-            s2 = s2_temp(ix) + s1;
-            s2_temp(ix) = s2;
-            intvolume(ix, iy, 0) = s2;
+            std::pair<ShapeN, ShapeN> prev = plane(k-1, k);
+            carry = carries.subarray(prev.first, prev.second);
         }
+        carry += intarray.subarray(last.first, last.second);
     }
-    
-    for (int iz=1; iz<nz; ++iz)
-    {    
-        s2_temp = T2();
-        
-        for (int iy=0; iy<ny; ++iy)
+
+    parallel_foreach(options, nSlabs - 1,
+        [&](size_t /* thread_id */, std::ptrdiff_t k)
         {
-            s1 = T2();
-            for (int ix=0; ix<nx; ++ix)
+            ++k;
+            std::pair<ShapeN, ShapeN> c = plane(k, k+1);
+            MultiArrayView<N, T2, StridedArrayTag> carry(carries.subarray(c.first, c.second));
+            for(MultiArrayIndex j = bounds[k]; j < bounds[k+1]; ++j)
             {
-                s1 += functor(volume(ix, iy, iz));
-                s2 = s2_temp(ix) + s1;
-                s2_temp(ix) = s2;
-                intvolume(ix, iy, iz) = s2 + intvolume(ix, iy, iz-1);
+                std::pair<ShapeN, ShapeN> p = plane(j, j+1);
+                intarray.subarray(p.first, p.second) += carry;
             }
-        }
+        });
+}
+
+} // namespace detail
+
+/** \brief Compute the integral image (summed area table) of an N-dimensional array.
+
+    Each element of <tt>intarray</tt> receives the sum of <tt>f(array[p])</tt>
+    over all points <tt>p</tt> that are less or equal in every coordinate.
+    <tt>array</tt> and <tt>intarray</tt> must have the same shape, and may refer to the same
+    data. The accumulation is done in <tt>intarray</tt>'s value type.
+    For <tt>Multiband</tt> arrays, every channel is processed separately.
+
+    The integral is computed in a single pass over the lines along axis 0 in scan
+    order: the prefix sum of each line is added to the sums of the preceding lines
+    along the other axes. When \ref ParallelOptions are passed (the versions without
+    <tt>options</tt> work sequentially), the array is split into one slab per thread
+    along the outermost axis with more than one element. The integrals of the slabs
+    are computed in parallel. Then the totals of all preceding slabs (the last
+    hyperplanes of these slabs, accumulated in turn) are added to every slab, again
+    in parallel.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1, class T2, class S2, class FUNCTOR>
+        void
+        integralMultiArray(MultiArrayView<N, T1, S1> const & array,
+                           MultiArrayView<N, T2, S2> intarray,
+                           FUNCTOR const & f,
+                           ParallelOptions const & options);
+
+        template <unsigned int N, class T1, class S1, class T2, class S2>
+        void
+        integralMultiArray(MultiArrayView<N, T1, S1> const & array,
+                           MultiArrayView<N, T2, S2> intarray,
+                           ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
+
+        // sum of squares
+        template <unsigned int N, class T1, class S1, class T2, class S2>
+        void
+        integralMultiArraySquared(MultiArrayView<N, T1, S1> const & array,
+                                  MultiArrayView<N, T2, S2> intarray,
+                                  ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
     }
+    \endcode
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/integral_image.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    MultiArray<3, UInt8>  volume(Shape3(300, 300, 300));
+    MultiArray<3, double> sums(volume.shape());
+    ...
+    integralMultiArray(volume, sums, ParallelOptions().numThreads(8));
+    \endcode
+
+    \see boxFilterMultiArray(), localVarianceMultiArray()
+*/
+doxygen_overloaded_function(template <...> void integralMultiArray)
+
+template <unsigned int N, class T1, class S1, class T2, class S2, class FUNCTOR>
+inline void 
+integralMultiArray(MultiArrayView<N, T1, S1> const & array, 
+                   MultiArrayView<N, T2, S2> intarray,
+                   FUNCTOR const & f,
+                   ParallelOptions const & options)
+{
+    detail::integralMultiArrayImpl(array, intarray, f, options);
+}
+
+template <unsigned int N, class T1, class S1, class T2, class S2, class FUNCTOR>
+inline void 
+integralMultiArray(MultiArrayView<N, Multiband<T1>, S1> const & array, 
+                   MultiArrayView<N, Multiband<T2>, S2> intarray,
+                   FUNCTOR const & f,
+                   ParallelOptions const & options)
+{
+    for(int channel=0; channel < array.shape(N-1); ++channel)
+        detail::integralMultiArrayImpl(array.bindOuter(channel), intarray.bindOuter(channel), f, options);
 }
 
 template <unsigned int N, class T1, class S1, class T2, class S2, class FUNCTOR>
@@ -167,7 +310,7 @@ integralMultiArray(MultiArrayView<N, T1, S1> const & array,
                    MultiArrayView<N, T2, S2> intarray,
                    FUNCTOR const & f)
 {
-    integralMultiArrayImpl(array, intarray, f);
+    integralMultiArray(array, intarray, f, ParallelOptions().numThreads(ParallelOptions::NoThreads));
 }
 
 template <unsigned int N, class T1, class S1, class T2, class S2, class FUNCTOR>
@@ -176,42 +319,365 @@ integralMultiArray(MultiArrayView<N, Multiband<T1>, S1> const & array,
                    MultiArrayView<N, Multiband<T2>, S2> intarray,
                    FUNCTOR const & f)
 {
-    for(int channel=0; channel < array.shape(N-1); ++channel)
-        integralMultiArrayImpl(array.bindOuter(channel), intarray.bindOuter(channel), f);
+    integralMultiArray(array, intarray, f, ParallelOptions().numThreads(ParallelOptions::NoThreads));
 }
 
 template <unsigned int N, class T1, class S1, class T2, class S2>
 inline void 
 integralMultiArray(MultiArrayView<N, T1, S1> const & array, 
-                   MultiArrayView<N, T2, S2> intarray)
+                   MultiArrayView<N, T2, S2> intarray,
+                   ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
 {
-    integralMultiArray(array, intarray, functor::Identity());
+    integralMultiArray(array, intarray, functor::Identity(), options);
 }
 
 template <unsigned int N, class T1, class S1, class T2, class S2>
 inline void 
 integralMultiArray(MultiArrayView<N, Multiband<T1>, S1> const & array, 
-                   MultiArrayView<N, Multiband<T2>, S2> intarray)
+                   MultiArrayView<N, Multiband<T2>, S2> intarray,
+                   ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
 {
-    integralMultiArray(array, intarray, functor::Identity());
+    integralMultiArray(array, intarray, functor::Identity(), options);
 }
 
 template <unsigned int N, class T1, class S1, class T2, class S2>
 inline void 
 integralMultiArraySquared(MultiArrayView<N, T1, S1> const & array, 
-                          MultiArrayView<N, T2, S2> intarray)
+                          MultiArrayView<N, T2, S2> intarray,
+                          ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
 {
     using namespace functor;
-    integralMultiArray(array, intarray, sq(Arg1()));
+    integralMultiArray(array, intarray, sq(Arg1()), options);
 }
 
 template <unsigned int N, class T1, class S1, class T2, class S2>
 inline void 
 integralMultiArraySquared(MultiArrayView<N, Multiband<T1>, S1> const & array, 
-                          MultiArrayView<N, Multiband<T2>, S2> intarray)
+                          MultiArrayView<N, Multiband<T2>, S2> intarray,
+                          ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
+{
+    using namespace functor;
+    integralMultiArray(array, intarray, sq(Arg1()), options);
+}
+
+namespace detail {
+
+    // Window sums along the line at position 'lo' and 'hi' on the axes 1...N-1 from
+    // 'table', the integral array padded with a leading zero hyperplane along every axis.
+    // The window [lo, hi) along the other axes is given, and sums[x] receives the sum
+    // over the window [x - radius, x + radius] along axis 0 (clipped at the border),
+    // counts[x] the window's number of elements. The sums are computed by
+    // inclusion-exclusion over the 2^N corners, where the 2^(N-1) lines of corners
+    // along axis 0 are determined once per line.
+template <unsigned int N, class T, class S, class Shape>
+void
+integralBoxLine(MultiArrayView<N, T, S> const & table,
+                Shape const & lo, Shape const & hi,
+                MultiArrayIndex width, MultiArrayIndex radius,
+                T * sums, double * counts)
+{
+    enum { Corners = 1 << (N-1) };
+
+    T const * lines[Corners];
+    bool negative[Corners];
+    double outerCount = 1.0;
+    for(unsigned int d = 1; d < N; ++d)
+        outerCount *= hi[d] - lo[d];
+    for(int c = 0; c < Corners; ++c)
+    {
+        Shape corner;
+        negative[c] = false;
+        for(unsigned int d = 1; d < N; ++d)
+        {
+            if(c & (1 << (d-1)))
+            {
+                corner[d] = hi[d];
+            }
+            else
+            {
+                corner[d] = lo[d];
+                negative[c] = !negative[c];
+            }
+        }
+        lines[c] = &table[corner];
+    }
+
+    MultiArrayIndex stride = table.stride(0);
+    for(MultiArrayIndex x = 0; x < width; ++x)
+    {
+        MultiArrayIndex l = std::max<MultiArrayIndex>(x - radius, 0)*stride,
+                        h = std::min<MultiArrayIndex>(x + radius + 1, width)*stride;
+        T sum = T();
+        for(int c = 0; c < Corners; ++c)
+        {
+            if(negative[c])
+                sum -= lines[c][h] - lines[c][l];
+            else
+                sum += lines[c][h] - lines[c][l];
+        }
+        sums[x] = sum;
+        counts[x] = outerCount * (h - l) / stride;
+    }
+}
+
+    // Call f(p, lo, hi) for the start 'p' of every line along axis 0 of an array of
+    // the given 'shape', where [lo, hi) is the window of the given 'radius' around
+    // the line along the other axes, clipped at the array border, in the coordinates
+    // of the padded integral array. The lines are split among the threads into slabs.
+    // Each slab works on its own copy of 'f', so that 'f' may own line buffers.
+template <class Shape, class Functor>
+void
+integralBoxFilter(Shape const & shape, Shape const & radius,
+                  ParallelOptions const & options, Functor const & f)
+{
+    enum { N = Shape::static_size };
+
+    Shape lines(shape);
+    lines[0] = 1;
+    parallel_foreach_slab(options, lines, N-1,
+        [&](size_t /* thread_id */, std::ptrdiff_t, Shape const & start, Shape const & stop)
+        {
+            Functor line(f);
+            MultiCoordinateIterator<N> i(stop - start),
+                                       end(i.getEndIterator());
+            for(; i != end; ++i)
+            {
+                Shape p(start + *i),
+                      lo(max(p - radius, Shape())),
+                      hi(min(p + radius + Shape(1), shape));
+                line(p, lo, hi);
+            }
+        });
+}
+
+} // namespace detail
+
+/** \brief Mean filter with a box-shaped window of arbitrary size.
+
+    Each element of <tt>dest</tt> receives the mean of the elements of <tt>src</tt>
+    in the window <tt>[p - radius, p + radius]</tt> around the element's position <tt>p</tt>.
+    At the array border, the window is clipped, i.e. the mean is taken over the
+    window's part inside the array. <tt>radius</tt> can be given per axis or as a
+    single number for all axes.
+
+    The window sums are computed from an integral array (see \ref integralMultiArray())
+    in double precision, such that the cost per element
+    is independent of the radius (namely <tt>2^N</tt> look-ups). This is much faster
+    than a convolution with a large averaging kernel. Both the integral array and the
+    filter are computed in parallel when \ref ParallelOptions are passed (by default,
+    the functions work sequentially, as \ref integralMultiArray() does).
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1, class T2, class S2>
+        void
+        boxFilterMultiArray(MultiArrayView<N, T1, S1> const & src,
+                            MultiArrayView<N, T2, S2> dest,
+                            typename MultiArrayShape<N>::type const & radius,
+                            ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
+
+        template <unsigned int N, class T1, class S1, class T2, class S2>
+        void
+        boxFilterMultiArray(MultiArrayView<N, T1, S1> const & src,
+                            MultiArrayView<N, T2, S2> dest,
+                            MultiArrayIndex radius,
+                            ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
+    }
+    \endcode
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/integral_image.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    MultiArray<3, UInt8> volume(Shape3(300, 300, 300));
+    MultiArray<3, float> mean(volume.shape());
+    ...
+    // mean over windows of size 31x31x11
+    boxFilterMultiArray(volume, mean, Shape3(15, 15, 5));
+    \endcode
+
+    \see localVarianceMultiArray()
+*/
+doxygen_overloaded_function(template <...> void boxFilterMultiArray)
+
+template <unsigned int N, class T1, class S1, class T2, class S2>
+void
+boxFilterMultiArray(MultiArrayView<N, T1, S1> const & src,
+                    MultiArrayView<N, T2, S2> dest,
+                    typename MultiArrayShape<N>::type const & radius,
+                    ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    typedef typename PromoteTraits<typename NumericTraits<T1>::RealPromote, double>::Promote SumType;
+
+    vigra_precondition(src.shape() == dest.shape(),
+        "boxFilterMultiArray(): shape mismatch between input and output.");
+    vigra_precondition(min(radius) >= 0,
+        "boxFilterMultiArray(): radius must be non-negative.");
+
+    MultiArray<N, SumType> table(src.shape() + Shape(1));
+    integralMultiArray(src, table.subarray(Shape(1), table.shape()), options);
+
+    MultiArrayIndex width = src.shape(0),
+                    stride = dest.stride(0);
+    ArrayVector<SumType> sums(width);
+    ArrayVector<double> counts(width);
+    detail::integralBoxFilter(src.shape(), radius, options,
+        [=, &table, &dest](Shape const & p, Shape const & lo, Shape const & hi) mutable
+        {
+            detail::integralBoxLine(table, lo, hi, width, radius[0], sums.begin(), counts.begin());
+            T2 * d = &dest[p];
+            for(MultiArrayIndex x = 0; x < width; ++x)
+                d[x*stride] = detail::RequiresExplicitCast<T2>::cast(sums[x] / counts[x]);
+        });
+}
+
+template <unsigned int N, class T1, class S1, class T2, class S2>
+inline void
+boxFilterMultiArray(MultiArrayView<N, T1, S1> const & src,
+                    MultiArrayView<N, T2, S2> dest,
+                    MultiArrayIndex radius,
+                    ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
 {
+    boxFilterMultiArray(src, dest, typename MultiArrayShape<N>::type(radius), options);
+}
+
+namespace detail {
+
+template <unsigned int N, class T1, class S1, class T2, class S2, class T3, class S3>
+void
+localVarianceMultiArrayImpl(MultiArrayView<N, T1, S1> const & src,
+                            MultiArrayView<N, T2, S2> dest,
+                            MultiArrayView<N, T3, S3> mean, bool writeMean,
+                            typename MultiArrayShape<N>::type const & radius,
+                            ParallelOptions const & options)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
     using namespace functor;
-    integralMultiArray(array, intarray, sq(Arg1()));
+
+    vigra_precondition(src.shape() == dest.shape() && src.shape() == mean.shape(),
+        "localVarianceMultiArray(): shape mismatch between input and output.");
+    vigra_precondition(min(radius) >= 0,
+        "localVarianceMultiArray(): radius must be non-negative.");
+
+    double offset = src.template sum<double>() / src.size();
+
+    MultiArray<N, double> sums(src.shape() + Shape(1)),
+                          squares(src.shape() + Shape(1));
+    integralMultiArray(src, sums.subarray(Shape(1), sums.shape()),
+                       Arg1() - Param(offset), options);
+    integralMultiArray(src, squares.subarray(Shape(1), squares.shape()),
+                       sq(Arg1() - Param(offset)), options);
+
+    MultiArrayIndex width = src.shape(0);
+    ArrayVector<double> s1(width), s2(width), counts(width);
+    integralBoxFilter(src.shape(), radius, options,
+        [=, &sums, &squares, &dest, &mean](Shape const & p, Shape const & lo, Shape const & hi) mutable
+        {
+            integralBoxLine(sums, lo, hi, width, radius[0], s1.begin(), counts.begin());
+            integralBoxLine(squares, lo, hi, width, radius[0], s2.begin(), counts.begin());
+            T2 * d = &dest[p];
+            T3 * m = &mean[p];
+            for(MultiArrayIndex x = 0; x < width; ++x)
+            {
+                double m1 = s1[x] / counts[x];
+                d[x*dest.stride(0)] = RequiresExplicitCast<T2>::cast(std::max(s2[x] / counts[x] - m1*m1, 0.0));
+                if(writeMean)
+                    m[x*mean.stride(0)] = RequiresExplicitCast<T3>::cast(m1 + offset);
+            }
+        });
+}
+
+} // namespace detail
+
+/** \brief Variance of the elements in a box-shaped window of arbitrary size.
+
+    Each element of <tt>dest</tt> receives the (population) variance of the elements
+    of <tt>src</tt> in the window <tt>[p - radius, p + radius]</tt> around the element's
+    position <tt>p</tt>, clipped at the array border as in \ref boxFilterMultiArray().
+    The variance is computed as the difference of the window means of the squares and
+    the squared window mean, using two integral arrays of type <tt>double</tt>. To reduce
+    cancellation, the global mean of <tt>src</tt> is subtracted beforehand, and
+    negative round-off results are set to zero. Optionally, the window means are
+    written to <tt>mean</tt>. <tt>src</tt> must be a scalar array.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1, class T2, class S2>
+        void
+        localVarianceMultiArray(MultiArrayView<N, T1, S1> const & src,
+                                MultiArrayView<N, T2, S2> dest,
+                                typename MultiArrayShape<N>::type const & radius,
+                                ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
+
+        template <unsigned int N, class T1, class S1, class T2, class S2>
+        void
+        localVarianceMultiArray(MultiArrayView<N, T1, S1> const & src,
+                                MultiArrayView<N, T2, S2> dest,
+                                MultiArrayIndex radius,
+                                ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
+
+        // additionally return the window means
+        template <unsigned int N, class T1, class S1, class T2, class S2, class T3, class S3>
+        void
+        localVarianceMultiArray(MultiArrayView<N, T1, S1> const & src,
+                                MultiArrayView<N, T2, S2> dest,
+                                MultiArrayView<N, T3, S3> mean,
+                                typename MultiArrayShape<N>::type const & radius,
+                                ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
+    }
+    \endcode
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/integral_image.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    MultiArray<2, float> image(Shape2(w, h)), variance(image.shape());
+    ...
+    localVarianceMultiArray(image, variance, 10);
+    \endcode
+
+    \see boxFilterMultiArray(), integralMultiArraySquared()
+*/
+doxygen_overloaded_function(template <...> void localVarianceMultiArray)
+
+template <unsigned int N, class T1, class S1, class T2, class S2, class T3, class S3>
+inline void
+localVarianceMultiArray(MultiArrayView<N, T1, S1> const & src,
+                        MultiArrayView<N, T2, S2> dest,
+                        MultiArrayView<N, T3, S3> mean,
+                        typename MultiArrayShape<N>::type const & radius,
+                        ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
+{
+    detail::localVarianceMultiArrayImpl(src, dest, mean, true, radius, options);
+}
+
+template <unsigned int N, class T1, class S1, class T2, class S2>
+inline void
+localVarianceMultiArray(MultiArrayView<N, T1, S1> const & src,
+                        MultiArrayView<N, T2, S2> dest,
+                        typename MultiArrayShape<N>::type const & radius,
+                        ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
+{
+    detail::localVarianceMultiArrayImpl(src, dest, dest, false, radius, options);
+}
+
+template <unsigned int N, class T1, class S1, class T2, class S2>
+inline void
+localVarianceMultiArray(MultiArrayView<N, T1, S1> const & src,
+                        MultiArrayView<N, T2, S2> dest,
+                        MultiArrayIndex radius,
+                        ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
+{
+    localVarianceMultiArray(src, dest, typename MultiArrayShape<N>::type(radius), options);
 }
 
 } // namespace vigra
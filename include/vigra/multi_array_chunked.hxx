@@ -129,7 +129,9 @@
 #ifndef VIGRA_MULTI_ARRAY_CHUNKED_HXX
 #define VIGRA_MULTI_ARRAY_CHUNKED_HXX
 
+#include <memory>
 #include <queue>
+#include <vector>
 #include <string>
 
 #include "multi_fwd.hxx"
@@ -138,6 +140,7 @@
 #include "memory.hxx"
 #include "metaprogramming.hxx"
 #include "threading.hxx"
+#include "threadpool.hxx"
 #include "compression.hxx"
 
 #ifdef _WIN32
@@ -357,15 +360,19 @@ class SharedChunkHandle
     SharedChunkHandle()
     : pointer_(0)
     , chunk_state_()
+    , recently_used_()
     {
         chunk_state_ = chunk_uninitialized;
+        recently_used_ = false;
     }
 
     SharedChunkHandle(SharedChunkHandle const & rhs)
     : pointer_(rhs.pointer_)
     , chunk_state_()
+    , recently_used_()
     {
         chunk_state_ = chunk_uninitialized;
+        recently_used_ = false;
     }
 
     shape_type const & strides() const
@@ -376,10 +383,48 @@ class SharedChunkHandle
     ChunkBase<N, T> * pointer_;
     mutable threading::atomic_long chunk_state_;
 
+    // reference bit of the cache's CLOCK replacement policy
+    mutable threading::atomic<bool> recently_used_;
+
   private:
     SharedChunkHandle & operator=(SharedChunkHandle const & rhs);
 };
 
+namespace detail {
+
+// One shard of the chunk cache of a ChunkedArray. It holds the cached chunks
+// in a ring which is scanned by the CLOCK replacement policy. Chunks are
+// distributed over the shards by their index, so that threads working on
+// different chunks rarely compete for the same lock.
+template <class Handle>
+struct ChunkCacheShard
+{
+    struct Entry
+    {
+        Handle * handle;
+        std::size_t bytes;
+    };
+
+    ChunkCacheShard()
+    : hand(0)
+    , hits(0)
+    , misses(0)
+    , evictions(0)
+    {}
+
+    threading::mutex lock;
+    std::vector<Entry> ring;
+    std::size_t hand;
+        // The statistics are updated on every access without holding the lock.
+        // They get cache lines of their own, so that counting a hit doesn't
+        // invalidate the line of the lock (or of a neighboring shard).
+    char pad_before_counters[64];
+    threading::atomic_long hits, misses, evictions;
+    char pad_after_counters[64];
+};
+
+} // namespace detail
+
 template <unsigned int N, class T>
 class ChunkedArrayBase
 {
@@ -423,6 +468,17 @@ class ChunkedArrayBase
         return false;
     }
 
+    // called by ChunkIterator to load the chunk 'chunk_index' in the background
+    // (the default implementation does nothing)
+    virtual void prefetchChunk(shape_type const & /* chunk_index */) const
+    {}
+
+    // number of chunks ChunkIterator shall prefetch ahead of its current position
+    virtual int readAhead() const
+    {
+        return 0;
+    }
+
     MultiArrayIndex size() const
     {
         return prod(shape_);
@@ -1272,7 +1328,9 @@ class ChunkedArrayOptions
     ChunkedArrayOptions()
     : fill_value(0.0)
     , cache_max(-1)
+    , cache_max_bytes(0)
     , compression_method(DEFAULT_COMPRESSION)
+    , read_ahead(0)
     {}
 
     /** \brief Element value for read-only access of uninitialized chunks.
@@ -1305,6 +1363,24 @@ class ChunkedArrayOptions
         return ChunkedArrayOptions(*this).cacheMax(v);
     }
 
+    /** \brief Maximum number of bytes occupied by the chunks in the cache.
+
+        When this limit is set and <tt>cacheMax()</tt> is left at its default,
+        the cache size is only limited by the number of bytes.
+
+        Default: 0 ( = no limit on the number of bytes)
+    */
+    ChunkedArrayOptions & cacheMaxBytes(std::size_t v)
+    {
+        cache_max_bytes = v;
+        return *this;
+    }
+
+    ChunkedArrayOptions cacheMaxBytes(std::size_t v) const
+    {
+        return ChunkedArrayOptions(*this).cacheMaxBytes(v);
+    }
+
     /** \brief Compress inactive chunks with the given method.
 
         Default: DEFAULT_COMPRESSION (depends on backend)
@@ -1320,9 +1396,30 @@ class ChunkedArrayOptions
         return ChunkedArrayOptions(*this).compression(v);
     }
 
+    /** \brief Number of chunks a \ref ChunkIterator loads ahead of its
+        current position.
+
+        The chunks are loaded by background tasks on <tt>ThreadPool::global()</tt>,
+        see <tt>ChunkedArray::prefetch()</tt>.
+
+        Default: 0 ( = no read-ahead)
+    */
+    ChunkedArrayOptions & readAhead(int v)
+    {
+        read_ahead = v;
+        return *this;
+    }
+
+    ChunkedArrayOptions readAhead(int v) const
+    {
+        return ChunkedArrayOptions(*this).readAhead(v);
+    }
+
     double fill_value;
     int cache_max;
+    std::size_t cache_max_bytes;
     CompressionMethod compression_method;
+    int read_ahead;
 };
 
 /** \weakgroup ParallelProcessing
@@ -1389,14 +1486,18 @@ Chunks can be in one of the following states:
 </ul>
 In-memory chunks (active and inactive) are placed in a cache. If a chunk
 transitions from the 'asleep' to the 'active' state, it is added to the cache,
-and an 'inactive' chunk is removed and sent 'asleep'. If there is no 'inactive'
-chunk in the cache, the cache size is temporarily increased. All state
-transitions are thread-safe.
+and an 'inactive' chunk is removed and sent 'asleep'. The victim is chosen by
+the CLOCK policy, an approximation of 'least recently used'. If there is
+no 'inactive' chunk in the cache, the cache size is temporarily increased.
+All state transitions are thread-safe. The cache is split into shards
+with separate locks, so that threads working on different chunks
+rarely wait for each other.
 
 In order to optimize performance, the user should adjust the cache size (via
-\ref setCacheMaxSize() or \ref ChunkedArrayOptions) so that it can hold all
-chunks that are frequently needed (e.g. all chunks forming a row of the full
-array).
+\ref setCacheMaxSize(), \ref setCacheMaxBytes() or \ref ChunkedArrayOptions)
+so that it can hold all chunks that are frequently needed (e.g. all chunks forming
+a row of the full array). The counters \ref cacheHits(), \ref cacheMisses() and
+\ref cacheEvictions() help to find a suitable size.
 
 Another performance critical parameter is the chunk shape. While the system
 uses sensible defaults (512<sup>2</sup> for 2D arrays, 64<sup>3</sup> for 3D,
@@ -1518,6 +1619,29 @@ appropriate element in the chunk), which causes the chunked view to
 be slower than an ordinary MultiArrayView. Second, all chunks intersected
 by the view must remain active throughout the view's lifetime, which
 may require a big chunk cache and thus keeps many chunks in memory.
+
+Loading a chunk that is asleep means I/O and/or decompression. To keep
+this off the critical path, chunks can be loaded in the background by
+tasks on the global \ref ThreadPool. Either request an ROI explicitly
+\code
+    // process the array in blocks, loading the next block while the current one is processed
+    chunked_array.prefetch(block_start[0], block_stop[0]);
+    for(int k=0; k<block_count; ++k)
+    {
+        if(k+1 < block_count)
+            chunked_array.prefetch(block_start[k+1], block_stop[k+1]);
+        process(chunked_array.subarray(block_start[k], block_stop[k]));
+    }
+\endcode
+or let the chunk iterator read ahead along its scan order:
+\code
+    chunked_array.setReadAhead(2); // or: ChunkedArrayOptions().readAhead(2)
+
+    for(auto chunk = chunked_array.chunk_begin(roi_start, roi_stop); chunk.isValid(); ++chunk)
+    {
+        ... // the next two chunks are loaded while this one is processed
+    }
+\endcode
 */
 template <unsigned int N, class T>
 class ChunkedArray
@@ -1613,7 +1737,10 @@ class ChunkedArray
     typedef ChunkBase<N, T> Chunk;
     typedef MultiArrayView<N, T, ChunkedArrayTag>                   view_type;
     typedef MultiArrayView<N, T const, ChunkedArrayTag>             const_view_type;
-    typedef std::queue<Handle*> CacheType;
+    typedef detail::ChunkCacheShard<Handle> CacheShard;
+
+    // number of independently locked parts of the cache (must be a power of 2)
+    static const int cache_shard_count = 16;
 
     static const long chunk_asleep = Handle::chunk_asleep;
     static const long chunk_uninitialized = Handle::chunk_uninitialized;
@@ -1628,16 +1755,24 @@ class ChunkedArray
     , bits_(initBitMask(this->chunk_shape_))
     , mask_(this->chunk_shape_ -shape_type(1))
     , cache_max_size_(options.cache_max)
+    , cache_max_bytes_(options.cache_max_bytes)
+    , cache_size_(0)
+    , cache_bytes_(0)
+    , cache_hand_(0)
     , chunk_lock_(new threading::mutex())
     , fill_value_(T(options.fill_value))
     , fill_scalar_(options.fill_value)
     , handle_array_(detail::computeChunkArrayShape(shape, bits_, mask_))
-    , data_bytes_()
+    , data_bytes_(0)
     , overhead_bytes_(handle_array_.size()*sizeof(Handle))
+    , read_ahead_(options.read_ahead)
+    , prefetch_tasks_(new PrefetchTasks)
     {
         fill_value_chunk_.pointer_ = &fill_value_;
         fill_value_handle_.pointer_ = &fill_value_chunk_;
         fill_value_handle_.chunk_state_.store(1);
+        for(int k=0; k<cache_shard_count; ++k)
+            cache_shards_.emplace_back(new CacheShard);
     }
 
     // compute masks needed for fast index access
@@ -1659,11 +1794,66 @@ class ChunkedArray
         // std::cerr << "    final cache size: " << cacheSize() << " (max: " << cacheMaxSize() << ")\n";
     }
 
-    /** \brief Number of chunks currently fitting into the cache.
+    /** \brief Number of chunks currently in the cache.
     */
     int cacheSize() const
     {
-        return cache_.size();
+        return (int)cache_size_.load();
+    }
+
+    /** \brief Number of data bytes of the chunks currently in the cache.
+    */
+    std::size_t cacheBytes() const
+    {
+        return cache_bytes_.load();
+    }
+
+    /** \brief Number of chunk requests that found the chunk in memory.
+
+        Chunks are requested whenever an iterator, view, or element access
+        enters a chunk.
+    */
+    std::size_t cacheHits() const
+    {
+        std::size_t res = 0;
+        for(int k=0; k<cache_shard_count; ++k)
+            res += cache_shards_[k]->hits.load();
+        return res;
+    }
+
+    /** \brief Number of chunk requests that had to load (or initialize)
+        the chunk.
+    */
+    std::size_t cacheMisses() const
+    {
+        std::size_t res = 0;
+        for(int k=0; k<cache_shard_count; ++k)
+            res += cache_shards_[k]->misses.load();
+        return res;
+    }
+
+    /** \brief Number of chunks the cache sent asleep to make room for
+        other chunks.
+    */
+    std::size_t cacheEvictions() const
+    {
+        std::size_t res = 0;
+        for(int k=0; k<cache_shard_count; ++k)
+            res += cache_shards_[k]->evictions.load();
+        return res;
+    }
+
+    /** \brief Reset the counters of cacheHits(), cacheMisses() and
+        cacheEvictions() to zero.
+    */
+    void resetCacheStatistics()
+    {
+        for(int k=0; k<cache_shard_count; ++k)
+        {
+            cache_shards_[k]->hits.store(0);
+            cache_shards_[k]->misses.store(0);
+            cache_shards_[k]->evictions.store(0);
+        }
     }
 
     /** \brief Bytes of main memory occupied by the array's data.
@@ -1850,10 +2040,7 @@ class ChunkedArray
             unrefChunk(chunks[k]);
 
         if(cacheMaxSize() > 0)
-        {
-            threading::lock_guard<threading::mutex> guard(*chunk_lock_);
-            cleanCache(cache_.size());
-        }
+            cleanCache(cacheSize());
     }
 
     // Increase the reference counter of the given chunk.
@@ -1904,9 +2091,19 @@ class ChunkedArray
 
         long rc = acquireRef(handle);
         if(rc >= 0)
+        {
+            if(handle != &fill_value_handle_)
+            {
+                cacheShard(handle).hits.fetch_add(1, threading::memory_order_relaxed);
+                // avoid writing to the shared cache line when the bit is already set
+                if(!handle->recently_used_.load(threading::memory_order_relaxed))
+                    handle->recently_used_.store(true, threading::memory_order_relaxed);
+            }
             return handle->pointer_->pointer_;
+        }
 
-        threading::lock_guard<threading::mutex> guard(*chunk_lock_);
+        // We own the chunk now (its state is 'chunk_locked'), so we can load it without
+        // holding a lock. Backends protect shared resources (e.g. files) themselves.
         try
         {
             T * p = self->loadChunk(&handle->pointer_, chunk_index);
@@ -1914,15 +2111,39 @@ class ChunkedArray
             if(!isConst && rc == chunk_uninitialized)
                 std::fill(p, p + prod(chunkShape(chunk_index)), this->fill_value_);
 
-            self->data_bytes_ += dataBytes(chunk);
+            std::size_t bytes = dataBytes(chunk);
+            self->data_bytes_ += bytes;
+
+            CacheShard & shard = self->cacheShard(handle);
+            shard.misses.fetch_add(1, threading::memory_order_relaxed);
+            // the reference bit is only set by later hits, so that chunks
+            // accessed just once (e.g. in a sequential scan) are evicted first
+            handle->recently_used_.store(false, threading::memory_order_relaxed);
 
             if(cacheMaxSize() > 0 && insertInCache)
             {
-                // insert in queue of mapped chunks
-                self->cache_.push(handle);
+                // insert in the ring of mapped chunks
+                {
+                    threading::lock_guard<threading::mutex> guard(shard.lock);
+                    typename CacheShard::Entry entry = { handle, bytes };
+                    shard.ring.push_back(entry);
+                    if(&shard == cache_shards_[cache_hand_.load() & (cache_shard_count - 1)].get())
+                    {
+                        // the hand is currently in this shard => put the chunk just
+                        // behind the hand, so that the next sweep examines it last
+                        std::size_t last = shard.ring.size() - 1;
+                        if(shard.hand < last)
+                            std::swap(shard.ring[shard.hand], shard.ring[last]);
+                        else
+                            shard.hand = last;
+                        ++shard.hand;
+                    }
+                }
+                ++self->cache_size_;
+                self->cache_bytes_ += bytes;
 
                 // do cache management if cache is full
-                // (note that we still hold the chunk_lock_)
+                // (the present chunk is still locked and won't be evicted)
                 self->cleanCache(2);
             }
             handle->chunk_state_.store(1, threading::memory_order_release);
@@ -1989,54 +2210,138 @@ class ChunkedArray
         return chunkForIteratorImpl(point, strides, upper_bound, h, true);
     }
 
-    // NOTE: This function must only be called while we hold the chunk_lock_.
-    //       This implies refcount != chunk_locked, so that race conditions are avoided.
+    // NOTE: This function must only be called while we hold the lock of the
+    //       handle's cache shard, so that the handle is not concurrently evicted.
     long releaseChunk(Handle * handle, bool destroy = false)
     {
-        long rc = 0;
-        bool mayUnload = handle->chunk_state_.compare_exchange_strong(rc, chunk_locked);
-        if(!mayUnload && destroy)
+        long rc;
+        if(claimChunk(handle, destroy, rc))
+            unloadClaimedChunk(handle, destroy);
+        return rc;
+    }
+
+    // Lock the chunk for unloading if its refcount is zero (or, when 'destroy'
+    // is true, if it is asleep). 'rc' receives the chunk's previous state.
+    bool claimChunk(Handle * handle, bool destroy, long & rc) const
+    {
+        rc = 0;
+        if(handle->chunk_state_.compare_exchange_strong(rc, chunk_locked))
+            return true;
+        if(!destroy)
+            return false;
+        rc = chunk_asleep;
+        return handle->chunk_state_.compare_exchange_strong(rc, chunk_locked);
+    }
+
+    // Unload a chunk locked by claimChunk(). Since other threads just wait
+    // until the chunk is unlocked, this doesn't require the cache shard's lock.
+    void unloadClaimedChunk(Handle * handle, bool destroy)
+    {
+        try
         {
-            rc = chunk_asleep;
-            mayUnload = handle->chunk_state_.compare_exchange_strong(rc, chunk_locked);
+            vigra_invariant(handle != &fill_value_handle_,
+               "ChunkedArray::releaseChunk(): attempt to release fill_value_handle_.");
+            Chunk * chunk = handle->pointer_;
+            this->data_bytes_ -= dataBytes(chunk);
+            int didDestroy = unloadChunk(chunk, destroy);
+            this->data_bytes_ += dataBytes(chunk);
+            if(didDestroy)
+                handle->chunk_state_.store(chunk_uninitialized);
+            else
+                handle->chunk_state_.store(chunk_asleep);
         }
-        if(mayUnload)
+        catch(...)
         {
-            // refcount was zero or chunk_asleep => can unload
-            try
-            {
-                vigra_invariant(handle != &fill_value_handle_,
-                   "ChunkedArray::releaseChunk(): attempt to release fill_value_handle_.");
-                Chunk * chunk = handle->pointer_;
-                this->data_bytes_ -= dataBytes(chunk);
-                int didDestroy = unloadChunk(chunk, destroy);
-                this->data_bytes_ += dataBytes(chunk);
-                if(didDestroy)
-                    handle->chunk_state_.store(chunk_uninitialized);
-                else
-                    handle->chunk_state_.store(chunk_asleep);
-            }
-            catch(...)
-            {
-                handle->chunk_state_.store(chunk_failed);
-                throw;
-            }
+            handle->chunk_state_.store(chunk_failed);
+            throw;
         }
-        return rc;
     }
 
-    // NOTE: this function must only be called while we hold the chunk_lock_
+    CacheShard & cacheShard(Handle const * handle) const
+    {
+        return *cache_shards_[(handle - handle_array_.data()) & (cache_shard_count - 1)];
+    }
+
+    bool cacheIsOverfull() const
+    {
+        return (std::size_t)cache_size_.load() > cacheMaxSize() ||
+               (cache_max_bytes_ > 0 && cache_bytes_.load() > cache_max_bytes_);
+    }
+
+    // NOTE: this function must only be called while we hold shard.lock
+    void removeCacheEntry(CacheShard & shard, std::size_t k)
+    {
+        --cache_size_;
+        cache_bytes_ -= shard.ring[k].bytes;
+        shard.ring[k] = shard.ring.back();
+        shard.ring.pop_back();
+    }
+
+    // Send up to 'how_many' inactive chunks asleep until the cache is no
+    // longer overfull. Victims are chosen by the CLOCK policy: a hand moves
+    // around the rings of all shards, clears the reference bits of recently
+    // used chunks (giving them a second chance), and evicts the first inactive
+    // chunk whose bit is not set. The next call continues where the hand stopped.
+    // Only the shard under the hand has a non-zero position 'shard.hand'.
+    // A victim is claimed and removed from its ring under the shard's lock, but
+    // unloaded (e.g. compressed) after the lock is released, so that threads
+    // evicting chunks at the same time (e.g. in commitSubarray()) work in parallel.
     void cleanCache(int how_many = -1)
     {
         if(how_many == -1)
-            how_many = cache_.size();
-        for(; cache_.size() > cacheMaxSize() && how_many > 0; --how_many)
+            how_many = cacheSize();
+        // visit each shard twice (and the first one a third time), so that
+        // every entry is seen again after its reference bit was cleared
+        for(int s = 0; s <= 2*cache_shard_count && how_many > 0 && cacheIsOverfull(); )
         {
-            Handle * handle = cache_.front();
-            cache_.pop();
-            long rc = releaseChunk(handle);
-            if(rc > 0) // refcount was positive => chunk is still needed
-                cache_.push(handle);
+            long current = cache_hand_.load();
+            CacheShard & shard = *cache_shards_[current & (cache_shard_count - 1)];
+            Handle * victim = 0;
+            {
+                threading::lock_guard<threading::mutex> guard(shard.lock);
+                while(victim == 0 && shard.hand < shard.ring.size() && cacheIsOverfull())
+                {
+                    Handle * handle = shard.ring[shard.hand].handle;
+                    long state = handle->chunk_state_.load();
+                    if(state < 0 && state != chunk_locked)
+                    {
+                        // chunk is no longer in memory (e.g. after a failure)
+                        removeCacheEntry(shard, shard.hand);
+                    }
+                    else if(state != 0 || handle->recently_used_.exchange(false))
+                    {
+                        // chunk is in use or was recently used => second chance
+                        ++shard.hand;
+                    }
+                    else if(claimChunk(handle, false, state))
+                    {
+                        removeCacheEntry(shard, shard.hand);
+                        victim = handle;
+                    }
+                    else
+                    {
+                        // chunk was acquired in the meantime
+                        ++shard.hand;
+                    }
+                }
+                if(victim == 0)
+                {
+                    if(shard.hand < shard.ring.size())
+                        break;
+                    shard.hand = 0;
+                }
+            }
+            if(victim != 0)
+            {
+                // the hand stays in this shard
+                unloadClaimedChunk(victim, false);
+                shard.evictions.fetch_add(1, threading::memory_order_relaxed);
+                --how_many;
+                continue;
+            }
+            // move on to the next shard (unless another thread already did)
+            cache_hand_.compare_exchange_strong(current, current + 1);
+            ++s;
         }
     }
 
@@ -2047,38 +2352,58 @@ class ChunkedArray
         Currently, chunks retain their values when sent asleep, and assume the
         array's fill_value when deleted, but applications should not rely on this
         behavior.
+
+        The chunks are unloaded (e.g. compressed) in parallel, using the thread pool
+        or number of threads given in 'options' (default: all threads of
+        <tt>ThreadPool::global()</tt>).
     */
-    void releaseChunks(shape_type const & start, shape_type const & stop, bool destroy = false)
+    void releaseChunks(shape_type const & start, shape_type const & stop, bool destroy = false,
+                       ParallelOptions const & options = ParallelOptions())
     {
         checkSubarrayBounds(start, stop, "ChunkedArray::releaseChunks()");
 
-        MultiCoordinateIterator<N> i(chunkStart(start), chunkStop(stop)),
+        // (the iterator's coordinates are relative to chunk_start)
+        shape_type chunk_start(chunkStart(start));
+        MultiCoordinateIterator<N> i(chunk_start, chunkStop(stop)),
                                    end(i.getEndIterator());
+        ArrayVector<Handle *> handles;
         for(; i != end; ++i)
         {
-            shape_type chunkOffset = *i * this->chunk_shape_;
+            shape_type chunk_index(*i + chunk_start);
+            shape_type chunkOffset = chunk_index * this->chunk_shape_;
             if(!allLessEqual(start, chunkOffset) ||
                !allLessEqual(min(chunkOffset+this->chunk_shape_, this->shape()), stop))
             {
                 // chunk is only partially covered by the ROI
                 continue;
             }
-
-            Handle * handle = this->lookupHandle(*i);
-            threading::lock_guard<threading::mutex> guard(*chunk_lock_);
-            releaseChunk(handle, destroy);
+            handles.push_back(this->lookupHandle(chunk_index));
         }
 
-        // remove all chunks from the cache that are asleep or unitialized
-        threading::lock_guard<threading::mutex> guard(*chunk_lock_);
-        int cache_size = cache_.size();
-        for(int k=0; k < cache_size; ++k)
-        {
-            Handle * handle = cache_.front();
-            cache_.pop();
-            if(handle->chunk_state_.load() >= 0)
-                cache_.push(handle);
-        }
+        forEachChunkIndex(options, (std::ptrdiff_t)handles.size(),
+            [this, &handles, destroy](std::size_t, std::ptrdiff_t k)
+            {
+                Handle * handle = handles[k];
+                CacheShard & shard = cacheShard(handle);
+                {
+                    threading::lock_guard<threading::mutex> guard(shard.lock);
+                    long rc;
+                    if(!claimChunk(handle, destroy, rc))
+                        return;
+
+                    // remove the chunk from the cache, so that the lock needn't
+                    // be held while the chunk is unloaded
+                    for(std::size_t j=0; j < shard.ring.size(); ++j)
+                    {
+                        if(shard.ring[j].handle == handle)
+                        {
+                            removeCacheEntry(shard, j);
+                            break;
+                        }
+                    }
+                }
+                unloadClaimedChunk(handle, destroy);
+            });
     }
 
     /** \brief Copy an ROI of the chunked array into an ordinary MultiArrayView.
@@ -2086,21 +2411,29 @@ class ChunkedArray
         The ROI's lower bound is given by 'start', its upper bound (in 'beyond' sense)
         is 'start + subarray.shape()'. Chunks in the ROI are only activated while
         the read is in progress.
+
+        The chunks are loaded (e.g. decompressed) and copied in parallel, using
+        the thread pool or number of threads given in 'options' (default: all
+        threads of <tt>ThreadPool::global()</tt>). When the ROI lies in a single
+        chunk or 'options' request at most one thread, the copy is done on the
+        calling thread without involving the pool.
     */
     template <class U, class Stride>
     void
     checkoutSubarray(shape_type const & start,
-                     MultiArrayView<N, U, Stride> & subarray) const
+                     MultiArrayView<N, U, Stride> & subarray,
+                     ParallelOptions const & options = ParallelOptions()) const
     {
         shape_type stop   = start + subarray.shape();
 
         checkSubarrayBounds(start, stop, "ChunkedArray::checkoutSubarray()");
 
-        chunk_const_iterator i = chunk_cbegin(start, stop);
-        for(; i.isValid(); ++i)
-        {
-            subarray.subarray(i.chunkStart()-start, i.chunkStop()-start) = *i;
-        }
+        forEachChunk(start, stop, true, options,
+            [&subarray, &start](MultiArrayView<N, T> const & chunk,
+                                shape_type const & chunk_start, shape_type const & chunk_stop)
+            {
+                subarray.subarray(chunk_start-start, chunk_stop-start) = chunk;
+            });
     }
 
     /** \brief Copy an ordinary MultiArrayView into an ROI of the chunked array.
@@ -2108,11 +2441,16 @@ class ChunkedArray
         The ROI's lower bound is given by 'start', its upper bound (in 'beyond' sense)
         is 'start + subarray.shape()'. Chunks in the ROI are only activated while
         the write is in progress.
+
+        The chunks are processed in parallel as in checkoutSubarray(). Chunks that
+        don't fit into the cache are therefore compressed concurrently when
+        they are evicted.
     */
     template <class U, class Stride>
     void
     commitSubarray(shape_type const & start,
-                   MultiArrayView<N, U, Stride> const & subarray)
+                   MultiArrayView<N, U, Stride> const & subarray,
+                   ParallelOptions const & options = ParallelOptions())
     {
         shape_type stop   = start + subarray.shape();
 
@@ -2120,10 +2458,76 @@ class ChunkedArray
                            "ChunkedArray::commitSubarray(): array is read-only.");
         checkSubarrayBounds(start, stop, "ChunkedArray::commitSubarray()");
 
-        chunk_iterator i = chunk_begin(start, stop);
-        for(; i.isValid(); ++i)
+        forEachChunk(start, stop, false, options,
+            [&subarray, &start](MultiArrayView<N, T> chunk,
+                                shape_type const & chunk_start, shape_type const & chunk_stop)
+            {
+                chunk = subarray.subarray(chunk_start-start, chunk_stop-start);
+            });
+    }
+
+    // helper function for checkoutSubarray() and commitSubarray():
+    // call f(view, chunk_start, chunk_stop) in parallel for the part of each
+    // chunk that intersects the ROI, while the chunk is active
+    template <class FUNCTOR>
+    void forEachChunk(shape_type const & start, shape_type const & stop,
+                      bool isConst, ParallelOptions const & options,
+                      FUNCTOR const & f) const
+    {
+        ChunkedArray * self = const_cast<ChunkedArray *>(this);
+        shape_type chunk_start(chunkStart(start)),
+                   chunks(chunkStop(stop) - chunk_start);
+
+        forEachChunkIndex(options, prod(chunks),
+            [&](std::size_t, std::ptrdiff_t k)
+            {
+                shape_type chunk_index(SkipInitialization);
+                detail::ScanOrderToCoordinate<N>::exec(k, chunks, chunk_index);
+                chunk_index += chunk_start;
+
+                bool insertInCache = true;
+                Handle * handle = self->lookupHandle(chunk_index);
+                if(isConst && handle->chunk_state_.load() == chunk_uninitialized)
+                {
+                    handle = &self->fill_value_handle_;
+                    insertInCache = false;
+                }
+
+                pointer p = getChunk(handle, isConst, insertInCache, chunk_index);
+                try
+                {
+                    shape_type offset = chunk_index * this->chunk_shape_,
+                               roi_start = max(start, offset),
+                               roi_stop = min(stop, offset + this->chunk_shape_);
+                    f(MultiArrayView<N, T>(roi_stop - roi_start, handle->strides(),
+                                           p + dot(roi_start - offset, handle->strides())),
+                      roi_start, roi_stop);
+                }
+                catch(...)
+                {
+                    unrefChunk(handle);
+                    throw;
+                }
+                unrefChunk(handle);
+            });
+    }
+
+    // helper function for forEachChunk() and releaseChunks(): call f(0, k) for
+    // k in [0, n) sequentially when only a single chunk is involved or the
+    // options resolve to one thread, so that small ROIs don't pay for the
+    // round trip through the thread pool, and use parallel_foreach() otherwise
+    template <class FUNCTOR>
+    static void forEachChunkIndex(ParallelOptions const & options, std::ptrdiff_t n,
+                                  FUNCTOR const & f)
+    {
+        if(n <= 1 || options.getNumThreads() <= 1)
+        {
+            for(std::ptrdiff_t k = 0; k < n; ++k)
+                f(0, k);
+        }
+        else
         {
-            *i = subarray.subarray(i.chunkStart()-start, i.chunkStop()-start);
+            parallel_foreach(options, n, f);
         }
     }
 
@@ -2150,20 +2554,21 @@ class ChunkedArray
         Unref * unref = new Unref(view.chunks_.size(), self);
         view.unref_ = VIGRA_SHARED_PTR<Unref>(unref);
 
+        // (the iterator's coordinates are relative to chunk_start)
         MultiCoordinateIterator<N> i(chunk_start, chunk_stop),
                                    end(i.getEndIterator());
         for(; i != end; ++i)
         {
-            Handle * handle = self->lookupHandle(*i);
+            shape_type chunk_index(*i + chunk_start);
+            Handle * handle = self->lookupHandle(chunk_index);
 
             if(isConst && handle->chunk_state_.load() == chunk_uninitialized)
                 handle = &self->fill_value_handle_;
 
-            // This potentially acquires the chunk_lock_ in each iteration.
-            // Would it be better to acquire it once before the loop?
-            pointer p = getChunk(handle, isConst, true, *i);
+            // This potentially loads a chunk in each iteration.
+            pointer p = getChunk(handle, isConst, true, chunk_index);
 
-            ChunkBase<N, T> * mini_chunk = &view.chunks_[*i - chunk_start];
+            ChunkBase<N, T> * mini_chunk = &view.chunks_[*i];
             mini_chunk->pointer_ = p;
             mini_chunk->strides_ = handle->strides();
             unref->chunks_[i.scanOrderIndex()] = handle;
@@ -2357,7 +2762,9 @@ class ChunkedArray
     std::size_t cacheMaxSize() const
     {
         if(cache_max_size_ < 0)
-            const_cast<int &>(cache_max_size_) = detail::defaultCacheSize(this->chunkArrayShape());
+            const_cast<int &>(cache_max_size_) = cache_max_bytes_ > 0
+                                                    ? (int)handle_array_.size()
+                                                    : detail::defaultCacheSize(this->chunkArrayShape());
         return cache_max_size_;
     }
 
@@ -2369,11 +2776,144 @@ class ChunkedArray
     void setCacheMaxSize(std::size_t c)
     {
         cache_max_size_ = c;
-        if(c < cache_.size())
-        {
-            threading::lock_guard<threading::mutex> guard(*chunk_lock_);
+        if(cacheIsOverfull())
+            cleanCache();
+    }
+
+    /** \brief Get the maximum number of data bytes the cache will hold
+        (0 means no limit).
+    */
+    std::size_t cacheMaxBytes() const
+    {
+        return cache_max_bytes_;
+    }
+
+    /** \brief Set the maximum number of data bytes the cache will hold.
+
+        This limit applies in addition to cacheMaxSize(). It is more convenient when
+        the memory budget of an application is known, because chunks may differ
+        in size. Passing 0 removes the limit.
+    */
+    void setCacheMaxBytes(std::size_t b)
+    {
+        cache_max_bytes_ = b;
+        if(cacheIsOverfull())
             cleanCache();
+    }
+
+    /** \brief Load the chunks intersecting the given ROI in the background.
+
+        The function returns immediately. The chunks are loaded by tasks on
+        <tt>ThreadPool::global()</tt> and put into the cache, so that later
+        accesses find them in memory. This allows to overlap I/O and decompression
+        with computation, e.g. by prefetching the next block of a blockwise
+        algorithm while the current one is processed. Only chunks which are
+        currently asleep are loaded (active chunks are already in memory, and
+        uninitialized ones hold no data). The ROI should fit into the cache
+        (see setCacheMaxSize()), otherwise prefetched chunks may be evicted again
+        before they are used.
+
+        If loading a chunk fails, the chunk is marked as failed, and the error
+        is reported by the next regular access.
+    */
+    void prefetch(shape_type const & start, shape_type const & stop) const
+    {
+        checkSubarrayBounds(start, stop, "ChunkedArray::prefetch()");
+
+        // (the iterator's coordinates are relative to chunk_start)
+        shape_type chunk_start(chunkStart(start));
+        MultiCoordinateIterator<N> i(chunk_start, chunkStop(stop)),
+                                   end(i.getEndIterator());
+        for(; i != end; ++i)
+            prefetchChunk(chunk_start + *i);
+    }
+
+    /** \brief Wait until all chunks requested by prefetch() (or by the
+        read-ahead of a \ref ChunkIterator) are loaded.
+
+        The destructors of the derived classes call this function, so that
+        no background task accesses the array after its destruction.
+    */
+    void waitPrefetch() const
+    {
+        std::vector<threading::future<void> > futures;
+        {
+            threading::lock_guard<threading::mutex> guard(prefetch_tasks_->lock);
+            futures.swap(prefetch_tasks_->futures);
+        }
+        for(std::size_t k = 0; k < futures.size(); ++k)
+        {
+            // When called from a worker of the pool, the task may be queued at this
+            // very worker. Then, runPendingTask() executes it instead of blocking.
+            // Otherwise, it returns false, and we wait until the task is finished.
+            while(futures[k].wait_for(threading::chrono::seconds(0)) != threading::future_status::ready)
+            {
+                if(!ThreadPool::global().runPendingTask())
+                    futures[k].wait();
+            }
+        }
+    }
+
+    // load a single chunk in the background (see prefetch())
+    virtual void prefetchChunk(shape_type const & chunk_index) const
+    {
+        ChunkedArray * self = const_cast<ChunkedArray *>(this);
+        Handle * handle = self->lookupHandle(chunk_index);
+        if(cacheMaxSize() == 0 || handle->chunk_state_.load() != chunk_asleep)
+            return;
+
+        threading::future<void> future = ThreadPool::global().enqueue(
+            [self, handle, chunk_index](int)
+            {
+                try
+                {
+                    // the chunk may have been activated in the meantime
+                    if(handle->chunk_state_.load() == chunk_asleep)
+                    {
+                        self->getChunk(handle, true, true, chunk_index);
+                        self->unrefChunk(handle);
+                    }
+                }
+                catch(...)
+                {
+                    // getChunk() marked the chunk as failed
+                }
+            });
+
+        threading::lock_guard<threading::mutex> guard(prefetch_tasks_->lock);
+        std::vector<threading::future<void> > & futures = prefetch_tasks_->futures;
+        // drop the futures of finished tasks whenever the size doubled
+        if(futures.size() >= 64 && (futures.size() & (futures.size() - 1)) == 0)
+        {
+            std::size_t k = 0;
+            for(std::size_t j = 0; j < futures.size(); ++j)
+                if(futures[j].wait_for(threading::chrono::seconds(0)) != threading::future_status::ready)
+                    futures[k++] = std::move(futures[j]);
+            futures.resize(k);
         }
+        futures.push_back(std::move(future));
+    }
+
+    /** \brief Get the number of chunks a \ref ChunkIterator prefetches ahead
+        of its current position (see ChunkedArrayOptions::readAhead()).
+    */
+    virtual int readAhead() const
+    {
+        return read_ahead_;
+    }
+
+    /** \brief Set the number of chunks a \ref ChunkIterator prefetches ahead
+        of its current position.
+
+        When iterating over the chunks of an ROI, the next <tt>n</tt> chunks in
+        scan order are loaded in the background by prefetch(), so that sequential
+        passes over large arrays don't stall on I/O or decompression. The
+        cache should be able to hold at least <tt>n+1</tt> chunks.
+        Default: 0 (no read-ahead).
+    */
+    void setReadAhead(int n)
+    {
+        read_ahead_ = n;
     }
 
     /** \brief Create a scan-order iterator for the entire chunked array.
@@ -2475,14 +3015,28 @@ class ChunkedArray
 
     shape_type bits_, mask_;
     int cache_max_size_;
+    std::size_t cache_max_bytes_;
+    threading::atomic_long cache_size_;
+    threading::atomic<std::size_t> cache_bytes_;
+    std::vector<std::unique_ptr<CacheShard> > cache_shards_;
+    threading::atomic_long cache_hand_;
+    // protects resources shared by all chunks of a backend (e.g. the HDF5 file)
     VIGRA_SHARED_PTR<threading::mutex> chunk_lock_;
-    CacheType cache_;
     Chunk fill_value_chunk_;
     Handle fill_value_handle_;
     value_type fill_value_;
     double fill_scalar_;
     MultiArray<N, Handle> handle_array_;
-    std::size_t data_bytes_, overhead_bytes_;
+    threading::atomic<std::size_t> data_bytes_, overhead_bytes_;
+    int read_ahead_;
+
+        // futures of the background tasks started by prefetchChunk()
+    struct PrefetchTasks
+    {
+        threading::mutex lock;
+        std::vector<threading::future<void> > futures;
+    };
+    VIGRA_SHARED_PTR<PrefetchTasks> prefetch_tasks_;
 };
 
 /** Returns a CoupledScanOrderIterator to simultaneously iterate over image m1 and its coordinates.
@@ -2754,6 +3308,7 @@ class ChunkedArrayLazy
 
     ~ChunkedArrayLazy()
     {
+        this->waitPrefetch();
         typename ChunkStorage::iterator i   = this->handle_array_.begin(),
                                         end = this->handle_array_.end();
         for(; i != end; ++i)
@@ -2801,6 +3356,21 @@ class ChunkedArrayLazy
     Alloc alloc_;
 };
 
+namespace detail {
+
+// size of the scalar type of T, which determines the operation
+// of the compression pre-filters
+template <class T>
+inline std::size_t compressionElementSize()
+{
+    typedef typename ExpandElementResult<T>::type Scalar;
+    return IsSameType<Scalar, UnsuitableTypeForExpandElements>::value
+               ? sizeof(T)
+               : sizeof(Scalar);
+}
+
+} // namespace detail
+
 /** \weakgroup ParallelProcessing
     \sa ChunkedArrayCompressed
 */
@@ -2862,7 +3432,8 @@ class ChunkedArrayCompressed
                 vigra_invariant(compressed_.size() == 0,
                     "ChunkedArrayCompressed::Chunk::compress(): compressed and uncompressed pointer are both non-zero.");
 
-                ::vigra::compress((char const *)this->pointer_, size_*sizeof(T), compressed_, method);
+                ::vigra::compress((char const *)this->pointer_, size_*sizeof(T), compressed_, method,
+                                  detail::compressionElementSize<T>());
 
                 // std::cerr << "compression ratio: " << double(compressed_.size())/(this->size()*sizeof(T)) << "\n";
                 detail::destroy_dealloc_n(this->pointer_, size_, alloc_);
@@ -2879,7 +3450,8 @@ class ChunkedArrayCompressed
                     this->pointer_ = alloc_.allocate((typename Alloc::size_type)size_);
 
                     ::vigra::uncompress(compressed_.data(), compressed_.size(),
-                                        (char*)this->pointer_, size_*sizeof(T), method);
+                                        (char*)this->pointer_, size_*sizeof(T), method,
+                                        detail::compressionElementSize<T>());
                     compressed_.clear();
                 }
                 else
@@ -2918,8 +3490,14 @@ class ChunkedArrayCompressed
         <li>ZLIB_FAST: Fast compression using 'zlib' (slower than LZ4, but higher compression).
         <li>ZLIB_BEST: Best compression using 'zlib', slow.
         <li>ZLIB_NONE: Use 'zlib' format without compression.
+        <li>ZSTD_FAST, ZSTD, ZSTD_BEST: Zstandard compression (if VIGRA was
+            compiled with libzstd). Ratios similar to 'zlib' at much higher speed.
         <li>DEFAULT_COMPRESSION: Same as LZ4.
         </ul>
+        Each method can be combined with the pre-filters SHUFFLE or BITSHUFFLE,
+        e.g. <tt>LZ4 | SHUFFLE</tt>, which usually improves compression of
+        multi-byte data considerably. Additional codecs can be added via
+        \ref registerCompressionCodec().
     */
     explicit ChunkedArrayCompressed(shape_type const & shape,
                                     shape_type const & chunk_shape=shape_type(),
@@ -2933,6 +3511,7 @@ class ChunkedArrayCompressed
 
     ~ChunkedArrayCompressed()
     {
+        this->waitPrefetch();
         typename ChunkStorage::iterator i   = this->handle_array_.begin(),
                                         end = this->handle_array_.end();
         for(; i != end; ++i)
@@ -2964,21 +3543,7 @@ class ChunkedArrayCompressed
 
     virtual std::string backend() const
     {
-        switch(compression_method_)
-        {
-          case ZLIB:
-            return "ChunkedArrayCompressed<ZLIB>";
-          case ZLIB_NONE:
-            return "ChunkedArrayCompressed<ZLIB_NONE>";
-          case ZLIB_FAST:
-            return "ChunkedArrayCompressed<ZLIB_FAST>";
-          case ZLIB_BEST:
-            return "ChunkedArrayCompressed<ZLIB_BEST>";
-          case LZ4:
-            return "ChunkedArrayCompressed<LZ4>";
-          default:
-            return "unknown";
-        }
+        return "ChunkedArrayCompressed<" + compressionMethodName(compression_method_) + ">";
     }
 
     virtual std::size_t dataBytes(ChunkBase<N,T> * c) const
@@ -3187,6 +3752,7 @@ class ChunkedArrayTmpFile
 
     ~ChunkedArrayTmpFile()
     {
+        this->waitPrefetch();
         typename ChunkStorage::iterator  i = this->handle_array_.begin(),
                                          end = this->handle_array_.end();
         for(; i != end; ++i)
@@ -3210,6 +3776,7 @@ class ChunkedArrayTmpFile
             shape_type shape = this->chunkShape(index);
             std::size_t chunk_size = computeAllocSize(shape);
         #ifdef VIGRA_NO_SPARSE_FILE
+            threading::lock_guard<threading::mutex> guard(*this->chunk_lock_);
             std::size_t offset = file_size_;
             if(offset + chunk_size > file_capacity_)
             {
@@ -3263,6 +3830,270 @@ class ChunkedArrayTmpFile
     std::size_t file_size_, file_capacity_;
 };
 
+/** \weakgroup ParallelProcessing
+    \sa ChunkedArrayMappedFile
+*/
+
+/** Implement ChunkedArray as a memory-mapped view of an existing file.
+
+    <b>\#include</b> \<vigra/multi_array_chunked.hxx\> <br/>
+    Namespace: vigra
+
+    The file must contain the array as a single contiguous block of
+    elements in VIGRA's scan order (i.e. the first axis varies fastest)
+    and native byte order, starting at byte 'offset'. This covers raw volumes
+    with or without a fixed-size header, and uncompressed HDF5 datasets
+    with contiguous layout (see \ref HDF5File::getDatasetFileOffset()).
+
+    The entire file is mapped upon construction, and the chunks are merely
+    strided views into this mapping. Thus, opening the array is instantaneous
+    regardless of its size, no data are copied, and the operating system
+    decides which pages are kept in memory. The array's cache is not used,
+    but \ref ChunkedArray::prefetch() and the chunk iterators' read-ahead
+    (see \ref ChunkedArrayOptions::readAhead()) advise the operating system
+    to read the respective pages in the background.
+
+    The array is opened in one of two modes:
+
+    <ul>
+    <li>ChunkedArrayMappedFile::ReadOnly: The array can only be accessed via
+        const functions and iterators (default). Attempts to write
+        via non-const functions raise a <tt>PreconditionViolation</tt>.
+    <li>ChunkedArrayMappedFile::CopyOnWrite: The array can be modified, but
+        changes are private to the present object and never written to the file.
+        Only the modified pages occupy additional memory.
+    </ul>
+
+    Usage:
+    \code
+    // a 2000 x 2000 x 12500 volume of uint16 following a 512 byte header
+    Shape3 shape(2000, 2000, 12500);
+    ChunkedArrayMappedFile<3, UInt16> volume("volume.raw", shape, Shape3(64),
+                                             ChunkedArrayMappedFile<3, UInt16>::ReadOnly,
+                                             512);
+
+    // read a ROI without touching the rest of the file
+    MultiArray<3, UInt16> roi(Shape3(100));
+    volume.checkoutSubarray(Shape3(1000, 1000, 6000), roi);
+
+    // map an uncompressed HDF5 dataset of type float
+    HDF5File file("data.h5", HDF5File::ReadOnly);
+    ArrayVector<hsize_t> s = file.getDatasetShape("data");
+    ChunkedArrayMappedFile<3, float> data("data.h5", Shape3(s[0], s[1], s[2]), Shape3(64),
+                                          ChunkedArrayMappedFile<3, float>::ReadOnly,
+                                          file.getDatasetFileOffset("data"));
+    \endcode
+
+    The array must not be used after the file has been truncated by another process.
+*/
+template <unsigned int N, class T>
+class ChunkedArrayMappedFile
+: public ChunkedArray<N, T>
+{
+  public:
+#ifdef _WIN32
+    typedef HANDLE FileHandle;
+#else
+    typedef int FileHandle;
+#endif
+
+    enum OpenMode { ReadOnly, CopyOnWrite };
+
+    typedef MultiArray<N, SharedChunkHandle<N, T> > ChunkStorage;
+    typedef MultiArray<N, ChunkBase<N, T> >         ChunkViews;
+    typedef typename ChunkStorage::difference_type  shape_type;
+    typedef T value_type;
+    typedef value_type * pointer;
+    typedef value_type & reference;
+
+    /** \brief Map the file 'file_name' as an array of the given 'shape'.
+
+        The array's first element is located at byte 'offset' in the file.
+        The file must be large enough to hold the entire array. The array is
+        split into chunks of shape 'chunk_shape' (which must be a power of 2
+        along each axis). Options related to the cache are ignored.
+    */
+    ChunkedArrayMappedFile(std::string const & file_name,
+                           shape_type const & shape,
+                           shape_type const & chunk_shape=shape_type(),
+                           OpenMode mode = ReadOnly,
+                           std::size_t offset = 0,
+                           ChunkedArrayOptions const & options = ChunkedArrayOptions())
+    : ChunkedArray<N, T>(shape, chunk_shape, options.cacheMax(0))
+    , chunks_(this->chunkArrayShape())
+    , file_name_(file_name)
+    , mode_(mode)
+    , mapping_(0)
+    , mapping_size_(0)
+    {
+        vigra_precondition(this->size() > 0,
+            "ChunkedArrayMappedFile(): invalid shape.");
+
+        std::size_t data_size = this->size()*sizeof(T),
+                    map_offset = offset & ~(mmap_alignment - 1);
+        mapping_size_ = offset - map_offset + data_size;
+
+    #ifdef _WIN32
+        FileHandle file = ::CreateFile(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if(file == INVALID_HANDLE_VALUE)
+            winErrorToException("ChunkedArrayMappedFile(): ");
+        LARGE_INTEGER file_size;
+        if(!::GetFileSizeEx(file, &file_size) ||
+           (unsigned long long)file_size.QuadPart < offset + data_size)
+        {
+            ::CloseHandle(file);
+            vigra_precondition(false,
+                "ChunkedArrayMappedFile(): file is too small for the given shape and offset.");
+        }
+        HANDLE mapped_file = ::CreateFileMapping(file, NULL,
+                                                 mode == ReadOnly ? PAGE_READONLY : PAGE_WRITECOPY,
+                                                 0, 0, NULL);
+        if(!mapped_file)
+        {
+            ::CloseHandle(file);
+            winErrorToException("ChunkedArrayMappedFile(): ");
+        }
+        static const std::size_t bits = sizeof(DWORD)*8,
+                                 mask = (std::size_t(1) << bits) - 1;
+        mapping_ = (char*)::MapViewOfFile(mapped_file,
+                                          mode == ReadOnly ? FILE_MAP_READ : FILE_MAP_COPY,
+                                          map_offset >> bits, map_offset & mask, mapping_size_);
+        // the view keeps the file open
+        ::CloseHandle(mapped_file);
+        ::CloseHandle(file);
+        if(mapping_ == 0)
+            winErrorToException("ChunkedArrayMappedFile(): ");
+    #else
+        FileHandle file = ::open(file_name.c_str(), O_RDONLY);
+        if(file == -1)
+            throw std::runtime_error("ChunkedArrayMappedFile(): unable to open file '" + file_name + "'.");
+        struct stat file_info;
+        if(::fstat(file, &file_info) == -1 ||
+           (std::size_t)file_info.st_size < offset + data_size)
+        {
+            ::close(file);
+            vigra_precondition(false,
+                "ChunkedArrayMappedFile(): file is too small for the given shape and offset.");
+        }
+        // a private mapping only requires read access to the file
+        void * mapping = mmap(0, mapping_size_,
+                              mode == ReadOnly ? PROT_READ : PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE, file, map_offset);
+        // the mapping keeps the file open
+        ::close(file);
+        if(mapping == MAP_FAILED)
+            throw std::runtime_error("ChunkedArrayMappedFile(): mmap() failed.");
+        mapping_ = (char*)mapping;
+    #endif
+
+        // all chunks are permanently available => let each handle refer to the
+        // corresponding view into the mapping
+        pointer data = (pointer)(mapping_ + (offset - map_offset));
+        shape_type strides = detail::defaultStride(shape);
+        typename ChunkViews::iterator c   = chunks_.begin(),
+                                      end = chunks_.end();
+        for(; c != end; ++c)
+        {
+            c->strides_ = strides;
+            c->pointer_ = data + dot(c.point()*this->chunk_shape_, strides);
+            SharedChunkHandle<N, T> & handle = this->handle_array_[c.point()];
+            handle.pointer_ = &*c;
+            handle.chunk_state_.store(0);
+        }
+        this->data_bytes_ = data_size;
+        this->overhead_bytes_ += chunks_.size()*sizeof(ChunkBase<N, T>);
+    }
+
+    ~ChunkedArrayMappedFile()
+    {
+        this->waitPrefetch();
+    #ifdef _WIN32
+        ::UnmapViewOfFile(mapping_);
+    #else
+        munmap(mapping_, mapping_size_);
+    #endif
+    }
+
+    virtual pointer loadChunk(ChunkBase<N, T> ** p, shape_type const &)
+    {
+        // chunks only fall asleep in releaseChunks(), but their data remain mapped
+        return (*p)->pointer_;
+    }
+
+    virtual bool unloadChunk(ChunkBase<N, T> *, bool /* destroy */)
+    {
+        return false; // never destroys the data
+    }
+
+    // tell the operating system that the chunk's pages will be needed soon
+    virtual void prefetchChunk(shape_type const & chunk_index) const
+    {
+    #ifndef _WIN32
+        shape_type chunk_shape = this->chunkShape(chunk_index);
+        ChunkBase<N, T> const & chunk = chunks_[chunk_index];
+
+        // the chunk consists of contiguous runs along the leading axes
+        // it spans entirely, plus the first axis it doesn't span
+        unsigned int d = 0;
+        while(d < N-1 && chunk_shape[d] == this->shape_[d])
+            ++d;
+        std::size_t run = chunk.strides_[d]*chunk_shape[d]*sizeof(T);
+
+        shape_type outer_shape(1);
+        for(unsigned int k=d+1; k<N; ++k)
+            outer_shape[k] = chunk_shape[k];
+
+        MultiCoordinateIterator<N> i(outer_shape),
+                                   end(i.getEndIterator());
+        for(; i != end; ++i)
+        {
+            // madvise() requires a page-aligned address
+            std::size_t begin = (char*)(chunk.pointer_ + dot(*i, chunk.strides_)) - mapping_,
+                        aligned = begin & ~(mmap_alignment - 1);
+            madvise(mapping_ + aligned, begin - aligned + run, MADV_WILLNEED);
+        }
+    #else
+        ignore_argument(chunk_index);
+    #endif
+    }
+
+    virtual bool isReadOnly() const
+    {
+        return mode_ == ReadOnly;
+    }
+
+    virtual std::string backend() const
+    {
+        return "ChunkedArrayMappedFile<'" + file_name_ + "'>";
+    }
+
+    virtual std::size_t dataBytes(ChunkBase<N,T> *) const
+    {
+        return 0; // the mapping is accounted for as a whole
+    }
+
+    virtual std::size_t overheadBytesPerChunk() const
+    {
+        return sizeof(ChunkBase<N, T>) + sizeof(SharedChunkHandle<N, T>);
+    }
+
+    std::string fileName() const
+    {
+        return file_name_;
+    }
+
+    ChunkViews chunks_;   // the chunks' views into the mapping
+    std::string file_name_;
+    OpenMode mode_;
+    char * mapping_;
+    std::size_t mapping_size_;
+
+  private:
+    ChunkedArrayMappedFile(ChunkedArrayMappedFile const &);
+    ChunkedArrayMappedFile & operator=(ChunkedArrayMappedFile const &);
+};
+
 template<unsigned int N, class U>
 class ChunkIterator
 : public MultiCoordinateIterator<N>
@@ -3293,6 +4124,7 @@ class ChunkIterator
     ChunkIterator()
     : base_type()
     , base_type2()
+    , prefetched_(-1)
     {}
 
     ChunkIterator(array_type * array,
@@ -3305,6 +4137,7 @@ class ChunkIterator
     , start_(start - chunk_.offset_)
     , stop_(end - chunk_.offset_)
     , chunk_shape_(chunk_shape)
+    , prefetched_(-1)
     {
         getChunk();
     }
@@ -3317,6 +4150,7 @@ class ChunkIterator
     , start_(rhs.start_)
     , stop_(rhs.stop_)
     , chunk_shape_(rhs.chunk_shape_)
+    , prefetched_(rhs.prefetched_)
     {
         getChunk();
     }
@@ -3331,6 +4165,7 @@ class ChunkIterator
             start_ = rhs.start_;
             stop_ = rhs.stop_;
             chunk_shape_ = rhs.chunk_shape_;
+            prefetched_ = rhs.prefetched_;
             getChunk();
         }
         return *this;
@@ -3374,7 +4209,30 @@ class ChunkIterator
                        upper_bound(SkipInitialization);
             this->m_ptr = array_->chunkForIterator(array_point, this->m_stride, upper_bound, &chunk_);
             this->m_shape = min(upper_bound, stop_) - array_point;
+            readAhead();
+        }
+    }
+
+    // request the next chunks in scan order from the array's read-ahead
+    void readAhead()
+    {
+        int ahead = array_->readAhead();
+        if(ahead <= 0)
+            return;
+        MultiArrayIndex current = this->scanOrderIndex(),
+                        last = std::min<MultiArrayIndex>(current + ahead, prod(shape()) - 1);
+        // only request chunks not yet requested, unless the iterator jumped
+        MultiArrayIndex k = (prefetched_ >= current && prefetched_ <= last)
+                                ? prefetched_ + 1
+                                : current + 1;
+        shape_type chunk_offset = chunk_.offset_ / chunk_shape_,
+                   chunk_index(SkipInitialization);
+        for(; k <= last; ++k)
+        {
+            detail::ScanOrderToCoordinate<N>::exec(k, shape(), chunk_index);
+            array_->prefetchChunk(chunk_index + chunk_offset);
         }
+        prefetched_ = last;
     }
 
     shape_type chunkStart() const
@@ -3481,6 +4339,7 @@ class ChunkIterator
     array_type * array_;
     Chunk chunk_;
     shape_type start_, stop_, chunk_shape_, array_point_;
+    MultiArrayIndex prefetched_;
 };
 
 //@}
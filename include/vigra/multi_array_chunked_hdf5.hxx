@@ -301,6 +301,8 @@ class ChunkedArrayHDF5
                 compression_ = ZLIB_FAST;
             vigra_precondition(compression_ != LZ4,
                 "ChunkedArrayHDF5(): HDF5 does not support LZ4 compression.");
+            vigra_precondition(compression_ <= ZLIB_BEST,
+                "ChunkedArrayHDF5(): HDF5 only supports ZLIB compression.");
 
             vigra_precondition(this->size() > 0,
                 "ChunkedArrayHDF5(): invalid shape.");
@@ -372,6 +374,7 @@ class ChunkedArrayHDF5
 
     void closeImpl(bool force_destroy)
     {
+        this->waitPrefetch();
         flushToDiskImpl(true, force_destroy);
         file_.close();
     }
@@ -423,6 +426,8 @@ class ChunkedArrayHDF5
 
     virtual pointer loadChunk(ChunkBase<N, T> ** p, shape_type const & index)
     {
+        // the HDF5 library must not be entered concurrently
+        threading::lock_guard<threading::mutex> guard(*this->chunk_lock_);
         vigra_precondition(file_.isOpen(),
             "ChunkedArrayHDF5::loadChunk(): file was already closed.");
         if(*p == 0)
@@ -435,6 +440,7 @@ class ChunkedArrayHDF5
 
     virtual bool unloadChunk(ChunkBase<N, T> * chunk, bool /* destroy */)
     {
+        threading::lock_guard<threading::mutex> guard(*this->chunk_lock_);
         if(!file_.isOpen())
             return true;
         static_cast<Chunk *>(chunk)->write();
@@ -41,6 +41,9 @@
 #include "vigra/multi_iterator.hxx"
 #include "vigra/multi_convolution.hxx"
 #include "vigra/transform_iterator.hxx"
+#include <algorithm>
+#include <utility>
+#include <vector>
 
 namespace vigra{
 
@@ -237,6 +240,50 @@ namespace vigra{
                                        CoordToBwb(*this, width));
         }
 
+        /** Get all blocks with border in Z-order (Morton order) of their
+            block coordinates, so that consecutive blocks are spatial neighbors.
+
+            Runs of <tt>fusion</tt> consecutive blocks along the last axis are
+            merged into a single block, so that the border between them only
+            needs to be processed once. The other axes are not merged.
+        */
+        std::vector<BlockWithBorder> blocksWithBorderZOrder(const Shape & width,
+                                                            PointValue fusion = 1)const{
+            vigra_precondition(fusion > 0,
+                "MultiBlocking::blocksWithBorderZOrder(): fusion must be positive.");
+            Shape fusedBlocksPerAxis(blocksPerAxis_);
+            fusedBlocksPerAxis[DIM-1] = (blocksPerAxis_[DIM-1] + fusion - 1) / fusion;
+
+            const unsigned int bitsPerAxis = 64 / DIM;
+            std::vector<std::pair<UInt64, BlockDesc> > order;
+            MultiCoordIter iter(fusedBlocksPerAxis), end(iter.getEndIterator());
+            for(; iter != end; ++iter){
+                UInt64 code = 0;
+                for(unsigned int b=0; b<bitsPerAxis; ++b)
+                    for(unsigned int d=0; d<DIM; ++d)
+                        code |= (UInt64)(((*iter)[d] >> b) & 1) << (b*DIM + d);
+                order.push_back(std::make_pair(code, *iter));
+            }
+            std::sort(order.begin(), order.end(),
+                [](std::pair<UInt64, BlockDesc> const & a, std::pair<UInt64, BlockDesc> const & b){
+                    return a.first < b.first;
+                });
+
+            std::vector<BlockWithBorder> res;
+            res.reserve(order.size());
+            for(size_t i=0; i<order.size(); ++i){
+                BlockDesc first(order[i].second), last(order[i].second);
+                first[DIM-1] *= fusion;
+                last[DIM-1] = std::min<PointValue>(first[DIM-1] + fusion, blocksPerAxis_[DIM-1]) - 1;
+                const Block core = getBlock(first) | getBlock(last);
+                Block border = core;
+                border.addBorder(width);
+                border &= Block(shape_);
+                res.push_back(BlockWithBorder(core, border));
+            }
+            return res;
+        }
+
         Block blockDescToBlock(const BlockDesc & desc){
             MultiCoordIter beginIter(blocksPerAxis_);
             beginIter+=desc;
@@ -42,6 +42,7 @@
 #include "multi_blocking.hxx"
 #include "multi_convolution.hxx"
 #include "multi_tensorutilities.hxx"
+#include "multi_array_chunked.hxx"
 #include "threadpool.hxx"
 #include "array_vector.hxx"
 
@@ -60,6 +61,7 @@ public:
     BlockwiseOptions()
     :   ParallelOptions()
     ,   blockShape_()
+    ,   blockFusion_(0)
     {}
 
         /** Retrieve block shape as a std::vector.
@@ -136,6 +138,35 @@ public:
         return *this;
     }
 
+        /** Specify how many neighboring blocks along the last axis are merged
+            into one task.
+
+            Blockwise filters must recompute the border (halo) of each block.
+            When the border is wide compared to the block shape (e.g. for large
+            scales), merging neighboring blocks avoids computing their common
+            border twice, at the price of more memory per thread.
+            Fusion is only done along the last axis: the borders along all
+            other axes are still recomputed for every block, so that the
+            saving is limited to the faces perpendicular to the last axis.
+            If <tt>n == 0</tt>, the number is chosen automatically from the
+            border width, block shape, and number of threads.
+            If <tt>n == 1</tt>, blocks are not merged.
+
+            Default: 0 (automatic)
+        */
+    BlockwiseOptions & blockFusion(const int n)
+    {
+        vigra_precondition(n >= 0,
+            "BlockwiseOptions::blockFusion(): n must not be negative.");
+        blockFusion_ = n;
+        return *this;
+    }
+
+    int getBlockFusion() const
+    {
+        return blockFusion_;
+    }
+
     BlockwiseOptions & numThreads(const int n)
     {
         ParallelOptions::numThreads(n);
@@ -147,8 +178,15 @@ public:
         ParallelOptions::numThreads(n);
     }
 
+    BlockwiseOptions & pool(ThreadPool & pool)
+    {
+        ParallelOptions::pool(pool);
+        return *this;
+    }
+
 private:
     Shape blockShape_;
+    int blockFusion_;
 };
 
     /** Option class for blockwise convolution algorithms.
@@ -170,6 +208,39 @@ public:
 
 namespace blockwise{
 
+    /**
+        Determine the order in which blockwise filters process the blocks.
+
+        The blocks are traversed in Z-order, so that consecutive blocks
+        (which are usually processed by the same thread) share most of their
+        input. In addition, neighboring blocks along the last axis are merged
+        according to <tt>options.getBlockFusion()</tt>, so that the border
+        between them is filtered only once. In automatic mode, just enough
+        blocks are merged to bring the border overhead along the last axis
+        below 1/8, while keeping at least two tasks per thread. Blocks are
+        never merged along the other axes, so their borders are computed
+        once per block as before.
+    */
+    template<unsigned int DIM, class C>
+    std::vector<typename MultiBlocking<DIM, C>::BlockWithBorder>
+    blockSchedule(
+        const vigra::MultiBlocking<DIM, C> & blocking,
+        const typename vigra::MultiBlocking<DIM, C>::Shape & borderWidth,
+        const BlockwiseOptions & options
+    ){
+        C fusion = options.getBlockFusion();
+        if(fusion == 0){
+            const C blockSize = blocking.blockShape()[DIM-1];
+            const C maxFusion = std::max<C>(1,
+                   (C)blocking.numBlocks() / (2*options.getActualNumThreads()));
+            fusion = 1;
+            while(fusion < maxFusion && fusion < blocking.blocksPerAxis()[DIM-1] &&
+                  16*borderWidth[DIM-1] > fusion*blockSize)
+                ++fusion;
+        }
+        return blocking.blocksWithBorderZOrder(borderWidth, fusion);
+    }
+
     /**
         helper function to create blockwise parallel filters.
         This implementation should be used if the filter functor
@@ -193,11 +264,10 @@ namespace blockwise{
 
         typedef typename MultiBlocking<DIM, C>::BlockWithBorder BlockWithBorder;
 
-        auto beginIter  =  blocking.blockWithBorderBegin(borderWidth);
-        auto endIter   =  blocking.blockWithBorderEnd(borderWidth);
+        const std::vector<BlockWithBorder> blocks = blockSchedule(blocking, borderWidth, options);
 
-        parallel_foreach(options.getNumThreads(),
-            beginIter, endIter,
+        parallel_foreach(options,
+            blocks.begin(), blocks.end(),
             [&](const int /*threadId*/, const BlockWithBorder bwb)
             {
                 // get the input of the block as a view
@@ -214,7 +284,7 @@ namespace blockwise{
                 dest.subarray(bwb.core().begin()-blocking.roiBegin(),
                               bwb.core().end()  -blocking.roiBegin()  ) = destSubCore;
             },
-            blocking.numBlocks()
+            blocks.size()
         );
 
     }
@@ -245,11 +315,10 @@ namespace blockwise{
         typedef typename MultiBlocking<DIM, C>::Block Block;
 
 
-        auto beginIter  =  blocking.blockWithBorderBegin(borderWidth);
-        auto endIter   =  blocking.blockWithBorderEnd(borderWidth);
+        const std::vector<BlockWithBorder> blocks = blockSchedule(blocking, borderWidth, options);
 
-        parallel_foreach(options.getNumThreads(),
-            beginIter, endIter,
+        parallel_foreach(options,
+            blocks.begin(), blocks.end(),
             [&](const int /*threadId*/, const BlockWithBorder bwb)
             {
                 // get the input of the block as a view
@@ -262,12 +331,66 @@ namespace blockwise{
                 // call the functor
                 functor(sourceSub, destCore, localCore.begin(), localCore.end());
             },
-            blocking.numBlocks()
+            blocks.size()
         );
 
 
     }
 
+    /**
+        helper function to create blockwise parallel filters on ChunkedArrays.
+        Each block is checked out of the source (together with its border)
+        into a temporary array, filtered, and the block's core is committed
+        to the destination. Only one block per thread is held in memory, so
+        that arrays larger than RAM can be processed when the chunks are
+        swapped out (e.g. by \ref vigra::ChunkedArrayCompressed or
+        \ref vigra::ChunkedArrayHDF5). The filter functor must support the
+        ROI/sub array options.
+    */
+    template<
+        unsigned int DIM,
+        class T_IN,
+        class T_OUT,
+        class FILTER_FUNCTOR,
+        class C
+    >
+    void blockwiseCaller(
+        const vigra::ChunkedArray<DIM, T_IN> & source,
+        vigra::ChunkedArray<DIM, T_OUT> & dest,
+        FILTER_FUNCTOR & functor,
+        const vigra::MultiBlocking<DIM, C> & blocking,
+        const typename vigra::MultiBlocking<DIM, C>::Shape & borderWidth,
+        const BlockwiseConvolutionOptions<DIM>  & options
+    ){
+
+        typedef typename MultiBlocking<DIM, C>::BlockWithBorder BlockWithBorder;
+        typedef typename MultiBlocking<DIM, C>::Block Block;
+
+        // the blocks are already processed in parallel, so the chunks
+        // of each block are copied sequentially
+        const ParallelOptions sequential = ParallelOptions().numThreads(ParallelOptions::NoThreads);
+
+        const std::vector<BlockWithBorder> blocks = blockSchedule(blocking, borderWidth, options);
+
+        parallel_foreach(options,
+            blocks.begin(), blocks.end(),
+            [&](const int /*threadId*/, const BlockWithBorder bwb)
+            {
+                // get the input of the block from the source's chunks
+                vigra::MultiArray<DIM, T_IN> sourceSub(bwb.border().size());
+                source.checkoutSubarray(bwb.border().begin(), sourceSub, sequential);
+                // get the output of the blocks core as NEW allocated array
+                vigra::MultiArray<DIM, T_OUT> destCore(bwb.core().size());
+                const Block localCore =  bwb.localCore();
+                // call the functor
+                functor(sourceSub, destCore, localCore.begin(), localCore.end());
+                // write the core into the destination's chunks
+                dest.commitSubarray(bwb.core().begin(), destCore, sequential);
+            },
+            blocks.size()
+        );
+    }
+
     #define CONVOLUTION_FUNCTOR(FUNCTOR_NAME, FUNCTION_NAME) \
     template<unsigned int DIM> \
     class FUNCTOR_NAME{ \
@@ -416,6 +539,9 @@ namespace blockwise{
 
 } // end namespace blockwise
 
+    // Each blockwise filter is defined for MultiArrayViews and for ChunkedArrays.
+    // In the latter case, the destination's chunk shape is the default block shape,
+    // so that every destination chunk is written by exactly one block.
 #define VIGRA_BLOCKWISE(FUNCTOR, FUNCTION, ORDER, USES_OUTER_SCALE) \
 template <unsigned int N, class T1, class S1, class T2, class S2> \
 void FUNCTION( \
@@ -432,6 +558,28 @@ void FUNCTION( \
     const Blocking blocking(source.shape(), options.template getBlockShapeN<N>()); \
     blockwise::FUNCTOR<N> f(subOptions); \
     blockwise::blockwiseCaller(source, dest, f, blocking, border, options); \
+} \
+\
+template <unsigned int N, class T1, class T2> \
+void FUNCTION( \
+    ChunkedArray<N, T1> const & source, \
+    ChunkedArray<N, T2> & dest, \
+    BlockwiseConvolutionOptions<N> const & options \
+) \
+{  \
+    typedef  MultiBlocking<N, vigra::MultiArrayIndex> Blocking; \
+    typedef typename Blocking::Shape Shape; \
+    vigra_precondition(source.shape() == dest.shape(), \
+        #FUNCTION "(): shape mismatch between input and output."); \
+    const Shape border = blockwise::getBorder(options, ORDER, USES_OUTER_SCALE); \
+    BlockwiseConvolutionOptions<N> subOptions(options); \
+    subOptions.subarray(Shape(0), Shape(0));  \
+    const Shape blockShape = options.getBlockShape().size() == 0 \
+                                 ? dest.chunkShape() \
+                                 : options.template getBlockShapeN<N>(); \
+    const Blocking blocking(source.shape(), blockShape); \
+    blockwise::FUNCTOR<N> f(subOptions); \
+    blockwise::blockwiseCaller(source, dest, f, blocking, border, options); \
 }
 
 VIGRA_BLOCKWISE(GaussianSmoothFunctor,                   gaussianSmoothMultiArray,                   0, false );
@@ -459,6 +607,16 @@ gaussianGradientMagnitude(
     gaussianGradientMagnitudeMultiArray(source, dest, options);
 }
 
+template <unsigned int N, class T1, class T2>
+inline void
+gaussianGradientMagnitude(
+    ChunkedArray<N, T1> const & source,
+    ChunkedArray<N, T2> & dest,
+    BlockwiseConvolutionOptions<N> const & options)
+{
+    gaussianGradientMagnitudeMultiArray(source, dest, options);
+}
+
 
 } // end namespace vigra
 
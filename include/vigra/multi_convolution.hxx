@@ -50,6 +50,8 @@
 #include "functorexpression.hxx"
 #include "tinyvector.hxx"
 #include "algorithm.hxx"
+#include "recursiveconvolution.hxx"
+#include "threadpool.hxx"
 
 
 #include <iostream>
@@ -345,13 +347,30 @@ class ConvolutionOptions
     ParamVec outer_scale;
     double window_ratio;
     Shape from_point, to_point;
+    ParallelOptions parallel_options;
+
+        /** Implementation of Gaussian filters and their derivatives,
+            see filterMode().
+        */
+    enum FilterMode
+    {
+        FIRFilter,       ///< convolve with sampled Gaussian kernels
+        RecursiveFilter, ///< use recursive filters
+        AutomaticFilter  ///< use recursive filters for large scales only
+    };
+
+    FilterMode filter_mode;
+    double recursive_threshold;
 
     ConvolutionOptions()
     : sigma_eff(0.0),
       sigma_d(0.0),
       step_size(1.0),
       outer_scale(0.0),
-      window_ratio(0.0)
+      window_ratio(0.0),
+      parallel_options(ParallelOptions().numThreads(ParallelOptions::NoThreads)),
+      filter_mode(FIRFilter),
+      recursive_threshold(4.0)
     {}
 
     typedef typename detail::WrapDoubleIteratorTriple<ParamIt, ParamIt, ParamIt>
@@ -508,11 +527,257 @@ class ConvolutionOptions
       res.second = to_point;
       return res;
     }
+
+        /** Process the lines of each axis in parallel.
+
+            The convolution along each axis is split into slabs of independent
+            lines which are processed by the threads given in <tt>options</tt>.
+            In contrast to the blockwise filters in \<vigra/multi_blockwise.hxx\>,
+            the array is filtered in-place, without copying blocks and their halos.
+
+            Default: <tt>ParallelOptions().numThreads(ParallelOptions::NoThreads)</tt>
+            (i.e. sequential execution)
+        */
+    ConvolutionOptions<dim> & parallelOptions(ParallelOptions const & options)
+    {
+        parallel_options = options;
+        return *this;
+    }
+
+    ParallelOptions const & getParallelOptions() const
+    {
+        return parallel_options;
+    }
+
+        /** Choose the implementation of Gaussian filters and their derivatives.
+
+            By default, the Gaussian filters convolve with sampled kernels, whose
+            cost per pixel grows linearly with the scale. With
+            <tt>RecursiveFilter</tt>, smoothing along an axis is instead performed
+            by Deriche's fourth order recursive approximation of the Gaussian,
+            whose cost per pixel is independent of the scale. Derivatives are then
+            computed by central differences of the smoothed data, with a slightly
+            reduced scale to compensate for the smoothing effect of the differences.
+            The results differ from those of the sampled kernels by less than 1%
+            of the result's maximum for smoothing, and by about 1-2% for derivatives.
+            With <tt>AutomaticFilter</tt>, recursive filters are only used along
+            axes whose (step size adjusted) scale is at least <tt>threshold</tt>,
+            and sampled kernels along the other axes.
+
+            Recursive filters are only applied along axes whose scale is at least 1
+            and which have at least 4 pixels, and never when a subarray is requested.
+            The option affects \ref gaussianSmoothMultiArray(),
+            \ref gaussianGradientMultiArray(), \ref gaussianGradientMagnitude(),
+            \ref laplacianOfGaussianMultiArray(), \ref hessianOfGaussianMultiArray(),
+            and \ref structureTensorMultiArray().
+
+            Default: <tt>FIRFilter</tt>, <tt>threshold = 4.0</tt>
+        */
+    ConvolutionOptions<dim> & filterMode(FilterMode mode, double threshold = 4.0)
+    {
+        vigra_precondition(threshold >= 1.0,
+            "ConvolutionOptions::filterMode(): threshold must be at least 1.");
+        filter_mode = mode;
+        recursive_threshold = threshold;
+        return *this;
+    }
+
+    FilterMode getFilterMode() const
+    {
+        return filter_mode;
+    }
+
+    double getRecursiveThreshold() const
+    {
+        return recursive_threshold;
+    }
+
+        // Should the recursive filter be used for the given (scaled) sigma
+        // along an axis of length 'w'?
+    bool useRecursiveFilter(double sigma, MultiArrayIndex w) const
+    {
+        if(filter_mode == FIRFilter || to_point != Shape() || sigma < 1.0 || w < 4)
+            return false;
+        return filter_mode == RecursiveFilter || sigma >= recursive_threshold;
+    }
 };
 
 namespace detail
 {
 
+    // number of neighboring lines convolved together by internalConvolvePanels().
+    // The slabs of parallel_foreach_lines() have the same granularity, so that
+    // slabs cut along axis 0 don't split a panel.
+enum { ConvolutionPanelWidth = 16 };
+
+/********************************************************/
+/*                                                      */
+/*               internalConvolvePanels                 */
+/*                                                      */
+/********************************************************/
+
+    // Convolve the lines of 'nav' in-place along the navigator's axis, writing
+    // the results for the line positions [lstart, lstop). Since 'nav' enumerates
+    // neighboring lines along another axis (usually the innermost one) in turn,
+    // PanelWidth lines at a time are copied into a buffer which holds the values
+    // of all lines at the same position contiguously (including the border
+    // according to the kernel's border treatment). The convolution's inner loop
+    // then runs over contiguous data, and the strided accesses along the outer axis
+    // are restricted to the copy steps. Symmetric and antisymmetric kernels are
+    // folded as in convolveLine(). Returns false if the kernel's border
+    // treatment is not supported, so that the caller falls back to convolveLine().
+template <class Navigator, class Accessor, class Kernel>
+bool
+internalConvolvePanels(Navigator nav, int w, Accessor a, Kernel const & kernel,
+                       int lstart, int lstop, VigraTrueType /* scalar pixel type */)
+{
+    typedef typename Accessor::value_type ValueType;
+    typedef typename PromoteTraits<ValueType, typename Kernel::value_type>::Promote SumType;
+    typedef typename Navigator::iterator LineIterator;
+
+    enum { PanelWidth = ConvolutionPanelWidth };
+
+    BorderTreatmentMode border = kernel.borderTreatment();
+    KernelSymmetry symmetry = kernel.symmetry();
+    int kleft = kernel.left(), kright = kernel.right();
+
+    if((border != BORDER_TREATMENT_REFLECT && border != BORDER_TREATMENT_REPEAT &&
+        border != BORDER_TREATMENT_WRAP    && border != BORDER_TREATMENT_ZEROPAD) ||
+       w < std::max(kright, -kleft) + 1)
+        return false;
+
+    if(lstop == 0)
+        lstop = w;
+
+    // the buffer holds the line positions [lstart - kright, lstop - kleft)
+    int bufsize = lstop - lstart + kright - kleft;
+    ArrayVector<ValueType> buffer(bufsize*PanelWidth);
+    ArrayVector<SumType> sum(PanelWidth);
+    ArrayVector<LineIterator> lines(PanelWidth);
+
+    // kernel coefficients in the order they are applied
+    ArrayVector<SumType> coefficients;
+    for(int t = kright; t >= kleft; --t)
+        coefficients.push_back(kernel[t]);
+    int ksize = (int)coefficients.size();
+
+    while(nav.hasMore())
+    {
+        int n = 0;
+        for(; n < PanelWidth && nav.hasMore(); ++n, ++nav)
+            lines[n] = nav.begin();
+
+        // copy the panel into the buffer
+        for(int p = 0; p < bufsize; ++p)
+        {
+            int x = internalBorderIndex(p + lstart - kright, w, border);
+            ValueType * b = buffer.begin() + p*PanelWidth;
+            if(x < 0)
+                std::fill(b, b + PanelWidth, NumericTraits<ValueType>::zero());
+            else
+                for(int j = 0; j < n; ++j)
+                    b[j] = a(lines[j] + x);
+        }
+
+        // convolve
+        for(int x = lstart; x < lstop; ++x)
+        {
+            for(int j = 0; j < PanelWidth; ++j)
+                sum[j] = NumericTraits<SumType>::zero();
+            if(symmetry == AsymmetricKernel)
+            {
+                ValueType const * b = buffer.begin() + (x - lstart)*PanelWidth;
+                for(int t = 0; t < ksize; ++t, b += PanelWidth)
+                {
+                    SumType k = coefficients[t];
+                    for(int j = 0; j < PanelWidth; ++j)
+                        sum[j] += k * b[j];
+                }
+            }
+            else
+            {
+                // fold pairs of taps with equal weight (up to the sign)
+                ValueType const * center = buffer.begin() + (x - lstart + kright)*PanelWidth;
+                if(symmetry == SymmetricKernel)
+                {
+                    SumType k = coefficients[kright];
+                    for(int j = 0; j < PanelWidth; ++j)
+                        sum[j] += k * center[j];
+                }
+                for(int t = 1; t <= kright; ++t)
+                {
+                    SumType k = coefficients[kright - t];
+                    ValueType const * left  = center - t*PanelWidth,
+                                    * right = center + t*PanelWidth;
+                    // promote before combining, since the sum or difference of
+                    // two taps may not fit into ValueType (e.g. for UInt32)
+                    if(symmetry == SymmetricKernel)
+                        for(int j = 0; j < PanelWidth; ++j)
+                            sum[j] += k * (SumType(left[j]) + SumType(right[j]));
+                    else
+                        for(int j = 0; j < PanelWidth; ++j)
+                            sum[j] += k * (SumType(left[j]) - SumType(right[j]));
+                }
+            }
+            for(int j = 0; j < n; ++j)
+                a.set(detail::RequiresExplicitCast<ValueType>::cast(sum[j]), lines[j] + x);
+        }
+    }
+    return true;
+}
+
+template <class Navigator, class Accessor, class Kernel>
+inline bool
+internalConvolvePanels(Navigator, int, Accessor, Kernel const &,
+                       int, int, VigraFalseType /* non-scalar pixel type */)
+{
+    return false;
+}
+
+/********************************************************/
+/*                                                      */
+/*             internalConvolveAxisInPlace              */
+/*                                                      */
+/********************************************************/
+
+    // Convolve all lines along axis 'd' of the array 'di' in-place.
+template <class DestIterator, class Shape, class DestAccessor, class Kernel>
+void
+internalConvolveAxisInPlace(DestIterator di, Shape const & shape, DestAccessor dest,
+                            int d, Kernel const & kernel, ParallelOptions const & options)
+{
+    enum { N = 1 + DestIterator::level };
+
+    typedef typename NumericTraits<typename DestAccessor::value_type>::RealPromote TmpType;
+    typedef typename AccessorTraits<TmpType>::default_accessor TmpAcessor;
+    typedef MultiArrayNavigator<DestIterator, N> DNavigator;
+
+    TmpAcessor acc;
+
+    parallel_foreach_lines(options, shape, d,
+        [&](size_t /* thread_id */, Shape const & start, Shape const & stop)
+        {
+            DNavigator dnav( di, start, stop, d );
+
+            if(d > 0 && internalConvolvePanels(dnav, shape[d], dest, kernel, 0, 0,
+                                               typename NumericTraits<TmpType>::isScalar()))
+                return;
+
+            ArrayVector<TmpType> tmp( shape[d] );
+
+            for( ; dnav.hasMore(); dnav++ )
+            {
+                 // first copy source to tmp since convolveLine() cannot work in-place
+                 copyLine(dnav.begin(), dnav.end(), dest, tmp.begin(), acc);
+
+                 convolveLine(srcIterRange(tmp.begin(), tmp.end(), acc),
+                              destIter( dnav.begin(), dest ),
+                              kernel1d( kernel ) );
+            }
+        },
+        ConvolutionPanelWidth);
+}
+
 /********************************************************/
 /*                                                      */
 /*        internalSeparableConvolveMultiArray           */
@@ -524,55 +789,45 @@ template <class SrcIterator, class SrcShape, class SrcAccessor,
 void
 internalSeparableConvolveMultiArrayTmp(
                       SrcIterator si, SrcShape const & shape, SrcAccessor src,
-                      DestIterator di, DestAccessor dest, KernelIterator kit)
+                      DestIterator di, DestAccessor dest, KernelIterator kit,
+                      ParallelOptions const & options)
 {
     enum { N = 1 + SrcIterator::level };
 
     typedef typename NumericTraits<typename DestAccessor::value_type>::RealPromote TmpType;
     typedef typename AccessorTraits<TmpType>::default_accessor TmpAcessor;
 
-    // temporary array to hold the current line to enable in-place operation
-    ArrayVector<TmpType> tmp( shape[0] );
-
     typedef MultiArrayNavigator<SrcIterator, N> SNavigator;
     typedef MultiArrayNavigator<DestIterator, N> DNavigator;
 
     TmpAcessor acc;
 
-    {
-        // only operate on first dimension here
-        SNavigator snav( si, shape, 0 );
-        DNavigator dnav( di, shape, 0 );
-
-        for( ; snav.hasMore(); snav++, dnav++ )
+    // only operate on first dimension here
+    parallel_foreach_lines(options, shape, 0,
+        [&](size_t /* thread_id */, SrcShape const & start, SrcShape const & stop)
         {
-             // first copy source to tmp for maximum cache efficiency
-             copyLine(snav.begin(), snav.end(), src, tmp.begin(), acc);
-
-             convolveLine(srcIterRange(tmp.begin(), tmp.end(), acc),
-                          destIter( dnav.begin(), dest ),
-                          kernel1d( *kit ) );
-        }
-        ++kit;
-    }
+            // temporary array to hold the current line to enable in-place operation
+            ArrayVector<TmpType> tmp( shape[0] );
 
-    // operate on further dimensions
-    for( int d = 1; d < N; ++d, ++kit )
-    {
-        DNavigator dnav( di, shape, d );
+            SNavigator snav( si, start, stop, 0 );
+            DNavigator dnav( di, start, stop, 0 );
 
-        tmp.resize( shape[d] );
+            for( ; snav.hasMore(); snav++, dnav++ )
+            {
+                 // first copy source to tmp for maximum cache efficiency
+                 copyLine(snav.begin(), snav.end(), src, tmp.begin(), acc);
 
-        for( ; dnav.hasMore(); dnav++ )
-        {
-             // first copy source to tmp since convolveLine() cannot work in-place
-             copyLine(dnav.begin(), dnav.end(), dest, tmp.begin(), acc);
+                 convolveLine(srcIterRange(tmp.begin(), tmp.end(), acc),
+                              destIter( dnav.begin(), dest ),
+                              kernel1d( *kit ) );
+            }
+        },
+        ConvolutionPanelWidth);
+    ++kit;
 
-             convolveLine(srcIterRange(tmp.begin(), tmp.end(), acc),
-                          destIter( dnav.begin(), dest ),
-                          kernel1d( *kit ) );
-        }
-    }
+    // operate on further dimensions
+    for( int d = 1; d < N; ++d, ++kit )
+        internalConvolveAxisInPlace(di, shape, dest, d, *kit, options);
 }
 
 /********************************************************/
@@ -587,7 +842,8 @@ void
 internalSeparableConvolveSubarray(
                       SrcIterator si, SrcShape const & shape, SrcAccessor src,
                       DestIterator di, DestAccessor dest, KernelIterator kit,
-                      SrcShape const & start, SrcShape const & stop)
+                      SrcShape const & start, SrcShape const & stop,
+                      ParallelOptions const & options)
 {
     enum { N = 1 + SrcIterator::level };
 
@@ -624,47 +880,66 @@ internalSeparableConvolveSubarray(
 
     {
         // only operate on first dimension here
-        SNavigator snav( si, sstart, sstop, axisorder[0]);
-        TNavigator tnav( tmp.traverser_begin(), dstart, dstop, axisorder[0]);
+        int axis   = axisorder[0];
+        int lstart = start[axis] - sstart[axis];
+        int lstop  = lstart + (stop[axis] - start[axis]);
 
-        ArrayVector<TmpType> tmpline(sstop[axisorder[0]] - sstart[axisorder[0]]);
+        parallel_foreach_lines(options, SrcShape(sstop - sstart), axis,
+            [&](size_t /* thread_id */, SrcShape const & from, SrcShape const & to)
+            {
+                SrcShape tto(to);
+                tto[axis] = dstop[axis];
+                SNavigator snav( si, sstart + from, sstart + to, axis);
+                TNavigator tnav( tmp.traverser_begin(), from, tto, axis);
 
-        int lstart = start[axisorder[0]] - sstart[axisorder[0]];
-        int lstop  = lstart + (stop[axisorder[0]] - start[axisorder[0]]);
+                ArrayVector<TmpType> tmpline(sstop[axis] - sstart[axis]);
 
-        for( ; snav.hasMore(); snav++, tnav++ )
-        {
-            // first copy source to tmp for maximum cache efficiency
-            copyLine(snav.begin(), snav.end(), src, tmpline.begin(), acc);
+                for( ; snav.hasMore(); snav++, tnav++ )
+                {
+                    // first copy source to tmp for maximum cache efficiency
+                    copyLine(snav.begin(), snav.end(), src, tmpline.begin(), acc);
 
-            convolveLine(srcIterRange(tmpline.begin(), tmpline.end(), acc),
-                         destIter(tnav.begin(), acc),
-                         kernel1d( kit[axisorder[0]] ), lstart, lstop);
-        }
+                    convolveLine(srcIterRange(tmpline.begin(), tmpline.end(), acc),
+                                 destIter(tnav.begin(), acc),
+                                 kernel1d( kit[axis] ), lstart, lstop);
+                }
+            },
+            ConvolutionPanelWidth);
     }
 
     // operate on further dimensions
     for( int d = 1; d < N; ++d)
     {
-        TNavigator tnav( tmp.traverser_begin(), dstart, dstop, axisorder[d]);
+        int axis   = axisorder[d];
+        int lstart = start[axis] - sstart[axis];
+        int lstop  = lstart + (stop[axis] - start[axis]);
 
-        ArrayVector<TmpType> tmpline(dstop[axisorder[d]] - dstart[axisorder[d]]);
+        parallel_foreach_lines(options, SrcShape(dstop - dstart), axis,
+            [&](size_t /* thread_id */, SrcShape const & from, SrcShape const & to)
+            {
+                TNavigator tnav( tmp.traverser_begin(), dstart + from, dstart + to, axis);
 
-        int lstart = start[axisorder[d]] - sstart[axisorder[d]];
-        int lstop  = lstart + (stop[axisorder[d]] - start[axisorder[d]]);
+                if(internalConvolvePanels(tnav, dstop[axis] - dstart[axis], acc,
+                                          kit[axis], lstart, lstop,
+                                          typename NumericTraits<TmpType>::isScalar()))
+                    return;
 
-        for( ; tnav.hasMore(); tnav++ )
-        {
-            // first copy source to tmp because convolveLine() cannot work in-place
-            copyLine(tnav.begin(), tnav.end(), acc, tmpline.begin(), acc );
+                ArrayVector<TmpType> tmpline(dstop[axis] - dstart[axis]);
 
-            convolveLine(srcIterRange(tmpline.begin(), tmpline.end(), acc),
-                         destIter( tnav.begin() + lstart, acc ),
-                         kernel1d( kit[axisorder[d]] ), lstart, lstop);
-        }
+                for( ; tnav.hasMore(); tnav++ )
+                {
+                    // first copy source to tmp because convolveLine() cannot work in-place
+                    copyLine(tnav.begin(), tnav.end(), acc, tmpline.begin(), acc );
+
+                    convolveLine(srcIterRange(tmpline.begin(), tmpline.end(), acc),
+                                 destIter( tnav.begin() + lstart, acc ),
+                                 kernel1d( kit[axis] ), lstart, lstop);
+                }
+            },
+            ConvolutionPanelWidth);
 
-        dstart[axisorder[d]] = lstart;
-        dstop[axisorder[d]] = lstop;
+        dstart[axis] = lstart;
+        dstop[axis] = lstop;
     }
 
     copyMultiArray(tmp.traverser_begin()+dstart, stop-start, acc, di, dest);
@@ -679,6 +954,444 @@ scaleKernel(K & kernel, double a)
         kernel[i] = detail::RequiresExplicitCast<typename K::value_type>::cast(kernel[i] * a);
 }
 
+/********************************************************/
+/*                                                      */
+/*          internalRecursiveGaussianAxisInPlace        */
+/*                                                      */
+/********************************************************/
+
+    // Smooth all lines along axis 'd' of the array 'di' in-place with Deriche's
+    // recursive Gaussian filter, and compute central differences of the given
+    // derivative 'order', multiplied by 'norm'. As in internalConvolvePanels(),
+    // PanelWidth neighboring lines are processed at once, so that the inner loops
+    // run over contiguous data. The lines are padded by reflection, and the
+    // filter states are initialized by the steady state of the first and last
+    // padded values.
+template <class DestIterator, class Shape, class DestAccessor>
+void
+internalRecursiveGaussianAxisInPlace(DestIterator di, Shape const & shape, DestAccessor dest,
+                                     int d, double sigma, int order, double norm,
+                                     ParallelOptions const & options)
+{
+    enum { N = 1 + DestIterator::level, PanelWidth = 16, Order = 4 };
+
+    typedef typename DestAccessor::value_type ValueType;
+    typedef typename PromoteTraits<ValueType, double>::Promote SumType;
+    typedef MultiArrayNavigator<DestIterator, N> DNavigator;
+    typedef typename DNavigator::iterator LineIterator;
+
+    // The differences [1/2, 0, -1/2] and [1, -2, 1] are the derivatives of
+    // a box and a triangle filter of variance 1/3 and 1/6 respectively.
+    // Reduce the scale of the smoothing accordingly.
+    if(order == 1)
+        sigma = std::sqrt(sq(sigma) - 1.0 / 3.0);
+    else if(order == 2)
+        sigma = std::sqrt(sq(sigma) - 1.0 / 6.0);
+
+    DericheGaussianCoefficients c(sigma);
+    double const * bc = c.b_causal;
+    double const * ba = c.b_anticausal;
+    double const * a  = c.a;
+
+    int w = shape[d],
+        pad = std::min(w - 1, (int)std::ceil(4.0*sigma) + 1),
+        bufsize = w + 2*pad + 2*Order;   // including Order initial values on either side
+
+    parallel_foreach_lines(options, shape, d,
+        [&](size_t /* thread_id */, Shape const & start, Shape const & stop)
+        {
+            ArrayVector<SumType> buffer(bufsize*PanelWidth),
+                                 causal(bufsize*PanelWidth),
+                                 anticausal(bufsize*PanelWidth);
+            ArrayVector<LineIterator> lines(PanelWidth);
+            int const W = PanelWidth;
+
+            for(DNavigator nav( di, start, stop, d ); nav.hasMore(); )
+            {
+                int n = 0;
+                for(; n < PanelWidth && nav.hasMore(); ++n, ++nav)
+                    lines[n] = nav.begin();
+
+                // copy the panel into the buffer
+                for(int p = 0; p < bufsize; ++p)
+                {
+                    int x = internalBorderIndex(std::min(std::max(p - Order, 0), w + 2*pad - 1) - pad,
+                                                w, BORDER_TREATMENT_REFLECT);
+                    SumType * b = buffer.begin() + p*W;
+                    for(int j = 0; j < n; ++j)
+                        b[j] = dest(lines[j] + x);
+                }
+
+                // causal filter
+                for(int p = 0; p < Order; ++p)
+                    for(int j = 0; j < W; ++j)
+                        causal[p*W + j] = c.sum_causal * buffer[p*W + j];
+                for(int p = Order; p < bufsize; ++p)
+                {
+                    SumType const * s = buffer.begin() + p*W;
+                    SumType * y = causal.begin() + p*W;
+                    for(int j = 0; j < W; ++j)
+                        y[j] = bc[0]*s[j] + bc[1]*s[j-W] + bc[2]*s[j-2*W] + bc[3]*s[j-3*W]
+                             - a[1]*y[j-W] - a[2]*y[j-2*W] - a[3]*y[j-3*W] - a[4]*y[j-4*W];
+                }
+
+                // anti-causal filter
+                for(int p = bufsize - Order; p < bufsize; ++p)
+                    for(int j = 0; j < W; ++j)
+                        anticausal[p*W + j] = c.sum_anticausal * buffer[p*W + j];
+                for(int p = bufsize - Order - 1; p >= 0; --p)
+                {
+                    SumType const * s = buffer.begin() + p*W;
+                    SumType * y = anticausal.begin() + p*W;
+                    for(int j = 0; j < W; ++j)
+                        y[j] = ba[1]*s[j+W] + ba[2]*s[j+2*W] + ba[3]*s[j+3*W] + ba[4]*s[j+4*W]
+                             - a[1]*y[j+W] - a[2]*y[j+2*W] - a[3]*y[j+3*W] - a[4]*y[j+4*W];
+                }
+
+                for(int k = 0; k < bufsize*W; ++k)
+                    causal[k] += anticausal[k];
+
+                // write the smoothed lines or their derivatives
+                for(int x = 0; x < w; ++x)
+                {
+                    SumType const * s = causal.begin() + (x + pad + Order)*W;
+                    for(int j = 0; j < n; ++j)
+                    {
+                        SumType r = order == 0
+                                        ? s[j]
+                                        : order == 1
+                                            ? SumType((0.5*norm) * (s[j+W] - s[j-W]))
+                                            : SumType(norm * (s[j+W] - 2.0*s[j] + s[j-W]));
+                        dest.set(detail::RequiresExplicitCast<ValueType>::cast(r), lines[j] + x);
+                    }
+                }
+            }
+        },
+        ConvolutionPanelWidth);
+}
+
+/********************************************************/
+/*                                                      */
+/*          internalRecursiveGaussianMultiArray         */
+/*                                                      */
+/********************************************************/
+
+    // Compute the Gaussian derivative of the given 'orders' according to
+    // the filter mode in 'opt': axes selected by opt.useRecursiveFilter() are
+    // processed by internalRecursiveGaussianAxisInPlace(), the others are
+    // convolved with the corresponding sampled 'kernels' (which already include
+    // the step size normalization). Returns false without touching 'dest' when
+    // no axis uses a recursive filter.
+template <class SrcIterator, class Shape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class Kernel>
+bool
+internalRecursiveGaussianMultiArray(SrcIterator si, Shape const & shape, SrcAccessor src,
+                                    DestIterator di, DestAccessor dest,
+                                    ConvolutionOptions<Shape::static_size> const & opt,
+                                    Shape const & orders,
+                                    ArrayVector<Kernel> const & kernels,
+                                    const char * const function_name)
+{
+    enum { N = Shape::static_size };
+
+    typedef typename NumericTraits<typename DestAccessor::value_type>::RealPromote TmpType;
+    typedef typename AccessorTraits<TmpType>::default_accessor TmpAcessor;
+
+    ArrayVector<double> sigmas(N), steps(N);
+    bool recursive = false;
+    typename ConvolutionOptions<N>::ScaleIterator params = opt.scaleParams();
+    for(int d = 0; d < N; ++d, ++params)
+    {
+        sigmas[d] = params.sigma_scaled(function_name, true);
+        steps[d] = params.step_size();
+        recursive = recursive || opt.useRecursiveFilter(sigmas[d], shape[d]);
+    }
+    if(!recursive)
+        return false;
+
+    // operate on a temporary array, so that intermediate results are not
+    // rounded to the destination type, and the source may equal the destination
+    MultiArray<N, TmpType> tmp(shape);
+    TmpAcessor acc;
+    copyMultiArray(si, shape, src, tmp.traverser_begin(), acc);
+
+    for(int d = 0; d < N; ++d)
+    {
+        if(opt.useRecursiveFilter(sigmas[d], shape[d]))
+            internalRecursiveGaussianAxisInPlace(tmp.traverser_begin(), shape, acc, d,
+                                                 sigmas[d], orders[d],
+                                                 1.0 / std::pow(steps[d], (double)orders[d]),
+                                                 opt.parallel_options);
+        else
+            internalConvolveAxisInPlace(tmp.traverser_begin(), shape, acc, d, kernels[d],
+                                        opt.parallel_options);
+    }
+
+    copyMultiArray(tmp.traverser_begin(), shape, acc, di, dest);
+    return true;
+}
+
+
+/********************************************************/
+/*                                                      */
+/*      internalSeparableConvolveMultiArrayFixedPoint   */
+/*                                                      */
+/********************************************************/
+
+    // Convolve the lines of 'snav' with the integer coefficients 'k' (see
+    // internalConvolveLineFixedPoint()) and write the results to the lines of 'dnav'.
+    // As in internalConvolvePanels(), 'panelWidth' neighboring lines are interleaved
+    // in a buffer, so that internalFixedPointSum() processes all lines of the panel
+    // in the same contiguous loops. Since each panel is completely copied
+    // before it is overwritten, 'snav' and 'dnav' may refer to the same array.
+template <class Accumulator,
+          class SNavigator, class SrcAccessor,
+          class DNavigator, class DestAccessor>
+void
+internalConvolveLinesFixedPointImpl(SNavigator snav, SrcAccessor src,
+                                    DNavigator dnav, DestAccessor dest,
+                                    int w, int panelWidth,
+                                    ArrayVector<Int32> const & k, int kleft, int kright, int shift,
+                                    BorderTreatmentMode border)
+{
+    typedef typename DestAccessor::value_type DestType;
+    typedef typename NumericTraits<DestType>::isIntegral IsIntegralDest;
+
+    int const W = panelWidth,
+              bufsize = w + kright - kleft;
+    ArrayVector<Int32> buffer(bufsize*W);
+    ArrayVector<Accumulator> sum(w*W);
+    ArrayVector<typename SNavigator::iterator> slines(W);
+    ArrayVector<typename DNavigator::iterator> dlines(W);
+
+    KernelSymmetry symmetry = kernelSymmetry(k.begin() - kleft, StandardConstAccessor<Int32>(),
+                                             kleft, kright);
+
+    while(snav.hasMore())
+    {
+        int n = 0;
+        for(; n < W && snav.hasMore(); ++n, ++snav, ++dnav)
+        {
+            slines[n] = snav.begin();
+            dlines[n] = dnav.begin();
+        }
+
+        // copy the panel into the buffer
+        for(int p = 0; p < bufsize; ++p)
+        {
+            int x = internalBorderIndex(p - kright, w, border);
+            Int32 * b = buffer.begin() + p*W;
+            if(x < 0)
+                std::fill(b, b + W, 0);
+            else
+                for(int j = 0; j < n; ++j)
+                    b[j] = static_cast<Int32>(src(slines[j] + x));
+        }
+
+        internalFixedPointSum(buffer.begin() + kright*W, W, w*W, sum.begin(),
+                              k.begin(), kleft, kright, symmetry);
+
+        for(int x = 0; x < w; ++x)
+            for(int j = 0; j < n; ++j)
+                dest.set(fixedPointResult<DestType>(sum[x*W + j], shift, IsIntegralDest()),
+                         dlines[j] + x);
+    }
+}
+
+    // Convolve all lines along axis 'd' with the integer coefficients 'k'.
+template <class SrcIterator, class Shape, class SrcAccessor,
+          class DestIterator, class DestAccessor>
+void
+internalConvolveLinesFixedPoint(SrcIterator si, Shape const & shape, SrcAccessor src,
+                                DestIterator di, DestAccessor dest, int d,
+                                ArrayVector<Int32> const & k, int kleft, int kright, int shift,
+                                double maxInput, BorderTreatmentMode border,
+                                ParallelOptions const & options)
+{
+    enum { N = 1 + SrcIterator::level };
+
+    typedef MultiArrayNavigator<SrcIterator, N> SNavigator;
+    typedef MultiArrayNavigator<DestIterator, N> DNavigator;
+
+    // lines along the innermost axis are already contiguous
+    int panelWidth = d == 0 ? 1 : 16;
+    bool fitsInt32 = fixedPointSumFitsInt32(k.begin(), k.size(), shift, maxInput);
+
+    parallel_foreach_lines(options, shape, d,
+        [&](size_t /* thread_id */, Shape const & start, Shape const & stop)
+        {
+            SNavigator snav( si, start, stop, d );
+            DNavigator dnav( di, start, stop, d );
+
+            if(fitsInt32)
+                internalConvolveLinesFixedPointImpl<Int32>(snav, src, dnav, dest, shape[d], panelWidth,
+                                                           k, kleft, kright, shift, border);
+            else
+                internalConvolveLinesFixedPointImpl<Int64>(snav, src, dnav, dest, shape[d], panelWidth,
+                                                           k, kleft, kright, shift, border);
+        },
+        ConvolutionPanelWidth);
+}
+
+    // Separable convolution of an integer array with fixed-point kernels in
+    // integer arithmetic. The intermediate results are stored in an Int32 array
+    // with 'guardBits' additional fractional bits (as many as possible without
+    // risking overflow, at most 8), so that the intermediate rounding errors are
+    // negligible. Only the last pass rounds to the destination type.
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class KernelIterator>
+void
+internalSeparableConvolveMultiArrayFixedPoint(
+                      SrcIterator si, SrcShape const & shape, SrcAccessor src,
+                      DestIterator di, DestAccessor dest, KernelIterator kit,
+                      ParallelOptions const & options)
+{
+    enum { N = 1 + SrcIterator::level };
+
+    typedef typename std::iterator_traits<KernelIterator>::value_type Kernel;
+    typedef FixedPointKernelTraits<typename Kernel::value_type> KernelTraits;
+    typedef MultiArray<N, Int32> TmpArray;
+    typedef typename TmpArray::traverser TmpIterator;
+    typedef typename AccessorTraits<Int32>::default_accessor TmpAccessor;
+
+    int const fractionalBits = KernelTraits::fractionalBits;
+
+    ArrayVector<ArrayVector<Int32> > k(N);
+    ArrayVector<double> norm(N);
+    for(int d = 0; d < N; ++d)
+    {
+        vigra_precondition(std::max(kit[d].right(), -kit[d].left()) < shape[d],
+            "separableConvolveMultiArray(): kernel longer than line.\n");
+        for(int i = kit[d].left(); i <= kit[d].right(); ++i)
+        {
+            k[d].push_back(kit[d][i].value);
+            norm[d] += std::abs((double)kit[d][i].value);
+        }
+        norm[d] = std::ldexp(norm[d], -fractionalBits);
+    }
+
+    double maxInput = FixedPointSourceTraits<typename SrcAccessor::value_type>::maxAbs();
+
+    if(N == 1)
+    {
+        internalConvolveLinesFixedPoint(si, shape, src, di, dest, 0,
+                                        k[0], kit[0].left(), kit[0].right(), fractionalBits,
+                                        maxInput, kit[0].borderTreatment(), options);
+        return;
+    }
+
+    // find the largest number of guard bits such that the intermediate
+    // results fit into Int32 (with one bit to spare for rounding)
+    int guardBits = std::min(8, fractionalBits);
+    for(; guardBits > 0; --guardBits)
+    {
+        double bound = std::ldexp(maxInput, guardBits);
+        bool fits = true;
+        for(int d = 0; d < N-1; ++d)
+        {
+            bound *= norm[d];
+            fits = fits && bound < std::ldexp(1.0, 30);
+        }
+        if(fits)
+            break;
+    }
+
+    TmpArray tmp(shape);
+    TmpIterator ti = tmp.traverser_begin();
+    TmpAccessor acc;
+
+    internalConvolveLinesFixedPoint(si, shape, src, ti, acc, 0,
+                                    k[0], kit[0].left(), kit[0].right(), fractionalBits - guardBits,
+                                    maxInput, kit[0].borderTreatment(), options);
+    maxInput = std::ldexp(maxInput * norm[0], guardBits);
+
+    for(int d = 1; d < N-1; ++d)
+    {
+        internalConvolveLinesFixedPoint(ti, shape, acc, ti, acc, d,
+                                        k[d], kit[d].left(), kit[d].right(), fractionalBits,
+                                        maxInput, kit[d].borderTreatment(), options);
+        maxInput *= norm[d];
+    }
+
+    internalConvolveLinesFixedPoint(ti, shape, acc, di, dest, N-1,
+                                    k[N-1], kit[N-1].left(), kit[N-1].right(), fractionalBits + guardBits,
+                                    maxInput, kit[N-1].borderTreatment(), options);
+}
+
+    // floating-point kernels
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class KernelIterator>
+void
+internalSeparableConvolveMultiArray(SrcIterator s, SrcShape const & shape, SrcAccessor src,
+                                    DestIterator d, DestAccessor dest,
+                                    KernelIterator kernels,
+                                    SrcShape start, SrcShape stop,
+                                    ParallelOptions const & options,
+                                    VigraFalseType /* fixed-point kernels */)
+{
+    typedef typename NumericTraits<typename DestAccessor::value_type>::RealPromote TmpType;
+
+    if(stop != SrcShape())
+    {
+
+        enum { N = 1 + SrcIterator::level };
+        detail::RelativeToAbsoluteCoordinate<N-1>::exec(shape, start);
+        detail::RelativeToAbsoluteCoordinate<N-1>::exec(shape, stop);
+
+        for(int k=0; k<N; ++k)
+            vigra_precondition(0 <= start[k] && start[k] < stop[k] && stop[k] <= shape[k],
+              "separableConvolveMultiArray(): invalid subarray shape.");
+
+        detail::internalSeparableConvolveSubarray(s, shape, src, d, dest, kernels, start, stop, options);
+    }
+    else if(!IsSameType<TmpType, typename DestAccessor::value_type>::boolResult)
+    {
+        // need a temporary array to avoid rounding errors
+        MultiArray<SrcShape::static_size, TmpType> tmpArray(shape);
+        detail::internalSeparableConvolveMultiArrayTmp( s, shape, src,
+             tmpArray.traverser_begin(), typename AccessorTraits<TmpType>::default_accessor(), kernels,
+             options );
+        copyMultiArray(srcMultiArrayRange(tmpArray), destIter(d, dest));
+    }
+    else
+    {
+        // work directly on the destination array
+        detail::internalSeparableConvolveMultiArrayTmp( s, shape, src, d, dest, kernels, options );
+    }
+}
+
+    // fixed-point kernels: use integer arithmetic if the source type and border
+    // treatments permit, otherwise convolve with the equivalent floating-point kernels
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class KernelIterator>
+void
+internalSeparableConvolveMultiArray(SrcIterator s, SrcShape const & shape, SrcAccessor src,
+                                    DestIterator d, DestAccessor dest,
+                                    KernelIterator kernels,
+                                    SrcShape start, SrcShape stop,
+                                    ParallelOptions const & options,
+                                    VigraTrueType /* fixed-point kernels */)
+{
+    enum { N = 1 + SrcIterator::level };
+
+    bool useIntegers = stop == SrcShape() &&
+        FixedPointSourceTraits<typename SrcAccessor::value_type>::isSupported::value;
+    for(int k=0; k<N; ++k)
+        useIntegers = useIntegers && fixedPointBorderTreatmentSupported(kernels[k].borderTreatment());
+
+    if(useIntegers)
+    {
+        internalSeparableConvolveMultiArrayFixedPoint(s, shape, src, d, dest, kernels, options);
+    }
+    else
+    {
+        ArrayVector<Kernel1D<double> > realKernels;
+        for(int k=0; k<N; ++k)
+            realKernels.push_back(Kernel1D<double>(kernels[k]));
+        internalSeparableConvolveMultiArray(s, shape, src, d, dest, realKernels.begin(),
+                                            start, stop, options, VigraFalseType());
+    }
+}
 
 } // namespace detail
 
@@ -712,6 +1425,21 @@ scaleKernel(K & kernel, double a)
     array directly would cause round-off errors (i.e. if
     <tt>typeid(typename NumericTraits<T2>::RealPromote) != typeid(T2)</tt>).
 
+    When \ref ParallelOptions are passed after <tt>start</tt> and <tt>stop</tt>, the
+    independent lines of each axis are split among the threads. This requires no
+    additional memory and also works in-place. The Gaussian filters below use this
+    mode when it is requested via <tt>ConvolutionOptions::parallelOptions()</tt>
+    (e.g. <tt>ConvolutionOptions<3>().parallelOptions(ParallelOptions().numThreads(4))</tt>).
+
+    If the kernels' value_type is \ref vigra::FixedPoint16 (e.g. <tt>Kernel1D<FixedPoint16<1> ></tt>)
+    and the source is an integral type of at most 16 bits (<tt>UInt8</tt>, <tt>UInt16</tt> etc.),
+    the convolution is computed in integer arithmetic. The intermediate results are then stored
+    in an <tt>Int32</tt> array with up to 8 extra fractional bits, and only the final result is
+    rounded as described in \ref convolveLine() (the kernel quantization errors of the
+    passes add up, so the error bound is <tt>0.5 + max|src| * sum_d (0.5 * kernel_d.size() / 2^FRACTIONAL_BITS)</tt>
+    for smoothing kernels). With a subarray or a border treatment other
+    than reflect, repeat, wrap and zero-padding, the kernels are converted to <tt>double</tt>.
+
     If <tt>start</tt> and <tt>stop</tt> have non-default values, they must represent
     a valid subarray of the input array. The convolution is then restricted to that
     subarray, and it is assumed that the output array only refers to the
@@ -771,6 +1499,16 @@ scaleKernel(K & kernel, double a)
                                     KernelIterator kernels,
                                     SrcShape const & start = SrcShape(),
                                     SrcShape const & stop = SrcShape());
+
+        // likewise, but process the lines of each axis in parallel
+        template <class SrcIterator, class SrcShape, class SrcAccessor,
+                  class DestIterator, class DestAccessor, class KernelIterator>
+        void
+        separableConvolveMultiArray(SrcIterator siter, SrcShape const & shape, SrcAccessor src,
+                                    DestIterator diter, DestAccessor dest,
+                                    KernelIterator kernels,
+                                    SrcShape start, SrcShape stop,
+                                    ParallelOptions const & options);
     }
     \endcode
     use argument objects in conjunction with \ref ArgumentObjectFactories :
@@ -865,38 +1603,26 @@ void
 separableConvolveMultiArray( SrcIterator s, SrcShape const & shape, SrcAccessor src,
                              DestIterator d, DestAccessor dest,
                              KernelIterator kernels,
-                             SrcShape start = SrcShape(),
-                             SrcShape stop = SrcShape())
+                             SrcShape start, SrcShape stop,
+                             ParallelOptions const & options)
 {
-    typedef typename NumericTraits<typename DestAccessor::value_type>::RealPromote TmpType;
-
-
-    if(stop != SrcShape())
-    {
-
-        enum { N = 1 + SrcIterator::level };
-        detail::RelativeToAbsoluteCoordinate<N-1>::exec(shape, start);
-        detail::RelativeToAbsoluteCoordinate<N-1>::exec(shape, stop);
+    typedef typename std::iterator_traits<KernelIterator>::value_type::value_type KernelValueType;
 
-        for(int k=0; k<N; ++k)
-            vigra_precondition(0 <= start[k] && start[k] < stop[k] && stop[k] <= shape[k],
-              "separableConvolveMultiArray(): invalid subarray shape.");
+    detail::internalSeparableConvolveMultiArray(s, shape, src, d, dest, kernels, start, stop, options,
+                           typename FixedPointKernelTraits<KernelValueType>::isFixedPoint());
+}
 
-        detail::internalSeparableConvolveSubarray(s, shape, src, d, dest, kernels, start, stop);
-    }
-    else if(!IsSameType<TmpType, typename DestAccessor::value_type>::boolResult)
-    {
-        // need a temporary array to avoid rounding errors
-        MultiArray<SrcShape::static_size, TmpType> tmpArray(shape);
-        detail::internalSeparableConvolveMultiArrayTmp( s, shape, src,
-             tmpArray.traverser_begin(), typename AccessorTraits<TmpType>::default_accessor(), kernels );
-        copyMultiArray(srcMultiArrayRange(tmpArray), destIter(d, dest));
-    }
-    else
-    {
-        // work directly on the destination array
-        detail::internalSeparableConvolveMultiArrayTmp( s, shape, src, d, dest, kernels );
-    }
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class KernelIterator>
+inline void
+separableConvolveMultiArray( SrcIterator s, SrcShape const & shape, SrcAccessor src,
+                             DestIterator d, DestAccessor dest,
+                             KernelIterator kernels,
+                             SrcShape const & start = SrcShape(),
+                             SrcShape const & stop = SrcShape())
+{
+    separableConvolveMultiArray( s, shape, src, d, dest, kernels, start, stop,
+                                 ParallelOptions().numThreads(ParallelOptions::NoThreads));
 }
 
 template <class SrcIterator, class SrcShape, class SrcAccessor,
@@ -1313,7 +2039,12 @@ gaussianSmoothMultiArray( SrcIterator s, SrcShape const & shape, SrcAccessor src
         kernels[dim].initGaussian(params.sigma_scaled(function_name, true),
                                   1.0, opt.window_ratio);
 
-    separableConvolveMultiArray(s, shape, src, d, dest, kernels.begin(), opt.from_point, opt.to_point);
+    if(detail::internalRecursiveGaussianMultiArray(s, shape, src, d, dest, opt, SrcShape(),
+                                                   kernels, function_name))
+        return;
+
+    separableConvolveMultiArray(s, shape, src, d, dest, kernels.begin(), opt.from_point, opt.to_point,
+                                opt.parallel_options);
 }
 
 template <class SrcIterator, class SrcShape, class SrcAccessor,
@@ -1548,8 +2279,11 @@ gaussianGradientMultiArray(SrcIterator si, SrcShape const & shape, SrcAccessor s
         ArrayVector<Kernel1D<KernelType> > kernels(plain_kernels);
         kernels[dim].initGaussianDerivative(params2.sigma_scaled(), 1, 1.0, opt.window_ratio);
         detail::scaleKernel(kernels[dim], 1.0 / params2.step_size());
+        if(detail::internalRecursiveGaussianMultiArray(si, shape, src, di, ElementAccessor(dim, dest), opt,
+                                                       SrcShape::unitVector(dim), kernels, function_name))
+            continue;
         separableConvolveMultiArray(si, shape, src, di, ElementAccessor(dim, dest), kernels.begin(),
-                                    opt.from_point, opt.to_point);
+                                    opt.from_point, opt.to_point, opt.parallel_options);
     }
 }
 
@@ -2073,17 +2807,28 @@ laplacianOfGaussianMultiArray(SrcIterator si, SrcShape const & shape, SrcAccesso
         ArrayVector<Kernel1D<KernelType> > kernels(plain_kernels);
         kernels[dim].initGaussianDerivative(params2.sigma_scaled(), 2, 1.0, opt.window_ratio);
         detail::scaleKernel(kernels[dim], 1.0 / sq(params2.step_size()));
+        SrcShape orders;
+        orders[dim] = 2;
 
         if (dim == 0)
         {
-            separableConvolveMultiArray( si, shape, src,
-                                         di, dest, kernels.begin(), opt.from_point, opt.to_point);
+            if(!detail::internalRecursiveGaussianMultiArray(si, shape, src, di, dest, opt,
+                                                            orders, kernels,
+                                                            "laplacianOfGaussianMultiArray"))
+                separableConvolveMultiArray( si, shape, src,
+                                             di, dest, kernels.begin(), opt.from_point, opt.to_point,
+                                             opt.parallel_options);
         }
         else
         {
-            separableConvolveMultiArray( si, shape, src,
-                                         derivative.traverser_begin(), DerivativeAccessor(),
-                                         kernels.begin(), opt.from_point, opt.to_point);
+            if(!detail::internalRecursiveGaussianMultiArray(si, shape, src,
+                                                            derivative.traverser_begin(), DerivativeAccessor(), opt,
+                                                            orders, kernels,
+                                                            "laplacianOfGaussianMultiArray"))
+                separableConvolveMultiArray( si, shape, src,
+                                             derivative.traverser_begin(), DerivativeAccessor(),
+                                             kernels.begin(), opt.from_point, opt.to_point,
+                                             opt.parallel_options);
             combineTwoMultiArrays(di, dshape, dest, derivative.traverser_begin(), DerivativeAccessor(),
                                   di, dest, Arg1() + Arg2() );
         }
@@ -2277,11 +3022,28 @@ gaussianDivergenceMultiArray(Iterator vectorField, Iterator vectorFieldEnd,
     typedef typename std::iterator_traits<Iterator>::value_type  ArrayType;
     typedef typename ArrayType::value_type                       SrcType;
     typedef typename NumericTraits<SrcType>::RealPromote         TmpType;
+    typedef typename AccessorTraits<SrcType>::default_const_accessor SrcAccessor;
+    typedef typename AccessorTraits<T>::default_accessor         DestAccessor;
+    typedef typename AccessorTraits<TmpType>::default_accessor   TmpAccessor;
     typedef Kernel1D<double>                                     Kernel;
 
     vigra_precondition(std::distance(vectorField, vectorFieldEnd) == N,
         "gaussianDivergenceMultiArray(): wrong number of input arrays.");
-    // more checks are performed in separableConvolveMultiArray()
+    for(Iterator f = vectorField; f != vectorFieldEnd; ++f)
+    {
+        if(opt.to_point != typename MultiArrayShape<N>::type())
+        {
+            detail::RelativeToAbsoluteCoordinate<N-1>::exec(f->shape(), opt.from_point);
+            detail::RelativeToAbsoluteCoordinate<N-1>::exec(f->shape(), opt.to_point);
+            vigra_precondition(divergence.shape() == (opt.to_point - opt.from_point),
+                "gaussianDivergenceMultiArray(): shape mismatch between ROI and output.");
+        }
+        else
+        {
+            vigra_precondition(f->shape() == divergence.shape(),
+                "gaussianDivergenceMultiArray(): shape mismatch between input and output.");
+        }
+    }
 
     typename ConvolutionOptions<N>::ScaleIterator params = opt.scaleParams();
     ArrayVector<double> sigmas(N);
@@ -2299,11 +3061,17 @@ gaussianDivergenceMultiArray(Iterator vectorField, Iterator vectorFieldEnd,
         kernels[k].initGaussianDerivative(sigmas[k], 1, 1.0, opt.window_ratio);
         if(k == 0)
         {
-            separableConvolveMultiArray(*vectorField, divergence, kernels.begin(), opt.from_point, opt.to_point);
+            separableConvolveMultiArray(vectorField->traverser_begin(), vectorField->shape(), SrcAccessor(),
+                                        divergence.traverser_begin(), DestAccessor(),
+                                        kernels.begin(), opt.from_point, opt.to_point,
+                                        opt.parallel_options);
         }
         else
         {
-            separableConvolveMultiArray(*vectorField, tmpDeriv, kernels.begin(), opt.from_point, opt.to_point);
+            separableConvolveMultiArray(vectorField->traverser_begin(), vectorField->shape(), SrcAccessor(),
+                                        tmpDeriv.traverser_begin(), TmpAccessor(),
+                                        kernels.begin(), opt.from_point, opt.to_point,
+                                        opt.parallel_options);
             divergence += tmpDeriv;
         }
         kernels[k].initGaussian(sigmas[k], 1.0, opt.window_ratio);
@@ -2521,8 +3289,13 @@ hessianOfGaussianMultiArray(SrcIterator si, SrcShape const & shape, SrcAccessor
             }
             detail::scaleKernel(kernels[i], 1 / params_i.step_size());
             detail::scaleKernel(kernels[j], 1 / params_j.step_size());
+            if(detail::internalRecursiveGaussianMultiArray(si, shape, src, di, ElementAccessor(b, dest), opt,
+                                                           SrcShape::unitVector(i) + SrcShape::unitVector(j),
+                                                           kernels, "hessianOfGaussianMultiArray"))
+                continue;
             separableConvolveMultiArray(si, shape, src, di, ElementAccessor(b, dest),
-                                        kernels.begin(), opt.from_point, opt.to_point);
+                                        kernels.begin(), opt.from_point, opt.to_point,
+                                        opt.parallel_options);
         }
     }
 }
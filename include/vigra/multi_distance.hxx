@@ -39,6 +39,7 @@
 
 #include <vector>
 #include <functional>
+#include <iterator>
 #include "array_vector.hxx"
 #include "multi_array.hxx"
 #include "accessor.hxx"
@@ -47,6 +48,7 @@
 #include "metaprogramming.hxx"
 #include "multi_pointoperators.hxx"
 #include "functorexpression.hxx"
+#include "threadpool.hxx"
 
 #include "multi_gridgraph.hxx"     //for boundaryGraph & boundaryMultiDistance
 #include "union_find.hxx"        //for boundaryGraph & boundaryMultiDistance
@@ -76,10 +78,12 @@ struct DistParabolaStackEntry
 /*                                                      */
 /********************************************************/
 
+    // '_stack' is passed by the caller, so that its memory can be reused for many lines
 template <class SrcIterator, class SrcAccessor,
-          class DestIterator, class DestAccessor >
+          class DestIterator, class DestAccessor, class Influence>
 void distParabola(SrcIterator is, SrcIterator iend, SrcAccessor sa,
-                  DestIterator id, DestAccessor da, double sigma )
+                  DestIterator id, DestAccessor da, double sigma,
+                  std::vector<Influence> & _stack)
 {
     // We assume that the data in the input is distance squared and treat it as such
     double w = iend - is;
@@ -89,9 +93,7 @@ void distParabola(SrcIterator is, SrcIterator iend, SrcAccessor sa,
     double sigma2 = sigma * sigma;
     double sigma22 = 2.0 * sigma2;
 
-    typedef typename SrcAccessor::value_type SrcType;
-    typedef DistParabolaStackEntry<SrcType> Influence;
-    std::vector<Influence> _stack;
+    _stack.clear();
     _stack.push_back(Influence(sa(is), 0.0, 0.0, w));
 
     ++is;
@@ -135,6 +137,15 @@ void distParabola(SrcIterator is, SrcIterator iend, SrcAccessor sa,
     }
 }
 
+template <class SrcIterator, class SrcAccessor,
+          class DestIterator, class DestAccessor >
+inline void distParabola(SrcIterator is, SrcIterator iend, SrcAccessor sa,
+                         DestIterator id, DestAccessor da, double sigma )
+{
+    std::vector<DistParabolaStackEntry<typename SrcAccessor::value_type> > stack;
+    distParabola(is, iend, sa, id, da, sigma, stack);
+}
+
 template <class SrcIterator, class SrcAccessor,
           class DestIterator, class DestAccessor>
 inline void distParabola(triple<SrcIterator, SrcIterator, SrcAccessor> src,
@@ -144,6 +155,114 @@ inline void distParabola(triple<SrcIterator, SrcIterator, SrcAccessor> src,
                  dest.first, dest.second, sigma);
 }
 
+    // transformMultiArray() on slabs of the array, in parallel according to 'options'
+template <class SrcIterator, class Shape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class Functor>
+void
+internalParallelDistTransform(SrcIterator s, Shape const & shape, SrcAccessor src,
+                              DestIterator d, DestAccessor dest, Functor const & f,
+                              ParallelOptions const & options)
+{
+    parallel_foreach_lines(options, shape, 0,
+        [&](size_t /* thread_id */, Shape const & start, Shape const & stop)
+        {
+            transformMultiArray(s + start, stop - start, src, d + start, dest, f);
+        });
+}
+
+/********************************************************/
+/*                                                      */
+/*                internalDistPanels                    */
+/*                                                      */
+/********************************************************/
+
+    // Apply f(begin, end) in-place to every line of 'nav', a navigator along an outer
+    // axis. Since 'nav' enumerates neighboring lines along the innermost axis in turn,
+    // PanelWidth lines at a time are copied into 'buffer', which holds every line
+    // contiguously, and copied back after processing. Thus, all elements of a cache line
+    // are used at once, instead of touching a new cache line for every element of the
+    // strided lines.
+template <class Navigator, class Accessor, class T, class Functor>
+void
+internalDistPanels(Navigator nav, MultiArrayIndex w, Accessor a,
+                   ArrayVector<T> & buffer, Functor f)
+{
+    typedef typename Navigator::iterator LineIterator;
+
+    enum { PanelWidth = 16 };
+
+    ArrayVector<LineIterator> lines(PanelWidth);
+    buffer.resize(w*PanelWidth);
+
+    while(nav.hasMore())
+    {
+        int n = 0;
+        for(; n < PanelWidth && nav.hasMore(); ++n, ++nav)
+            lines[n] = nav.begin();
+
+        for(MultiArrayIndex x = 0; x < w; ++x)
+            for(int j = 0; j < n; ++j)
+                buffer[j*w + x] = a(lines[j] + x);
+
+        for(int j = 0; j < n; ++j)
+            f(buffer.begin() + j*w, buffer.begin() + (j+1)*w);
+
+        for(MultiArrayIndex x = 0; x < w; ++x)
+            for(int j = 0; j < n; ++j)
+                a.set(buffer[j*w + x], lines[j] + x);
+    }
+}
+
+/********************************************************/
+/*                                                      */
+/*        internalSeparableMultiArrayDistAxis           */
+/*                                                      */
+/********************************************************/
+
+    // Apply the parabola pass with spread 'sigma' in-place to all lines along axis 'd'
+    // of the array 'di'. The outer axes are processed in panels of neighboring lines.
+template <class DestIterator, class Shape, class DestAccessor>
+void internalSeparableMultiArrayDistAxis(
+                      DestIterator di, Shape const & shape, DestAccessor dest,
+                      int d, double sigma, ParallelOptions const & options)
+{
+    enum { N = Shape::static_size };
+
+    typedef typename NumericTraits<typename DestAccessor::value_type>::RealPromote TmpType;
+    typedef typename AccessorTraits<TmpType>::default_accessor TmpAccessor;
+    typedef typename AccessorTraits<TmpType>::default_const_accessor TmpConstAccessor;
+    typedef MultiArrayNavigator<DestIterator, N> DNavigator;
+
+    parallel_foreach_lines(options, shape, d,
+        [&](size_t /* thread_id */, Shape const & start, Shape const & stop)
+        {
+            ArrayVector<TmpType> buffer;
+            std::vector<DistParabolaStackEntry<TmpType> > stack;
+            DNavigator dnav( di, start, stop, d );
+
+            if(d == 0)
+            {
+                // temporary array to hold the current line to enable in-place operation
+                buffer.resize( shape[0] );
+                for( ; dnav.hasMore(); dnav++ )
+                {
+                    copyLine( dnav.begin(), dnav.end(), dest, buffer.begin(), TmpAccessor() );
+                    detail::distParabola( buffer.begin(), buffer.end(), TmpConstAccessor(),
+                                          dnav.begin(), dest, sigma, stack );
+                }
+                return;
+            }
+
+            internalDistPanels(dnav, shape[d], dest, buffer,
+                [&](TmpType * begin, TmpType * end)
+                {
+                    // distParabola() reads the entire line before it writes the results
+                    detail::distParabola( begin, end, TmpConstAccessor(),
+                                          begin, TmpAccessor(), sigma, stack );
+                });
+        });
+}
+
 /********************************************************/
 /*                                                      */
 /*        internalSeparableMultiArrayDistTmp            */
@@ -154,7 +273,8 @@ template <class SrcIterator, class SrcShape, class SrcAccessor,
           class DestIterator, class DestAccessor, class Array>
 void internalSeparableMultiArrayDistTmp(
                       SrcIterator si, SrcShape const & shape, SrcAccessor src,
-                      DestIterator di, DestAccessor dest, Array const & sigmas, bool invert)
+                      DestIterator di, DestAccessor dest, Array const & sigmas, bool invert,
+                      ParallelOptions const & options)
 {
     // Sigma is the spread of the parabolas. It determines the structuring element size
     // for ND morphology. When calculating the distance transforms, sigma is usually set to 1,
@@ -163,57 +283,55 @@ void internalSeparableMultiArrayDistTmp(
 
     // we need the Promote type here if we want to invert the image (dilation)
     typedef typename NumericTraits<typename DestAccessor::value_type>::RealPromote TmpType;
-
-    // temporary array to hold the current line to enable in-place operation
-    ArrayVector<TmpType> tmp( shape[0] );
+    typedef typename AccessorTraits<TmpType>::default_accessor TmpAccessor;
+    typedef typename AccessorTraits<TmpType>::default_const_accessor TmpConstAccessor;
 
     typedef MultiArrayNavigator<SrcIterator, N> SNavigator;
     typedef MultiArrayNavigator<DestIterator, N> DNavigator;
 
+    using namespace vigra::functor;
 
     // only operate on first dimension here
-    SNavigator snav( si, shape, 0 );
-    DNavigator dnav( di, shape, 0 );
+    parallel_foreach_lines(options, shape, 0,
+        [&](size_t /* thread_id */, SrcShape const & start, SrcShape const & stop)
+        {
+            // temporary array to hold the current line to enable in-place operation
+            ArrayVector<TmpType> tmp( shape[0] );
+            std::vector<DistParabolaStackEntry<TmpType> > stack;
 
-    using namespace vigra::functor;
+            SNavigator snav( si, start, stop, 0 );
+            DNavigator dnav( di, start, stop, 0 );
 
-    for( ; snav.hasMore(); snav++, dnav++ )
-    {
-            // first copy source to temp for maximum cache efficiency
-            // Invert the values if necessary. Only needed for grayscale morphology
-            if(invert)
-                transformLine( snav.begin(), snav.end(), src, tmp.begin(),
-                               typename AccessorTraits<TmpType>::default_accessor(),
-                               Param(NumericTraits<TmpType>::zero())-Arg1());
-            else
-                copyLine( snav.begin(), snav.end(), src, tmp.begin(),
-                          typename AccessorTraits<TmpType>::default_accessor() );
-
-            detail::distParabola( srcIterRange(tmp.begin(), tmp.end(),
-                          typename AccessorTraits<TmpType>::default_const_accessor()),
-                          destIter( dnav.begin(), dest ), sigmas[0] );
-    }
+            for( ; snav.hasMore(); snav++, dnav++ )
+            {
+                // first copy source to temp for maximum cache efficiency
+                // Invert the values if necessary. Only needed for grayscale morphology
+                if(invert)
+                    transformLine( snav.begin(), snav.end(), src, tmp.begin(), TmpAccessor(),
+                                   Param(NumericTraits<TmpType>::zero())-Arg1());
+                else
+                    copyLine( snav.begin(), snav.end(), src, tmp.begin(), TmpAccessor() );
+
+                detail::distParabola( tmp.begin(), tmp.end(), TmpConstAccessor(),
+                                      dnav.begin(), dest, sigmas[0], stack );
+            }
+        });
 
     // operate on further dimensions
     for( int d = 1; d < N; ++d )
-    {
-        DNavigator dnav( di, shape, d );
-
-        tmp.resize( shape[d] );
-
-
-        for( ; dnav.hasMore(); dnav++ )
-        {
-             // first copy source to temp for maximum cache efficiency
-             copyLine( dnav.begin(), dnav.end(), dest,
-                       tmp.begin(), typename AccessorTraits<TmpType>::default_accessor() );
+        internalSeparableMultiArrayDistAxis( di, shape, dest, d, sigmas[d], options );
+    if(invert)
+        internalParallelDistTransform( di, shape, dest, di, dest, -Arg1(), options );
+}
 
-             detail::distParabola( srcIterRange(tmp.begin(), tmp.end(),
-                           typename AccessorTraits<TmpType>::default_const_accessor()),
-                           destIter( dnav.begin(), dest ), sigmas[d] );
-        }
-    }
-    if(invert) transformMultiArray( di, shape, dest, di, dest, -Arg1());
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class Array>
+inline void internalSeparableMultiArrayDistTmp(
+                      SrcIterator si, SrcShape const & shape, SrcAccessor src,
+                      DestIterator di, DestAccessor dest, Array const & sigmas, bool invert)
+{
+    internalSeparableMultiArrayDistTmp( si, shape, src, di, dest, sigmas, invert,
+                                        ParallelOptions().numThreads(ParallelOptions::NoThreads) );
 }
 
 template <class SrcIterator, class SrcShape, class SrcAccessor,
@@ -272,6 +390,25 @@ inline void internalSeparableMultiArrayDistTmp( SrcIterator si, SrcShape const &
         separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
                                   MultiArrayView<N, T2, S2> dest,
                                   bool background);
+
+        // process the lines of each axis in parallel
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2,
+                  class Array>
+        void
+        separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
+                                  MultiArrayView<N, T2, S2> dest,
+                                  bool background,
+                                  Array const & pixelPitch,
+                                  ParallelOptions const & options);
+
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2>
+        void
+        separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
+                                  MultiArrayView<N, T2, S2> dest,
+                                  bool background,
+                                  ParallelOptions const & options);
     }
     \endcode
 
@@ -343,6 +480,14 @@ inline void internalSeparableMultiArrayDistTmp( SrcIterator si, SrcShape const &
     <tt> NumericTraits<typename DestAccessor::value_type>::max() < N * M*M</tt>, where M is the
     size of the largest dimension of the array.
 
+    The transform consists of one pass per axis, where all lines along the axis
+    are processed independently. When \ref ParallelOptions are passed, the lines
+    of each pass are distributed over the threads in slabs along an outer axis
+    (the default of the overloads without <tt>options</tt> is sequential execution).
+    On the outer axes, neighboring lines are processed in panels that are copied
+    into a contiguous buffer, so that the strided memory accesses are confined to
+    the copy steps. The result is independent of the number of threads.
+
     <b> Usage:</b>
 
     <b>\#include</b> \<vigra/multi_distance.hxx\><br/>
@@ -356,6 +501,9 @@ inline void internalSeparableMultiArrayDistTmp( SrcIterator si, SrcShape const &
 
     // Calculate Euclidean distance squared for all background pixels
     separableMultiDistSquared(source, dest, true);
+
+    // the same, using 8 threads
+    separableMultiDistSquared(source, dest, true, ParallelOptions().numThreads(8));
     \endcode
 
     \see vigra::distanceTransform(), vigra::separableMultiDistance()
@@ -366,7 +514,7 @@ template <class SrcIterator, class SrcShape, class SrcAccessor,
           class DestIterator, class DestAccessor, class Array>
 void separableMultiDistSquared( SrcIterator s, SrcShape const & shape, SrcAccessor src,
                                 DestIterator d, DestAccessor dest, bool background,
-                                Array const & pixelPitch)
+                                Array const & pixelPitch, ParallelOptions const & options)
 {
     int N = shape.size();
 
@@ -392,38 +540,54 @@ void separableMultiDistSquared( SrcIterator s, SrcShape const & shape, SrcAccess
     {
         // Threshold the values so all objects have infinity value in the beginning
         Real maxDist = (Real)dmax, rzero = (Real)0.0;
+        typedef typename AccessorTraits<Real>::default_accessor RealAccessor;
         MultiArray<SrcShape::static_size, Real> tmpArray(shape);
         if(background == true)
-            transformMultiArray( s, shape, src,
-                                 tmpArray.traverser_begin(), typename AccessorTraits<Real>::default_accessor(),
-                                 ifThenElse( Arg1() == Param(zero), Param(maxDist), Param(rzero) ));
+            detail::internalParallelDistTransform( s, shape, src,
+                                 tmpArray.traverser_begin(), RealAccessor(),
+                                 ifThenElse( Arg1() == Param(zero), Param(maxDist), Param(rzero) ),
+                                 options );
         else
-            transformMultiArray( s, shape, src,
-                                 tmpArray.traverser_begin(), typename AccessorTraits<Real>::default_accessor(),
-                                 ifThenElse( Arg1() != Param(zero), Param(maxDist), Param(rzero) ));
+            detail::internalParallelDistTransform( s, shape, src,
+                                 tmpArray.traverser_begin(), RealAccessor(),
+                                 ifThenElse( Arg1() != Param(zero), Param(maxDist), Param(rzero) ),
+                                 options );
 
         detail::internalSeparableMultiArrayDistTmp( tmpArray.traverser_begin(),
-                shape, typename AccessorTraits<Real>::default_accessor(),
-                tmpArray.traverser_begin(),
-                typename AccessorTraits<Real>::default_accessor(), pixelPitch);
+                shape, RealAccessor(), tmpArray.traverser_begin(), RealAccessor(),
+                pixelPitch, false, options);
 
-        copyMultiArray(srcMultiArrayRange(tmpArray), destIter(d, dest));
+        detail::internalParallelDistTransform( tmpArray.traverser_begin(), shape, RealAccessor(),
+                                               d, dest, Arg1(), options );
     }
     else        // work directly on the destination array
     {
         // Threshold the values so all objects have infinity value in the beginning
         DestType maxDist = DestType(std::ceil(dmax)), rzero = (DestType)0;
         if(background == true)
-            transformMultiArray( s, shape, src, d, dest,
-                                 ifThenElse( Arg1() == Param(zero), Param(maxDist), Param(rzero) ));
+            detail::internalParallelDistTransform( s, shape, src, d, dest,
+                                 ifThenElse( Arg1() == Param(zero), Param(maxDist), Param(rzero) ),
+                                 options );
         else
-            transformMultiArray( s, shape, src, d, dest,
-                                 ifThenElse( Arg1() != Param(zero), Param(maxDist), Param(rzero) ));
+            detail::internalParallelDistTransform( s, shape, src, d, dest,
+                                 ifThenElse( Arg1() != Param(zero), Param(maxDist), Param(rzero) ),
+                                 options );
 
-        detail::internalSeparableMultiArrayDistTmp( d, shape, dest, d, dest, pixelPitch);
+        detail::internalSeparableMultiArrayDistTmp( d, shape, dest, d, dest, pixelPitch, false, options);
     }
 }
 
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class Array>
+inline
+void separableMultiDistSquared( SrcIterator s, SrcShape const & shape, SrcAccessor src,
+                                DestIterator d, DestAccessor dest, bool background,
+                                Array const & pixelPitch)
+{
+    separableMultiDistSquared( s, shape, src, d, dest, background, pixelPitch,
+                               ParallelOptions().numThreads(ParallelOptions::NoThreads) );
+}
+
 template <class SrcIterator, class SrcShape, class SrcAccessor,
           class DestIterator, class DestAccessor>
 inline
@@ -479,6 +643,31 @@ separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
                                destMultiArray(dest), background );
 }
 
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2,
+          class Array>
+inline void
+separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
+                          MultiArrayView<N, T2, S2> dest, bool background,
+                          Array const & pixelPitch, ParallelOptions const & options)
+{
+    vigra_precondition(source.shape() == dest.shape(),
+        "separableMultiDistSquared(): shape mismatch between input and output.");
+    separableMultiDistSquared( source.traverser_begin(), source.shape(), StandardConstValueAccessor<T1>(),
+                               dest.traverser_begin(), StandardValueAccessor<T2>(),
+                               background, pixelPitch, options );
+}
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+inline void
+separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
+                          MultiArrayView<N, T2, S2> dest, bool background,
+                          ParallelOptions const & options)
+{
+    separableMultiDistSquared( source, dest, background, TinyVector<double, N>(1.0), options );
+}
+
 /********************************************************/
 /*                                                      */
 /*             separableMultiDistance                   */
@@ -508,6 +697,24 @@ separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
         separableMultiDistance(MultiArrayView<N, T1, S1> const & source,
                                MultiArrayView<N, T2, S2> dest,
                                bool background);
+
+        // process the lines of each axis in parallel
+        template <unsigned int N, class T1, class S1,
+                  class T2, class S2, class Array>
+        void
+        separableMultiDistance(MultiArrayView<N, T1, S1> const & source,
+                               MultiArrayView<N, T2, S2> dest,
+                               bool background,
+                               Array const & pixelPitch,
+                               ParallelOptions const & options);
+
+        template <unsigned int N, class T1, class S1,
+                  class T2, class S2>
+        void
+        separableMultiDistance(MultiArrayView<N, T1, S1> const & source,
+                               MultiArrayView<N, T2, S2> dest,
+                               bool background,
+                               ParallelOptions const & options);
     }
     \endcode
 
@@ -576,6 +783,9 @@ separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
 
     // Calculate Euclidean distance for all background pixels
     separableMultiDistance(source, dest, true);
+
+    // the same, using all available cores
+    separableMultiDistance(source, dest, true, ParallelOptions());
     \endcode
 
     \see vigra::distanceTransform(), vigra::separableMultiDistSquared()
@@ -586,14 +796,25 @@ template <class SrcIterator, class SrcShape, class SrcAccessor,
           class DestIterator, class DestAccessor, class Array>
 void separableMultiDistance( SrcIterator s, SrcShape const & shape, SrcAccessor src,
                              DestIterator d, DestAccessor dest, bool background,
-                             Array const & pixelPitch)
+                             Array const & pixelPitch, ParallelOptions const & options)
 {
-    separableMultiDistSquared( s, shape, src, d, dest, background, pixelPitch);
+    separableMultiDistSquared( s, shape, src, d, dest, background, pixelPitch, options);
 
     // Finally, calculate the square root of the distances
     using namespace vigra::functor;
 
-    transformMultiArray( d, shape, dest, d, dest, sqrt(Arg1()) );
+    detail::internalParallelDistTransform( d, shape, dest, d, dest, sqrt(Arg1()), options );
+}
+
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class Array>
+inline
+void separableMultiDistance( SrcIterator s, SrcShape const & shape, SrcAccessor src,
+                             DestIterator d, DestAccessor dest, bool background,
+                             Array const & pixelPitch)
+{
+    separableMultiDistance( s, shape, src, d, dest, background, pixelPitch,
+                            ParallelOptions().numThreads(ParallelOptions::NoThreads) );
 }
 
 template <class SrcIterator, class SrcShape, class SrcAccessor,
@@ -655,6 +876,33 @@ separableMultiDistance(MultiArrayView<N, T1, S1> const & source,
                             destMultiArray(dest), background );
 }
 
+template <unsigned int N, class T1, class S1,
+          class T2, class S2, class Array>
+inline void
+separableMultiDistance(MultiArrayView<N, T1, S1> const & source,
+                       MultiArrayView<N, T2, S2> dest,
+                       bool background,
+                       Array const & pixelPitch,
+                       ParallelOptions const & options)
+{
+    vigra_precondition(source.shape() == dest.shape(),
+        "separableMultiDistance(): shape mismatch between input and output.");
+    separableMultiDistance( source.traverser_begin(), source.shape(), StandardConstValueAccessor<T1>(),
+                            dest.traverser_begin(), StandardValueAccessor<T2>(),
+                            background, pixelPitch, options );
+}
+
+template <unsigned int N, class T1, class S1,
+          class T2, class S2>
+inline void
+separableMultiDistance(MultiArrayView<N, T1, S1> const & source,
+                       MultiArrayView<N, T2, S2> dest,
+                       bool background,
+                       ParallelOptions const & options)
+{
+    separableMultiDistance( source, dest, background, TinyVector<double, N>(1.0), options );
+}
+
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% BoundaryDistanceTransform %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
 //rewrite labeled data and work with separableMultiDist
@@ -729,8 +977,8 @@ boundaryDistParabola(DestIterator is, DestIterator iend,
         return;
 
     DestIterator id = is;
-    typedef typename LabelIterator::value_type LabelType;
-    typedef typename DestIterator::value_type DestType;
+    typedef typename std::iterator_traits<LabelIterator>::value_type LabelType;
+    typedef typename std::iterator_traits<DestIterator>::value_type DestType;
     typedef detail::DistParabolaStackEntry<DestType> Influence;
     typedef std::vector<Influence> Stack;
 
@@ -805,28 +1053,93 @@ void
 internalBoundaryMultiArrayDist(
                       MultiArrayView<N, T1, S1> const & labels,
                       MultiArrayView<N, T2, S2> dest,
-                      double dmax, bool array_border_is_active=false)
+                      double dmax, bool array_border_is_active,
+                      ParallelOptions const & options)
 {
+    typedef typename MultiArrayShape<N>::type Shape;
     typedef typename MultiArrayView<N, T1, S1>::const_traverser LabelIterator;
     typedef typename MultiArrayView<N, T2, S2>::traverser DestIterator;
     typedef MultiArrayNavigator<LabelIterator, N> LabelNavigator;
     typedef MultiArrayNavigator<DestIterator, N> DNavigator;
+    typedef typename LabelNavigator::iterator LabelLine;
+    typedef typename DNavigator::iterator DestLine;
+
+    enum { PanelWidth = 16 };
 
-    dest = dmax;
+    using namespace vigra::functor;
+
+    internalParallelDistTransform(dest.traverser_begin(), dest.shape(), StandardConstValueAccessor<T2>(),
+                                  dest.traverser_begin(), StandardValueAccessor<T2>(),
+                                  Param(T2(dmax)), options);
     for( unsigned d = 0; d < N; ++d )
     {
-        LabelNavigator lnav( labels.traverser_begin(), labels.shape(), d );
-        DNavigator dnav( dest.traverser_begin(), dest.shape(), d );
-
-        for( ; dnav.hasMore(); dnav++, lnav++ )
-        {
-            boundaryDistParabola(dnav.begin(), dnav.end(),
-                                 lnav.begin(),
-                                 dmax, array_border_is_active);
-        }
+        parallel_foreach_lines(options, labels.shape(), d,
+            [&](size_t /* thread_id */, Shape const & start, Shape const & stop)
+            {
+                LabelNavigator lnav( labels.traverser_begin(), start, stop, d );
+                DNavigator dnav( dest.traverser_begin(), start, stop, d );
+
+                if(d == 0)
+                {
+                    for( ; dnav.hasMore(); dnav++, lnav++ )
+                    {
+                        boundaryDistParabola(dnav.begin(), dnav.end(),
+                                             lnav.begin(),
+                                             dmax, array_border_is_active);
+                    }
+                    return;
+                }
+
+                // on the outer axes, copy panels of neighboring lines (and their labels)
+                // into contiguous buffers, as in internalDistPanels()
+                MultiArrayIndex w = labels.shape(d);
+                ArrayVector<T1> labelBuffer(w*PanelWidth);
+                ArrayVector<T2> destBuffer(w*PanelWidth);
+                ArrayVector<LabelLine> labelLines(PanelWidth);
+                ArrayVector<DestLine> destLines(PanelWidth);
+
+                while(dnav.hasMore())
+                {
+                    int n = 0;
+                    for(; n < PanelWidth && dnav.hasMore(); ++n, ++dnav, ++lnav)
+                    {
+                        labelLines[n] = lnav.begin();
+                        destLines[n] = dnav.begin();
+                    }
+                    for(MultiArrayIndex x = 0; x < w; ++x)
+                    {
+                        for(int j = 0; j < n; ++j)
+                        {
+                            labelBuffer[j*w + x] = labelLines[j][x];
+                            destBuffer[j*w + x] = destLines[j][x];
+                        }
+                    }
+                    for(int j = 0; j < n; ++j)
+                    {
+                        boundaryDistParabola(destBuffer.begin() + j*w, destBuffer.begin() + (j+1)*w,
+                                             labelBuffer.begin() + j*w,
+                                             dmax, array_border_is_active);
+                    }
+                    for(MultiArrayIndex x = 0; x < w; ++x)
+                        for(int j = 0; j < n; ++j)
+                            destLines[j][x] = destBuffer[j*w + x];
+                }
+            });
     }
 }
 
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+inline void
+internalBoundaryMultiArrayDist(
+                      MultiArrayView<N, T1, S1> const & labels,
+                      MultiArrayView<N, T2, S2> dest,
+                      double dmax, bool array_border_is_active=false)
+{
+    internalBoundaryMultiArrayDist(labels, dest, dmax, array_border_is_active,
+                                   ParallelOptions().numThreads(ParallelOptions::NoThreads));
+}
+
 } // namespace detail
 
     /** \brief Specify which boundary is used for boundaryMultiDistance().
@@ -858,7 +1171,8 @@ enum BoundaryDistanceTag {
         boundaryMultiDistance(MultiArrayView<N, T1, S1> const & labels,
                               MultiArrayView<N, T2, S2> dest,
                               bool array_border_is_active=false,
-                              BoundaryDistanceTag boundary=InterpixelBoundary);
+                              BoundaryDistanceTag boundary=InterpixelBoundary,
+                              ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
     }
     \endcode
 
@@ -880,6 +1194,9 @@ enum BoundaryDistanceTag {
     and the infinite region) is also used. Otherwise (the default), regions
     touching the array border are treated as if they extended to infinity.
 
+    As in \ref separableMultiDistSquared(), the lines of each axis are distributed
+    over the threads specified by <tt>options</tt>.
+
     <b> Usage:</b>
 
     <b>\#include</b> \<vigra/multi_distance.hxx\><br/>
@@ -909,7 +1226,8 @@ void
 boundaryMultiDistance(MultiArrayView<N, T1, S1> const & labels,
                       MultiArrayView<N, T2, S2> dest,
                       bool array_border_is_active=false,
-                      BoundaryDistanceTag boundary=InterpixelBoundary)
+                      BoundaryDistanceTag boundary=InterpixelBoundary,
+                      ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
 {
     vigra_precondition(labels.shape() == dest.shape(),
         "boundaryMultiDistance(): shape mismatch between input and output.");
@@ -923,7 +1241,7 @@ boundaryMultiDistance(MultiArrayView<N, T1, S1> const & labels,
         markRegionBoundaries(labels, boundaries, IndirectNeighborhood);
         if(array_border_is_active)
             initMultiArrayBorder(boundaries, 1, 1);
-        separableMultiDistance(boundaries, dest, true);
+        separableMultiDistance(boundaries, dest, true, options);
     }
     else
     {
@@ -942,14 +1260,20 @@ boundaryMultiDistance(MultiArrayView<N, T1, S1> const & labels,
             typedef typename NumericTraits<T2>::RealPromote Real;
             MultiArray<N, Real> tmpArray(labels.shape());
             detail::internalBoundaryMultiArrayDist(labels, tmpArray,
-                                                      dmax, array_border_is_active);
-            transformMultiArray(tmpArray, dest, sqrt(Arg1()) - Param(offset) );
+                                                   dmax, array_border_is_active, options);
+            detail::internalParallelDistTransform(tmpArray.traverser_begin(), tmpArray.shape(),
+                                                  StandardConstValueAccessor<Real>(),
+                                                  dest.traverser_begin(), StandardValueAccessor<T2>(),
+                                                  sqrt(Arg1()) - Param(offset), options );
         }
         else
         {
             // can work directly on the destination array
-            detail::internalBoundaryMultiArrayDist(labels, dest, dmax, array_border_is_active);
-            transformMultiArray(dest, dest, sqrt(Arg1()) - Param(offset) );
+            detail::internalBoundaryMultiArrayDist(labels, dest, dmax, array_border_is_active, options);
+            detail::internalParallelDistTransform(dest.traverser_begin(), dest.shape(),
+                                                  StandardConstValueAccessor<T2>(),
+                                                  dest.traverser_begin(), StandardValueAccessor<T2>(),
+                                                  sqrt(Arg1()) - Param(offset), options );
         }
     }
 }
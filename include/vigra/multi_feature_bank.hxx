@@ -0,0 +1,600 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2009-2010 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_MULTI_FEATURE_BANK_HXX
+#define VIGRA_MULTI_FEATURE_BANK_HXX
+
+#include <algorithm>
+#include <vector>
+#include "multi_array.hxx"
+#include "multi_math.hxx"
+#include "multi_convolution.hxx"
+#include "multi_tensorutilities.hxx"
+
+namespace vigra {
+
+/** \addtogroup ConvolutionFilters
+*/
+//@{
+
+/********************************************************/
+/*                                                      */
+/*                 GaussianFeatureBank                  */
+/*                                                      */
+/********************************************************/
+
+/** \brief Compute a bank of Gaussian filters at several scales in one go.
+
+    Pixel classifiers typically use the same few Gaussian features at
+    several scales. When the features are computed by individual calls to
+    \ref gaussianSmoothMultiArray(), \ref gaussianGradientMagnitude() etc.,
+    every call convolves the entire array along every axis from scratch.
+    This class instead collects (feature, scale) requests with add() and
+    plans a shared computation:
+
+    <ul>
+    <li> All derivatives at the same scale are products of one-dimensional
+         Gaussian derivatives of order 0, 1, or 2 along each axis. They are computed
+         in a tree whose levels correspond to the axes, so that a partial result
+         (e.g. the smoothing along the x-axis) is computed only once for all derivatives
+         beginning with the same kernels. In 3D, the 10 derivatives needed for
+         smoothing, gradient and Hessian take 19 instead of 30 one-dimensional
+         convolutions. The gradient is shared by the gradient magnitude and the
+         structure tensor at the same scale, and the Hessian by its eigenvalues and
+         the Laplacian.
+    <li> If <tt>cascadeScales(true)</tt> is set (the default), the features at a
+         larger scale <tt>s2</tt> are computed from the smoothed array at a smaller scale
+         <tt>s1</tt>, using the narrower kernels of standard deviation
+         <tt>sqrt(s2*s2 - s1*s1)</tt>. A smaller scale is only used as input
+         when this increment is at least one pixel along every axis, because narrower
+         derivative kernels are poorly sampled. The results then agree with the
+         individual filters up to the kernels' truncation error, which is
+         inherent to the window size. With <tt>cascadeScales(false)</tt>,
+         every scale is computed from the original data, and the results agree with
+         the individual filters up to round-off.
+    </ul>
+
+    The results are stored in the channels (the last axis) of a single array,
+    in the order of the add() calls. The features are defined by the
+    corresponding individual functions, using the \ref ConvolutionOptions
+    passed to the constructor (step size, resolution standard deviation, window size,
+    and parallelization of each convolution, see \ref ConvolutionOptions::parallelOptions()).
+    Subarrays are not supported. The eigenvalue features are sorted in descending
+    order, as in \ref tensorEigenvaluesMultiArray().
+
+    <b>\#include</b> \<vigra/multi_feature_bank.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    MultiArray<3, float> volume(Shape3(w, h, d));
+    ...
+    GaussianFeatureBank<3> bank;
+    double scales[] = { 0.7, 1.0, 1.6, 3.5, 5.0, 10.0 };
+    for(int k = 0; k < 6; ++k)
+    {
+        bank.add(GaussianFeatureBank<3>::GaussianSmoothing, scales[k]);
+        bank.add(GaussianFeatureBank<3>::GaussianGradientMagnitude, scales[k]);
+        bank.add(GaussianFeatureBank<3>::HessianOfGaussianEigenvalues, scales[k]);
+        bank.add(GaussianFeatureBank<3>::StructureTensorEigenvalues, scales[k], 0.5*scales[k]);
+    }
+
+    MultiArray<4, float> features(Shape4(w, h, d, bank.channelCount()));
+    bank.compute(volume, features);
+    \endcode
+
+    <b> Preconditions:</b>
+
+    <tt>N == 2</tt> or <tt>N == 3</tt>
+*/
+template <unsigned int N>
+class GaussianFeatureBank
+{
+    static_assert(N == 2 || N == 3,
+        "GaussianFeatureBank: only 2- and 3-dimensional arrays are supported.");
+
+  public:
+
+        /** The available features.
+        */
+    enum Feature
+    {
+        GaussianSmoothing,            ///< 1 channel, see gaussianSmoothMultiArray()
+        GaussianGradientMagnitude,    ///< 1 channel, see gaussianGradientMagnitude()
+        LaplacianOfGaussian,          ///< 1 channel, see laplacianOfGaussianMultiArray()
+        HessianOfGaussianEigenvalues, ///< N channels, eigenvalues of hessianOfGaussianMultiArray()
+        StructureTensorEigenvalues    ///< N channels, eigenvalues of structureTensorMultiArray()
+    };
+
+    typedef typename MultiArrayShape<N>::type Shape;
+
+        /** Create an empty feature bank. The <tt>options</tt> apply to all features.
+        */
+    explicit GaussianFeatureBank(ConvolutionOptions<N> const & options = ConvolutionOptions<N>())
+    : options_(options),
+      cascade_(true),
+      channels_(0)
+    {
+        vigra_precondition(options.to_point == Shape(),
+            "GaussianFeatureBank(): subarrays are not supported.");
+    }
+
+        /** Request a feature at the given <tt>scale</tt>. The structure tensor
+            additionally requires the <tt>outerScale</tt> (the inner scale is
+            <tt>scale</tt>).
+
+            Returns the index of the feature's first channel in the result.
+        */
+    unsigned int add(Feature feature, double scale, double outerScale = 0.0)
+    {
+        vigra_precondition(scale > 0.0,
+            "GaussianFeatureBank::add(): scale must be positive.");
+        vigra_precondition(feature != StructureTensorEigenvalues || outerScale > 0.0,
+            "GaussianFeatureBank::add(): the structure tensor requires a positive outer scale.");
+        Request request = { feature, scale, outerScale, channels_ };
+        requests_.push_back(request);
+        channels_ += channelCount(feature);
+        return request.channel;
+    }
+
+        /** Number of channels of the given feature.
+        */
+    static unsigned int channelCount(Feature feature)
+    {
+        return feature == HessianOfGaussianEigenvalues || feature == StructureTensorEigenvalues
+                   ? N
+                   : 1;
+    }
+
+        /** Total number of channels of all requested features.
+        */
+    unsigned int channelCount() const
+    {
+        return channels_;
+    }
+
+        /** Number of requested features.
+        */
+    unsigned int size() const
+    {
+        return requests_.size();
+    }
+
+        /** Compute larger scales from the smoothed result at smaller scales
+            (see class description).
+
+            Default: <tt>true</tt>
+        */
+    GaussianFeatureBank & cascadeScales(bool cascade)
+    {
+        cascade_ = cascade;
+        return *this;
+    }
+
+    bool getCascadeScales() const
+    {
+        return cascade_;
+    }
+
+        /** Number of one-dimensional convolutions (each along one axis of
+            a scalar array) needed to compute all requested features.
+        */
+    unsigned int convolutionCount() const
+    {
+        std::vector<ScalePlan> scales;
+        plan(scales);
+        unsigned int count = 0;
+        for(unsigned int k = 0; k < scales.size(); ++k)
+        {
+            for(unsigned int level = 1; level <= N; ++level)
+                for(unsigned int prefix = 0; prefix < power(level); ++prefix)
+                    if(hasPrefix(scales[k].derivatives, prefix, level))
+                        ++count;
+        }
+        for(unsigned int r = 0; r < requests_.size(); ++r)
+            if(requests_[r].feature == StructureTensorEigenvalues)
+                count += N*TensorSize;
+        return count;
+    }
+
+        /** Compute all requested features of <tt>source</tt>. The features are
+            stored in the channels of <tt>dest</tt>, i.e. <tt>dest</tt> must have
+            the shape of <tt>source</tt> plus <tt>channelCount()</tt> channels.
+        */
+    template <class T1, class S1, class T2, class S2>
+    void compute(MultiArrayView<N, T1, S1> const & source,
+                 MultiArrayView<N+1, T2, S2> dest) const
+    {
+        typedef typename NumericTraits<T2>::RealPromote TmpType;
+
+        vigra_precondition((source.shape() == dest.shape().template subarray<0, N>()),
+            "GaussianFeatureBank::compute(): shape mismatch between input and output.");
+        vigra_precondition(dest.shape(N) == (MultiArrayIndex)channels_,
+            "GaussianFeatureBank::compute(): wrong number of channels in output array.");
+
+        std::vector<ScalePlan> scales;
+        plan(scales);
+
+        Results<TmpType> results(source.shape());
+        MultiArray<N, TmpType> original;
+        ArrayVector<MultiArray<N, TmpType> > smoothed(scales.size()),
+                                             levels(N+1);
+
+        for(unsigned int k = 0; k < scales.size(); ++k)
+        {
+            ScalePlan const & scale = scales[k];
+
+            // the kernels for the increment from the input scale
+            ArrayVector<double> sigmas, inputSigmas(N, 0.0), steps;
+            scaledSigmas(scale.scale, sigmas, steps);
+            if(scale.input >= 0)
+                scaledSigmas(scales[scale.input].scale, inputSigmas, steps);
+
+            ArrayVector<Kernel1D<double> > kernels(3*N);
+            for(unsigned int d = 0; d < N; ++d)
+            {
+                double sigma = std::sqrt(sq(sigmas[d]) - sq(inputSigmas[d]));
+                kernels[3*d].initGaussian(sigma, 1.0, options_.window_ratio);
+                for(int order = 1; order <= 2; ++order)
+                {
+                    kernels[3*d+order].initGaussianDerivative(sigma, order, 1.0, options_.window_ratio);
+                    detail::scaleKernel(kernels[3*d+order], 1.0 / std::pow(steps[d], order));
+                }
+            }
+
+            if(scale.input >= 0)
+            {
+                if(scales[scale.input].lastUse == k)
+                {
+                    // the input is no longer needed afterwards
+                    levels[0].swap(smoothed[scale.input]);
+                    smoothed[scale.input] = MultiArray<N, TmpType>();
+                }
+                else
+                    levels[0] = smoothed[scale.input];
+            }
+            else
+            {
+                if(original.size() == 0)
+                    original = source;
+                levels[0] = original;
+            }
+
+            results.prepare(scale.derivatives);
+            computeDerivatives(0, 0, scale, kernels, levels, results, smoothed[k], dest);
+            writeFeatures(scale.scale, results, dest);
+        }
+    }
+
+  private:
+
+    enum { TensorSize = N*(N+1)/2 };
+
+    struct Request
+    {
+        Feature feature;
+        double scale, outerScale;
+        unsigned int channel;
+    };
+
+        // A distinct scale of the computation. The needed derivatives are
+        // encoded as bits of 'derivatives': bit 'code' with
+        // code = sum_d order[d]*3^d is set when the derivative of order[d]
+        // along each axis d is needed.
+    struct ScalePlan
+    {
+        double scale;
+        unsigned int index;
+        int input;             // index of the input scale, or -1 for the source
+        unsigned int lastUse;  // index of the last scale using this one as input
+        unsigned int derivatives;
+    };
+
+    template <class T>
+    struct Results
+    {
+        Shape shape;
+        MultiArray<N, TinyVector<T, int(N)> > gradient;
+        MultiArray<N, TinyVector<T, int(TensorSize)> > hessian;
+        MultiArray<N, T> laplacian;
+        bool hasLaplacian;
+
+        Results(Shape const & s)
+        : shape(s),
+          hasLaplacian(false)
+        {}
+
+        void prepare(unsigned int derivatives)
+        {
+            unsigned int firstOrder = 0, secondOrder = 0;
+            for(unsigned int d = 0; d < N; ++d)
+            {
+                firstOrder  |= 1u << power(d);
+                secondOrder |= 1u << (2*power(d));
+            }
+            if((derivatives & firstOrder) != 0 && gradient.size() == 0)
+                gradient.reshape(shape);
+            if((derivatives & secondOrder) != 0 && hessian.size() == 0)
+                hessian.reshape(shape);
+            hasLaplacian = false;
+        }
+    };
+
+    static unsigned int power(unsigned int d)
+    {
+        unsigned int res = 1;
+        for(unsigned int k = 0; k < d; ++k)
+            res *= 3;
+        return res;
+    }
+
+        // Is there a needed derivative whose orders along the first 'level'
+        // axes are encoded in 'prefix'?
+    static bool hasPrefix(unsigned int derivatives, unsigned int prefix, unsigned int level)
+    {
+        for(unsigned int code = 0; code < power(N); ++code)
+            if((derivatives & (1u << code)) != 0 && code % power(level) == prefix)
+                return true;
+        return false;
+    }
+
+        // index of the tensor element (i, j) in the upper triangular storage
+        // order of hessianOfGaussianMultiArray()
+    static unsigned int tensorIndex(unsigned int i, unsigned int j)
+    {
+        return i*(2*N - i - 1) / 2 + j;
+    }
+
+    void scaledSigmas(double scale, ArrayVector<double> & sigmas, ArrayVector<double> & steps) const
+    {
+        ConvolutionOptions<N> opt(options_);
+        typename ConvolutionOptions<N>::ScaleIterator params = opt.stdDev(scale).scaleParams();
+        sigmas.resize(N);
+        steps.resize(N);
+        for(unsigned int d = 0; d < N; ++d, ++params)
+        {
+            sigmas[d] = params.sigma_scaled("GaussianFeatureBank");
+            steps[d] = params.step_size();
+        }
+    }
+
+    void plan(std::vector<ScalePlan> & scales) const
+    {
+        std::vector<double> distinct;
+        for(unsigned int r = 0; r < requests_.size(); ++r)
+            distinct.push_back(requests_[r].scale);
+        std::sort(distinct.begin(), distinct.end());
+        distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+
+        scales.resize(distinct.size());
+        for(unsigned int k = 0; k < scales.size(); ++k)
+        {
+            scales[k].scale = distinct[k];
+            scales[k].index = k;
+            scales[k].input = -1;
+            scales[k].lastUse = k;
+            scales[k].derivatives = 0;
+        }
+
+        for(unsigned int r = 0; r < requests_.size(); ++r)
+        {
+            ScalePlan & scale = scales[std::lower_bound(distinct.begin(), distinct.end(),
+                                                        requests_[r].scale) - distinct.begin()];
+            switch(requests_[r].feature)
+            {
+              case GaussianSmoothing:
+                scale.derivatives |= 1u;
+                break;
+              case GaussianGradientMagnitude:
+              case StructureTensorEigenvalues:
+                for(unsigned int d = 0; d < N; ++d)
+                    scale.derivatives |= 1u << power(d);
+                break;
+              case LaplacianOfGaussian:
+                for(unsigned int d = 0; d < N; ++d)
+                    scale.derivatives |= 1u << (2*power(d));
+                break;
+              case HessianOfGaussianEigenvalues:
+                for(unsigned int i = 0; i < N; ++i)
+                    for(unsigned int j = i; j < N; ++j)
+                        scale.derivatives |= 1u << (power(i) + power(j));
+                break;
+            }
+        }
+
+        if(!cascade_)
+            return;
+
+        // use the largest smaller scale whose increment is at least one pixel
+        ArrayVector<double> sigmas, steps, smaller;
+        for(unsigned int k = 1; k < scales.size(); ++k)
+        {
+            scaledSigmas(scales[k].scale, sigmas, steps);
+            for(int j = k-1; j >= 0; --j)
+            {
+                scaledSigmas(scales[j].scale, smaller, steps);
+                bool sufficient = true;
+                for(unsigned int d = 0; d < N; ++d)
+                    sufficient = sufficient && sq(sigmas[d]) - sq(smaller[d]) >= 1.0;
+                if(sufficient)
+                {
+                    scales[k].input = j;
+                    scales[j].lastUse = k;
+                    scales[j].derivatives |= 1u;
+                    break;
+                }
+            }
+        }
+    }
+
+        // Depth-first traversal of the derivative tree: convolve levels[level]
+        // along axis 'level' with the kernels of all needed orders, and recurse.
+    template <class T, class T2, class S2>
+    void computeDerivatives(unsigned int level, unsigned int prefix,
+                            ScalePlan const & scale,
+                            ArrayVector<Kernel1D<double> > const & kernels,
+                            ArrayVector<MultiArray<N, T> > & levels,
+                            Results<T> & results,
+                            MultiArray<N, T> & smoothed,
+                            MultiArrayView<N+1, T2, S2> dest) const
+    {
+        for(unsigned int order = 0; order <= 2; ++order)
+        {
+            unsigned int code = prefix + order*power(level);
+            if(!hasPrefix(scale.derivatives, code, level+1))
+                continue;
+
+            levels[level+1] = levels[level];
+            detail::internalConvolveAxisInPlace(levels[level+1].traverser_begin(), levels[level+1].shape(),
+                                                typename AccessorTraits<T>::default_accessor(),
+                                                level, kernels[3*level+order],
+                                                options_.parallel_options);
+
+            if(level+1 < N)
+                computeDerivatives(level+1, code, scale, kernels, levels, results, smoothed, dest);
+            else
+                storeDerivative(code, scale, levels[N], results, smoothed, dest);
+        }
+    }
+
+    template <class T, class T2, class S2>
+    void storeDerivative(unsigned int code, ScalePlan const & scale,
+                         MultiArray<N, T> const & derivative,
+                         Results<T> & results,
+                         MultiArray<N, T> & smoothed,
+                         MultiArrayView<N+1, T2, S2> dest) const
+    {
+        using namespace multi_math;
+
+        // the first and the second axis with a non-zero derivative order
+        unsigned int orders[N], firstOrder = N, secondOrder = N, total = 0;
+        for(unsigned int d = 0; d < N; ++d)
+        {
+            orders[d] = (code / power(d)) % 3;
+            total += orders[d];
+            if(orders[d] > 0)
+            {
+                if(firstOrder == N)
+                    firstOrder = d;
+                else if(secondOrder == N)
+                    secondOrder = d;
+            }
+        }
+
+        if(total == 0)
+        {
+            for(unsigned int r = 0; r < requests_.size(); ++r)
+                if(requests_[r].feature == GaussianSmoothing && requests_[r].scale == scale.scale)
+                    dest.bindOuter(requests_[r].channel) = derivative;
+            if(scale.lastUse > scale.index)
+                smoothed = derivative;
+        }
+        else if(total == 1)
+        {
+            results.gradient.bindElementChannel(firstOrder) = derivative;
+        }
+        else if(orders[firstOrder] == 2)
+        {
+            results.hessian.bindElementChannel(tensorIndex(firstOrder, firstOrder)) = derivative;
+            if(results.hasLaplacian)
+                results.laplacian += derivative;
+            else
+                results.laplacian = derivative;
+            results.hasLaplacian = true;
+        }
+        else
+        {
+            results.hessian.bindElementChannel(tensorIndex(firstOrder, secondOrder)) = derivative;
+        }
+    }
+
+    template <class T, class T2, class S2>
+    void writeFeatures(double scale, Results<T> & results,
+                       MultiArrayView<N+1, T2, S2> dest) const
+    {
+        using namespace multi_math;
+        typedef TinyVector<T, int(TensorSize)> Tensor;
+
+        MultiArray<N, TinyVector<T, int(N)> > eigenvalues;
+        for(unsigned int r = 0; r < requests_.size(); ++r)
+        {
+            Request const & request = requests_[r];
+            if(request.scale != scale)
+                continue;
+
+            switch(request.feature)
+            {
+              case GaussianSmoothing:
+                break;
+              case GaussianGradientMagnitude:
+                dest.bindOuter(request.channel) = sqrt(squaredNorm(results.gradient));
+                break;
+              case LaplacianOfGaussian:
+                dest.bindOuter(request.channel) = results.laplacian;
+                break;
+              case HessianOfGaussianEigenvalues:
+                eigenvalues.reshape(results.shape);
+                tensorEigenvaluesMultiArray(results.hessian, eigenvalues);
+                for(unsigned int d = 0; d < N; ++d)
+                    dest.bindOuter(request.channel + d) = eigenvalues.bindElementChannel(d);
+                break;
+              case StructureTensorEigenvalues:
+              {
+                MultiArray<N, Tensor> tensor(results.shape);
+                transformMultiArray(results.gradient, tensor,
+                                    detail::StructurTensorFunctor<N, Tensor>());
+                ConvolutionOptions<N> outer(options_);
+                outer.stdDev(request.outerScale).resolutionStdDev(0.0);
+                gaussianSmoothMultiArray(tensor, tensor, outer);
+                eigenvalues.reshape(results.shape);
+                tensorEigenvaluesMultiArray(tensor, eigenvalues);
+                for(unsigned int d = 0; d < N; ++d)
+                    dest.bindOuter(request.channel + d) = eigenvalues.bindElementChannel(d);
+                break;
+              }
+            }
+        }
+    }
+
+    ConvolutionOptions<N> options_;
+    std::vector<Request> requests_;
+    bool cascade_;
+    unsigned int channels_;
+};
+
+//@}
+
+} // namespace vigra
+
+#endif // VIGRA_MULTI_FEATURE_BANK_HXX
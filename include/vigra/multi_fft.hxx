@@ -43,6 +43,7 @@
 #include "navigator.hxx"
 #include "copyimage.hxx"
 #include "threading.hxx"
+#include "threadpool.hxx"
 
 namespace vigra {
 
@@ -2418,6 +2419,478 @@ convolveFFTComplexMany(MultiArrayView<N, FFTWComplex<Real>, C1> in,
     plan.executeMany(in, kernels, kernelsEnd, outs);
 }
 
+/********************************************************/
+/*                                                      */
+/*                  convolveMultiArray                  */
+/*                                                      */
+/********************************************************/
+
+/** \brief Options class for \ref convolveMultiArray().
+
+    <b>\#include</b> \<vigra/multi_fft.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    MultiArray<3, float> src(Shape3(512, 512, 256)), dest(src.shape());
+    MultiArray<3, float> kernel(Shape3(15, 15, 15));
+    ...
+    // always use the FFT, with tiles of at most 2^20 pixels, executed by 4 threads
+    convolveMultiArray(src, kernel, dest,
+                       ConvolveMultiArrayOptions().method(ConvolveMultiArrayOptions::FFTConvolution)
+                                                  .maxTileSize(1 << 20)
+                                                  .parallelOptions(ParallelOptions().numThreads(4)));
+    \endcode
+*/
+class ConvolveMultiArrayOptions
+{
+  public:
+
+        /** Implementation of the convolution.
+        */
+    enum Method {
+        DirectConvolution,    ///< sum over the kernel points in the spatial domain
+        FFTConvolution,       ///< multiply in the frequency domain (overlap-save)
+        AutomaticConvolution  ///< choose the method with the smaller estimated cost
+    };
+
+    ConvolveMultiArrayOptions()
+    : method_(AutomaticConvolution),
+      max_tile_size_(1 << 22),
+      planner_flags_(FFTW_ESTIMATE)
+    {}
+
+        /** Choose the implementation.
+
+            In automatic mode, the number of operations of the direct
+            convolution (array size times number of non-zero kernel coefficients)
+            is compared with the cost of the FFT convolution (about
+            <tt>n log(n)</tt> per tile, where <tt>n</tt> is the padded tile size).
+
+            Default: <tt>AutomaticConvolution</tt>
+        */
+    ConvolveMultiArrayOptions & method(Method m)
+    {
+        method_ = m;
+        return *this;
+    }
+
+    Method getMethod() const
+    {
+        return method_;
+    }
+
+        /** Maximal number of pixels of a padded FFT tile.
+
+            The array is convolved in tiles whose padded size (tile plus kernel
+            halo, rounded up to an efficient FFT size) doesn't exceed this bound,
+            unless the tiles would become smaller than the kernel. Each thread
+            holds one tile in the frequency domain, so that the memory requirement
+            is bounded by about <tt>(threads + 1) * size * sizeof(Real)</tt>,
+            regardless of the array size. When the entire array fits into a
+            single tile, it is transformed at once as in \ref convolveFFT().
+
+            Default: <tt>2^22</tt>
+        */
+    ConvolveMultiArrayOptions & maxTileSize(MultiArrayIndex size)
+    {
+        vigra_precondition(size > 0,
+            "ConvolveMultiArrayOptions::maxTileSize(): size must be positive.");
+        max_tile_size_ = size;
+        return *this;
+    }
+
+    MultiArrayIndex getMaxTileSize() const
+    {
+        return max_tile_size_;
+    }
+
+        /** FFTW planner flags for the plans shared by all tiles.
+
+            Default: <tt>FFTW_ESTIMATE</tt>
+        */
+    ConvolveMultiArrayOptions & plannerFlags(unsigned int flags)
+    {
+        planner_flags_ = flags;
+        return *this;
+    }
+
+    unsigned int getPlannerFlags() const
+    {
+        return planner_flags_;
+    }
+
+        /** Process the tiles in parallel.
+
+            Default: <tt>ParallelOptions()</tt> (i.e. use the machine's
+            default number of threads)
+        */
+    ConvolveMultiArrayOptions & parallelOptions(ParallelOptions const & options)
+    {
+        parallel_options_ = options;
+        return *this;
+    }
+
+    ParallelOptions const & getParallelOptions() const
+    {
+        return parallel_options_;
+    }
+
+  private:
+    Method method_;
+    MultiArrayIndex max_tile_size_;
+    unsigned int planner_flags_;
+    ParallelOptions parallel_options_;
+};
+
+namespace detail {
+
+    // Map index 'i' into [0, w) by reflection at the borders
+    // (without repeating the border pixel).
+inline MultiArrayIndex
+convolveReflectIndex(MultiArrayIndex i, MultiArrayIndex w)
+{
+    if(w == 1)
+        return 0;
+    MultiArrayIndex period = 2*(w-1);
+    i %= period;
+    if(i < 0)
+        i += period;
+    return i < w
+               ? i
+               : period - i;
+}
+
+    // Copy the region of 'in' starting at 'start' (which may lie partially or
+    // entirely outside of the array) into 'buffer', reflecting at the borders.
+template <unsigned int N, class T, class S1, class Real, class S2>
+void
+convolveGatherTile(MultiArrayView<N, T, S1> const & in,
+                   typename MultiArrayShape<N>::type const & start,
+                   MultiArrayView<N, Real, S2> buffer)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    ArrayVector<MultiArrayIndex> offsets[N];
+    for(unsigned int d=0; d<N; ++d)
+    {
+        offsets[d].resize(buffer.shape(d));
+        for(MultiArrayIndex k=0; k<buffer.shape(d); ++k)
+            offsets[d][k] = convolveReflectIndex(start[d] + k, in.shape(d))*in.stride(d);
+    }
+
+    Shape lines(buffer.shape());
+    lines[0] = 1;
+    MultiCoordinateIterator<N> c(lines),
+                               cend = c.getEndIterator();
+    for(; c != cend; ++c)
+    {
+        T const * s = in.data();
+        for(unsigned int d=1; d<N; ++d)
+            s += offsets[d][(*c)[d]];
+        Real * b = &buffer[*c];
+        for(MultiArrayIndex k=0; k<buffer.shape(0); ++k, b += buffer.stride(0))
+            *b = static_cast<Real>(s[offsets[0][k]]);
+    }
+}
+
+    // Choose the shape of the output tiles: starting from the entire array,
+    // the largest tile axis (which is still bigger than the kernel) is halved until
+    // the padded tile size is at most 'maxSize'. The padded shape is the
+    // tile plus the kernel halo, rounded up to an efficient FFT size if
+    // 'fftPadding' is true. When padding makes room for a bigger tile, the
+    // tile is enlarged accordingly.
+template <class Shape>
+Shape
+convolveTileShape(Shape const & shape, Shape const & kernelShape,
+                  MultiArrayIndex maxSize, bool fftPadding, Shape & padded)
+{
+    Shape tile(shape);
+    for(;;)
+    {
+        padded = tile + kernelShape - Shape(1);
+        if(fftPadding)
+            padded = fftwBestPaddedShapeR2C(padded);
+        if(prod(padded) <= maxSize)
+            break;
+        int axis = -1;
+        for(int d=0; d<(int)Shape::static_size; ++d)
+            if(tile[d] > kernelShape[d] && (axis < 0 || tile[d] > tile[axis]))
+                axis = d;
+        if(axis < 0)
+            break;
+        tile[axis] = (tile[axis] + 1) / 2;
+    }
+    return min(shape, padded - kernelShape + Shape(1));
+}
+
+template <class Shape>
+MultiArrayIndex
+convolveTileCount(Shape const & shape, Shape const & tile)
+{
+    MultiArrayIndex count = 1;
+    for(int d=0; d<(int)Shape::static_size; ++d)
+        count *= (shape[d] + tile[d] - 1) / tile[d];
+    return count;
+}
+
+template <class Shape>
+Shape
+convolveTileStart(Shape const & shape, Shape const & tile, MultiArrayIndex index)
+{
+    Shape start;
+    for(int d=0; d<(int)Shape::static_size; ++d)
+    {
+        MultiArrayIndex count = (shape[d] + tile[d] - 1) / tile[d];
+        start[d] = (index % count) * tile[d];
+        index /= count;
+    }
+    return start;
+}
+
+    // Test if the memory of the two arrays may overlap, so that the
+    // input must be copied before the output can be written tile by tile.
+template <unsigned int N, class T1, class S1, class T2, class S2>
+bool
+convolveArraysOverlap(MultiArrayView<N, T1, S1> const & a,
+                      MultiArrayView<N, T2, S2> const & b)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    char const * afirst = (char const *)a.data(),
+               * alast  = (char const *)(&a[a.shape() - Shape(1)] + 1),
+               * bfirst = (char const *)b.data(),
+               * blast  = (char const *)(&b[b.shape() - Shape(1)] + 1);
+    return !(alast <= bfirst || blast <= afirst);
+}
+
+template <unsigned int N, class T1, class S1, class Real, class S2, class T3, class S3>
+void
+convolveMultiArrayDirect(MultiArrayView<N, T1, S1> const & in,
+                         MultiArrayView<N, Real, S2> const & kernel,
+                         MultiArrayView<N, T3, S3> out,
+                         typename MultiArrayShape<N>::type const & tile,
+                         ParallelOptions const & options)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    using namespace multi_math;
+
+    Shape kernelShape(kernel.shape()),
+          last = kernelShape - Shape(1),
+          halo = last - div(kernelShape, MultiArrayIndex(2));
+    MultiArrayIndex tileCount = convolveTileCount(in.shape(), tile);
+
+    ArrayVector<MultiArray<N, Real> > buffers(options.getActualNumThreads()),
+                                      results(options.getActualNumThreads());
+
+    parallel_foreach(options, tileCount,
+        [&](size_t thread_id, std::ptrdiff_t k)
+        {
+            MultiArray<N, Real> & buffer = buffers[thread_id],
+                                & result = results[thread_id];
+            if(!buffer.hasData())
+            {
+                buffer.reshape(tile + last);
+                result.reshape(tile);
+            }
+
+            Shape start = convolveTileStart(in.shape(), tile, k),
+                  stop  = min(start + tile, in.shape());
+            convolveGatherTile(in, start - halo, buffer);
+
+            result = 0;
+            MultiCoordinateIterator<N> m(kernelShape),
+                                       mend = m.getEndIterator();
+            for(; m != mend; ++m)
+            {
+                Real coefficient = kernel[*m];
+                if(coefficient != 0)
+                    result += coefficient * buffer.subarray(last - *m, last - *m + tile);
+            }
+            out.subarray(start, stop) = result.subarray(Shape(), stop - start);
+        });
+}
+
+template <unsigned int N, class T1, class S1, class Real, class S2, class T3, class S3>
+void
+convolveMultiArrayFFT(MultiArrayView<N, T1, S1> const & in,
+                      MultiArrayView<N, Real, S2> const & kernel,
+                      MultiArrayView<N, T3, S3> out,
+                      typename MultiArrayShape<N>::type const & tile,
+                      typename MultiArrayShape<N>::type const & padded,
+                      unsigned int planner_flags,
+                      ParallelOptions const & options)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    typedef MultiArray<N, FFTWComplex<Real>, FFTWAllocator<FFTWComplex<Real> > > CArray;
+    typedef MultiArrayView<N, Real> RView;
+
+    Shape kernelShape(kernel.shape()),
+          last = kernelShape - Shape(1),
+          halo = last - div(kernelShape, MultiArrayIndex(2)),
+          complexShape = fftwCorrespondingShapeR2C(padded);
+    MultiArrayIndex tileCount = convolveTileCount(in.shape(), tile);
+
+    CArray fourierKernel(complexShape);
+    Shape realStrides = 2*fourierKernel.stride();
+    realStrides[0] = 1;
+    RView realKernel(padded, realStrides, (Real*)fourierKernel.data());
+
+        // all tiles have the same shape and strides, so that one pair of plans
+        // can be executed concurrently on the workspaces of all threads
+    FFTWPlan<N, Real> forward_plan(realKernel, fourierKernel, planner_flags),
+                      backward_plan(fourierKernel, realKernel, planner_flags);
+
+        // the kernel's origin is at the upper left corner, so that the result for
+        // the tile is found behind the halo, where the cyclic convolution doesn't wrap around
+    realKernel.init(0.0);
+    realKernel.subarray(Shape(), kernelShape) = kernel;
+    forward_plan.execute(realKernel, fourierKernel);
+
+    ArrayVector<CArray> workspaces(options.getActualNumThreads());
+
+    parallel_foreach(options, tileCount,
+        [&](size_t thread_id, std::ptrdiff_t k)
+        {
+            CArray & fourierArray = workspaces[thread_id];
+            if(!fourierArray.hasData())
+                fourierArray.reshape(complexShape);
+            RView realArray(padded, realStrides, (Real*)fourierArray.data());
+
+            Shape start = convolveTileStart(in.shape(), tile, k),
+                  stop  = min(start + tile, in.shape());
+            convolveGatherTile(in, start - halo, realArray);
+
+            forward_plan.execute(realArray, fourierArray);
+            fourierArray *= fourierKernel;
+            backward_plan.execute(fourierArray, realArray);
+
+            out.subarray(start, stop) = realArray.subarray(last, last + stop - start);
+        });
+}
+
+} // namespace detail
+
+/** \brief Convolve an array with an arbitrary N-D kernel, choosing between
+           direct and FFT-based convolution.
+
+    This function unifies direct (spatial domain) convolution and \ref convolveFFT().
+    The kernel's center is at <tt>floor(kernel.shape() / 2.0)</tt>, i.e.
+
+    \code
+    out[x] = sum over m of kernel[m] * in[x + center - m]
+    \endcode
+
+    where the input is reflected at the borders (like BORDER_TREATMENT_REFLECT).
+    Input, kernel, and output must be scalar and may have arbitrary (but matching)
+    value types; the computations are performed in <tt>NumericTraits<T3>::RealPromote</tt>
+    (the precision of FFTW: <tt>float</tt>, <tt>double</tt>, or <tt>long double</tt>).
+
+    The implementation is chosen by \ref ConvolveMultiArrayOptions::method(). In automatic mode
+    (the default), direct convolution is used for small kernels and the FFT for large ones.
+    In both cases, the array is processed in tiles which are convolved in parallel.
+    FFT convolution uses the <i>overlap-save</i> method: every tile is extended by the kernel
+    halo and padded to an efficient transform size, so that the memory requirement is bounded
+    by \ref ConvolveMultiArrayOptions::maxTileSize() per thread instead of growing with the array
+    size, and the FFTW plans and the kernel's transform are computed only once for all tiles.
+    Input and output may refer to the same memory.
+
+    <b> Declaration:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2,
+                                  class T3, class S3>
+        void
+        convolveMultiArray(MultiArrayView<N, T1, S1> const & in,
+                           MultiArrayView<N, T2, S2> const & kernel,
+                           MultiArrayView<N, T3, S3> out,
+                           ConvolveMultiArrayOptions const & options = ConvolveMultiArrayOptions());
+    }
+    \endcode
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/multi_fft.hxx\><br>
+    Namespace: vigra
+
+    \code
+    MultiArray<3, UInt8> volume(Shape3(1024, 1024, 512));
+    MultiArray<3, float> dest(volume.shape());
+
+    // a non-separable kernel, e.g. a ball of radius 8
+    MultiArray<3, float> ball(Shape3(17, 17, 17));
+    ...
+
+    // large kernel => tiled FFT convolution on all cores
+    convolveMultiArray(volume, ball, dest);
+    \endcode
+
+    <b> Preconditions:</b>
+
+    \code
+    in.shape() == out.shape()
+    \endcode
+
+    All kernel axes must be non-empty.
+*/
+doxygen_overloaded_function(template <...> void convolveMultiArray)
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2,
+                          class T3, class S3>
+void
+convolveMultiArray(MultiArrayView<N, T1, S1> const & in,
+                   MultiArrayView<N, T2, S2> const & kernel,
+                   MultiArrayView<N, T3, S3> out,
+                   ConvolveMultiArrayOptions const & options = ConvolveMultiArrayOptions())
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    typedef typename NumericTraits<T3>::RealPromote Real;
+
+    vigra_precondition(in.shape() == out.shape(),
+        "convolveMultiArray(): input and output must have the same shape.");
+    vigra_precondition(kernel.size() > 0,
+        "convolveMultiArray(): kernel must not be empty.");
+    if(in.size() == 0)
+        return;
+
+    MultiArray<N, Real> realKernel(kernel);
+    Shape directPadded, fftPadded,
+          directTile = detail::convolveTileShape(in.shape(), kernel.shape(), 1 << 16, false, directPadded),
+          fftTile = detail::convolveTileShape(in.shape(), kernel.shape(), options.getMaxTileSize(), true, fftPadded);
+
+    ConvolveMultiArrayOptions::Method method = options.getMethod();
+    if(method == ConvolveMultiArrayOptions::AutomaticConvolution)
+    {
+        double directCost = double(in.size()) *
+                            std::count_if(realKernel.begin(), realKernel.end(),
+                                          [](Real v) { return v != 0; }),
+               fftSize = double(prod(fftPadded)),
+               fftCost = detail::convolveTileCount(in.shape(), fftTile) *
+                         fftSize * (3.0*std::log2(fftSize) + 8.0);
+        method = directCost <= fftCost
+                     ? ConvolveMultiArrayOptions::DirectConvolution
+                     : ConvolveMultiArrayOptions::FFTConvolution;
+    }
+
+    if(detail::convolveArraysOverlap(in, out))
+    {
+        MultiArray<N, T1> tmp(in);
+        convolveMultiArray(tmp, kernel, out,
+                           ConvolveMultiArrayOptions(options).method(method));
+    }
+    else if(method == ConvolveMultiArrayOptions::DirectConvolution)
+    {
+        detail::convolveMultiArrayDirect(in, realKernel, out, directTile,
+                                         options.getParallelOptions());
+    }
+    else
+    {
+        detail::convolveMultiArrayFFT(in, realKernel, out, fftTile, fftPadded,
+                                      options.getPlannerFlags(), options.getParallelOptions());
+    }
+}
+
 /********************************************************/
 /*                                                      */
 /*                     correlateFFT                     */
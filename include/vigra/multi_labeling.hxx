@@ -40,6 +40,7 @@
 #include "multi_gridgraph.hxx"
 #include "union_find.hxx"
 #include "any.hxx"
+#include "threadpool.hxx"
 
 namespace vigra{
 
@@ -377,6 +378,465 @@ class LabelOptions
     }
 };
 
+namespace detail {
+
+template <class Equal>
+struct LabelingEqualityIsTransitive
+: public VigraFalseType
+{};
+
+template <class T>
+struct LabelingEqualityIsTransitive<std::equal_to<T> >
+: public VigraTrueType
+{};
+
+    // Connected components labeling with a ConcurrentUnionFindArray over the points'
+    // scan-order indices. The array is split into slabs along the last axis. In the
+    // first pass, every slab unites its points with their equal back neighbors inside
+    // the slab, without any interaction between the threads. Then, the points in the
+    // first plane of each slab are united with their neighbors in the preceding slab,
+    // where the threads may modify the same trees concurrently, so that the unions
+    // must use compare-and-swap.
+    //
+    // When the equality predicate is transitive, redundant unions are skipped: if two
+    // back neighbors of a point are adjacent to each other and both equal to the point,
+    // they already belong to the same tree, so that only one of them must be united
+    // with the point. The back neighbors are therefore considered in the order of
+    // decreasing number of adjacent back neighbors, and the neighbors adjacent to an
+    // already united one are dropped (a decision tree on the bit mask of equal neighbors,
+    // e.g. in 3D with 26-neighborhood, the point right in front of the current one is
+    // adjacent to all other back neighbors, so that a single union suffices when it is
+    // equal). The back neighbors in the direct neighborhood are not adjacent to each other.
+    // Here, a back neighbor is skipped when the preceding point on the line is equal, and
+    // the corresponding back neighbor of the preceding point was equal as well (run-based
+    // scan). The bit masks limit this class to at most 63 back neighbors, i.e. to
+    // N <= 4 for the indirect neighborhood.
+template <unsigned int N, class T, class S, class Index, class Equal>
+class ParallelLabeling
+{
+  public:
+    typedef TinyVector<MultiArrayIndex, N> Shape;
+
+    ParallelLabeling(MultiArrayView<N, T, S> const & data,
+                     NeighborhoodType neighborhood,
+                     bool hasBackground, T const & background,
+                     Equal const & equal)
+    : data_(data)
+    , shape_(data.shape())
+    , scan_strides_(defaultStride(shape_))
+    , has_background_(hasBackground)
+    , background_(background)
+    , equal_(equal)
+    , regions_(data.size() + 1)
+    , run_rule_(false)
+    {
+        bool transitive = LabelingEqualityIsTransitive<Equal>::value;
+
+        // the back neighbors, i.e. the neighbors whose last non-zero coordinate is negative
+        ArrayVector<Shape> offsets;
+        MultiCoordinateIterator<N> it(Shape(3)),
+                                   end(it.getEndIterator());
+        for(; it != end; ++it)
+        {
+            Shape o = *it - Shape(1);
+            int nonzero = 0, last = -1;
+            for(unsigned int d = 0; d < N; ++d)
+            {
+                if(o[d] != 0)
+                {
+                    ++nonzero;
+                    last = d;
+                }
+            }
+            if(nonzero == 0 || o[last] > 0 ||
+               (neighborhood == DirectNeighborhood && nonzero > 1))
+                continue;
+            offsets.push_back(o);
+        }
+        int K = offsets.size();
+
+        if(neighborhood == DirectNeighborhood)
+        {
+            // the preceding point on the line comes first
+            std::rotate(offsets.begin(), offsets.end() - 1, offsets.end());
+            run_rule_ = transitive;
+            offsets_ = offsets;
+        }
+        else
+        {
+            ArrayVector<int> degree(K, 0), order(K);
+            for(int k = 0; k < K; ++k)
+            {
+                order[k] = k;
+                for(int l = 0; l < K; ++l)
+                    if(l != k && max(abs(offsets[k] - offsets[l])) == 1)
+                        ++degree[k];
+            }
+            std::stable_sort(order.begin(), order.end(),
+                             [&degree](int a, int b) { return degree[a] > degree[b]; });
+            for(int k = 0; k < K; ++k)
+                offsets_.push_back(offsets[order[k]]);
+
+            if(transitive)
+            {
+                adjacent_.resize(K, 0);
+                for(int k = 0; k < K; ++k)
+                    for(int l = 0; l < K; ++l)
+                        if(l != k && max(abs(offsets_[k] - offsets_[l])) == 1)
+                            adjacent_[k] |= UInt64(1) << l;
+            }
+        }
+
+        for(int k = 0; k < K; ++k)
+        {
+            data_offsets_.push_back(dot(offsets_[k], data.stride()));
+            index_offsets_.push_back(dot(offsets_[k], scan_strides_));
+        }
+    }
+
+    bool isBackground(T const & t) const
+    {
+        return has_background_ &&
+               labeling_equality::callEqual(equal_, t, background_, Shape());
+    }
+
+    bool isEqual(T const & center, T const & neighbor, Shape const & diff) const
+    {
+        return labeling_equality::callEqual(equal_, center, neighbor, diff);
+    }
+
+    Index index(Shape const & c) const
+    {
+        return Index(dot(c, scan_strides_) + 1);
+    }
+
+        // call f(c) for the first point of every line along axis 0 in [start, stop)
+    template <class Functor>
+    void forEachLine(Shape const & start, Shape const & stop, Functor f) const
+    {
+        Shape lines(stop - start);
+        lines[0] = 1;
+        MultiCoordinateIterator<N> it(lines),
+                                   end(it.getEndIterator());
+        for(; it != end; ++it)
+            f(start + *it);
+    }
+
+        // Unite the points in [start, stop) (which must span the entire array along
+        // all axes but the last) with their equal back neighbors. If 'crossing' is
+        // false, only the neighbors within the slab starting at 'start' are considered,
+        // and the points are initialized as singletons. Otherwise, only the neighbors
+        // in the preceding slab are considered.
+        //
+        // The point with scan-order index k has index k+1 in 'regions_'. Index 0 is
+        // the root of all background points. As in labelGraphWithBackground(), a region
+        // becomes background when the equality predicate considers any of its points
+        // equal to a neighboring background point (which never happens for a transitive
+        // predicate).
+    void scan(Shape const & start, Shape const & stop, bool crossing)
+    {
+        ArrayVector<UInt64> equal_neighbors(shape_[0]);
+        forEachLine(start, stop, [&](Shape const & c)
+        {
+            scanLine(c, start[N-1], crossing, equal_neighbors.data());
+        });
+    }
+
+        // Unite the points in the line starting at 'c' with their neighbors. 'slab_start'
+        // and 'crossing' determine the neighbors to be considered as explained above.
+        // All data needed in the loops are copied to local variables, such that the compiler
+        // can keep them in registers.
+    void scanLine(Shape const & c, MultiArrayIndex slab_start, bool crossing, UInt64 * masks)
+    {
+        MultiArrayIndex const w = shape_[0],
+                              s0 = data_.stride(0);
+        int const K = offsets_.size();
+        bool const run_rule = run_rule_;
+        UInt64 const * const adjacent = adjacent_.size() > 0 ? adjacent_.data() : 0;
+        MultiArrayIndex const * const index_offsets = index_offsets_.data();
+        T const * const line = &data_[c];
+        UInt64 const background_bit = UInt64(1) << 63;
+
+        // Determine the equal neighbors of all points in the line by one loop per
+        // neighbor. These loops are branch-free, in contrast to the union decisions.
+        for(MultiArrayIndex x = 0; x < w; ++x)
+            masks[x] = isBackground(line[x*s0]) ? background_bit : 0;
+        for(int k = 0; k < K; ++k)
+        {
+            Shape n = c + offsets_[k];
+            bool valid = true;
+            for(unsigned int d = 1; d < N; ++d)
+                if(n[d] < 0 || n[d] >= shape_[d])
+                    valid = false;
+            if(N > 1 && (n[N-1] < slab_start) != crossing)
+                valid = false;
+            if(!valid)
+                continue;
+
+            Shape const diff = offsets_[k];
+            MultiArrayIndex const begin = std::max<MultiArrayIndex>(0, -diff[0]),
+                                  end = std::min<MultiArrayIndex>(w, w - diff[0]),
+                                  doff = data_offsets_[k];
+            for(MultiArrayIndex x = begin; x < end; ++x)
+                masks[x] |= UInt64(isEqual(line[x*s0], line[x*s0 + doff], diff)) << k;
+        }
+
+        Index i = index(c);
+        UInt64 previous = 0;
+        for(MultiArrayIndex x = 0; x < w; ++x, ++i)
+        {
+            UInt64 current = masks[x];
+            if((current & background_bit) != 0)
+            {
+                if(!crossing)
+                    regions_.setParent(i, 0);
+                previous = 0;
+                continue;
+            }
+
+            UInt64 todo = current;
+            if(run_rule)
+            {
+                // in the crossing pass, the preceding point is not among the considered
+                // neighbors, but it was united with the present point in the first pass
+                bool west_equal = crossing
+                                      ? x > 0 && equal_(line[x*s0], line[(x-1)*s0])
+                                      : (current & 1) != 0;
+                if(west_equal)
+                    todo &= ~(previous & ~UInt64(1));
+            }
+            previous = current;
+
+            Index root = i;
+            for(int k = 0; todo != 0; ++k, todo >>= 1)
+            {
+                if((todo & 1) == 0)
+                    continue;
+                if(adjacent)
+                    todo &= ~(adjacent[k] >> k);
+
+                Index neighbor = Index(i + index_offsets[k]);
+                if(crossing)
+                {
+                    regions_.makeUnion(i, neighbor);
+                }
+                else if(root == i)
+                {
+                    // the present point is still a singleton: just attach it to the
+                    // neighbor's parent, which has a smaller index by construction
+                    root = regions_.parent(neighbor);
+                    regions_.setParent(i, root);
+                }
+                else
+                {
+                    root = regions_.makeUnionExclusive(root, neighbor);
+                }
+            }
+            if(!crossing && root == i)
+                regions_.makeSet(i);
+        }
+    }
+
+        // The passes below only need 'regions_' because all background points
+        // are attached to index 0. The points in [start, stop) form the index
+        // range [index(start), end(stop)).
+    Index end(Shape const & stop) const
+    {
+        Shape e;
+        e[N-1] = stop[N-1];
+        return index(e);
+    }
+
+    MultiArrayIndex countRegions(Shape const & start, Shape const & stop) const
+    {
+        MultiArrayIndex count = 0;
+        for(Index i = index(start), e = end(stop); i < e; ++i)
+            if(regions_.isRoot(i))
+                ++count;
+        return count;
+    }
+
+        // Store the final labels (starting at 'label' + 1) at the roots in [start, stop).
+        // To distinguish them from indices, the labels are offset by the size of 'regions_'.
+    void labelRegions(Shape const & start, Shape const & stop, MultiArrayIndex label)
+    {
+        Index offset = Index(regions_.size() + label);
+        for(Index i = index(start), e = end(stop); i < e; ++i)
+            if(regions_.isRoot(i))
+                regions_.setParent(i, ++offset);
+    }
+
+    void initBackground()
+    {
+        regions_.makeSet(0);
+    }
+
+    void labelBackground()
+    {
+        regions_.setParent(0, Index(regions_.size()));
+    }
+
+    template <class Label, class S2>
+    void relabel(Shape const & start, Shape const & stop,
+                 MultiArrayView<N, Label, S2> labels) const
+    {
+        MultiArrayIndex w = shape_[0],
+                        l0 = labels.stride(0);
+        Index size = Index(regions_.size());
+        forEachLine(start, stop, [&](Shape const & c)
+        {
+            Label * l = &labels[c];
+            Index i = index(c);
+            for(MultiArrayIndex x = 0; x < w; ++x, ++i)
+            {
+                Index v = regions_.parent(i);
+                while(v < size)
+                    v = regions_.parent(v);
+                l[x*l0] = Label(v - size);
+            }
+        });
+    }
+
+  private:
+    MultiArrayView<N, T, S> const & data_;
+    Shape shape_, scan_strides_;
+    bool has_background_;
+    T background_;
+    Equal const & equal_;
+    ConcurrentUnionFindArray<Index> regions_;
+    ArrayVector<Shape> offsets_;
+    ArrayVector<MultiArrayIndex> data_offsets_, index_offsets_;
+    ArrayVector<UInt64> adjacent_;
+    bool run_rule_;
+};
+
+template <class Index,
+          unsigned int N, class T, class S1,
+          class Label, class S2,
+          class Equal>
+Label
+parallelLabelMultiArrayImpl(MultiArrayView<N, T, S1> const & data,
+                            MultiArrayView<N, Label, S2> labels,
+                            NeighborhoodType neighborhood,
+                            bool hasBackground, T const & background,
+                            Equal const & equal,
+                            ParallelOptions const & options)
+{
+    typedef TinyVector<MultiArrayIndex, N> Shape;
+
+    ParallelLabeling<N, T, S1, Index, Equal> labeling(data, neighborhood,
+                                                      hasBackground, background, equal);
+
+    Shape shape = data.shape();
+    MultiArrayIndex extent = shape[N-1],
+                    nSlabs = (N == 1)
+                                 ? 1
+                                 : parallel_slab_count(options, extent);
+
+    auto slabStart = [&](MultiArrayIndex k)
+    {
+        Shape start;
+        start[N-1] = parallel_slab_bound(k, nSlabs, extent);
+        return start;
+    };
+    auto slabStop = [&](MultiArrayIndex k)
+    {
+        Shape stop(shape);
+        stop[N-1] = parallel_slab_bound(k+1, nSlabs, extent);
+        return stop;
+    };
+
+    labeling.initBackground();
+
+    // find the connected components within each slab
+    parallel_foreach(options, nSlabs,
+        [&](size_t /* thread_id */, std::ptrdiff_t k)
+        {
+            labeling.scan(slabStart(k), slabStop(k), false);
+        });
+
+    // merge the components across the slab borders
+    if(nSlabs > 1)
+    {
+        parallel_foreach(options, nSlabs-1,
+            [&](size_t /* thread_id */, std::ptrdiff_t k)
+            {
+                Shape start = slabStart(k+1),
+                      stop(shape);
+                stop[N-1] = start[N-1] + 1;
+                labeling.scan(start, stop, true);
+            });
+    }
+
+    // number the regions consecutively in the scan order of their first points
+    ArrayVector<MultiArrayIndex> counts(nSlabs);
+    parallel_foreach(options, nSlabs,
+        [&](size_t /* thread_id */, std::ptrdiff_t k)
+        {
+            counts[k] = labeling.countRegions(slabStart(k), slabStop(k));
+        });
+
+    MultiArrayIndex count = 0;
+    for(MultiArrayIndex k = 0; k < nSlabs; ++k)
+    {
+        MultiArrayIndex c = counts[k];
+        counts[k] = count;
+        count += c;
+    }
+    vigra_precondition((double)count <= (double)NumericTraits<Label>::max(),
+        "labelMultiArray(): Need more labels than can be represented in the destination type.");
+
+    parallel_foreach(options, nSlabs,
+        [&](size_t /* thread_id */, std::ptrdiff_t k)
+        {
+            labeling.labelRegions(slabStart(k), slabStop(k), counts[k]);
+        });
+    labeling.labelBackground();
+
+    parallel_foreach(options, nSlabs,
+        [&](size_t /* thread_id */, std::ptrdiff_t k)
+        {
+            labeling.relabel(slabStart(k), slabStop(k), labels);
+        });
+
+    return Label(count);
+}
+
+template <unsigned int N, class T, class S1,
+                          class Label, class S2,
+          class Equal>
+Label
+parallelLabelMultiArray(MultiArrayView<N, T, S1> const & data,
+                        MultiArrayView<N, Label, S2> labels,
+                        NeighborhoodType neighborhood,
+                        bool hasBackground, T const & background,
+                        Equal const & equal,
+                        ParallelOptions const & options)
+{
+    vigra_precondition(data.shape() == labels.shape(),
+        "labelMultiArray(): shape mismatch between input and output.");
+
+    if(neighborhood == IndirectNeighborhood && N > 4)
+    {
+        // too many back neighbors for ParallelLabeling, use the sequential algorithm
+        GridGraph<N, undirected_tag> graph(data.shape(), neighborhood);
+        if(hasBackground)
+            return lemon_graph::labelGraphWithBackground(graph, data, labels, background, equal);
+        else
+            return lemon_graph::labelGraph(graph, data, labels, equal);
+    }
+
+    // the index type must also hold the array size plus the number of regions
+    if(2*(data.size() + 1) < (MultiArrayIndex)NumericTraits<UInt32>::max())
+        return parallelLabelMultiArrayImpl<UInt32>(data, labels, neighborhood,
+                                                   hasBackground, background, equal, options);
+    else
+        return parallelLabelMultiArrayImpl<UInt64>(data, labels, neighborhood,
+                                                   hasBackground, background, equal, options);
+}
+
+} // namespace detail
+
 /********************************************************/
 /*                                                      */
 /*                     labelMultiArray                  */
@@ -385,7 +845,7 @@ class LabelOptions
 
 /** \brief Find the connected components of a MultiArray with arbitrary many dimensions.
 
-    See also \ref labelMultiArrayBlockwise() for a parallel version of this algorithm.
+    See also \ref labelMultiArrayBlockwise() for a blockwise version of this algorithm.
 
     By specifying a background value in the \ref vigra::LabelOptions, this function
     can also realize the behavior of \ref labelMultiArrayWithBackground().
@@ -415,6 +875,32 @@ class LabelOptions
                         LabelOptions const & options,
                         Equal equal = std::equal<T>());
 
+        // multi-threaded labeling
+        template <unsigned int N, class T, class S1,
+                                  class Label, class S2>
+        Label
+        labelMultiArray(MultiArrayView<N, T, S1> const & data,
+                        MultiArrayView<N, Label, S2> labels,
+                        NeighborhoodType neighborhood,
+                        ParallelOptions const & parallel);
+
+        template <unsigned int N, class T, class S1,
+                                  class Label, class S2>
+        Label
+        labelMultiArray(MultiArrayView<N, T, S1> const & data,
+                        MultiArrayView<N, Label, S2> labels,
+                        LabelOptions const & options,
+                        ParallelOptions const & parallel);
+
+        template <unsigned int N, class T, class S1,
+                                  class Label, class S2,
+                  class Equal>
+        Label
+        labelMultiArray(MultiArrayView<N, T, S1> const & data,
+                        MultiArrayView<N, Label, S2> labels,
+                        LabelOptions const & options,
+                        Equal equal,
+                        ParallelOptions const & parallel);
     }
     \endcode
 
@@ -433,6 +919,24 @@ class LabelOptions
     <tt>IndirectNeighborhood</tt> (which corresponds to
     8-neighborhood in 2D and 26-neighborhood in 3D).
 
+    When \ref vigra::ParallelOptions are passed, the array is labeled by multiple
+    threads in memory: The array is split into slabs along its last axis, and all
+    threads operate on a shared union-find structure over the points (see
+    \ref vigra::ConcurrentUnionFindArray), which is updated by atomic compare-and-swap
+    operations. First, each thread finds the connected components within its slabs,
+    and then the components are merged across the slab borders. For the default equality
+    predicate, the scan skips redundant unions: in the indirect neighborhood, the equal
+    back neighbors are processed in a decision-tree order, such that neighbors adjacent
+    to an already united neighbor are skipped (e.g. a single union suffices in 2D and 3D
+    when the neighbor above or in front of the current point is equal). In the direct
+    neighborhood, a neighbor is not united with the current point when it merely continues
+    a run of equal points whose predecessor was united already. The labels are numbered
+    in the scan order of the regions' first points, so that the result is identical to
+    that of the sequential algorithm, regardless of the number of threads. The union-find
+    structure requires 4 bytes per point (8 bytes for arrays with more than 2<sup>31</sup>
+    points) in addition to <tt>labels</tt>. Arrays with more than four dimensions are
+    labeled sequentially in the indirect neighborhood.
+
     Return:  the highest region label used
 
     <b> Usage:</b>
@@ -455,6 +959,10 @@ class LabelOptions
     max_region_label = labelMultiArray(src, dest,
                                        LabelOptions().neighborhood(DirectNeighborhood)
                                                      .ignoreBackgroundValue(0));
+
+    // find 26-connected regions with 8 threads
+    max_region_label = labelMultiArray(src, dest, IndirectNeighborhood,
+                                       ParallelOptions().numThreads(8));
     \endcode
 
     <b> Required Interface:</b>
@@ -526,6 +1034,45 @@ labelMultiArray(MultiArrayView<N, T, S1> const & data,
         return labelMultiArray(data, labels, options.getNeighborhood(), equal);
 }
 
+template <unsigned int N, class T, class S1,
+                          class Label, class S2,
+          class Equal>
+inline Label
+labelMultiArray(MultiArrayView<N, T, S1> const & data,
+                MultiArrayView<N, Label, S2> labels,
+                LabelOptions const & options,
+                Equal equal,
+                ParallelOptions const & parallel)
+{
+    return detail::parallelLabelMultiArray(data, labels, options.getNeighborhood(),
+                                           options.hasBackgroundValue(),
+                                           options.template getBackgroundValue<T>(),
+                                           equal, parallel);
+}
+
+template <unsigned int N, class T, class S1,
+                          class Label, class S2>
+inline Label
+labelMultiArray(MultiArrayView<N, T, S1> const & data,
+                MultiArrayView<N, Label, S2> labels,
+                LabelOptions const & options,
+                ParallelOptions const & parallel)
+{
+    return labelMultiArray(data, labels, options, std::equal_to<T>(), parallel);
+}
+
+template <unsigned int N, class T, class S1,
+                          class Label, class S2>
+inline Label
+labelMultiArray(MultiArrayView<N, T, S1> const & data,
+                MultiArrayView<N, Label, S2> labels,
+                NeighborhoodType neighborhood,
+                ParallelOptions const & parallel)
+{
+    return labelMultiArray(data, labels, LabelOptions().neighborhood(neighborhood),
+                           std::equal_to<T>(), parallel);
+}
+
 /********************************************************/
 /*                                                      */
 /*           labelMultiArrayWithBackground              */
@@ -538,7 +1085,9 @@ labelMultiArray(MultiArrayView<N, T, S1> const & data,
     From a user's point of view, this function is no longer needed because
     \ref labelMultiArray() can realizes the same behavior when an appropriate
     background value is specified in its \ref vigra::LabelOptions. Similarly,
-    \ref labelMultiArrayBlockwise() implements a parallel version of this algorithm.
+    \ref labelMultiArrayBlockwise() implements a parallel version of this algorithm,
+    and \ref labelMultiArrayRunLength() a version for sparse data that operates
+    on runs of equal values.
 
     <b> Declaration:</b>
 
@@ -626,6 +1175,456 @@ labelMultiArrayWithBackground(MultiArrayView<N, T, S1> const & data,
     return labelMultiArrayWithBackground(data, labels, neighborhood, backgroundValue, std::equal_to<T>());
 }
 
+/********************************************************/
+/*                                                      */
+/*                   RunLengthLabels                    */
+/*                                                      */
+/********************************************************/
+
+/** \brief Run-length encoded label array.
+
+    Stores the result of \ref labelMultiArrayRunLength() without materializing a
+    dense label array. The non-background points of each line along axis 0 are
+    represented by runs, i.e. by intervals <tt>[begin, end)</tt> of consecutive
+    points with the same label. Lines are numbered in scan order, and the runs
+    are sorted by line and position, so that the memory consumption and the
+    cost of iterating over all runs are proportional to the number of runs.
+    Points that are not covered by a run have label zero.
+
+    <b>\#include</b> \<vigra/multi_labeling.hxx\><br>
+    Namespace: vigra
+*/
+template <unsigned int N, class Label>
+class RunLengthLabels
+{
+  public:
+        /** \brief A run of points with equal label.
+
+            The run covers the points <tt>begin <= x < end</tt> along axis 0
+            of the line with scan-order index <tt>line</tt>.
+        */
+    struct Run
+    {
+        MultiArrayIndex line, begin, end;
+        Label label;
+    };
+
+    typedef typename MultiArrayShape<N>::type        shape_type;
+    typedef Label                                    value_type;
+    typedef typename ArrayVector<Run>::iterator       iterator;
+    typedef typename ArrayVector<Run>::const_iterator const_iterator;
+
+        /** \brief Construct an empty array of shape zero.
+        */
+    RunLengthLabels()
+    {
+        reshape(shape_type());
+    }
+
+        /** \brief Construct an array of the given shape without any runs
+            (i.e. all points have label zero).
+        */
+    explicit RunLengthLabels(shape_type const & shape)
+    {
+        reshape(shape);
+    }
+
+        /** \brief Change the shape and remove all runs.
+        */
+    void reshape(shape_type const & shape)
+    {
+        shape_ = shape;
+        line_strides_ = shape_type();
+        if(N > 1)
+            line_strides_[1] = 1;
+        for(unsigned int k = 2; k < N; ++k)
+            line_strides_[k] = line_strides_[k-1] * shape[k-1];
+        runs_.clear();
+    }
+
+        /** \brief Append a run.
+
+            The runs must be appended in scan order, i.e. sorted by line and position.
+        */
+    void appendRun(MultiArrayIndex line, MultiArrayIndex begin, MultiArrayIndex end, Label label)
+    {
+        vigra_precondition(0 <= begin && begin < end && end <= shape_[0],
+            "RunLengthLabels::appendRun(): run out of range.");
+        vigra_precondition(runs_.empty() || runs_.back().line < line ||
+                           (runs_.back().line == line && runs_.back().end <= begin),
+            "RunLengthLabels::appendRun(): runs must be appended in scan order.");
+        Run run = { line, begin, end, label };
+        runs_.push_back(run);
+    }
+
+        /** \brief The shape of the label array.
+        */
+    shape_type const & shape() const
+    {
+        return shape_;
+    }
+
+        /** \brief The number of runs.
+        */
+    MultiArrayIndex numberOfRuns() const
+    {
+        return runs_.size();
+    }
+
+        /** \brief The scan-order index of the line along axis 0 that contains point \a p.
+        */
+    MultiArrayIndex lineIndex(shape_type const & p) const
+    {
+        return dot(p, line_strides_);
+    }
+
+        /** \brief Iterator to the first run (in scan order).
+        */
+    iterator begin()
+    {
+        return runs_.begin();
+    }
+
+    const_iterator begin() const
+    {
+        return runs_.begin();
+    }
+
+        /** \brief Iterator past the last run.
+        */
+    iterator end()
+    {
+        return runs_.end();
+    }
+
+    const_iterator end() const
+    {
+        return runs_.end();
+    }
+
+        /** \brief Iterator to the first run in the given line.
+        */
+    const_iterator lineBegin(MultiArrayIndex line) const
+    {
+        return std::lower_bound(runs_.begin(), runs_.end(), line,
+                                [](Run const & r, MultiArrayIndex l) { return r.line < l; });
+    }
+
+        /** \brief Iterator past the last run in the given line.
+        */
+    const_iterator lineEnd(MultiArrayIndex line) const
+    {
+        return lineBegin(line + 1);
+    }
+
+        /** \brief The label of point \a p (found by binary search).
+        */
+    Label operator[](shape_type const & p) const
+    {
+        MultiArrayIndex line = lineIndex(p);
+        const_iterator r = std::upper_bound(runs_.begin(), runs_.end(), p[0],
+            [line](MultiArrayIndex x, Run const & r)
+            {
+                return line < r.line || (line == r.line && x < r.begin);
+            });
+        if(r == runs_.begin())
+            return Label();
+        --r;
+        return r->line == line && p[0] < r->end
+                  ? r->label
+                  : Label();
+    }
+
+        /** \brief Decode the labels of the box starting at \a start into a dense array.
+
+            The shape of the box is given by the shape of \a subarray. Use
+            <tt>checkoutSubarray(shape_type(), labels)</tt> to decode the entire array.
+        */
+    template <class U, class Stride>
+    void checkoutSubarray(shape_type const & start, MultiArrayView<N, U, Stride> subarray) const
+    {
+        shape_type stop = start + subarray.shape();
+        vigra_precondition(allLessEqual(shape_type(), start) && allLessEqual(stop, shape_),
+            "RunLengthLabels::checkoutSubarray(): subarray out of range.");
+
+        subarray.init(U());
+        if(subarray.size() == 0)
+            return;
+
+        shape_type lines(subarray.shape());
+        lines[0] = 1;
+        MultiArrayIndex stride = subarray.stride(0);
+
+        MultiCoordinateIterator<N> i(lines),
+                                   iend(i.getEndIterator());
+        for(; i != iend; ++i)
+        {
+            MultiArrayIndex line = lineIndex(start + *i);
+            U * d = &subarray[*i];
+            const_iterator r = lineBegin(line);
+            for(; r != runs_.end() && r->line == line && r->begin < stop[0]; ++r)
+            {
+                MultiArrayIndex b = std::max(r->begin, start[0]) - start[0],
+                                e = std::min(r->end, stop[0]) - start[0];
+                for(MultiArrayIndex x = b; x < e; ++x)
+                    d[x*stride] = static_cast<U>(r->label);
+            }
+        }
+    }
+
+  private:
+    shape_type shape_, line_strides_;
+    ArrayVector<Run> runs_;
+};
+
+namespace detail {
+
+    // Connected components labeling of the runs of equal values along axis 0.
+    // The lines are visited in scan order, and each run is united with the
+    // overlapping runs of equal value in the preceding neighbor lines, i.e. the
+    // lines that contain back neighbors of the run's points. In the direct
+    // neighborhood, these are the lines one step back along a single axis, and
+    // runs must overlap. In the indirect neighborhood, these are all lines whose
+    // offset is lexicographically negative, and diagonally touching runs are also
+    // connected. Since the runs of each line are sorted, the overlapping runs are
+    // found by merging the run lists, so that the cost of the unions is proportional
+    // to the number of runs and overlaps. Adjacent runs on the same line have
+    // different values and are never united. The tentative region indices are
+    // created in the scan order of the runs, exactly like the indices of
+    // lemon_graph::labelGraphWithBackground() are created in the scan order
+    // of the points, so that the final labels are identical.
+template <unsigned int N, class T, class S, class Label>
+Label
+labelMultiArrayRunLengthImpl(MultiArrayView<N, T, S> const & data,
+                             RunLengthLabels<N, Label> & runs,
+                             NeighborhoodType neighborhood,
+                             T backgroundValue)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    Shape shape = data.shape();
+    runs.reshape(shape);
+    if(data.size() == 0)
+        return 0;
+
+    MultiArrayIndex width = shape[0],
+                    stride = data.stride(0),
+                    tolerance = neighborhood == DirectNeighborhood ? 0 : 1;
+    Shape lines(shape);
+    lines[0] = 1;
+
+    // offsets of the neighbor lines that contain back neighbors
+    ArrayVector<Shape> offsets;
+    ArrayVector<MultiArrayIndex> lineOffsets;
+    Shape cube(3);
+    cube[0] = 1;
+    MultiCoordinateIterator<N> c(cube),
+                               cend(c.getEndIterator());
+    for(; c != cend; ++c)
+    {
+        Shape o = *c - Shape(1);
+        o[0] = 0;
+        int last = N-1;
+        while(last > 0 && o[last] == 0)
+            --last;
+        if(last == 0 || o[last] > 0)
+            continue;
+        if(neighborhood == DirectNeighborhood && sum(abs(o)) != 1)
+            continue;
+        offsets.push_back(o);
+        lineOffsets.push_back(runs.lineIndex(o));
+    }
+
+    ArrayVector<T> values;                       // the value of each run
+    ArrayVector<MultiArrayIndex> lineStarts(prod(lines) + 1),
+                                 cursors(offsets.size()),
+                                 cursorEnds(offsets.size());
+    UnionFindArray<Label> regions;
+
+    MultiCoordinateIterator<N> line(lines),
+                               lend(line.getEndIterator());
+    for(MultiArrayIndex l = 0; line != lend; ++line, ++l)
+    {
+        // pass 1a: find the runs of the current line
+        MultiArrayIndex first = runs.numberOfRuns();
+        lineStarts[l] = first;
+        T const * p = &data[*line];
+        for(MultiArrayIndex x = 0; x < width;)
+        {
+            MultiArrayIndex begin = x;
+            T value = p[x*stride];
+            for(++x; x < width && p[x*stride] == value; ++x)
+                ;
+            if(value == backgroundValue)
+                continue;
+            runs.appendRun(l, begin, x, Label());
+            values.push_back(value);
+        }
+        MultiArrayIndex last = runs.numberOfRuns();
+        if(first == last)
+            continue;
+
+        // pass 1b: unite the runs with the overlapping runs in the neighbor lines
+        for(unsigned int k = 0; k < offsets.size(); ++k)
+        {
+            Shape n = *line + offsets[k];
+            if(allLessEqual(Shape(), n) && allLess(n, shape))
+            {
+                cursors[k] = lineStarts[l + lineOffsets[k]];
+                cursorEnds[k] = lineStarts[l + lineOffsets[k] + 1];
+            }
+            else
+            {
+                cursors[k] = cursorEnds[k] = 0;
+            }
+        }
+
+        typename RunLengthLabels<N, Label>::iterator r = runs.begin();
+        for(MultiArrayIndex i = first; i < last; ++i)
+        {
+            MultiArrayIndex begin = r[i].begin - tolerance,
+                            end = r[i].end + tolerance;
+            Label currentIndex = regions.nextFreeIndex();
+            for(unsigned int k = 0; k < offsets.size(); ++k)
+            {
+                MultiArrayIndex j = cursors[k], jend = cursorEnds[k];
+                while(j < jend && r[j].end <= begin)
+                    ++j;
+                cursors[k] = j;
+                for(; j < jend && r[j].begin < end; ++j)
+                    if(values[j] == values[i])
+                        currentIndex = regions.makeUnion(r[j].label, currentIndex);
+            }
+            r[i].label = regions.finalizeIndex(currentIndex);
+        }
+    }
+
+    Label count = regions.makeContiguous();
+
+    // pass 2: make component labels contiguous
+    for(typename RunLengthLabels<N, Label>::iterator r = runs.begin(); r != runs.end(); ++r)
+        r->label = regions.findLabel(r->label);
+    return count;
+}
+
+} // namespace detail
+
+/********************************************************/
+/*                                                      */
+/*               labelMultiArrayRunLength               */
+/*                                                      */
+/********************************************************/
+
+/** \brief Find the connected components of a MultiArray excluding the background,
+     using a run-length encoding of the lines along axis 0.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+
+        // run-length encoded result
+        template <unsigned int N, class T, class S1,
+                                  class Label>
+        Label
+        labelMultiArrayRunLength(MultiArrayView<N, T, S1> const & data,
+                                 RunLengthLabels<N, Label> & labels,
+                                 NeighborhoodType neighborhood = DirectNeighborhood,
+                                 T backgroundValue = T());
+
+        // dense result
+        template <unsigned int N, class T, class S1,
+                                  class Label, class S2>
+        Label
+        labelMultiArrayRunLength(MultiArrayView<N, T, S1> const & data,
+                                 MultiArrayView<N, Label, S2> labels,
+                                 NeighborhoodType neighborhood = DirectNeighborhood,
+                                 T backgroundValue = T());
+    }
+    \endcode
+
+    This function computes the same labels as \ref labelMultiArrayWithBackground()
+    (with the default equality predicate), but is much faster when the non-background
+    points form long runs along axis 0, e.g. for sparse binary masks. Each line along
+    axis 0 is scanned once to find the runs of equal non-background values. Then, the
+    runs are united with the overlapping runs of the same value in the preceding
+    neighboring lines (including diagonally touching runs in the indirect neighborhood).
+    Thus, only the runs are involved in the union-find operations, rather than every
+    point and every neighbor. Background points get label zero, and the regions are
+    numbered consecutively starting at one in the scan order of their first points.
+
+    The first version returns the labels as a \ref vigra::RunLengthLabels object, so that
+    no dense label array must be allocated. Its memory consumption is proportional to
+    the number of runs, and individual labels or subarrays can be decoded on demand.
+    The second version decodes the labels into the given array.
+
+    Return: the number of non-background regions found (= highest region label,
+    because background has label 0)
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/multi_labeling.hxx\><br>
+    Namespace: vigra
+
+    \code
+    MultiArray<3, UInt8> mask(Shape3(w,h,d));
+    ... // fill mask, 0 is background
+
+    // find 26-connected regions in run-length encoding
+    RunLengthLabels<3, UInt32> runs;
+    UInt32 max_region_label = labelMultiArrayRunLength(mask, runs, IndirectNeighborhood);
+
+    // iterate over the runs of all regions
+    for(auto const & run: runs)
+        std::cout << "line " << run.line << ", x = " << run.begin << " ... " << run.end-1
+                  << ": label " << run.label << "\n";
+
+    // decode a subarray
+    MultiArray<3, UInt32> labels(Shape3(64));
+    runs.checkoutSubarray(Shape3(128, 128, 0), labels);
+
+    // find 6-connected regions in a dense label array
+    MultiArray<3, UInt32> dense(mask.shape());
+    max_region_label = labelMultiArrayRunLength(mask, dense);
+    \endcode
+
+    <b> Required Interface:</b>
+
+    \code
+    T t, backgroundValue;
+    t == backgroundValue        // T is equality comparable
+    \endcode
+*/
+doxygen_overloaded_function(template <...> unsigned int labelMultiArrayRunLength)
+
+template <unsigned int N, class T, class S1,
+                          class Label>
+inline Label
+labelMultiArrayRunLength(MultiArrayView<N, T, S1> const & data,
+                         RunLengthLabels<N, Label> & labels,
+                         NeighborhoodType neighborhood = DirectNeighborhood,
+                         T backgroundValue = T())
+{
+    return detail::labelMultiArrayRunLengthImpl(data, labels, neighborhood, backgroundValue);
+}
+
+template <unsigned int N, class T, class S1,
+                          class Label, class S2>
+inline Label
+labelMultiArrayRunLength(MultiArrayView<N, T, S1> const & data,
+                         MultiArrayView<N, Label, S2> labels,
+                         NeighborhoodType neighborhood = DirectNeighborhood,
+                         T backgroundValue = T())
+{
+    vigra_precondition(data.shape() == labels.shape(),
+        "labelMultiArrayRunLength(): shape mismatch between input and output.");
+
+    RunLengthLabels<N, Label> runs;
+    Label count = detail::labelMultiArrayRunLengthImpl(data, runs, neighborhood, backgroundValue);
+    runs.checkoutSubarray(typename MultiArrayShape<N>::type(), labels);
+    return count;
+}
+
 //@}
 
 } // namespace vigra
@@ -38,6 +38,9 @@
 
 #include <functional>
 #include <limits>
+#include <memory>
+#include <queue>
+#include <vector>
 #include "mathutil.hxx"
 #include "multi_array.hxx"
 #include "multi_math.hxx"
@@ -47,6 +50,7 @@
 #include "watersheds.hxx"
 #include "bucket_queue.hxx"
 #include "union_find.hxx"
+#include "threadpool.hxx"
 
 namespace vigra {
 
@@ -219,6 +223,24 @@ generateWatershedSeeds(Graph const & g,
     return labelGraphWithBackground(g, minima, seeds, MarkerType(0), std::equal_to<MarkerType>());
 }
 
+    // select the priority queue for seeded watersheds: the priorities never
+    // decrease during flooding, so that a radix heap can be used for all built-in
+    // types except 8-bit integers (where PriorityQueue is a BucketQueue) and
+    // types without radix keys (e.g. long double, which use a heap)
+template <class Node, class CostType,
+          bool UseRadix = detail::RadixPriorityKeySupported<CostType>::value &&
+                          (sizeof(CostType) > 1)>
+struct SeededWatershedsQueue
+{
+    typedef PriorityQueue<Node, CostType, true> type;
+};
+
+template <class Node, class CostType>
+struct SeededWatershedsQueue<Node, CostType, true>
+{
+    typedef RadixPriorityQueue<Node, CostType> type;
+};
+
 #ifdef __GNUC__
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wsign-compare"
@@ -237,7 +259,7 @@ seededWatersheds(Graph const & g,
     typedef typename T1Map::value_type  CostType;
     typedef typename T2Map::value_type  LabelType;
 
-    PriorityQueue<Node, CostType, true> pqueue;
+    typename SeededWatershedsQueue<Node, CostType>::type pqueue;
 
     bool keepContours = ((options.terminate & KeepContours) != 0);
     LabelType maxRegionLabel = 0;
@@ -327,10 +349,328 @@ seededWatersheds(Graph const & g,
     return maxRegionLabel;
 }
 
+    // An entry of the parallel flooding: 'order' is the position of the push
+    // in the sequential algorithm, which breaks ties between equal priorities.
+template <class Node, class CostType>
+struct ParallelWatershedsEntry
+{
+    Node node;
+    CostType priority;
+    UInt64 order;
+
+    ParallelWatershedsEntry(Node const & n = Node(), CostType p = CostType(), UInt64 o = 0)
+    : node(n), priority(p), order(o)
+    {}
+
+    bool operator>(ParallelWatershedsEntry const & other) const
+    {
+        return other.priority < priority ||
+               (!(priority < other.priority) && other.order < order);
+    }
+};
+
+    // Parallel version of seededWatersheds() for GridGraphs. The queue is processed
+    // in batches of consecutive entries. The elements of a batch visit their
+    // neighbors concurrently, and each unlabeled neighbor is claimed with an atomic
+    // minimum of (position in batch, arc index), so that it is won by the element
+    // that would label it first in the sequential algorithm. However, a neighbor
+    // pushed with a priority below the level of a later batch element would be
+    // popped before the latter by the sequential algorithm. Therefore, only the
+    // longest batch prefix that is unaffected by such pushes is committed, and the
+    // remaining elements are processed again in the next batch. Together with the
+    // first-in first-out order of equal priorities (which is preserved by
+    // numbering all pushes), this makes the result identical to seededWatersheds().
+    // When the order of equal priorities is unspecified (cost types without
+    // BucketQueue or RadixPriorityQueue) or contours shall be kept, the sequential
+    // algorithm is called.
+template <unsigned int N, class DirectedTag, class T1Map, class T2Map>
+typename T2Map::value_type
+parallelSeededWatersheds(GridGraph<N, DirectedTag> const & g,
+                         T1Map const & data,
+                         T2Map & labels,
+                         WatershedOptions const & options,
+                         ParallelOptions const & parallel)
+{
+    typedef GridGraph<N, DirectedTag>                   Graph;
+    typedef typename Graph::Node                        Node;
+    typedef typename Graph::OutArcIt                    neighbor_iterator;
+    typedef typename T1Map::value_type                  CostType;
+    typedef typename T2Map::value_type                  LabelType;
+    typedef ParallelWatershedsEntry<Node, CostType>     Entry;
+    typedef std::pair<Node, UInt64>                     QueueValue;
+
+    static const bool fifoQueue = detail::RadixPriorityKeySupported<CostType>::value &&
+                                  (sizeof(CostType) > 1 || std::is_same<CostType, UInt8>::value);
+    int nThreads = parallel.getActualNumThreads();
+    if(!fifoQueue || nThreads <= 1 || (options.terminate & KeepContours) != 0)
+        return seededWatersheds(g, data, labels, options);
+
+    typename SeededWatershedsQueue<QueueValue, CostType>::type pqueue;
+    UInt64 order = 0;
+
+    // find all seeds that have an unlabeled neighbor, and register them in scan order
+    Node shape = g.shape();
+    MultiArrayIndex nSlabs = parallel_slab_count(parallel, shape[N-1]);
+    std::vector<std::vector<Node> > seeds(nSlabs);
+    std::vector<LabelType> maxLabels(nSlabs, LabelType());
+    parallel_foreach_slab(parallel, shape, N-1,
+        [&](size_t /* thread_id */, std::ptrdiff_t k, Node const & start, Node const & stop)
+        {
+            MultiCoordinateIterator<N> i(stop - start),
+                                       end(i.getEndIterator());
+            for(; i != end; ++i)
+            {
+                Node node = start + *i;
+                LabelType label = labels[node];
+                if(label == 0)
+                    continue;
+                if(maxLabels[k] < label)
+                    maxLabels[k] = label;
+                for (neighbor_iterator arc(g, node); arc != INVALID; ++arc)
+                {
+                    if(labels[g.target(*arc)] == 0)
+                    {
+                        seeds[k].push_back(node);
+                        break;
+                    }
+                }
+            }
+        });
+
+    LabelType maxRegionLabel = 0;
+    for(MultiArrayIndex k = 0; k < nSlabs; ++k)
+    {
+        if(maxRegionLabel < maxLabels[k])
+            maxRegionLabel = maxLabels[k];
+        for(std::size_t i = 0; i < seeds[k].size(); ++i)
+        {
+            Node const & node = seeds[k][i];
+            if(labels[node] == options.biased_label)
+                pqueue.push(QueueValue(node, order++), data[node] * options.bias);
+            else
+                pqueue.push(QueueValue(node, order++), data[node]);
+        }
+        std::vector<Node>().swap(seeds[k]);
+    }
+
+    // The entries that must not be put into 'pqueue': the batch elements that
+    // were not committed, and pushes below the priority of the last entry inspected
+    // in 'pqueue' (which RadixPriorityQueue cannot accept).
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > pending;
+    bool queueSeen = false;
+    CostType queueLevel = CostType();
+
+    UInt32 const unclaimed = NumericTraits<UInt32>::max();
+    MultiArrayIndex const degree = g.maxDegree(),
+                          maxBatchSize = std::max<MultiArrayIndex>(1,
+                                             std::min<MultiArrayIndex>(1 << 16, unclaimed / (degree + 1))),
+                          minBatchSize = std::min<MultiArrayIndex>(64, maxBatchSize),
+                          minChunkSize = 64;
+    MultiArrayIndex batchSize = minBatchSize;
+
+    std::unique_ptr<threading::atomic<UInt32>[]> claims(new threading::atomic<UInt32>[g.nodeNum()]);
+    parallel_foreach_slab(parallel, g.nodeNum(),
+        [&](size_t /* thread_id */, std::ptrdiff_t, MultiArrayIndex begin, MultiArrayIndex end)
+        {
+            for(MultiArrayIndex i = begin; i < end; ++i)
+                claims[i].store(unclaimed, threading::memory_order_relaxed);
+        },
+        1 << 16);
+
+    // per batch element: the label, and whether it labels any neighbor (and the
+    // lowest priority of these neighbors); per arc: the target, its priority, and
+    // its state (0: target already labeled, 1: unlabeled, 2: claimed by this arc)
+    std::vector<Entry> batch;
+    std::vector<LabelType> batchLabels;
+    std::vector<UInt8> hasPushes;
+    std::vector<CostType> lowestPushes;
+    std::vector<Node> targets;
+    std::vector<CostType> priorities;
+    std::vector<UInt8> states;
+
+    bool stopAtThreshold = (options.terminate & StopAtThreshold) != 0;
+
+    for(;;)
+    {
+        // take the next entries in the order of the sequential algorithm
+        batch.clear();
+        while((MultiArrayIndex)batch.size() < batchSize)
+        {
+            bool fromQueue = false;
+            Entry entry;
+            if(!pqueue.empty())
+            {
+                entry = Entry(pqueue.top().first, CostType(pqueue.topPriority()), pqueue.top().second);
+                // RadixPriorityQueue only accepts pushes not below its top
+                queueLevel = entry.priority;
+                queueSeen = true;
+                fromQueue = pending.empty() || pending.top() > entry;
+            }
+            if(!fromQueue)
+            {
+                if(pending.empty())
+                    break;
+                entry = pending.top();
+            }
+            if(stopAtThreshold && (entry.priority > options.max_cost))
+                break;
+            batch.push_back(entry);
+            if(fromQueue)
+                pqueue.pop();
+            else
+                pending.pop();
+        }
+        if(batch.empty())
+            break;
+
+        MultiArrayIndex size = batch.size();
+        batchLabels.resize(size);
+        hasPushes.resize(size);
+        lowestPushes.resize(size);
+        targets.resize(size*degree);
+        priorities.resize(size*degree);
+        states.resize(size*degree);
+
+        // find the unlabeled neighbors and claim them
+        parallel_foreach_slab(parallel, size,
+            [&](size_t /* thread_id */, std::ptrdiff_t, MultiArrayIndex begin, MultiArrayIndex end)
+            {
+                for(MultiArrayIndex i = begin; i < end; ++i)
+                {
+                    batchLabels[i] = labels[batch[i].node];
+                    MultiArrayIndex c = i*degree;
+                    for (neighbor_iterator arc(g, batch[i].node); arc != INVALID; ++arc, ++c)
+                    {
+                        Node target = g.target(*arc);
+                        if(labels[target] != 0)
+                        {
+                            states[c] = 0;
+                            continue;
+                        }
+                        states[c] = 1;
+                        targets[c] = target;
+                        threading::atomic<UInt32> & claim = claims[g.id(target)];
+                        UInt32 rank = (UInt32)c,
+                               old = claim.load(threading::memory_order_relaxed);
+                        while(rank < old &&
+                              !claim.compare_exchange_weak(old, rank, threading::memory_order_relaxed))
+                        {}
+                    }
+                    for(; c < (i+1)*degree; ++c)
+                        states[c] = 0;
+                }
+            },
+            minChunkSize);
+
+        // determine the neighbors won by each element and their priorities
+        parallel_foreach_slab(parallel, size,
+            [&](size_t /* thread_id */, std::ptrdiff_t, MultiArrayIndex begin, MultiArrayIndex end)
+            {
+                for(MultiArrayIndex i = begin; i < end; ++i)
+                {
+                    hasPushes[i] = 0;
+                    for(MultiArrayIndex c = i*degree; c < (i+1)*degree; ++c)
+                    {
+                        if(states[c] == 0 ||
+                           claims[g.id(targets[c])].load(threading::memory_order_relaxed) != (UInt32)c)
+                            continue;
+                        states[c] = 2;
+                        CostType priority = (batchLabels[i] == options.biased_label)
+                                               ? data[targets[c]] * options.bias
+                                               : data[targets[c]];
+                        if(priority < batch[i].priority)
+                            priority = batch[i].priority;
+                        priorities[c] = priority;
+                        if(hasPushes[i] == 0 || priority < lowestPushes[i])
+                            lowestPushes[i] = priority;
+                        hasPushes[i] = 1;
+                    }
+                }
+            },
+            minChunkSize);
+
+        // the prefix of the batch whose elements are not preceded by pushes
+        // of earlier elements
+        MultiArrayIndex committed = 1;
+        bool hasLowest = hasPushes[0] != 0;
+        CostType lowest = hasLowest ? lowestPushes[0] : CostType();
+        for(; committed < size; ++committed)
+        {
+            if(hasLowest && lowest < batch[committed].priority)
+                break;
+            if(hasPushes[committed] != 0 && (!hasLowest || lowestPushes[committed] < lowest))
+            {
+                hasLowest = true;
+                lowest = lowestPushes[committed];
+            }
+        }
+
+        // label the won neighbors of the committed elements, reset the claims
+        parallel_foreach_slab(parallel, size,
+            [&](size_t /* thread_id */, std::ptrdiff_t, MultiArrayIndex begin, MultiArrayIndex end)
+            {
+                for(MultiArrayIndex c = begin*degree; c < end*degree; ++c)
+                {
+                    if(states[c] == 0)
+                        continue;
+                    claims[g.id(targets[c])].store(unclaimed, threading::memory_order_relaxed);
+                    if(states[c] == 2 && c < committed*degree)
+                        labels[targets[c]] = batchLabels[c / degree];
+                }
+            },
+            minChunkSize);
+
+        // push the won neighbors in the sequential order
+        for(MultiArrayIndex c = 0; c < committed*degree; ++c)
+        {
+            if(states[c] != 2)
+                continue;
+            if(queueSeen && priorities[c] < queueLevel)
+                pending.push(Entry(targets[c], priorities[c], order++));
+            else
+                pqueue.push(QueueValue(targets[c], order++), priorities[c]);
+        }
+        for(MultiArrayIndex i = committed; i < size; ++i)
+            pending.push(batch[i]);
+
+        // grow slowly, because the truncated part of a batch must be processed again
+        batchSize = std::max(minBatchSize, std::min(maxBatchSize, committed + committed / 8));
+    }
+
+    return maxRegionLabel;
+}
+
 #ifdef __GNUC__
 #pragma GCC diagnostic pop
 #endif
 
+template <class Graph, class T1Map, class T2Map>
+void
+prepareSeededWatersheds(Graph const & g,
+                        T1Map const & data,
+                        T2Map & labels,
+                        WatershedOptions const & options)
+{
+    SeedOptions seed_options;
+
+    // check if the user has explicitly requested seed computation
+    if(options.seed_options.mini != SeedOptions::Unspecified)
+    {
+        seed_options = options.seed_options;
+    }
+    else
+    {
+        // otherwise, don't compute seeds if 'labels' already contains them
+        if(labels.any())
+            seed_options.mini = SeedOptions::Unspecified;
+    }
+
+    if(seed_options.mini != SeedOptions::Unspecified)
+    {
+        generateWatershedSeeds(g, data, labels, seed_options);
+    }
+}
+
 } // namespace graph_detail
 
 template <class Graph, class T1Map, class T2Map>
@@ -354,25 +694,7 @@ watershedsGraph(Graph const & g,
     }
     else if(options.method == WatershedOptions::RegionGrowing)
     {
-        SeedOptions seed_options;
-
-        // check if the user has explicitly requested seed computation
-        if(options.seed_options.mini != SeedOptions::Unspecified)
-        {
-            seed_options = options.seed_options;
-        }
-        else
-        {
-            // otherwise, don't compute seeds if 'labels' already contains them
-            if(labels.any())
-                seed_options.mini = SeedOptions::Unspecified;
-        }
-
-        if(seed_options.mini != SeedOptions::Unspecified)
-        {
-            graph_detail::generateWatershedSeeds(g, data, labels, seed_options);
-        }
-
+        graph_detail::prepareSeededWatersheds(g, data, labels, options);
         return graph_detail::seededWatersheds(g, data, labels, options);
     }
     else
@@ -451,7 +773,26 @@ generateWatershedSeeds(MultiArrayView<N, T, S1> const & data,
     </ul>
 
     The option <tt>turboAlgorithm()</tt> is implied by method <tt>regionGrowing()</tt> (this is
-    in contrast to watershedsRegionGrowing(), which supports an additional algorithm in 2D only).
+    in contrast to watershedsRegionGrowing(), which supports an additional algorithm in 2D only):
+    Since the flooding level never decreases, the points are ordered by a \ref BucketQueue
+    for 8-bit data and by a \ref RadixPriorityQueue for all other built-in types (including
+    <tt>float</tt> and <tt>double</tt>, but not <tt>long double</tt>), so that no heap is needed. Points of equal priority are processed in
+    first-in first-out order, so that the result only depends on the order of the values,
+    not on the data type.
+
+    When \ref vigra::ParallelOptions are passed, the flooding of method <tt>regionGrowing()</tt>
+    is distributed over multiple threads: The queue is processed in batches of consecutive
+    points whose neighbors are visited concurrently. A neighbor reached by several points of
+    a batch is assigned to the point that would have reached it first in the sequential
+    algorithm, and a batch is only committed up to the first point that the sequential
+    algorithm would have preceded by a newly reached point. Therefore, the result is
+    identical to the sequential one, regardless of the number of threads. Since the rest
+    of a batch must be processed again, and the queue itself is maintained by a single
+    thread, the parallel version does about 1.5 to 2 times as much work in total, so that
+    it only pays off with several threads. It needs an additional 32-bit integer per
+    point. The computation is sequential for <tt>keepContours()</tt>, for
+    the union-find method and the automatic seed computation, and for data types other
+    than <tt>UInt8</tt> and the built-in arithmetic types with more than 8 bits.
 
     watershedsMultiArray() returns the number of regions found (= the highest region label, because
     labels start at 1).
@@ -467,6 +808,16 @@ generateWatershedSeeds(MultiArrayView<N, T, S1> const & data,
                              MultiArrayView<N, Label, S2> labels,  // may also hold input seeds
                              NeighborhoodType neighborhood = DirectNeighborhood,
                              WatershedOptions const & options = WatershedOptions());
+
+        // flood with multiple threads
+        template <unsigned int N, class T, class S1,
+                                  class Label, class S2>
+        Label
+        watershedsMultiArray(MultiArrayView<N, T, S1> const & data,
+                             MultiArrayView<N, Label, S2> labels,
+                             NeighborhoodType neighborhood,
+                             WatershedOptions const & options,
+                             ParallelOptions const & parallel);
     }
     \endcode
 
@@ -517,7 +868,7 @@ generateWatershedSeeds(MultiArrayView<N, T, S1> const & data,
         MultiArray<2, unsigned char> gradMag256(255.0 / (M - m) * (gradMag - m));
 
         // call region-growing algorithm with 8-neighborhood,
-        // since the data are 8-bit, a faster priority queue will be used
+        // since the data are 8-bit, a bucket queue will be used
         watershedsMultiArray(gradMag256, labeling, IndirectNeighborhood);
     }
 
@@ -541,6 +892,15 @@ generateWatershedSeeds(MultiArrayView<N, T, S1> const & data,
         // use the fast union-find algorithm with 4-neighborhood
         watershedsMultiArray(gradMag, labeling, WatershedOptions().unionFind());
     }
+
+    // example 5
+    {
+        MultiArray<2, unsigned int> labeling(src.shape());
+
+        // region growing with 8 threads, the result is the same as with one thread
+        watershedsMultiArray(gradMag, labeling, DirectNeighborhood, WatershedOptions(),
+                             ParallelOptions().numThreads(8));
+    }
     \endcode
 */
 doxygen_overloaded_function(template <...> Label watershedsMultiArray)
@@ -560,6 +920,26 @@ watershedsMultiArray(MultiArrayView<N, T, S1> const & data,
     return lemon_graph::watershedsGraph(graph, data, labels, options);
 }
 
+template <unsigned int N, class T, class S1,
+                          class Label, class S2>
+inline Label
+watershedsMultiArray(MultiArrayView<N, T, S1> const & data,
+                     MultiArrayView<N, Label, S2> labels,  // may also hold input seeds
+                     NeighborhoodType neighborhood,
+                     WatershedOptions const & options,
+                     ParallelOptions const & parallel)
+{
+    vigra_precondition(data.shape() == labels.shape(),
+        "watershedsMultiArray(): Shape mismatch between input and output.");
+
+    GridGraph<N, undirected_tag> graph(data.shape(), neighborhood);
+    if(options.method != WatershedOptions::RegionGrowing)
+        return lemon_graph::watershedsGraph(graph, data, labels, options);
+
+    lemon_graph::graph_detail::prepareSeededWatersheds(graph, data, labels, options);
+    return lemon_graph::graph_detail::parallelSeededWatersheds(graph, data, labels, options, parallel);
+}
+
 //@}
 
 } // namespace vigra
@@ -40,7 +40,11 @@
 #include "config.hxx"
 #include "error.hxx"
 #include "array_vector.hxx"
+#include "mathutil.hxx"
 #include <queue>
+#include <vector>
+#include <cstring>
+#include <type_traits>
 
 namespace vigra {
 
@@ -399,7 +403,255 @@ class PriorityQueue<ValueType, unsigned short, Ascending>
     {}
 };
 
+namespace detail {
+
+    // Map the priorities of RadixPriorityQueue to unsigned integer keys
+    // with the same order: unsigned integers are used as they are, the sign bit
+    // of signed integers is flipped, and the bit pattern of IEEE floating point
+    // numbers is flipped entirely (negative numbers) or in the sign bit only
+    // (positive numbers). Since the queue compares keys, values that compare
+    // equal must get the same key: -0.0 is mapped like +0.0. NaNs (of either
+    // sign) get the largest key, i.e. they are sorted after +infinity.
+template <int SIZE>
+struct RadixPriorityKeyType
+{
+    static_assert(SIZE == 1 || SIZE == 2 || SIZE == 4,
+        "RadixPriorityQueue: priority types must have 1, 2, 4 or 8 bytes.");
+    typedef UInt32 type;
+};
+
+template <>
+struct RadixPriorityKeyType<8>
+{
+    typedef UInt64 type;
+};
+
+    // Can T be mapped to a key? This holds for integers of 1, 2, 4 or 8 bytes,
+    // and for floating point types of 4 or 8 bytes (i.e. not for long double,
+    // unless it is the same as double).
+template <class T>
+struct RadixPriorityKeySupported
+{
+    static const bool value = std::is_arithmetic<T>::value &&
+        (std::is_floating_point<T>::value
+             ? (sizeof(T) == 4 || sizeof(T) == 8)
+             : (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8));
+};
+
+template <class T,
+          bool IsFloat = std::is_floating_point<T>::value,
+          bool IsSigned = std::is_signed<T>::value>
+struct RadixPriorityKey
+{
+    typedef typename RadixPriorityKeyType<sizeof(T)>::type type;
+
+    static type get(T t)
+    {
+        return (type)t;
+    }
+};
+
+template <class T>
+struct RadixPriorityKey<T, false, true>
+{
+    typedef typename RadixPriorityKeyType<sizeof(T)>::type type;
+
+    static type get(T t)
+    {
+        return (type)t ^ ((type)1 << (8*sizeof(type)-1));
+    }
+};
+
+template <class T>
+struct RadixPriorityKey<T, true, true>
+{
+    typedef typename RadixPriorityKeyType<sizeof(T)>::type type;
+
+    static type get(T t)
+    {
+        static const type sign = (type)1 << (8*sizeof(type)-1);
+        if(t != t)
+            return ~(type)0;
+        if(t == T())
+            t = T();
+        type u;
+        std::memcpy(&u, &t, sizeof(type));
+        return (u & sign) != 0
+                   ? ~u
+                   : u | sign;
+    }
+};
+
+inline int radixHighestBit(UInt32 x)
+{
+    return log2i(x);
+}
+
+inline int radixHighestBit(UInt64 x)
+{
+    return (x >> 32) != 0
+               ? 32 + log2i((UInt32)(x >> 32))
+               : log2i((UInt32)x);
+}
+
+} // namespace detail
+
+/** \brief Monotone priority queue for integer and floating point priorities (radix heap).
+
+    This template is compatible to the ascending versions of \ref vigra::BucketQueue
+    and \ref vigra::PriorityQueue, but requires the queue to be <i>monotone</i>: the
+    priority of a new element must not be smaller than the priority of the last
+    top element (elements can be pushed in arbitrary order as long as <tt>top()</tt>,
+    <tt>topPriority()</tt>, and <tt>pop()</tt> have not been called). This is the case in region growing
+    algorithms where the priority of a pixel is the maximum of its own cost and
+    the cost of the pixel from which it was reached (e.g. watersheds). Under this
+    condition, the queue supports all built-in integer and floating point priority
+    types in amortized constant time per element (at most one pass per bit of the
+    priority), without the memory consumption of \ref vigra::BucketQueue for
+    large priority ranges and without the logarithmic cost of a heap.
+
+    <tt>PriorityType</tt> must be a built-in integer type, <tt>float</tt> or <tt>double</tt>
+    (<tt>long double</tt> is not supported). The priorities are mapped to unsigned
+    integer keys of the same order, where <tt>-0.0</tt> and <tt>+0.0</tt> are
+    equal and NaNs are larger than all other values (including <tt>+inf</tt>),
+    so that a NaN top element only admits NaN priorities afterwards. Element
+    <tt>e</tt> is stored in bucket <tt>k</tt> when the most significant bit in which
+    its key differs from the key of the last top element is bit <tt>k-1</tt>
+    (bucket 0 holds the elements whose key equals the last top key). When
+    bucket 0 runs empty, the smallest non-empty bucket is redistributed relative to
+    its minimum, which becomes the new top key. Like in \ref vigra::BucketQueue, elements with equal priorities
+    are returned in a first-in first-out fashion.
+
+    <b>\#include</b> \<vigra/priority_queue.hxx\><br>
+    Namespace: vigra
+*/
+template <class ValueType,
+          class PriorityType>
+class RadixPriorityQueue
+{
+    static_assert(detail::RadixPriorityKeySupported<PriorityType>::value,
+        "RadixPriorityQueue: PriorityType must be a built-in integer type or float or double.");
+
+    typedef detail::RadixPriorityKey<PriorityType> KeyTraits;
+    typedef typename KeyTraits::type               Key;
+    typedef std::pair<ValueType, PriorityType>     ElementType;
+    typedef std::vector<ElementType>               Bucket;
+
+    enum { BucketCount = 8*sizeof(Key) + 1 };
+
+    mutable Bucket buckets_[BucketCount];
+    std::size_t size_;
+    mutable std::size_t front_;
+    mutable Key last_;
+
+    std::size_t bucketIndex(Key key) const
+    {
+        return key == last_
+                   ? 0
+                   : 1 + detail::radixHighestBit(Key(key ^ last_));
+    }
+
+        // make sure that bucket 0 contains the top element
+    void findTop() const
+    {
+        if(front_ < buckets_[0].size())
+            return;
+
+        std::size_t k = 1;
+        while(buckets_[k].empty())
+            ++k;
+
+        Bucket & bucket = buckets_[k];
+        last_ = KeyTraits::get(bucket[0].second);
+        for(std::size_t i = 1; i < bucket.size(); ++i)
+            last_ = std::min(last_, KeyTraits::get(bucket[i].second));
+        for(std::size_t i = 0; i < bucket.size(); ++i)
+            buckets_[bucketIndex(KeyTraits::get(bucket[i].second))].push_back(bucket[i]);
+        bucket.clear();
+    }
+
+  public:
+
+    typedef ValueType value_type;
+    typedef ValueType & reference;
+    typedef ValueType const & const_reference;
+    typedef std::size_t size_type;
+    typedef PriorityType priority_type;
+
+        /** \brief Create empty priority queue.
+        */
+    RadixPriorityQueue()
+    : size_(0), front_(0), last_(0)
+    {}
+
+        /** \brief Number of elements in this queue.
+        */
+    size_type size() const
+    {
+        return size_;
+    }
+
+        /** \brief Queue contains no elements.
+             Equivalent to <tt>size() == 0</tt>.
+        */
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+        /** \brief Maximum priority allowed in this queue.
+        */
+    priority_type maxIndex() const
+    {
+        return NumericTraits<priority_type>::max();
+    }
 
+        /** \brief Priority of the current top element.
+        */
+    priority_type topPriority() const
+    {
+        findTop();
+        return buckets_[0][front_].second;
+    }
+
+        /** \brief The current top element.
+        */
+    const_reference top() const
+    {
+        findTop();
+        return buckets_[0][front_].first;
+    }
+
+        /** \brief Remove the current top element.
+        */
+    void pop()
+    {
+        findTop();
+        --size_;
+        if(++front_ == buckets_[0].size())
+        {
+            buckets_[0].clear();
+            front_ = 0;
+            if(size_ == 0)
+                last_ = 0;
+        }
+    }
+
+        /** \brief Insert new element \arg v with given \arg priority.
+
+            The priority must not be smaller than the priority of the
+            top element that was accessed or removed last, unless the
+            queue has been emptied since then.
+        */
+    void push(value_type const & v, priority_type priority)
+    {
+        Key key = KeyTraits::get(priority);
+        vigra_assert(last_ <= key,
+            "RadixPriorityQueue::push(): priority is smaller than the last top priority.");
+        buckets_[bucketIndex(key)].push_back(ElementType(v, priority));
+        ++size_;
+    }
+};
 
 /** \brief Heap-based changable priority queue with a maximum number of elemements.
 
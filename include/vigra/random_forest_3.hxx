@@ -448,21 +448,13 @@ random_forest_impl(
         tree_visitors.emplace_back(visitor);
     }
 
-    // Train the trees.
-    ThreadPool pool((size_t)n_threads);
-    std::vector<threading::future<void> > futures;
-    for (size_t i = 0; i < tree_count; ++i)
-    {
-        futures.emplace_back(
-            pool.enqueue([&features, &transformed_labels, &options, &tree_visitors, &stop, &trees, i, &rand_engines](size_t thread_id)
-                {
-                    random_forest_single_tree<RF, SCORER, VisitorCopyType, STOP>(features, transformed_labels, options, tree_visitors[i], stop, trees[i], rand_engines[thread_id]);
-                }
-            )
-        );
-    }
-    for (auto & fut : futures)
-        fut.get();
+    // Train the trees on the global thread pool (thread_id < n_threads is guaranteed).
+    parallel_foreach(n_threads, tree_count,
+        [&features, &transformed_labels, &options, &tree_visitors, &stop, &trees, &rand_engines](size_t thread_id, size_t i)
+        {
+            random_forest_single_tree<RF, SCORER, VisitorCopyType, STOP>(features, transformed_labels, options, tree_visitors[i], stop, trees[i], rand_engines[thread_id]);
+        }
+    );
 
     // Merge the trees together.
     RF rf(trees[0]);
@@ -38,6 +38,7 @@
 #define VIGRA_RECURSIVECONVOLUTION_HXX
 
 #include <cmath>
+#include <complex>
 #include <vector>
 #include "utilities.hxx"
 #include "numerictraits.hxx"
@@ -515,6 +516,91 @@ recursiveGaussianFilterLine(SrcIterator is, SrcIterator isend, SrcAccessor as,
 }
 
             
+namespace detail {
+
+    // Coefficients of Deriche's fourth order recursive approximation of the
+    // Gaussian filter, see
+    //
+    //     R. Deriche: "Recursively implementing the Gaussian and its derivatives",
+    //     INRIA Research Report 1893, 1993
+    //
+    // The filter is the sum of a causal and an anti-causal part:
+    //
+    //     causal[x]     = sum_{k=0..3} b_causal[k]*src[x-k]     - sum_{k=1..4} a[k]*causal[x-k]
+    //     anticausal[x] = sum_{k=1..4} b_anticausal[k]*src[x+k] - sum_{k=1..4} a[k]*anticausal[x+k]
+    //
+    // The coefficients are obtained from the partial fraction form of the
+    // filter as in P. Getreuer: "A Survey of Gaussian Convolution Algorithms",
+    // Image Processing On Line 3:286-310, 2013. They are normalized such that
+    // the filter preserves constant signals, like the sampled Gaussian kernels.
+struct DericheGaussianCoefficients
+{
+    double b_causal[4], b_anticausal[5], a[5];
+
+        // responses of the causal and anti-causal part to a constant signal of value 1
+    double sum_causal, sum_anticausal;
+
+    explicit DericheGaussianCoefficients(double sigma)
+    {
+        typedef std::complex<double> Complex;
+
+        static const double alpha[4][2] = { {  0.84,     1.8675 }, {  0.84,    -1.8675 },
+                                            { -0.34015, -0.1299 }, { -0.34015,  0.1299 } };
+        static const double lambda[4][2] = { { 1.783,  0.6318 }, { 1.783, -0.6318 },
+                                             { 1.723,  1.997  }, { 1.723, -1.997  } };
+
+        Complex beta[4], b[4], aa[5];
+        for(int k = 0; k < 4; ++k)
+        {
+            double t = std::exp(-lambda[k][0] / sigma);
+            beta[k] = Complex(-t*std::cos(lambda[k][1] / sigma), t*std::sin(lambda[k][1] / sigma));
+        }
+
+        // expand sum_k alpha[k] / (1 + beta[k] z^-1) into b(z) / a(z)
+        b[0] = Complex(alpha[0][0], alpha[0][1]);
+        aa[0] = Complex(1.0);
+        aa[1] = beta[0];
+        for(int k = 1; k < 4; ++k)
+        {
+            Complex alphak(alpha[k][0], alpha[k][1]);
+            b[k] = beta[k] * b[k-1];
+            for(int j = k-1; j > 0; --j)
+                b[j] += beta[k] * b[j-1];
+            for(int j = 0; j <= k; ++j)
+                b[j] += alphak * aa[j];
+            aa[k+1] = beta[k] * aa[k];
+            for(int j = k; j > 0; --j)
+                aa[j] += beta[k] * aa[j-1];
+        }
+
+        a[0] = 1.0;
+        for(int k = 0; k < 4; ++k)
+        {
+            b_causal[k] = b[k].real();
+            a[k+1] = aa[k+1].real();
+        }
+
+        b_anticausal[0] = 0.0;
+        for(int k = 1; k < 4; ++k)
+            b_anticausal[k] = b_causal[k] - a[k] * b_causal[0];
+        b_anticausal[4] = -a[4] * b_causal[0];
+
+        double denominator = 1.0 + a[1] + a[2] + a[3] + a[4];
+        sum_causal = (b_causal[0] + b_causal[1] + b_causal[2] + b_causal[3]) / denominator;
+        sum_anticausal = (b_anticausal[1] + b_anticausal[2] + b_anticausal[3] + b_anticausal[4]) / denominator;
+
+        double norm = 1.0 / (sum_causal + sum_anticausal);
+        for(int k = 0; k < 4; ++k)
+            b_causal[k] *= norm;
+        for(int k = 1; k < 5; ++k)
+            b_anticausal[k] *= norm;
+        sum_causal *= norm;
+        sum_anticausal *= norm;
+    }
+};
+
+} // namespace detail
+
 /********************************************************/
 /*                                                      */
 /*                    recursiveSmoothLine               */
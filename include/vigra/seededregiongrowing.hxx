@@ -103,52 +103,6 @@ public:
 
             return r.cost_ < l.cost_;
         }
-        bool operator()(SeedRgPixel const * l,
-                        SeedRgPixel const * r) const
-        {
-            if(r->cost_ == l->cost_)
-            {
-                if(r->dist_ == l->dist_) return r->count_ < l->count_;
-
-                return r->dist_ < l->dist_;
-            }
-
-            return r->cost_ < l->cost_;
-        }
-    };
-
-    struct Allocator
-    {
-        ~Allocator()
-        {
-            while(!freelist_.empty())
-            {
-                delete freelist_.top();
-                freelist_.pop();
-            }
-        }
-
-        SeedRgPixel *
-        create(Point2D const & location, Point2D const & nearest,
-               COST const & cost, int const & count, int const & label)
-        {
-            if(!freelist_.empty())
-            {
-                SeedRgPixel * res = freelist_.top();
-                freelist_.pop();
-                res->set(location, nearest, cost, count, label);
-                return res;
-            }
-
-            return new SeedRgPixel(location, nearest, cost, count, label);
-        }
-
-        void dismiss(SeedRgPixel * p)
-        {
-            freelist_.push(p);
-        }
-
-        std::stack<SeedRgPixel<COST> *> freelist_;
     };
 };
 
@@ -436,9 +390,9 @@ seededRegionGrowing(SrcIterator srcul,
     typedef typename RegionStatistics::cost_type CostType;
     typedef detail::SeedRgPixel<CostType> Pixel;
 
-    typename Pixel::Allocator allocator;
-
-    typedef std::priority_queue<Pixel *, std::vector<Pixel *>,
+    // the candidates are stored by value, so that no memory must be
+    // allocated per pixel, and the heap comparisons don't chase pointers
+    typedef std::priority_queue<Pixel, std::vector<Pixel>,
                                 typename Pixel::Compare>  SeedRgPixelHeap;
 
     // copy seed image in an image with border
@@ -475,9 +429,7 @@ seededRegionGrowing(SrcIterator srcul,
                     {
                         CostType cost = stats[cneighbor].cost(as(isx));
 
-                        Pixel * pixel =
-                            allocator.create(pos, pos+Neighborhood::diff((Direction)i), cost, count++, cneighbor);
-                        pheap.push(pixel);
+                        pheap.push(Pixel(pos, pos+Neighborhood::diff((Direction)i), cost, count++, cneighbor));
                     }
                 }
             }
@@ -494,16 +446,12 @@ seededRegionGrowing(SrcIterator srcul,
     // perform region growing
     while(pheap.size() != 0)
     {
-        Pixel * pixel = pheap.top();
+        Point2D pos = pheap.top().location_;
+        Point2D nearest = pheap.top().nearest_;
+        int lab = pheap.top().label_;
+        CostType cost = pheap.top().cost_;
         pheap.pop();
 
-        Point2D pos = pixel->location_;
-        Point2D nearest = pixel->nearest_;
-        int lab = pixel->label_;
-        CostType cost = pixel->cost_;
-
-        allocator.dismiss(pixel);
-
         if((srgType & StopAtThreshold) != 0 && cost > max_cost)
             break;
 
@@ -541,21 +489,12 @@ seededRegionGrowing(SrcIterator srcul,
                 {
                     CostType cost = stats[lab].cost(as(isx, Neighborhood::diff((Direction)i)));
 
-                    Pixel * new_pixel =
-                        allocator.create(pos+Neighborhood::diff((Direction)i), nearest, cost, count++, lab);
-                    pheap.push(new_pixel);
+                    pheap.push(Pixel(pos+Neighborhood::diff((Direction)i), nearest, cost, count++, lab));
                 }
             }
         }
     }
 
-    // free temporary memory
-    while(pheap.size() != 0)
-    {
-        allocator.dismiss(pheap.top());
-        pheap.pop();
-    }
-
     // write result
     transformImage(ir, ir+Point2D(w,h), regions.accessor(), destul, ad,
                    detail::UnlabelWatersheds());
@@ -52,50 +52,47 @@ namespace vigra {
 
 namespace detail {
 
+    // Candidate voxel for seeded region growing. The voxel and the seed from
+    // which it was reached ('nearest') are stored as scan-order indices, so
+    // that the candidates are small enough to be kept in the heap by value.
 template <class COST, class Diff_type>
 class SeedRgVoxel
 {
 public:
-    Diff_type location_, nearest_;
     COST cost_;
     int count_;
-    int label_;
     int dist_;
+    MultiArrayIndex location_, nearest_;
+    int label_;
 
-    SeedRgVoxel()
-    //: location_(0,0,0), nearest_(0,0,0), cost_(0), count_(0), label_(0)
+    SeedRgVoxel(Diff_type const & location, Diff_type const & nearest,
+                COST const & cost, int const & count, int const & label,
+                Diff_type const & shape)
+    : cost_(cost), count_(count),
+      location_(scanOrderIndex(location, shape)),
+      nearest_(scanOrderIndex(nearest, shape)),
+      label_(label)
     {
-        location_ = Diff_type(0,0,0);
-        nearest_ = Diff_type(0,0,0);
-        cost_ = 0;
-        count_ = 0;
-        label_ = 0;
+        int dx = location[0] - nearest[0];
+        int dy = location[1] - nearest[1];
+        int dz = location[2] - nearest[2];
+        dist_ = dx * dx + dy * dy + dz * dz;
     }
 
-    SeedRgVoxel(Diff_type const & location, Diff_type const & nearest,
-                COST const & cost, int const & count, int const & label)
-    : location_(location), nearest_(nearest),
-      cost_(cost), count_(count), label_(label)
+    static MultiArrayIndex scanOrderIndex(Diff_type const & p, Diff_type const & shape)
     {
-        int dx = location_[0] - nearest_[0];
-        int dy = location_[1] - nearest_[1];
-        int dz = location_[2] - nearest_[2];
-        dist_ = dx * dx + dy * dy + dz * dz;
+        return (MultiArrayIndex)p[0] +
+               (MultiArrayIndex)shape[0]*((MultiArrayIndex)p[1] + (MultiArrayIndex)shape[1]*p[2]);
     }
 
-    void set(Diff_type const & location, Diff_type const & nearest,
-             COST const & cost, int const & count, int const & label)
+    static Diff_type point(MultiArrayIndex index, Diff_type const & shape)
     {
-        location_ = location;
-        nearest_ = nearest;
-        cost_ = cost;
-        count_ = count;
-        label_ = label;
-
-        int dx = location_[0] - nearest_[0];
-        int dy = location_[1] - nearest_[1];
-        int dz = location_[2] - nearest_[2];
-        dist_ = dx * dx + dy * dy + dz * dz;
+        Diff_type res;
+        res[0] = index % shape[0];
+        index /= shape[0];
+        res[1] = index % shape[1];
+        res[2] = index / shape[1];
+        return res;
     }
 
     struct Compare
@@ -113,51 +110,6 @@ public:
 
             return r.cost_ < l.cost_;
         }
-        bool operator()(SeedRgVoxel const * l,
-                        SeedRgVoxel const * r) const
-        {
-            if(r->cost_ == l->cost_)
-            {
-                if(r->dist_ == l->dist_) return r->count_ < l->count_;
-
-                return r->dist_ < l->dist_;
-            }
-
-            return r->cost_ < l->cost_;
-        }
-    };
-
-    struct Allocator
-    {
-        ~Allocator()
-        {
-            while(!freelist_.empty())
-            {
-                delete freelist_.top();
-                freelist_.pop();
-            }
-        }
-
-        SeedRgVoxel * create(Diff_type const & location, Diff_type const & nearest,
-                             COST const & cost, int const & count, int const & label)
-        {
-            if(!freelist_.empty())
-            {
-                SeedRgVoxel * res = freelist_.top();
-                freelist_.pop();
-                res->set(location, nearest, cost, count, label);
-                return res;
-            }
-
-            return new SeedRgVoxel(location, nearest, cost, count, label);
-        }
-
-        void dismiss(SeedRgVoxel * p)
-        {
-            freelist_.push(p);
-        }
-
-        std::stack<SeedRgVoxel<COST,Diff_type> *> freelist_;
     };
 };
 
@@ -343,10 +295,10 @@ seededRegionGrowing3D(SrcImageIterator srcul, Diff_type shape, SrcAccessor as,
     typedef typename PromoteTraits<typename RegionStatistics::cost_type, double>::Promote CostType;
     typedef detail::SeedRgVoxel<CostType, Diff_type> Voxel;
 
-    typename Voxel::Allocator allocator;
-
-    typedef std::priority_queue< Voxel *,
-                                 std::vector<Voxel *>,
+    // the candidates are stored by value, so that no memory must be
+    // allocated per voxel, and the heap comparisons don't chase pointers
+    typedef std::priority_queue< Voxel,
+                                 std::vector<Voxel>,
                                  typename Voxel::Compare >  SeedRgVoxelHeap;
     typedef MultiArray<3, int> IVolume;
     typedef IVolume::traverser Traverser;
@@ -400,9 +352,7 @@ seededRegionGrowing3D(SrcImageIterator srcul, Diff_type shape, SrcAccessor as,
                         {
                             CostType cost = stats[cneighbor].cost(as(isx));
 
-                            Voxel * voxel =
-                                allocator.create(pos, pos+Neighborhood::diff((Direction)i), cost, count++, cneighbor);
-                            pheap.push(voxel);
+                            pheap.push(Voxel(pos, pos+Neighborhood::diff((Direction)i), cost, count++, cneighbor, shape));
                         }
                     }
                 }
@@ -413,16 +363,12 @@ seededRegionGrowing3D(SrcImageIterator srcul, Diff_type shape, SrcAccessor as,
     // perform region growing
     while(pheap.size() != 0)
     {
-        Voxel * voxel = pheap.top();
+        Diff_type pos = Voxel::point(pheap.top().location_, shape);
+        Diff_type nearest = Voxel::point(pheap.top().nearest_, shape);
+        int lab = pheap.top().label_;
+        CostType cost = pheap.top().cost_;
         pheap.pop();
 
-        Diff_type pos = voxel->location_;
-        Diff_type nearest = voxel->nearest_;
-        int lab = voxel->label_;
-        CostType cost = voxel->cost_;
-
-        allocator.dismiss(voxel);
-
         if((srgType & StopAtThreshold) != 0 && cost > max_cost)
             break;
 
@@ -460,21 +406,12 @@ seededRegionGrowing3D(SrcImageIterator srcul, Diff_type shape, SrcAccessor as,
                 {
                     CostType cost = stats[lab].cost(as(isx, Neighborhood::diff((Direction)i)));
 
-                    Voxel * new_voxel =
-                        allocator.create(pos+Neighborhood::diff((Direction)i), nearest, cost, count++, lab);
-                    pheap.push(new_voxel);
+                    pheap.push(Voxel(pos+Neighborhood::diff((Direction)i), nearest, cost, count++, lab, shape));
                 }
             }
         }
     }
 
-    // free temporary memory
-    while(pheap.size() != 0)
-    {
-        allocator.dismiss(pheap.top());
-        pheap.pop();
-    }
-
     // write result
     transformMultiArray(ir, Diff_type(w,h,d), AccessorTraits<int>::default_accessor(),
                         destul, ad, detail::UnlabelWatersheds());
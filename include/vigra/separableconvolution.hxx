@@ -45,6 +45,7 @@
 #include "gaussians.hxx"
 #include "array_vector.hxx"
 #include "multi_shape.hxx"
+#include "fixedpoint.hxx"
 
 namespace vigra {
 
@@ -751,6 +752,495 @@ void internalConvolveLineAvoid(SrcIterator is, SrcIterator iend, SrcAccessor sa,
     }
 }
 
+/********************************************************/
+/*                                                      */
+/*                   kernelSymmetry                     */
+/*                                                      */
+/********************************************************/
+
+/** \brief Symmetry of a 1D convolution kernel, see \ref vigra::Kernel1D::symmetry().
+
+    <b>\#include</b> \<vigra/separableconvolution.hxx\><br/>
+    Namespace: vigra
+*/
+enum KernelSymmetry
+{
+    AsymmetricKernel,    ///< no symmetry (in particular, if <tt>left() != -right()</tt>)
+    SymmetricKernel,     ///< <tt>k[-i] == k[i]</tt>, e.g. Gaussian and its second derivative
+    AntisymmetricKernel  ///< <tt>k[-i] == -k[i]</tt>, e.g. Gaussian first derivative
+};
+
+    // Determine the symmetry of the kernel whose center is 'ik'.
+template <class KernelIterator, class KernelAccessor>
+KernelSymmetry
+kernelSymmetry(KernelIterator ik, KernelAccessor ka, int kleft, int kright)
+{
+    typedef typename KernelAccessor::value_type KT;
+
+    if(kleft != -kright || kright == 0)
+        return AsymmetricKernel;
+
+    bool symmetric = true,
+         antisymmetric = ka(ik) == NumericTraits<KT>::zero();
+    for(int i = 1; i <= kright; ++i)
+    {
+        symmetric     = symmetric     && ka(ik + i) == ka(ik - i);
+        antisymmetric = antisymmetric && ka(ik + i) == -ka(ik - i);
+    }
+    return symmetric
+               ? SymmetricKernel
+               : antisymmetric
+                    ? AntisymmetricKernel
+                    : AsymmetricKernel;
+}
+
+/********************************************************/
+/*                                                      */
+/*             internalConvolveLineFolded               */
+/*                                                      */
+/********************************************************/
+
+    // Map position 'x' of a line of length 'w' into the range [0, w)
+    // according to the border treatment, or return -1 when the value
+    // is zero (BORDER_TREATMENT_ZEROPAD). Only implemented for
+    // modes that can be expressed by padding, and for -w < x < 2*w-1.
+inline int
+internalBorderIndex(int x, int w, BorderTreatmentMode border)
+{
+    if(x < 0)
+        return border == BORDER_TREATMENT_REFLECT ? -x :
+               border == BORDER_TREATMENT_REPEAT  ? 0 :
+               border == BORDER_TREATMENT_WRAP    ? x + w :
+                                                    -1;
+    if(x >= w)
+        return border == BORDER_TREATMENT_REFLECT ? 2*(w-1) - x :
+               border == BORDER_TREATMENT_REPEAT  ? w-1 :
+               border == BORDER_TREATMENT_WRAP    ? x - w :
+                                                    -1;
+    return x;
+}
+
+    // Convolution result at 'center' for a symmetric or antisymmetric kernel,
+    // given by its values k[0...radius]. Pairs of taps with equal weight are
+    // added (resp. subtracted) before the multiplication. The taps are converted
+    // to SumType first, since their sum or difference may not fit into T (e.g.
+    // for UInt32). If RADIUS > 0, the radius is a compile-time constant and the
+    // loop is unrolled.
+template <int RADIUS, bool SYMMETRIC, class SumType, class T, class K>
+inline SumType
+internalFoldedSum(T const * center, K const * k, int radius)
+{
+    if(RADIUS > 0)
+        radius = RADIUS;
+    SumType sum = SYMMETRIC
+                      ? SumType(k[0] * center[0])
+                      : NumericTraits<SumType>::zero();
+    for(int i = 1; i <= radius; ++i)
+        sum += SYMMETRIC
+                   ? k[i] * (SumType(center[-i]) + SumType(center[i]))
+                   : k[i] * (SumType(center[-i]) - SumType(center[i]));
+    return sum;
+}
+
+template <int RADIUS, bool SYMMETRIC,
+          class SrcIterator, class SrcAccessor,
+          class DestIterator, class DestAccessor, class K>
+void internalConvolveLineFoldedImpl(SrcIterator is, int w, SrcAccessor sa,
+                                    DestIterator id, DestAccessor da,
+                                    K const * k, int radius, BorderTreatmentMode border,
+                                    int start, int stop)
+{
+    typedef typename SrcAccessor::value_type SrcType;
+    typedef typename PromoteTraits<SrcType, K>::Promote SumType;
+
+    // copy the required part of the line, including the border
+    ArrayVector<SrcType> buffer(stop - start + 2*radius);
+    for(int p = 0; p < (int)buffer.size(); ++p)
+    {
+        int x = internalBorderIndex(p + start - radius, w, border);
+        buffer[p] = x < 0
+                        ? NumericTraits<SrcType>::zero()
+                        : sa(is + x);
+    }
+
+    SrcType const * center = buffer.begin() + radius;
+    for(int x = start; x < stop; ++x, ++center, ++id)
+    {
+        da.set(detail::RequiresExplicitCast<typename DestAccessor::value_type>::cast(
+                   internalFoldedSum<RADIUS, SYMMETRIC, SumType>(center, k, radius)), id);
+    }
+}
+
+template <bool SYMMETRIC,
+          class SrcIterator, class SrcAccessor,
+          class DestIterator, class DestAccessor, class K>
+void internalConvolveLineFoldedRadius(SrcIterator is, int w, SrcAccessor sa,
+                                      DestIterator id, DestAccessor da,
+                                      K const * k, int radius, BorderTreatmentMode border,
+                                      int start, int stop)
+{
+    // fully unrolled versions for the most common radii
+    switch(radius)
+    {
+      case 1:
+        internalConvolveLineFoldedImpl<1, SYMMETRIC>(is, w, sa, id, da, k, radius, border, start, stop);
+        break;
+      case 2:
+        internalConvolveLineFoldedImpl<2, SYMMETRIC>(is, w, sa, id, da, k, radius, border, start, stop);
+        break;
+      case 3:
+        internalConvolveLineFoldedImpl<3, SYMMETRIC>(is, w, sa, id, da, k, radius, border, start, stop);
+        break;
+      case 4:
+        internalConvolveLineFoldedImpl<4, SYMMETRIC>(is, w, sa, id, da, k, radius, border, start, stop);
+        break;
+      case 5:
+        internalConvolveLineFoldedImpl<5, SYMMETRIC>(is, w, sa, id, da, k, radius, border, start, stop);
+        break;
+      default:
+        internalConvolveLineFoldedImpl<0, SYMMETRIC>(is, w, sa, id, da, k, radius, border, start, stop);
+    }
+}
+
+    // Convolve with a symmetric or antisymmetric kernel, so that pairs of taps
+    // need only a single multiplication. Returns false (without doing anything)
+    // if the kernel has no symmetry, or the border treatment is not supported.
+template <class SrcIterator, class SrcAccessor,
+          class DestIterator, class DestAccessor,
+          class KernelIterator, class KernelAccessor>
+bool internalConvolveLineFolded(SrcIterator is, SrcIterator iend, SrcAccessor sa,
+                                DestIterator id, DestAccessor da,
+                                KernelIterator ik, KernelAccessor ka,
+                                int kleft, int kright, BorderTreatmentMode border,
+                                int start, int stop)
+{
+    typedef typename KernelAccessor::value_type KT;
+
+    if(border != BORDER_TREATMENT_REFLECT && border != BORDER_TREATMENT_REPEAT &&
+       border != BORDER_TREATMENT_WRAP    && border != BORDER_TREATMENT_ZEROPAD)
+        return false;
+
+    KernelSymmetry symmetry = kernelSymmetry(ik, ka, kleft, kright);
+    if(symmetry == AsymmetricKernel)
+        return false;
+
+    ArrayVector<KT> k(kright + 1);
+    for(int i = 0; i <= kright; ++i)
+        k[i] = ka(ik + i);
+
+    int w = std::distance(is, iend);
+    if(stop == 0)
+        stop = w;
+
+    if(symmetry == SymmetricKernel)
+        internalConvolveLineFoldedRadius<true>(is, w, sa, id, da, k.begin(), kright, border, start, stop);
+    else
+        internalConvolveLineFoldedRadius<false>(is, w, sa, id, da, k.begin(), kright, border, start, stop);
+    return true;
+}
+
+/********************************************************/
+/*                                                      */
+/*            internalConvolveLineFixedPoint            */
+/*                                                      */
+/********************************************************/
+
+    // Kernels with FixedPoint16 coefficients (e.g. Kernel1D<FixedPoint16<1> >)
+    // select integer arithmetic in convolveLine() and separableConvolveMultiArray().
+template <class T>
+struct FixedPointKernelTraits
+{
+    typedef VigraFalseType isFixedPoint;
+};
+
+template <int IntBits, FPOverflowHandling OverflowHandling>
+struct FixedPointKernelTraits<FixedPoint16<IntBits, OverflowHandling> >
+{
+    typedef VigraTrueType isFixedPoint;
+    static const int fractionalBits = FixedPoint16<IntBits, OverflowHandling>::FRACTIONAL_BITS;
+};
+
+    // Integer arithmetic is used for integral source types of at most 16 bits.
+template <class T>
+struct FixedPointSourceTraits
+{
+    typedef typename IfBool<NumericTraits<T>::isIntegral::value && sizeof(T) <= 2,
+                            VigraTrueType, VigraFalseType>::type isSupported;
+
+    static double maxAbs()
+    {
+        return std::max(std::abs((double)NumericTraits<T>::min()),
+                        (double)NumericTraits<T>::max());
+    }
+};
+
+    // Convert the fixed-point sum 'v' (a multiple of 2^-shift) to an integral
+    // destination by rounding to the nearest integer (ties toward +infinity)
+    // and saturating at the destination's range.
+template <class DestType, class Accumulator>
+inline DestType
+fixedPointResult(Accumulator v, int shift, VigraTrueType /* integral destination */)
+{
+    if(shift > 0)
+        v = (v + (Accumulator(1) << (shift - 1))) >> shift;
+    return v < (Accumulator)NumericTraits<DestType>::min()
+               ? NumericTraits<DestType>::min()
+               : v > (Accumulator)NumericTraits<DestType>::max()
+                     ? NumericTraits<DestType>::max()
+                     : static_cast<DestType>(v);
+}
+
+    // Floating-point destinations receive the exact value.
+template <class DestType, class Accumulator>
+inline DestType
+fixedPointResult(Accumulator v, int shift, VigraFalseType /* integral destination */)
+{
+    return detail::RequiresExplicitCast<DestType>::cast(std::ldexp((double)v, -shift));
+}
+
+    // Can the sums of products of the coefficients k[0...size-1] with values
+    // of magnitude at most 'maxInput' (plus the rounding offset) be accumulated in Int32?
+inline bool
+fixedPointSumFitsInt32(Int32 const * k, int size, int shift, double maxInput)
+{
+    double bound = 0.0;
+    for(int i = 0; i < size; ++i)
+        bound += std::abs((double)k[i]);
+    return bound * maxInput + std::ldexp(1.0, shift) < (double)NumericTraits<Int32>::max();
+}
+
+    // Compute the sums s[x] = sum_i k[i-kleft] * center[x - i*stride] for x in [0, size),
+    // where 'stride' is the distance of neighboring line positions in the buffer
+    // 'center'. Each tap (or pair of folded taps of a symmetric or antisymmetric
+    // kernel) is added in a separate loop over contiguous memory, which the
+    // compiler can vectorize.
+template <class Accumulator>
+void internalFixedPointSum(Int32 const * center, int stride, int size, Accumulator * s,
+                           Int32 const * k, int kleft, int kright, KernelSymmetry symmetry)
+{
+    std::fill(s, s + size, Accumulator());
+    if(symmetry == AsymmetricKernel)
+    {
+        for(int i = kleft; i <= kright; ++i)
+        {
+            Accumulator c = k[i - kleft];
+            if(c == 0)
+                continue;
+            Int32 const * b = center - i*stride;
+            for(int x = 0; x < size; ++x)
+                s[x] += c * b[x];
+        }
+        return;
+    }
+
+    if(symmetry == SymmetricKernel)
+    {
+        Accumulator c = k[kright];
+        for(int x = 0; x < size; ++x)
+            s[x] += c * center[x];
+    }
+    for(int i = 1; i <= kright; ++i)
+    {
+        Accumulator c = k[kright + i];
+        Int32 const * right = center - i*stride,  // tap i
+                    * left  = center + i*stride;  // tap -i
+        if(symmetry == SymmetricKernel)
+            for(int x = 0; x < size; ++x)
+                s[x] += c * (right[x] + left[x]);
+        else
+            for(int x = 0; x < size; ++x)
+                s[x] += c * (right[x] - left[x]);
+    }
+}
+
+template <class Accumulator,
+          class SrcIterator, class SrcAccessor,
+          class DestIterator, class DestAccessor>
+void internalConvolveLineFixedPointImpl(SrcIterator is, int w, SrcAccessor sa,
+                                        DestIterator id, DestAccessor da,
+                                        Int32 const * k, int kleft, int kright, int shift,
+                                        BorderTreatmentMode border, int start, int stop)
+{
+    typedef typename DestAccessor::value_type DestType;
+
+    // copy the required part of the line, including the border
+    int size = stop - start;
+    ArrayVector<Int32> buffer(size + kright - kleft);
+    for(int p = 0; p < (int)buffer.size(); ++p)
+    {
+        int x = internalBorderIndex(p + start - kright, w, border);
+        buffer[p] = x < 0
+                        ? 0
+                        : static_cast<Int32>(sa(is + x));
+    }
+
+    ArrayVector<Accumulator> sum(size);
+    internalFixedPointSum(buffer.begin() + kright, 1, size, sum.begin(), k, kleft, kright,
+                          kernelSymmetry(k - kleft, StandardConstAccessor<Int32>(), kleft, kright));
+
+    for(int x = 0; x < size; ++x, ++id)
+        da.set(fixedPointResult<DestType>(sum[x], shift,
+                                          typename NumericTraits<DestType>::isIntegral()), id);
+}
+
+    // Convolve an integer-valued line with the integer coefficients k[0...kright-kleft]
+    // (representing multiples of 2^-shift). 'maxInput' bounds the magnitude of the
+    // source values: when the sums cannot overflow 32 bits, they are accumulated
+    // in Int32, otherwise in Int64. Only border treatments which can be expressed
+    // by padding are supported (see internalBorderIndex()).
+template <class SrcIterator, class SrcAccessor,
+          class DestIterator, class DestAccessor>
+void internalConvolveLineFixedPoint(SrcIterator is, SrcIterator iend, SrcAccessor sa,
+                                    DestIterator id, DestAccessor da,
+                                    Int32 const * k, int kleft, int kright, int shift,
+                                    double maxInput, BorderTreatmentMode border,
+                                    int start = 0, int stop = 0)
+{
+    int w = std::distance(is, iend);
+    if(stop == 0)
+        stop = w;
+
+    if(fixedPointSumFitsInt32(k, kright - kleft + 1, shift, maxInput))
+        internalConvolveLineFixedPointImpl<Int32>(is, w, sa, id, da, k, kleft, kright, shift,
+                                                  border, start, stop);
+    else
+        internalConvolveLineFixedPointImpl<Int64>(is, w, sa, id, da, k, kleft, kright, shift,
+                                                  border, start, stop);
+}
+
+inline bool
+fixedPointBorderTreatmentSupported(BorderTreatmentMode border)
+{
+    return border == BORDER_TREATMENT_REFLECT || border == BORDER_TREATMENT_REPEAT ||
+           border == BORDER_TREATMENT_WRAP    || border == BORDER_TREATMENT_ZEROPAD;
+}
+
+    // floating-point kernel
+template <class SrcIterator, class SrcAccessor,
+          class DestIterator, class DestAccessor,
+          class KernelIterator, class KernelAccessor>
+void internalConvolveLine(SrcIterator is, SrcIterator iend, SrcAccessor sa,
+                          DestIterator id, DestAccessor da,
+                          KernelIterator ik, KernelAccessor ka,
+                          int kleft, int kright, BorderTreatmentMode border,
+                          int start, int stop, VigraFalseType /* fixed-point kernel */)
+{
+    // symmetric and antisymmetric kernels (e.g. Gaussians and their derivatives)
+    // are applied by a specialized implementation
+    if(internalConvolveLineFolded(is, iend, sa, id, da, ik, ka, kleft, kright, border, start, stop))
+        return;
+
+    switch(border)
+    {
+      case BORDER_TREATMENT_WRAP:
+      {
+        internalConvolveLineWrap(is, iend, sa, id, da, ik, ka, kleft, kright, start, stop);
+        break;
+      }
+      case BORDER_TREATMENT_AVOID:
+      {
+        internalConvolveLineAvoid(is, iend, sa, id, da, ik, ka, kleft, kright, start, stop);
+        break;
+      }
+      case BORDER_TREATMENT_REFLECT:
+      {
+        internalConvolveLineReflect(is, iend, sa, id, da, ik, ka, kleft, kright, start, stop);
+        break;
+      }
+      case BORDER_TREATMENT_REPEAT:
+      {
+        internalConvolveLineRepeat(is, iend, sa, id, da, ik, ka, kleft, kright, start, stop);
+        break;
+      }
+      case BORDER_TREATMENT_CLIP:
+      {
+        // find norm of kernel
+        typedef typename KernelAccessor::value_type KT;
+        KT norm = NumericTraits<KT>::zero();
+        KernelIterator iik = ik + kleft;
+        for(int i=kleft; i<=kright; ++i, ++iik)
+            norm += ka(iik);
+
+        vigra_precondition(norm != NumericTraits<KT>::zero(),
+                     "convolveLine(): Norm of kernel must be != 0"
+                     " in mode BORDER_TREATMENT_CLIP.\n");
+
+        internalConvolveLineClip(is, iend, sa, id, da, ik, ka, kleft, kright, norm, start, stop);
+        break;
+      }
+      case BORDER_TREATMENT_ZEROPAD:
+      {
+        internalConvolveLineZeropad(is, iend, sa, id, da, ik, ka, kleft, kright, start, stop);
+        break;
+      }
+      default:
+      {
+        vigra_precondition(0,
+                     "convolveLine(): Unknown border treatment mode.\n");
+      }
+    }
+}
+
+    // fixed-point kernel, but the source type or border treatment is not supported:
+    // convolve with the equivalent floating-point kernel
+template <class SrcIterator, class SrcAccessor,
+          class DestIterator, class DestAccessor,
+          class KernelIterator, class KernelAccessor>
+void internalConvolveLineFixedPointKernel(SrcIterator is, SrcIterator iend, SrcAccessor sa,
+                                          DestIterator id, DestAccessor da,
+                                          KernelIterator ik, KernelAccessor ka,
+                                          int kleft, int kright, BorderTreatmentMode border,
+                                          int start, int stop, VigraFalseType /* supported source */)
+{
+    ArrayVector<double> k(kright - kleft + 1);
+    for(int i = kleft; i <= kright; ++i)
+        k[i - kleft] = fixed_point_cast<double>(ka(ik + i));
+    internalConvolveLine(is, iend, sa, id, da, k.begin() - kleft, StandardConstAccessor<double>(),
+                         kleft, kright, border, start, stop, VigraFalseType());
+}
+
+template <class SrcIterator, class SrcAccessor,
+          class DestIterator, class DestAccessor,
+          class KernelIterator, class KernelAccessor>
+void internalConvolveLineFixedPointKernel(SrcIterator is, SrcIterator iend, SrcAccessor sa,
+                                          DestIterator id, DestAccessor da,
+                                          KernelIterator ik, KernelAccessor ka,
+                                          int kleft, int kright, BorderTreatmentMode border,
+                                          int start, int stop, VigraTrueType /* supported source */)
+{
+    typedef typename SrcAccessor::value_type SrcType;
+    typedef typename KernelAccessor::value_type KT;
+
+    if(!fixedPointBorderTreatmentSupported(border))
+    {
+        internalConvolveLineFixedPointKernel(is, iend, sa, id, da, ik, ka, kleft, kright,
+                                             border, start, stop, VigraFalseType());
+        return;
+    }
+
+    ArrayVector<Int32> k(kright - kleft + 1);
+    for(int i = kleft; i <= kright; ++i)
+        k[i - kleft] = ka(ik + i).value;
+    internalConvolveLineFixedPoint(is, iend, sa, id, da, k.begin(), kleft, kright,
+                                   FixedPointKernelTraits<KT>::fractionalBits,
+                                   FixedPointSourceTraits<SrcType>::maxAbs(),
+                                   border, start, stop);
+}
+
+template <class SrcIterator, class SrcAccessor,
+          class DestIterator, class DestAccessor,
+          class KernelIterator, class KernelAccessor>
+inline void
+internalConvolveLine(SrcIterator is, SrcIterator iend, SrcAccessor sa,
+                     DestIterator id, DestAccessor da,
+                     KernelIterator ik, KernelAccessor ka,
+                     int kleft, int kright, BorderTreatmentMode border,
+                     int start, int stop, VigraTrueType /* fixed-point kernel */)
+{
+    internalConvolveLineFixedPointKernel(is, iend, sa, id, da, ik, ka, kleft, kright, border, start, stop,
+              typename FixedPointSourceTraits<typename SrcAccessor::value_type>::isSupported());
+}
+
 /********************************************************/
 /*                                                      */
 /*         Separable convolution functions              */
@@ -794,6 +1284,24 @@ void internalConvolveLineAvoid(SrcIterator is, SrcIterator iend, SrcAccessor sa,
     <tt>start</tt>). If <tt>start</tt> and <tt>stop</tt> are both zero
     (the default), the entire array is convolved.
 
+    <b>Integer convolution:</b> If the kernel's value_type is \ref vigra::FixedPoint16
+    (e.g. <tt>Kernel1D<FixedPoint16<1> ></tt>, which can be constructed from a
+    <tt>Kernel1D<double></tt>) and the source is an integral type of at most 16 bits
+    (e.g. <tt>UInt8</tt>, <tt>UInt16</tt>), the convolution is computed in integer
+    arithmetic without converting the pixels to <tt>RealPromote</tt>. The sums are
+    accumulated exactly in <tt>Int32</tt> (or <tt>Int64</tt> if the kernel's
+    L1-norm times the largest source value could overflow 32 bits). For integral
+    destinations, they are rounded to the nearest integer (ties toward +infinity)
+    and saturated to the destination's range. Thus, the only errors relative to the
+    floating-point convolution with the original kernel stem from quantizing the
+    kernel to <tt>FixedPoint16::FRACTIONAL_BITS</tt> bits: at most
+    <tt>0.5 + 0.5 * (kright - kleft + 1) * max|src| / 2^FRACTIONAL_BITS</tt>
+    (i.e. below one gray level for typical 8-bit smoothing kernels). This mode
+    supports the border treatments <tt>BORDER_TREATMENT_REFLECT</tt>,
+    <tt>BORDER_TREATMENT_REPEAT</tt>, <tt>BORDER_TREATMENT_WRAP</tt> and
+    <tt>BORDER_TREATMENT_ZEROPAD</tt>. Otherwise, the fixed-point kernel is converted
+    to <tt>double</tt> and the floating-point convolution is used.
+
     <b> Declarations:</b>
 
     pass \ref ImageIterators and \ref DataAccessors :
@@ -917,59 +1425,9 @@ void convolveLine(SrcIterator is, SrcIterator iend, SrcAccessor sa,
         vigra_precondition(0 <= start && start < stop && stop <= w,
                         "convolveLine(): invalid subrange (start, stop).\n");
 
-    typedef typename PromoteTraits<
-            typename SrcAccessor::value_type,
-            typename KernelAccessor::value_type>::Promote SumType;
-    ArrayVector<SumType> a(iend - is);
-    switch(border)
-    {
-      case BORDER_TREATMENT_WRAP:
-      {
-        internalConvolveLineWrap(is, iend, sa, id, da, ik, ka, kleft, kright, start, stop);
-        break;
-      }
-      case BORDER_TREATMENT_AVOID:
-      {
-        internalConvolveLineAvoid(is, iend, sa, id, da, ik, ka, kleft, kright, start, stop);
-        break;
-      }
-      case BORDER_TREATMENT_REFLECT:
-      {
-        internalConvolveLineReflect(is, iend, sa, id, da, ik, ka, kleft, kright, start, stop);
-        break;
-      }
-      case BORDER_TREATMENT_REPEAT:
-      {
-        internalConvolveLineRepeat(is, iend, sa, id, da, ik, ka, kleft, kright, start, stop);
-        break;
-      }
-      case BORDER_TREATMENT_CLIP:
-      {
-        // find norm of kernel
-        typedef typename KernelAccessor::value_type KT;
-        KT norm = NumericTraits<KT>::zero();
-        KernelIterator iik = ik + kleft;
-        for(int i=kleft; i<=kright; ++i, ++iik)
-            norm += ka(iik);
-
-        vigra_precondition(norm != NumericTraits<KT>::zero(),
-                     "convolveLine(): Norm of kernel must be != 0"
-                     " in mode BORDER_TREATMENT_CLIP.\n");
-
-        internalConvolveLineClip(is, iend, sa, id, da, ik, ka, kleft, kright, norm, start, stop);
-        break;
-      }
-      case BORDER_TREATMENT_ZEROPAD:
-      {
-        internalConvolveLineZeropad(is, iend, sa, id, da, ik, ka, kleft, kright, start, stop);
-        break;
-      }
-      default:
-      {
-        vigra_precondition(0,
-                     "convolveLine(): Unknown border treatment mode.\n");
-      }
-    }
+    typedef typename KernelAccessor::value_type KT;
+    internalConvolveLine(is, iend, sa, id, da, ik, ka, kleft, kright, border, start, stop,
+                         typename FixedPointKernelTraits<KT>::isFixedPoint());
 }
 
 template <class SrcIterator, class SrcAccessor,
@@ -999,6 +1457,14 @@ void convolveLine(triple<SrcIterator, SrcIterator, SrcAccessor> src,
     It calls \ref convolveLine() for every row of the image. See \ref convolveLine()
     for more information about required interfaces and vigra_preconditions.
 
+    A kernel with \ref vigra::FixedPoint16 coefficients selects integer arithmetic
+    for 8- and 16-bit images (see \ref convolveLine() for the rounding behavior):
+    \code
+    Kernel1D<double> gauss;
+    gauss.initGaussian(1.5);
+    separableConvolveX(src, dest, Kernel1D<FixedPoint16<1> >(gauss));
+    \endcode
+
     <b> Declarations:</b>
 
     pass 2D array views:
@@ -1154,6 +1620,14 @@ separableConvolveX(MultiArrayView<2, T1, S1> const & src,
     It calls \ref convolveLine() for every column of the image. See \ref convolveLine()
     for more information about required interfaces and vigra_preconditions.
 
+    A kernel with \ref vigra::FixedPoint16 coefficients selects integer arithmetic
+    for 8- and 16-bit images (see \ref convolveLine() for the rounding behavior):
+    \code
+    Kernel1D<double> gauss;
+    gauss.initGaussian(1.5);
+    separableConvolveY(src, dest, Kernel1D<FixedPoint16<1> >(gauss));
+    \endcode
+
     <b> Declarations:</b>
 
     pass 2D array views:
@@ -1472,12 +1946,16 @@ class Kernel1D
         */
     template <class U>
     Kernel1D(Kernel1D<U> const & k)
-    : kernel_(k.center()+k.left(), k.center()+k.right()+1),
+    : kernel_(k.size()),
       left_(k.left()),
       right_(k.right()),
       border_treatment_(k.borderTreatment()),
       norm_(k.norm())
-    {}
+    {
+        // element-wise, since the conversion may be explicit (e.g. FixedPoint16(double))
+        for(int i = left_; i <= right_; ++i)
+            kernel_[i - left_] = value_type(k[i]);
+    }
 
         /** Copy assignment.
         */
@@ -2160,6 +2638,15 @@ class Kernel1D
         */
     int size() const { return right_ - left_ + 1; }
 
+        /** Symmetry of the kernel, determined from its current values.
+
+            Convolution functions (e.g. \ref convolveLine() and
+            \ref separableConvolveMultiArray()) automatically apply symmetric
+            and antisymmetric kernels with half the number of multiplications.
+        */
+    KernelSymmetry symmetry() const
+    { return kernelSymmetry(center(), accessor(), left(), right()); }
+
         /** current border treatment mode
         */
     BorderTreatmentMode borderTreatment() const
@@ -2421,8 +2908,9 @@ Kernel1D<ARITHTYPE>::initGaussianDerivative(double std_dev,
     dc = ARITHTYPE(dc / (2.0*radius + 1.0));
 
     // remove DC, but only if kernel correction is permitted by a non-zero
-    // value for norm
-    if(norm != 0.0)
+    // value for norm (the DC of odd derivatives is zero by symmetry, skipping
+    // the subtraction keeps them exactly antisymmetric)
+    if(norm != 0.0 && order % 2 == 0)
     {
         for(unsigned int i=0; i < kernel_.size(); ++i)
         {
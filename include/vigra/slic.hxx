@@ -36,12 +36,16 @@
 #ifndef VIGRA_SLIC_HXX
 #define VIGRA_SLIC_HXX
 
+#include <algorithm>
+#include <vector>
 #include "multi_array.hxx"
 #include "multi_convolution.hxx"
 #include "multi_labeling.hxx"
 #include "numerictraits.hxx"
 #include "accumulator.hxx"
 #include "array_vector.hxx"
+#include "rgbvalue.hxx"
+#include "threadpool.hxx"
 
 namespace vigra {
 
@@ -193,6 +197,93 @@ struct SlicOptions
 
 namespace detail {
 
+    // Squared color distances between a cluster mean and a line of pixels.
+template <class T, class MeanType, class DistanceType>
+void
+slicColorDistances(T const * data, MultiArrayIndex stride, MultiArrayIndex size,
+                   MeanType const & mean, DistanceType * res)
+{
+    for(MultiArrayIndex k = 0; k < size; ++k, data += stride)
+        res[k] = DistanceType(squaredNorm(mean - *data));
+}
+
+    // Fast kernel for 3-channel float data (e.g. RGB or Lab images): the channels
+    // are accessed directly, and the loop contains no branches and no calls, so that
+    // the compiler can vectorize it. The arithmetic is the same as in the generic
+    // version, so that the results are identical.
+template <class MeanType, class DistanceType>
+void
+slicColorDistances3(float const * data, MultiArrayIndex stride, MultiArrayIndex size,
+                    MeanType const & mean, DistanceType * res)
+{
+    double m0 = mean[0], m1 = mean[1], m2 = mean[2];
+    if(stride == 3)
+    {
+        for(MultiArrayIndex k = 0; k < size; ++k)
+        {
+            double d0 = m0 - data[3*k], d1 = m1 - data[3*k+1], d2 = m2 - data[3*k+2];
+            res[k] = DistanceType(d0*d0 + d1*d1 + d2*d2);
+        }
+    }
+    else
+    {
+        for(MultiArrayIndex k = 0; k < size; ++k)
+        {
+            float const * p = data + k*stride;
+            double d0 = m0 - p[0], d1 = m1 - p[1], d2 = m2 - p[2];
+            res[k] = DistanceType(d0*d0 + d1*d1 + d2*d2);
+        }
+    }
+}
+
+template <class MeanType, class DistanceType>
+inline void
+slicColorDistances(TinyVector<float, 3> const * data, MultiArrayIndex stride, MultiArrayIndex size,
+                   MeanType const & mean, DistanceType * res)
+{
+    slicColorDistances3(&(*data)[0], 3*stride, size, mean, res);
+}
+
+template <class MeanType, class DistanceType>
+inline void
+slicColorDistances(RGBValue<float> const * data, MultiArrayIndex stride, MultiArrayIndex size,
+                   MeanType const & mean, DistanceType * res)
+{
+    slicColorDistances3(&(*data)[0], 3*stride, size, mean, res);
+}
+
+    // Assign 'label' to the pixels of a line whose new distance is smaller than the
+    // present one. The outcome is unpredictable, so selects and bit masks are used
+    // instead of branches, and the compiler can vectorize the loop when the labels
+    // are unstrided ('distances' is always unstrided).
+template <class DistanceType, class Label>
+void
+slicUpdateLine(DistanceType const * dist, DistanceType * distances,
+               Label * labels, MultiArrayIndex labelStride,
+               MultiArrayIndex size, Label label)
+{
+    if(labelStride == 1)
+    {
+        for(MultiArrayIndex k = 0; k < size; ++k)
+        {
+            DistanceType value = dist[k], oldDist = distances[k];
+            Label mask = Label(0) - Label(value < oldDist);
+            labels[k] = (label & mask) | (labels[k] & ~mask);
+            distances[k] = value < oldDist ? value : oldDist;
+        }
+    }
+    else
+    {
+        for(MultiArrayIndex k = 0; k < size; ++k)
+        {
+            DistanceType value = dist[k], oldDist = distances[k];
+            Label oldLabel = labels[k*labelStride];
+            labels[k*labelStride] = value < oldDist ? label : oldLabel;
+            distances[k] = value < oldDist ? value : oldDist;
+        }
+    }
+}
+
 template <unsigned int N, class T, class Label>
 class Slic
 {
@@ -210,14 +301,35 @@ class Slic
          LabelImageType labelImage,
          DistanceType intensityScaling,
          int maxRadius,
-         SlicOptions const & options = SlicOptions());
+         SlicOptions const & options = SlicOptions(),
+         ParallelOptions const & parallel = ParallelOptions().numThreads(ParallelOptions::NoThreads));
 
     unsigned int execute();
 
   private:
+    typedef typename acc::AccumulatorResultTraits<T>::SumType MeanType;
+    typedef TinyVector<double, N>                             CenterType;
+
+        // the sums over the points of a cluster
+    struct ClusterSums
+    {
+        ClusterSums()
+        : count(0.0),
+          sum(NumericTraits<MeanType>::zero()),
+          coordSum(0.0)
+        {}
+
+        double     count;
+        MeanType   sum;
+        CenterType coordSum;
+    };
+
+    void updateClusters();
     void updateAssigments();
     unsigned int postProcessing();
 
+    void blockBounds(MultiArrayIndex block, ShapeType & start, ShapeType & stop) const;
+
     typedef MultiArray<N,DistanceType>  DistanceImageType;
 
     ShapeType                       shape_;
@@ -227,10 +339,14 @@ class Slic
     int                             max_radius_;
     DistanceType                    normalization_;
     SlicOptions                     options_;
-
-    typedef acc::Select<acc::DataArg<1>, acc::LabelArg<2>, acc::Mean, acc::RegionCenter> Statistics;
-    typedef acc::AccumulatorChainArray<CoupledArrays<N, T, Label>, Statistics> RegionFeatures;
-    RegionFeatures clusters_;
+    ParallelOptions                 parallel_;
+    MultiArrayIndex                 blockCount_;
+    Label                           maxLabel_;
+
+        // cluster statistics, indexed by label
+    ArrayVector<double>             counts_;
+    ArrayVector<MeanType>           means_;
+    ArrayVector<CenterType>         centers_;
 };
 
 
@@ -241,27 +357,57 @@ Slic<N, T, Label>::Slic(
     LabelImageType        labelImage,
     DistanceType          intensityScaling,
     int                   maxRadius,
-    SlicOptions const &   options)
+    SlicOptions const &   options,
+    ParallelOptions const & parallel)
 :   shape_(dataImage.shape()),
     dataImage_(dataImage),
     labelImage_(labelImage),
     distance_(shape_),
     max_radius_(maxRadius),
     normalization_(sq(intensityScaling) / sq(max_radius_)),
-    options_(options)
+    options_(options),
+    parallel_(parallel),
+    // The array is divided into blocks along the last axis. The block count does
+    // not depend on the number of threads, so that the cluster statistics (which
+    // are summed per block) are the same for any number of threads.
+    blockCount_(std::min<MultiArrayIndex>(shape_[N-1], 256)),
+    maxLabel_(0)
+{}
+
+template <unsigned int N, class T, class Label>
+void
+Slic<N, T, Label>::blockBounds(MultiArrayIndex block, ShapeType & start, ShapeType & stop) const
 {
-    clusters_.ignoreLabel(0);
+    start = ShapeType();
+    stop = shape_;
+    start[N-1] = block * shape_[N-1] / blockCount_;
+    stop[N-1]  = (block + 1) * shape_[N-1] / blockCount_;
 }
 
 template <unsigned int N, class T, class Label>
 unsigned int Slic<N, T, Label>::execute()
 {
+    // labels can only disappear during the iterations, so that
+    // the largest initial label bounds all later ones
+    std::vector<Label> blockMax(blockCount_, Label());
+    parallel_foreach(parallel_, blockCount_,
+        [&](size_t, std::ptrdiff_t b)
+        {
+            ShapeType start, stop;
+            blockBounds(b, start, stop);
+            LabelImageType block = labelImage_.subarray(start, stop);
+            for(auto iter = block.begin(); iter != block.end(); ++iter)
+                blockMax[b] = std::max(blockMax[b], *iter);
+        });
+    maxLabel_ = blockCount_ > 0
+                    ? *std::max_element(blockMax.begin(), blockMax.end())
+                    : Label();
+
     // Do SLIC
     for(size_t i=0; i<options_.iter; ++i)
     {
         // update mean for each cluster
-        clusters_.reset();
-        extractFeatures(dataImage_, labelImage_, clusters_);
+        updateClusters();
 
         // update which pixels get assigned to which cluster
         updateAssigments();
@@ -272,45 +418,169 @@ unsigned int Slic<N, T, Label>::execute()
 
 template <unsigned int N, class T, class Label>
 void
-Slic<N, T, Label>::updateAssigments()
+Slic<N, T, Label>::updateClusters()
 {
-    using namespace acc;
-    distance_.init(NumericTraits<DistanceType>::max());
-    for(unsigned int c=1; c<=clusters_.maxRegionLabel(); ++c)
+    // Every block sums its points in scan order, using a dense per-thread buffer,
+    // and hands over the sums of the labels it touched. These partial sums are
+    // then added in block order, so that the result is deterministic.
+    std::size_t threadCount = std::max<std::size_t>(1, parallel_.getActualNumThreads());
+    std::vector<ArrayVector<ClusterSums> > buffers(threadCount);
+    std::vector<std::vector<std::pair<Label, ClusterSums> > > partialSums(blockCount_);
+
+    parallel_foreach(parallel_, blockCount_,
+        [&](size_t thread_id, std::ptrdiff_t b)
+        {
+            ArrayVector<ClusterSums> & buffer = buffers[thread_id];
+            if(buffer.size() == 0)
+                buffer.resize(maxLabel_+1);
+            std::vector<std::pair<Label, ClusterSums> > & touched = partialSums[b];
+
+            ShapeType start, stop;
+            blockBounds(b, start, stop);
+            ShapeType lines(stop - start);
+            lines[0] = 1;
+            MultiCoordinateIterator<N> line(lines),
+                                       end(line.getEndIterator());
+            for(; line != end; ++line)
+            {
+                ShapeType p(start + *line);
+                T const * data = &dataImage_[p];
+                Label const * labels = &labelImage_[p];
+                for(MultiArrayIndex k = start[0]; k < stop[0]; ++k,
+                    data += dataImage_.stride(0), labels += labelImage_.stride(0))
+                {
+                    Label label = *labels;
+                    if(label == 0)
+                        continue;
+                    ClusterSums & sums = buffer[label];
+                    if(sums.count == 0.0)
+                        touched.push_back(std::make_pair(label, ClusterSums()));
+                    sums.count += 1.0;
+                    sums.sum += *data;
+                    p[0] = k;
+                    sums.coordSum += p;
+                }
+            }
+            for(std::size_t k = 0; k < touched.size(); ++k)
+            {
+                touched[k].second = buffer[touched[k].first];
+                buffer[touched[k].first] = ClusterSums();
+            }
+        });
+
+    ArrayVector<ClusterSums> sums(maxLabel_+1);
+    for(MultiArrayIndex b = 0; b < blockCount_; ++b)
+    {
+        for(std::size_t k = 0; k < partialSums[b].size(); ++k)
+        {
+            ClusterSums & s = sums[partialSums[b][k].first];
+            ClusterSums const & t = partialSums[b][k].second;
+            s.count += t.count;
+            s.sum += t.sum;
+            s.coordSum += t.coordSum;
+        }
+    }
+
+    counts_.resize(maxLabel_+1);
+    means_.resize(maxLabel_+1);
+    centers_.resize(maxLabel_+1);
+    for(std::size_t c = 1; c < sums.size(); ++c)
     {
-        if(get<Count>(clusters_, c) == 0) // label doesn't exist
+        counts_[c] = sums[c].count;
+        if(sums[c].count == 0.0) // label doesn't exist
             continue;
+        means_[c] = sums[c].sum / sums[c].count;
+        centers_[c] = sums[c].coordSum / sums[c].count;
+    }
+}
 
-        typedef typename LookupTag<RegionCenter, RegionFeatures>::value_type CenterType;
-        CenterType center = get<RegionCenter>(clusters_, c);
+template <unsigned int N, class T, class Label>
+void
+Slic<N, T, Label>::updateAssigments()
+{
+    // get ROI limits around the region centers, and sort the clusters
+    // into the blocks intersected by their ROIs
+    std::vector<MultiArrayIndex> blockIndex(shape_[N-1]);
+    for(MultiArrayIndex b = 0; b < blockCount_; ++b)
+    {
+        ShapeType start, stop;
+        blockBounds(b, start, stop);
+        std::fill(blockIndex.begin() + start[N-1], blockIndex.begin() + stop[N-1], b);
+    }
 
-        // get ROI limits around region center
-        ShapeType pixelCenter(round(center)),
-                  startCoord(max(ShapeType(0), pixelCenter - ShapeType(max_radius_))),
-                  endCoord(min(shape_, pixelCenter + ShapeType(max_radius_+1)));
-        center -= startCoord; // need center relative to ROI
+    ArrayVector<ShapeType> startCoords(counts_.size()), endCoords(counts_.size());
+    std::vector<std::vector<Label> > blockClusters(blockCount_);
+    for(std::size_t c=1; c<counts_.size(); ++c)
+    {
+        if(counts_[c] == 0.0) // label doesn't exist
+            continue;
 
-        // setup iterators for ROI
-        typedef typename CoupledArrays<N, T, Label, DistanceType>::IteratorType Iterator;
-        Iterator iter = createCoupledIterator(dataImage_, labelImage_, distance_).
-                            restrictToSubarray(startCoord, endCoord),
-                 end = iter.getEndIterator();
+        ShapeType pixelCenter(round(centers_[c]));
+        startCoords[c] = max(ShapeType(0), pixelCenter - ShapeType(max_radius_));
+        endCoords[c] = min(shape_, pixelCenter + ShapeType(max_radius_+1));
+        if(!allLess(startCoords[c], endCoords[c]))
+            continue;
+        for(MultiArrayIndex b = blockIndex[startCoords[c][N-1]]; b <= blockIndex[endCoords[c][N-1]-1]; ++b)
+            blockClusters[b].push_back(static_cast<Label>(c));
+    }
 
-        // only pixels within the ROI can be assigned to a cluster
-        for(; iter != end; ++iter)
+    // Every block visits its clusters in the same order as the sequential
+    // algorithm, but only updates the points of their ROIs within the block.
+    // Thus, the blocks are independent, and the result does not depend on
+    // the number of threads.
+    parallel_foreach(parallel_, blockCount_,
+        [&](size_t, std::ptrdiff_t b)
         {
-            // compute distance between cluster center and pixel
-            DistanceType spatialDist   = squaredNorm(center-iter.point());
-            DistanceType colorDist     = squaredNorm(get<Mean>(clusters_, c)-iter.template get<1>());
-            DistanceType dist =  colorDist + normalization_*spatialDist;
-            // update label?
-            if(dist < iter.template get<3>())
+            ShapeType blockStart, blockStop;
+            blockBounds(b, blockStart, blockStop);
+            distance_.subarray(blockStart, blockStop).init(NumericTraits<DistanceType>::max());
+
+            ArrayVector<DistanceType> dist(shape_[0]);
+            ArrayVector<double> coordinates(shape_[0]);
+            for(MultiArrayIndex k = 0; k < shape_[0]; ++k)
+                coordinates[k] = double(k);
+            for(std::size_t i=0; i<blockClusters[b].size(); ++i)
             {
-                iter.template get<2>() = static_cast<Label>(c);
-                iter.template get<3>() = dist;
+                Label c = blockClusters[b][i];
+                ShapeType const & startCoord = startCoords[c];
+                CenterType center = centers_[c] - startCoord; // need center relative to ROI
+
+                // only pixels within the ROI can be assigned to a cluster
+                ShapeType start(max(startCoord, blockStart)),
+                          stop(min(endCoords[c], blockStop));
+
+                ShapeType lines(stop - start);
+                MultiArrayIndex size = lines[0];
+                lines[0] = 1;
+                MultiCoordinateIterator<N> line(lines),
+                                           end(line.getEndIterator());
+                for(; line != end; ++line)
+                {
+                    ShapeType p(start + *line);
+
+                    // squared distances along the other axes (in the order of squaredNorm())
+                    double spatialOffset[N];
+                    for(unsigned int d = 1; d < N; ++d)
+                        spatialOffset[d] = sq(center[d] - (p[d] - startCoord[d]));
+
+                    // compute distance between cluster center and pixels
+                    slicColorDistances(&dataImage_[p], dataImage_.stride(0), size,
+                                       means_[c], dist.begin());
+                    double const * coord0 = coordinates.begin() + (start[0] - startCoord[0]);
+                    for(MultiArrayIndex k = 0; k < size; ++k)
+                    {
+                        double spatialDist = sq(center[0] - coord0[k]);
+                        for(unsigned int d = 1; d < N; ++d)
+                            spatialDist += spatialOffset[d];
+                        dist[k] += normalization_*DistanceType(spatialDist);
+                    }
+
+                    // update labels
+                    slicUpdateLine(dist.begin(), &distance_[p], &labelImage_[p],
+                                   labelImage_.stride(0), size, c);
+                }
             }
-        }
-    }
+        });
 }
 
 template <unsigned int N, class T, class Label>
@@ -319,7 +589,7 @@ Slic<N, T, Label>::postProcessing()
 {
     // get rid of regions below a size limit
     MultiArray<N,Label> tmpLabelImage(labelImage_);
-    unsigned int maxLabel = labelMultiArray(tmpLabelImage, labelImage_, DirectNeighborhood);
+    unsigned int maxLabel = labelMultiArray(tmpLabelImage, labelImage_, DirectNeighborhood, parallel_);
 
     unsigned int sizeLimit = options_.sizeLimit == 0
                                  ? (unsigned int)(0.25 * labelImage_.size() / maxLabel)
@@ -429,9 +699,35 @@ Slic<N, T, Label>::postProcessing()
                         DistanceType                      intensityScaling,
                         unsigned int                      seedDistance,
                         SlicOptions const &               options = SlicOptions());
+
+        // multi-threaded version
+        template <unsigned int N, class T, class S1,
+                                  class Label, class S2,
+                  class DistanceType>
+        unsigned int
+        slicSuperpixels(MultiArrayView<N, T, S1> const &  src,
+                        MultiArrayView<N, Label, S2>      labels,
+                        DistanceType                      intensityScaling,
+                        unsigned int                      seedDistance,
+                        SlicOptions const &               options,
+                        ParallelOptions const &           parallel);
     }
     \endcode
 
+    The second version distributes the work over the threads requested by
+    \ref ParallelOptions. The array is divided into slabs along the last axis. In the
+    assignment step, every slab considers the clusters whose search window intersects it,
+    in the same order as the sequential algorithm. In the update step, every slab sums
+    the colors and coordinates of its points into a per-thread buffer, and the partial
+    sums are added in slab order. Since the slabs do not depend on the number of threads,
+    the result is the same for any thread count. The first version sums over the same
+    slabs, so both versions may differ from the results of earlier VIGRA versions in
+    rare cases: the cluster means are summed in a different order, which can change the
+    last bits of the distances and thus the label of a pixel on a cluster boundary.
+    For 3-channel <tt>float</tt> data (e.g. <tt>RGBValue<float></tt> or
+    <tt>TinyVector<float, 3></tt>), color distances are computed by a dedicated kernel
+    that the compiler can vectorize.
+
     <b> Usage:</b>
 
     <b>\#include</b> \<vigra/slic.hxx\><br>
@@ -451,6 +747,10 @@ Slic<N, T, Label>::postProcessing()
     // compute seeds automatically, perform 40 iterations, and scale intensity differences
     // down to 1/20 before comparing with spatial distances
     slicSuperpixels(src, labels, intensityScaling, seedDistance, SlicOptions().iterations(40));
+
+    // the same with 4 threads
+    slicSuperpixels(src, labels, intensityScaling, seedDistance, SlicOptions().iterations(40),
+                    ParallelOptions().numThreads(4));
     \endcode
 
     This works for arbitrary-dimensional arrays.
@@ -477,6 +777,28 @@ slicSuperpixels(MultiArrayView<N, T, S1> const &  src,
     return detail::Slic<N, T, Label>(src, labels, intensityScaling, seedDistance, options).execute();
 }
 
+template <unsigned int N, class T, class S1,
+                          class Label, class S2,
+          class DistanceType>
+unsigned int
+slicSuperpixels(MultiArrayView<N, T, S1> const &  src,
+                MultiArrayView<N, Label, S2>      labels,
+                DistanceType                      intensityScaling,
+                unsigned int                      seedDistance,
+                SlicOptions const &               options,
+                ParallelOptions const &           parallel)
+{
+    if(!labels.any())
+    {
+        typedef typename NormTraits<T>::NormType TmpType;
+        MultiArray<N, TmpType> grad(src.shape());
+        gaussianGradientMagnitude(src, grad, 1.0, ConvolutionOptions<N>().parallelOptions(parallel));
+        generateSlicSeeds(grad, labels, seedDistance);
+    }
+    return detail::Slic<N, T, Label>(src, labels, intensityScaling, seedDistance,
+                                     options, parallel).execute();
+}
+
 //@}
 
 } // namespace vigra
@@ -147,6 +147,9 @@ using VIGRA_THREADING_NAMESPACE::call_once;
 // Futures.
 
 using VIGRA_THREADING_NAMESPACE::future;
+using VIGRA_THREADING_NAMESPACE::future_status;
+
+namespace chrono = VIGRA_THREADING_NAMESPACE::chrono;
 
 // Condition variables.
 
@@ -37,9 +37,13 @@
 #define VIGRA_THREADPOOL_HXX
 
 #include <vector>
-#include <queue>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <functional>
 #include <stdexcept>
 #include <cmath>
+#include <cstdlib>
 #include "mathutil.hxx"
 #include "counting_iterator.hxx"
 #include "threading.hxx"
@@ -53,6 +57,8 @@ namespace vigra
 
 //@{
 
+class ThreadPool;
+
     /**\brief Option base class for parallel algorithms.
 
         <b>\#include</b> \<vigra/threadpool.hxx\><br>
@@ -72,6 +78,7 @@ class ParallelOptions
 
     ParallelOptions()
     :   numThreads_(actualNumThreads(Auto))
+    ,   pool_(0)
     {}
 
         /** \brief Get desired number of threads.
@@ -111,9 +118,28 @@ class ParallelOptions
     ParallelOptions & numThreads(const int n)
     {
         numThreads_ = actualNumThreads(n);
+        pool_ = 0;
         return *this;
     }
 
+        /** \brief Execute parallel algorithms on the given pool.
+
+            Default: no pool is set, and algorithms run on \ref ThreadPool::global()
+            with the desired number of threads.
+
+            This sets the number of threads to <tt>pool.nThreads()</tt>. A subsequent
+            call to <tt>numThreads()</tt> detaches the pool again. The pool must not be
+            destroyed while it is used by an algorithm.
+        */
+    ParallelOptions & pool(ThreadPool & pool);
+
+        /** \brief Get the pool set by <tt>pool()</tt>, or 0 if the
+            global pool shall be used.
+        */
+    ThreadPool * getPool() const
+    {
+        return pool_;
+    }
 
   private:
         // helper function to compute the actual number of threads
@@ -131,8 +157,164 @@ class ParallelOptions
     }
 
     int numThreads_;
+    ThreadPool * pool_;
+};
+
+/********************************************************/
+/*                                                      */
+/*                   WorkStealingDeque                  */
+/*                                                      */
+/********************************************************/
+
+namespace detail {
+
+    /* Chase-Lev work-stealing deque (D. Chase, Y. Lev: "Dynamic Circular
+       Work-Stealing Deque", SPAA 2005), using the C++11 memory orderings
+       proposed by N.M. Le et al.: "Correct and Efficient Work-Stealing for
+       Weak Memory Models", PPoPP 2013.
+
+       The owning thread calls push() and pop() at the bottom end without
+       taking a lock, all other threads call steal() at the top end. The
+       element type must be a pointer, and a null pointer signals "no item".
+       Buffers replaced during growth are kept alive until destruction because
+       concurrent thieves may still read from them.
+    */
+template <class T>
+class WorkStealingDeque
+{
+    class Buffer
+    {
+      public:
+        explicit Buffer(std::ptrdiff_t capacity)
+        : mask_(capacity - 1)
+        , data_(new threading::atomic<T>[capacity])
+        {}
+
+        std::ptrdiff_t capacity() const
+        {
+            return mask_ + 1;
+        }
+
+        T get(std::ptrdiff_t i) const
+        {
+            return data_[i & mask_].load(threading::memory_order_relaxed);
+        }
+
+        void put(std::ptrdiff_t i, T value)
+        {
+            data_[i & mask_].store(value, threading::memory_order_relaxed);
+        }
+
+        Buffer * grow(std::ptrdiff_t bottom, std::ptrdiff_t top) const
+        {
+            Buffer * res = new Buffer(2*capacity());
+            for(std::ptrdiff_t i = top; i != bottom; ++i)
+                res->put(i, get(i));
+            return res;
+        }
+
+      private:
+        std::ptrdiff_t mask_;
+        std::unique_ptr<threading::atomic<T>[]> data_;
+    };
+
+  public:
+
+    explicit WorkStealingDeque(std::ptrdiff_t initialCapacity = 256)
+    : top_(0)
+    , bottom_(0)
+    , buffer_(0)
+    {
+        vigra_precondition(initialCapacity > 0 && (initialCapacity & (initialCapacity - 1)) == 0,
+            "WorkStealingDeque(): capacity must be a power of 2.");
+        Buffer * b = new Buffer(initialCapacity);
+        buffers_.emplace_back(b);
+        buffer_.store(b, threading::memory_order_relaxed);
+    }
+
+        // owner thread only
+    void push(T value)
+    {
+        std::ptrdiff_t b = bottom_.load(threading::memory_order_relaxed);
+        std::ptrdiff_t t = top_.load(threading::memory_order_acquire);
+        Buffer * a = buffer_.load(threading::memory_order_relaxed);
+        if(b - t > a->capacity() - 1)
+        {
+            a = a->grow(b, t);
+            buffers_.emplace_back(a);
+            buffer_.store(a, threading::memory_order_release);
+        }
+        a->put(b, value);
+        threading::atomic_thread_fence(threading::memory_order_release);
+        bottom_.store(b + 1, threading::memory_order_relaxed);
+    }
+
+        // owner thread only, returns 0 if the deque is empty
+    T pop()
+    {
+        std::ptrdiff_t b = bottom_.load(threading::memory_order_relaxed) - 1;
+        Buffer * a = buffer_.load(threading::memory_order_relaxed);
+        bottom_.store(b, threading::memory_order_relaxed);
+        threading::atomic_thread_fence(threading::memory_order_seq_cst);
+        std::ptrdiff_t t = top_.load(threading::memory_order_relaxed);
+        T res = 0;
+        if(t <= b)
+        {
+            res = a->get(b);
+            if(t == b)
+            {
+                // last item: race against concurrent thieves
+                if(!top_.compare_exchange_strong(t, t + 1, threading::memory_order_seq_cst,
+                                                           threading::memory_order_relaxed))
+                    res = 0;
+                bottom_.store(b + 1, threading::memory_order_relaxed);
+            }
+        }
+        else
+        {
+            bottom_.store(b + 1, threading::memory_order_relaxed);
+        }
+        return res;
+    }
+
+        // any thread, returns 0 if the deque is empty or the race for the top item was lost
+    T steal()
+    {
+        std::ptrdiff_t t = top_.load(threading::memory_order_acquire);
+        threading::atomic_thread_fence(threading::memory_order_seq_cst);
+        std::ptrdiff_t b = bottom_.load(threading::memory_order_acquire);
+        if(t < b)
+        {
+            Buffer * a = buffer_.load(threading::memory_order_acquire);
+            T res = a->get(t);
+            if(top_.compare_exchange_strong(t, t + 1, threading::memory_order_seq_cst,
+                                                      threading::memory_order_relaxed))
+                return res;
+        }
+        return 0;
+    }
+
+    bool empty() const
+    {
+        return bottom_.load(threading::memory_order_relaxed) <=
+                  top_.load(threading::memory_order_relaxed);
+    }
+
+  private:
+    WorkStealingDeque(WorkStealingDeque const &);
+    WorkStealingDeque & operator=(WorkStealingDeque const &);
+
+        // keep top_ and bottom_ on different cache lines, since the former is
+        // written by thieves and the latter by the owner
+    threading::atomic<std::ptrdiff_t> top_;
+    char padding_[64];
+    threading::atomic<std::ptrdiff_t> bottom_;
+    threading::atomic<Buffer *> buffer_;
+    std::vector<std::unique_ptr<Buffer> > buffers_;
 };
 
+} // namespace detail
+
 /********************************************************/
 /*                                                      */
 /*                      ThreadPool                      */
@@ -141,6 +323,14 @@ class ParallelOptions
 
     /**\brief Thread pool class to manage a set of parallel workers.
 
+        Each worker owns a work-stealing deque: tasks enqueued from within a
+        running task are pushed onto the calling worker's deque without locking,
+        and idle workers steal from the deques of their peers. Tasks enqueued
+        from outside the pool are distributed round-robin over per-worker
+        inboxes, so that submitting threads and workers don't contend on a
+        single lock. Workers that find no work go to sleep until new tasks
+        arrive.
+
         <b>\#include</b> \<vigra/threadpool.hxx\><br>
         Namespace: vigra
     */
@@ -198,12 +388,14 @@ class ThreadPool
 
     /**
      * Block until all tasks are finished.
+     *
+     * When called from within a task running on this pool, the calling worker
+     * doesn't block. Instead, it executes pending tasks until all tasks are
+     * finished except for those that are themselves waiting in
+     * <tt>waitFinished()</tt>. Use \ref TaskGroup to wait for a specific
+     * set of tasks.
      */
-    void waitFinished()
-    {
-        threading::unique_lock<threading::mutex> lock(queue_mutex);
-        finish_condition.wait(lock, [this](){ return tasks.empty() && (busy == 0); });
-    }
+    void waitFinished();
 
     /**
      * Return the number of worker threads.
@@ -213,74 +405,189 @@ class ThreadPool
         return workers.size();
     }
 
+    /**
+     * Return the process-wide thread pool. It is created upon first use with
+     * <tt>globalConcurrency()</tt> workers and is shared by all parallel algorithms
+     * that don't get an explicit pool via <tt>ParallelOptions::pool()</tt>.
+     * This avoids creating and joining threads in every algorithm call.
+     */
+    static ThreadPool & global();
+
+    /**
+     * Return the number of workers of the global pool, i.e. the maximum number
+     * of threads that run concurrently in algorithms using the global pool.
+     * Unless set by <tt>setGlobalConcurrency()</tt>, this is taken from the
+     * environment variable <tt>VIGRA_NUM_THREADS</tt> if present, and
+     * <tt>threading::thread::hardware_concurrency()</tt> otherwise.
+     */
+    static int globalConcurrency();
+
+    /**
+     * Set the number of workers of the global pool (or one of the constants
+     * <tt>ParallelOptions::Auto</tt>, <tt>Nice</tt> and <tt>NoThreads</tt>).
+     * This must be called before the global pool is used for the first time,
+     * otherwise a <tt>PreconditionViolation</tt> is thrown.
+     */
+    static void setGlobalConcurrency(int n);
+
+    /**
+     * When called from a worker of this pool, find and execute one pending task
+     * and return true. Otherwise, or if no task is pending, return false.
+     * Use this to wait for the completion of tasks without blocking a worker
+     * (see also TaskGroup).
+     */
+    bool runPendingTask();
+
 private:
 
+    friend class TaskGroup;
+
+    typedef std::function<void(int)> Task;
+
+    // per-worker task queues
+    struct WorkerQueue
+    {
+        WorkerQueue()
+        : inbox_size(0)
+        {}
+
+        // tasks enqueued by the worker itself (lock-free)
+        detail::WorkStealingDeque<Task *> local;
+
+        // tasks enqueued by threads outside the pool
+        threading::mutex inbox_mutex;
+        std::deque<Task *> inbox;
+        threading::atomic_long inbox_size;
+    };
+
+    // the pool and worker index the calling thread belongs to (if any)
+    struct CurrentWorker
+    {
+        ThreadPool * pool;
+        int index;
+    };
+
+    static CurrentWorker & currentWorker()
+    {
+        static thread_local CurrentWorker current = { 0, -1 };
+        return current;
+    }
+
+    bool calledFromWorker() const
+    {
+        return currentWorker().pool == this;
+    }
+
+    // settings and instance of the global pool
+    struct GlobalPool
+    {
+        GlobalPool()
+        : concurrency(defaultConcurrency())
+        {}
+
+        static int defaultConcurrency()
+        {
+            char const * env = std::getenv("VIGRA_NUM_THREADS");
+            int n = env ? std::atoi(env) : 0;
+            return ParallelOptions().numThreads(n > 0 ? n : (int)ParallelOptions::Auto).getNumThreads();
+        }
+
+        threading::mutex mutex;
+        int concurrency;
+        std::unique_ptr<ThreadPool> pool;
+    };
+
+    static GlobalPool & globalPool()
+    {
+        static GlobalPool global;
+        return global;
+    }
+
     // helper function to init the thread pool
     void init(const ParallelOptions & options);
 
+    // the main loop of worker 'ti'
+    void work(int ti);
+
+    // put a task into the appropriate queue and wake up a sleeping worker
+    void push(Task * task);
+
+    // get the next task for worker 'ti', or 0 if no task is available
+    Task * findTask(int ti);
+
+    Task * popInbox(int ti);
+
+    void runTask(Task * task, int ti);
+
     // need to keep track of threads so we can join them
     std::vector<threading::thread> workers;
 
-    // the task queue
-    std::queue<std::function<void(int)> > tasks;
+    // the task queues, one per worker
+    std::vector<std::unique_ptr<WorkerQueue> > queues;
 
     // synchronization
-    threading::mutex queue_mutex;
+    threading::mutex sleep_mutex;
     threading::condition_variable worker_condition;
     threading::condition_variable finish_condition;
-    bool stop;
-    threading::atomic_long busy, processed;
+    threading::atomic<bool> stop;
+    // 'pending' counts the queued tasks, 'outstanding' the tasks that were pushed
+    // and haven't finished yet, and 'active' the outstanding tasks that are not
+    // blocked in waitFinished()
+    threading::atomic_long pending, outstanding, active, sleeping, processed, next_inbox;
 };
 
+inline ParallelOptions & ParallelOptions::pool(ThreadPool & pool)
+{
+    numThreads_ = (int)pool.nThreads();
+    pool_ = &pool;
+    return *this;
+}
+
+inline ThreadPool & ThreadPool::global()
+{
+    GlobalPool & global = globalPool();
+    threading::lock_guard<threading::mutex> lock(global.mutex);
+    if(!global.pool)
+        global.pool.reset(new ThreadPool(global.concurrency));
+    return *global.pool;
+}
+
+inline int ThreadPool::globalConcurrency()
+{
+    GlobalPool & global = globalPool();
+    threading::lock_guard<threading::mutex> lock(global.mutex);
+    return global.concurrency;
+}
+
+inline void ThreadPool::setGlobalConcurrency(int n)
+{
+    GlobalPool & global = globalPool();
+    threading::lock_guard<threading::mutex> lock(global.mutex);
+    vigra_precondition(!global.pool,
+        "ThreadPool::setGlobalConcurrency(): the global pool is already in use.");
+    global.concurrency = ParallelOptions().numThreads(n).getNumThreads();
+}
+
 inline void ThreadPool::init(const ParallelOptions & options)
 {
-    busy.store(0);
+    pending.store(0);
+    outstanding.store(0);
+    active.store(0);
+    sleeping.store(0);
     processed.store(0);
+    next_inbox.store(0);
 
     const size_t actualNThreads = options.getNumThreads();
     for(size_t ti = 0; ti<actualNThreads; ++ti)
-    {
-        workers.emplace_back(
-            [ti,this]
-            {
-                for(;;)
-                {
-                    std::function<void(int)> task;
-                    {
-                        threading::unique_lock<threading::mutex> lock(this->queue_mutex);
-
-                        // will wait if : stop == false  AND queue is empty
-                        // if stop == true AND queue is empty thread function will return later
-                        //
-                        // so the idea of this wait, is : If where are not in the destructor
-                        // (which sets stop to true, we wait here for new jobs)
-                        this->worker_condition.wait(lock, [this]{ return this->stop || !this->tasks.empty(); });
-                        if(!this->tasks.empty())
-                        {
-                            ++busy;
-                            task = std::move(this->tasks.front());
-                            this->tasks.pop();
-                            lock.unlock();
-                            task(ti);
-                            ++processed;
-                            --busy;
-                            finish_condition.notify_one();
-                        }
-                        else if(stop)
-                        {
-                            return;
-                        }
-                    }
-                }
-            }
-        );
-    }
+        queues.emplace_back(new WorkerQueue);
+    for(size_t ti = 0; ti<actualNThreads; ++ti)
+        workers.emplace_back([ti,this]{ this->work((int)ti); });
 }
 
 inline ThreadPool::~ThreadPool()
 {
     {
-        threading::unique_lock<threading::mutex> lock(queue_mutex);
+        threading::unique_lock<threading::mutex> lock(sleep_mutex);
         stop = true;
     }
     worker_condition.notify_all();
@@ -288,6 +595,162 @@ inline ThreadPool::~ThreadPool()
         worker.join();
 }
 
+inline void ThreadPool::waitFinished()
+{
+    if(calledFromWorker())
+    {
+        // the calling task doesn't count as active while it waits, so we are
+        // done when all outstanding tasks are waiting as well
+        --active;
+        while(active.load() > 0)
+        {
+            if(!runPendingTask())
+                threading::this_thread::yield();
+        }
+        ++active;
+    }
+    else
+    {
+        threading::unique_lock<threading::mutex> lock(sleep_mutex);
+        finish_condition.wait(lock, [this](){ return outstanding.load() == 0; });
+    }
+}
+
+inline void ThreadPool::work(int ti)
+{
+    currentWorker().pool = this;
+    currentWorker().index = ti;
+
+    // number of unsuccessful searches before the worker goes to sleep
+    const int spinLimit = 64;
+    int idle = 0;
+    for(;;)
+    {
+        Task * task = findTask(ti);
+        if(task)
+        {
+            runTask(task, ti);
+            idle = 0;
+        }
+        else if(++idle < spinLimit)
+        {
+            threading::this_thread::yield();
+        }
+        else
+        {
+            threading::unique_lock<threading::mutex> lock(sleep_mutex);
+
+            // will wait if : stop == false  AND no task is pending
+            // if stop == true AND no task is pending thread function will return
+            ++sleeping;
+            worker_condition.wait(lock, [this]{ return this->stop || this->pending.load() > 0; });
+            --sleeping;
+            if(stop && pending.load() == 0)
+                return;
+            idle = 0;
+        }
+    }
+}
+
+inline void ThreadPool::push(Task * task)
+{
+    // don't allow enqueueing after stopping the pool
+    if(stop)
+    {
+        delete task;
+        throw std::runtime_error("enqueue on stopped ThreadPool");
+    }
+
+    // count the task before it can run, so that the counters of a task that
+    // pushes subtasks never drop to zero before the subtasks are finished
+    ++outstanding;
+    ++active;
+    ++pending;
+    CurrentWorker const & current = currentWorker();
+    if(current.pool == this)
+    {
+        queues[current.index]->local.push(task);
+    }
+    else
+    {
+        WorkerQueue & q = *queues[next_inbox.fetch_add(1) % (long)queues.size()];
+        threading::lock_guard<threading::mutex> lock(q.inbox_mutex);
+        q.inbox.push_back(task);
+        ++q.inbox_size;
+    }
+
+    if(sleeping.load() > 0)
+    {
+        threading::lock_guard<threading::mutex> lock(sleep_mutex);
+        worker_condition.notify_one();
+    }
+}
+
+inline ThreadPool::Task * ThreadPool::popInbox(int ti)
+{
+    WorkerQueue & q = *queues[ti];
+    if(q.inbox_size.load() == 0)
+        return 0;
+    threading::lock_guard<threading::mutex> lock(q.inbox_mutex);
+    if(q.inbox.empty())
+        return 0;
+    Task * task = q.inbox.front();
+    q.inbox.pop_front();
+    --q.inbox_size;
+    return task;
+}
+
+inline ThreadPool::Task * ThreadPool::findTask(int ti)
+{
+    // prefer our own tasks, most recently spawned first (good cache locality)
+    Task * task = queues[ti]->local.pop();
+    if(task)
+        return task;
+    task = popInbox(ti);
+    if(task)
+        return task;
+
+    // steal from the other workers, oldest tasks first
+    const int n = (int)queues.size();
+    for(int k = 1; k < n && pending.load() > 0; ++k)
+    {
+        int victim = (ti + k) % n;
+        task = queues[victim]->local.steal();
+        if(task)
+            return task;
+        task = popInbox(victim);
+        if(task)
+            return task;
+    }
+    return 0;
+}
+
+inline bool ThreadPool::runPendingTask()
+{
+    CurrentWorker const & current = currentWorker();
+    if(current.pool != this)
+        return false;
+    Task * task = findTask(current.index);
+    if(!task)
+        return false;
+    runTask(task, current.index);
+    return true;
+}
+
+inline void ThreadPool::runTask(Task * task, int ti)
+{
+    --pending;
+    (*task)(ti);
+    delete task;
+    ++processed;
+    --active;
+    if(outstanding.fetch_sub(1) == 1)
+    {
+        threading::lock_guard<threading::mutex> lock(sleep_mutex);
+        finish_condition.notify_all();
+    }
+}
+
 template<class F>
 inline auto
 ThreadPool::enqueueReturning(F&& f) -> threading::future<decltype(f(0))>
@@ -299,21 +762,12 @@ ThreadPool::enqueueReturning(F&& f) -> threading::future<decltype(f(0))>
     auto res = task->get_future();
 
     if(workers.size()>0){
-        {
-            threading::unique_lock<threading::mutex> lock(queue_mutex);
-
-            // don't allow enqueueing after stopping the pool
-            if(stop)
-                throw std::runtime_error("enqueue on stopped ThreadPool");
-
-            tasks.emplace(
+        push(new Task(
                 [task](int tid)
                 {
                     (*task)(std::move(tid));
                 }
-            );
-        }
-        worker_condition.notify_one();
+            ));
     }
     else{
         (*task)(0);
@@ -343,14 +797,7 @@ ThreadPool::enqueue(F&& f)
 
     auto res = task->get_future();
     if(workers.size()>0){
-        {
-            threading::unique_lock<threading::mutex> lock(queue_mutex);
-
-            // don't allow enqueueing after stopping the pool
-            if(stop)
-                throw std::runtime_error("enqueue on stopped ThreadPool");
-
-            tasks.emplace(
+        push(new Task(
                [task](int tid)
                {
 #if defined(USE_BOOST_THREAD) && \
@@ -360,9 +807,7 @@ ThreadPool::enqueue(F&& f)
                     (*task)(std::move(tid));
 #endif
                }
-            );
-        }
-        worker_condition.notify_one();
+            ));
     }
     else{
 #if defined(USE_BOOST_THREAD) && \
@@ -375,12 +820,191 @@ ThreadPool::enqueue(F&& f)
     return res;
 }
 
+/********************************************************/
+/*                                                      */
+/*                       TaskGroup                      */
+/*                                                      */
+/********************************************************/
+
+    /**\brief Run a group of tasks on a ThreadPool and wait for their completion.
+
+        This class implements fork-join parallelism: tasks are spawned with
+        <tt>run()</tt> and joined with <tt>wait()</tt>. When <tt>wait()</tt> is
+        called from within a task that runs on the same pool, the calling worker
+        doesn't go to sleep. Instead, it executes pending tasks of the pool (preferably
+        the ones it just spawned) until all tasks of the group are finished. Therefore,
+        nested parallel algorithms can share a single pool without the danger of
+        starvation or deadlock, even if all workers are waiting for nested groups.
+
+        If tasks throw exceptions, <tt>wait()</tt> rethrows the first one (in the order
+        of the <tt>run()</tt> calls) after all tasks of the group have finished.
+
+        <b>Usage:</b>
+
+        \code
+        // compute the sum of v[begin, end) by recursive subdivision
+        long sum(ThreadPool & pool, std::vector<long> const & v, size_t begin, size_t end)
+        {
+            if(end - begin < 1000)
+                return std::accumulate(v.begin()+begin, v.begin()+end, 0L);
+
+            size_t middle = (begin + end) / 2;
+            long left = 0;
+            TaskGroup group(pool);
+            group.run([&](int thread_id)
+                      {
+                          left = sum(pool, v, begin, middle);
+                      });
+            long right = sum(pool, v, middle, end);
+            group.wait();
+            return left + right;
+        }
+        \endcode
+
+        <b>\#include</b> \<vigra/threadpool.hxx\><br>
+        Namespace: vigra
+    */
+class TaskGroup
+{
+  public:
+
+        /** Create an empty task group whose tasks will be executed by \a pool.
+        */
+    explicit TaskGroup(ThreadPool & pool)
+    : pool_(pool)
+    , running_(0)
+    {}
+
+        /** The destructor waits until all tasks are finished. Exceptions
+            are discarded, call <tt>wait()</tt> explicitly to receive them.
+        */
+    ~TaskGroup()
+    {
+        try
+        {
+            wait();
+        }
+        catch(...)
+        {}
+    }
+
+        /** Enqueue a task. \a f must be callable with the thread index as
+            its only argument.
+        */
+    template <class F>
+    void run(F && f);
+
+        /** Wait until all tasks of the group are finished, and rethrow the
+            first exception raised by any of them.
+        */
+    void wait();
+
+        /** The pool executing the tasks of this group.
+        */
+    ThreadPool & pool() const
+    {
+        return pool_;
+    }
+
+  private:
+    TaskGroup(TaskGroup const &);
+    TaskGroup & operator=(TaskGroup const &);
+
+    ThreadPool & pool_;
+    threading::atomic_long running_;
+    std::vector<threading::future<void> > futures_;
+};
+
+template <class F>
+inline void TaskGroup::run(F && f)
+{
+    threading::atomic_long * running = &running_;
+    ++running_;
+    try
+    {
+        futures_.push_back(pool_.enqueue(
+            [f, running](int tid) mutable
+            {
+                // signal completion even if f throws
+                struct Guard
+                {
+                    threading::atomic_long * r;
+                    ~Guard() { --(*r); }
+                } guard = { running };
+                f(tid);
+            }));
+    }
+    catch(...)
+    {
+        --running_;
+        throw;
+    }
+}
+
+inline void TaskGroup::wait()
+{
+    if(pool_.calledFromWorker())
+    {
+        // help instead of blocking the worker
+        while(running_.load() > 0)
+        {
+            if(!pool_.runPendingTask())
+                threading::this_thread::yield();
+        }
+    }
+    std::vector<threading::future<void> > futures;
+    futures.swap(futures_);
+    for(auto & fut : futures)
+        fut.wait();
+    for(auto & fut : futures)
+        fut.get();
+}
+
 /********************************************************/
 /*                                                      */
 /*                   parallel_foreach                   */
 /*                                                      */
 /********************************************************/
 
+namespace detail {
+
+// Process the chunks [0, nChunks) by at most nSlots concurrent tasks on the given pool.
+// Each task repeatedly grabs the next unprocessed chunk and calls process(slot, chunk).
+// The slot index in [0, nSlots) identifies the task and is passed to the user functor
+// as its thread index. Thus, thread indices are always smaller than the number of
+// threads requested by the caller, even when the pool has more workers.
+template <class F>
+inline void parallel_foreach_chunks(
+    ThreadPool & pool,
+    std::ptrdiff_t nSlots,
+    std::ptrdiff_t nChunks,
+    F && process
+){
+    nSlots = std::min(nSlots, nChunks);
+    threading::atomic_long next(0);
+    TaskGroup group(pool);
+    for(std::ptrdiff_t slot = 0; slot < nSlots; ++slot)
+    {
+        group.run(
+            [&process, &next, nChunks, slot]
+            (int)
+            {
+                for(std::ptrdiff_t chunk = next.fetch_add(1); chunk < nChunks; chunk = next.fetch_add(1))
+                    process((int)slot, chunk);
+            }
+        );
+    }
+    group.wait();
+}
+
+inline std::ptrdiff_t parallel_foreach_chunk_size(std::ptrdiff_t workload, std::ptrdiff_t nSlots)
+{
+    const float workPerThread = float(workload)/nSlots;
+    return std::max<std::ptrdiff_t>(roundi(workPerThread/3.0), 1);
+}
+
+} // namespace detail
+
 // nItems must be either zero or std::distance(iter, end).
 // NOTE: the redundancy of nItems and iter,end here is due to the fact that, for forward iterators,
 // computing the distance from iterators is costly, and, for input iterators, we might not know in advance
@@ -388,37 +1012,26 @@ ThreadPool::enqueue(F&& f)
 template<class ITER, class F>
 inline void parallel_foreach_impl(
     ThreadPool & pool,
+    const std::ptrdiff_t nSlots,
     const std::ptrdiff_t nItems,
     ITER iter,
     ITER end,
     F && f,
     std::random_access_iterator_tag
 ){
-    std::ptrdiff_t workload = std::distance(iter, end);
+    const std::ptrdiff_t workload = std::distance(iter, end);
     vigra_precondition(workload == nItems || nItems == 0, "parallel_foreach(): Mismatch between num items and begin/end.");
-    const float workPerThread = float(workload)/pool.nThreads();
-    const std::ptrdiff_t chunkedWorkPerThread = std::max<std::ptrdiff_t>(roundi(workPerThread/3.0), 1);
+    const std::ptrdiff_t chunkSize = detail::parallel_foreach_chunk_size(workload, nSlots);
 
-    std::vector<threading::future<void> > futures;
-    for( ;iter<end; iter+=chunkedWorkPerThread)
-    {
-        const size_t lc = std::min(workload, chunkedWorkPerThread);
-        workload-=lc;
-        futures.emplace_back(
-            pool.enqueue(
-                [&f, iter, lc]
-                (int id)
-                {
-                    for(size_t i=0; i<lc; ++i)
-                        f(id, iter[i]);
-                }
-            )
-        );
-    }
-    for (auto & fut : futures)
-    {
-        fut.get();
-    }
+    detail::parallel_foreach_chunks(pool, nSlots, (workload + chunkSize - 1) / chunkSize,
+        [&f, iter, workload, chunkSize]
+        (int id, std::ptrdiff_t chunk)
+        {
+            const std::ptrdiff_t chunkEnd = std::min(workload, (chunk+1)*chunkSize);
+            for(std::ptrdiff_t i=chunk*chunkSize; i<chunkEnd; ++i)
+                f(id, iter[i]);
+        }
+    );
 }
 
 
@@ -427,7 +1040,8 @@ inline void parallel_foreach_impl(
 template<class ITER, class F>
 inline void parallel_foreach_impl(
     ThreadPool & pool,
-    const std::ptrdiff_t nItems,
+    const std::ptrdiff_t nSlots,
+    std::ptrdiff_t nItems,
     ITER iter,
     ITER end,
     F && f,
@@ -437,41 +1051,36 @@ inline void parallel_foreach_impl(
         nItems = std::distance(iter, end);
 
     std::ptrdiff_t workload = nItems;
-    const float workPerThread = float(workload)/pool.nThreads();
-    const std::ptrdiff_t chunkedWorkPerThread = std::max<std::ptrdiff_t>(roundi(workPerThread/3.0), 1);
+    const std::ptrdiff_t chunkSize = detail::parallel_foreach_chunk_size(workload, nSlots);
 
-    std::vector<threading::future<void> > futures;
-    for(;;)
+    // find the start of each chunk
+    std::vector<ITER> chunkBegin;
+    std::vector<std::ptrdiff_t> chunkLength;
+    while(workload > 0)
     {
-        const size_t lc = std::min(chunkedWorkPerThread, workload);
+        const std::ptrdiff_t lc = std::min(chunkSize, workload);
         workload -= lc;
-        futures.emplace_back(
-            pool.enqueue(
-                [&f, iter, lc]
-                (int id)
-                {
-                    auto iterCopy = iter;
-                    for(size_t i=0; i<lc; ++i){
-                        f(id, *iterCopy);
-                        ++iterCopy;
-                    }
-                }
-            )
-        );
-        for (size_t i = 0; i < lc; ++i)
+        chunkBegin.push_back(iter);
+        chunkLength.push_back(lc);
+        for (std::ptrdiff_t i = 0; i < lc; ++i)
         {
+            vigra_postcondition(iter != end, "parallel_foreach(): Mismatch between num items and begin/end.");
             ++iter;
-            if (iter == end)
-            {
-                vigra_postcondition(workload == 0, "parallel_foreach(): Mismatch between num items and begin/end.");
-                break;
-            }
         }
-        if(workload==0)
-            break;
     }
-    for (auto & fut : futures)
-        fut.get();
+    vigra_postcondition(iter == end, "parallel_foreach(): Mismatch between num items and begin/end.");
+
+    detail::parallel_foreach_chunks(pool, nSlots, (std::ptrdiff_t)chunkBegin.size(),
+        [&f, &chunkBegin, &chunkLength]
+        (int id, std::ptrdiff_t chunk)
+        {
+            auto iterCopy = chunkBegin[chunk];
+            for(std::ptrdiff_t i=0; i<chunkLength[chunk]; ++i){
+                f(id, *iterCopy);
+                ++iterCopy;
+            }
+        }
+    );
 }
 
 
@@ -480,29 +1089,22 @@ inline void parallel_foreach_impl(
 template<class ITER, class F>
 inline void parallel_foreach_impl(
     ThreadPool & pool,
+    const std::ptrdiff_t nSlots,
     const std::ptrdiff_t nItems,
     ITER iter,
     ITER end,
     F && f,
     std::input_iterator_tag
 ){
-    std::ptrdiff_t num_items = 0;
-    std::vector<threading::future<void> > futures;
+    // input iterators can only be traversed once, so we copy the items
+    std::vector<typename std::iterator_traits<ITER>::value_type> items;
+    if(nItems > 0)
+        items.reserve(nItems);
     for (; iter != end; ++iter)
-    {
-        auto item = *iter;
-        futures.emplace_back(
-            pool.enqueue(
-                [&f, &item](int id){
-                    f(id, item);
-                }
-            )
-        );
-        ++num_items;
-    }
-    vigra_postcondition(num_items == nItems || nItems == 0, "parallel_foreach(): Mismatch between num items and begin/end.");
-    for (auto & fut : futures)
-        fut.get();
+        items.push_back(*iter);
+    vigra_postcondition((std::ptrdiff_t)items.size() == nItems || nItems == 0, "parallel_foreach(): Mismatch between num items and begin/end.");
+    parallel_foreach_impl(pool, nSlots, 0, items.begin(), items.end(), f,
+                          std::random_access_iterator_tag());
 }
 
 // Runs foreach on a single thread.
@@ -530,13 +1132,20 @@ inline void parallel_foreach_single_thread(
     \code
     namespace vigra {
         // pass the desired number of threads or ParallelOptions::Auto
-        // (creates an internal thread pool accordingly)
+        // (executes on the global thread pool)
         template<class ITER, class F>
         void parallel_foreach(int64_t nThreads,
                               ITER begin, ITER end,
                               F && f,
                               const uint64_t nItems = 0);
 
+        // use the pool or number of threads specified in the options
+        template<class ITER, class F>
+        void parallel_foreach(ParallelOptions const & options,
+                              ITER begin, ITER end,
+                              F && f,
+                              const uint64_t nItems = 0);
+
         // use an existing thread pool
         template<class ITER, class F>
         void parallel_foreach(ThreadPool & pool,
@@ -556,29 +1165,47 @@ inline void parallel_foreach_single_thread(
         void parallel_foreach(ThreadPool & threadpool,
                               uint64_t nItems,
                               F && f);
+
+        // likewise with ParallelOptions
+        template<class F>
+        void parallel_foreach(ParallelOptions const & options,
+                              uint64_t nItems,
+                              F && f);
     }
     \endcode
 
-    Create a thread pool (or use an existing one) to apply the functor \arg f
+    Use the global thread pool (or an existing one) to apply the functor \arg f
     to all items in the range <tt>[begin, end)</tt> in parallel. \arg f must
     be callable with two arguments of type <tt>size_t</tt> and <tt>T</tt>, where
     the first argument is the thread index (starting at 0) and T is convertible
     from the iterator's <tt>reference_type</tt> (i.e. the result of <tt>*begin</tt>).
+    The thread index is always smaller than the requested number of threads
+    (or <tt>pool.nThreads()</tt>, respectively), and no two concurrently running
+    invocations of \arg f receive the same index.
 
     If the iterators are forward iterators (<tt>std::forward_iterator_tag</tt>), you
     can provide the optional argument <tt>nItems</tt> to avoid the a
     <tt>std::distance(begin, end)</tt> call to compute the range's length.
 
     Parameter <tt>nThreads</tt> controls the number of threads. <tt>parallel_foreach</tt>
-    will split the work into about three times as many parallel tasks.
+    will split the work into about three times as many chunks.
     If <tt>nThreads = ParallelOptions::Auto</tt>, the number of threads is set to
     the machine default (<tt>std::thread::hardware_concurrency()</tt>).
+    When no pool is given, the chunks are executed by \ref ThreadPool::global(), so
+    that no threads need to be created per call. Since all such calls share the
+    global pool, the total concurrency never exceeds
+    <tt>ThreadPool::globalConcurrency()</tt>, regardless of <tt>nThreads</tt>.
 
     If <tt>nThreads = 0</tt>, the function will not use threads,
     but will call the functor sequentially. This can also be enforced by setting the
     preprocessor flag <tt>VIGRA_SINGLE_THREADED</tt>, ignoring the value of
     <tt>nThreads</tt> (useful for debugging).
 
+    <tt>parallel_foreach</tt> may be called from within a functor that is itself
+    executed by <tt>parallel_foreach</tt> on the same pool. The outer worker then
+    doesn't block while the nested items are processed, but helps executing them
+    (see \ref TaskGroup). Nested algorithms can thus share a single pool.
+
     <b>Usage:</b>
 
     \code
@@ -634,7 +1261,7 @@ inline void parallel_foreach(
 {
     if(pool.nThreads()>1)
     {
-        parallel_foreach_impl(pool,nItems, begin, end, f,
+        parallel_foreach_impl(pool, pool.nThreads(), nItems, begin, end, f,
             typename std::iterator_traits<ITER>::iterator_category());
     }
     else
@@ -651,9 +1278,30 @@ inline void parallel_foreach(
     F && f,
     const std::ptrdiff_t nItems = 0)
 {
+    const int actualNThreads = ParallelOptions().numThreads((int)nThreads).getNumThreads();
+    if(actualNThreads>1)
+    {
+        parallel_foreach_impl(ThreadPool::global(), actualNThreads, nItems, begin, end, f,
+            typename std::iterator_traits<ITER>::iterator_category());
+    }
+    else
+    {
+        parallel_foreach_single_thread(begin, end, f, nItems);
+    }
+}
 
-    ThreadPool pool(nThreads);
-    parallel_foreach(pool, begin, end, f, nItems);
+template<class ITER, class F>
+inline void parallel_foreach(
+    ParallelOptions const & options,
+    ITER begin,
+    ITER end,
+    F && f,
+    const std::ptrdiff_t nItems = 0)
+{
+    if(options.getPool())
+        parallel_foreach(*options.getPool(), begin, end, f, nItems);
+    else
+        parallel_foreach(options.getNumThreads(), begin, end, f, nItems);
 }
 
 template<class F>
@@ -677,6 +1325,178 @@ inline void parallel_foreach(
     parallel_foreach(threadpool, iter, iter.end(), f, nItems);
 }
 
+template<class F>
+inline void parallel_foreach(
+    ParallelOptions const & options,
+    std::ptrdiff_t nItems,
+    F && f)
+{
+    auto iter = range(nItems);
+    parallel_foreach(options, iter, iter.end(), f, nItems);
+}
+
+/********************************************************/
+/*                                                      */
+/*                parallel_foreach_slab                 */
+/*                                                      */
+/********************************************************/
+
+/** \brief Number of slabs into which \ref parallel_foreach_slab() splits a range.
+
+    The range <tt>[0, extent)</tt> is split into about four slabs per thread
+    requested by \arg options, so that the load is balanced when slabs take
+    different time, but into no more than <tt>extent / granularity</tt> slabs.
+    If the options request at most one thread, the result is 1.
+*/
+inline std::ptrdiff_t
+parallel_slab_count(ParallelOptions const & options, std::ptrdiff_t extent,
+                    std::ptrdiff_t granularity = 1)
+{
+    std::ptrdiff_t units = extent / granularity;
+    if(options.getActualNumThreads() <= 1 || units < 2)
+        return 1;
+    return std::min<std::ptrdiff_t>(units, 4*options.getActualNumThreads());
+}
+
+/** \brief Lower bound of slab \arg k when <tt>[0, extent)</tt> is split into
+    \arg nSlabs slabs.
+
+    The bounds are multiples of \arg granularity, except for the upper bound
+    of the last slab (<tt>parallel_slab_bound(nSlabs, nSlabs, extent) == extent</tt>).
+    No slab is empty if <tt>nSlabs <= extent / granularity</tt>.
+*/
+inline std::ptrdiff_t
+parallel_slab_bound(std::ptrdiff_t k, std::ptrdiff_t nSlabs, std::ptrdiff_t extent,
+                    std::ptrdiff_t granularity = 1)
+{
+    if(k >= nSlabs)
+        return extent;
+    return (k*(extent / granularity) / nSlabs)*granularity;
+}
+
+/** \brief Split a range or an array into slabs and process them in parallel.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        // call f(thread_id, k, begin, end) for the slabs [begin, end) of [0, extent)
+        template<class F>
+        void parallel_foreach_slab(ParallelOptions const & options,
+                                   std::ptrdiff_t extent,
+                                   F && f,
+                                   std::ptrdiff_t granularity = 1);
+
+        // call f(thread_id, k, start, stop) for the slabs of an array
+        // of the given shape, cut along 'axis'
+        template<class Shape, class F>
+        void parallel_foreach_slab(ParallelOptions const & options,
+                                   Shape const & shape, int axis,
+                                   F && f,
+                                   std::ptrdiff_t granularity = 1);
+
+        // call f(thread_id, start, stop) for slabs that contain complete
+        // lines along axis 'd' of an array of the given shape
+        template<class Shape, class F>
+        void parallel_foreach_lines(ParallelOptions const & options,
+                                    Shape const & shape, int d,
+                                    F && f,
+                                    std::ptrdiff_t granularity = 16);
+    }
+    \endcode
+
+    The number of slabs is given by \ref parallel_slab_count() and their bounds
+    by \ref parallel_slab_bound(), so that callers can allocate per-slab data
+    indexed by \a k in advance. Since the slabs don't overlap, \arg f may
+    write to its slab without synchronization. When there is only one slab,
+    \arg f is called on the calling thread (with <tt>thread_id == 0</tt> and
+    <tt>k == 0</tt>), otherwise the slabs are processed by \ref parallel_foreach().
+
+    <tt>parallel_foreach_lines()</tt> is meant for algorithms that process an
+    array line by line along axis \a d, e.g. separable filters. It cuts the
+    array along the outermost axis other than \a d that has more than one
+    element. When this is axis 0 (e.g. for <tt>d == 1</tt> in 2D), the bounds
+    are multiples of \arg granularity, so that neighboring slabs don't write
+    to the same cache line.
+
+    <b>Usage:</b>
+
+    \code
+    MultiArray<3, float> array(Shape3(200, 200, 100));
+    // process the array in parallel slabs along the last axis
+    parallel_foreach_slab(ParallelOptions(), array.shape(), 2,
+        [&array](size_t, std::ptrdiff_t, Shape3 const & start, Shape3 const & stop)
+        {
+            array.subarray(start, stop) += 1.0f;
+        });
+    \endcode
+*/
+doxygen_overloaded_function(template <...> void parallel_foreach_slab)
+
+template<class F>
+inline void parallel_foreach_slab(
+    ParallelOptions const & options,
+    std::ptrdiff_t extent,
+    F && f,
+    std::ptrdiff_t granularity = 1)
+{
+    std::ptrdiff_t nSlabs = parallel_slab_count(options, extent, granularity);
+    if(nSlabs <= 1)
+    {
+        f(0, 0, 0, extent);
+        return;
+    }
+    parallel_foreach(options, nSlabs,
+        [&](size_t thread_id, std::ptrdiff_t k)
+        {
+            f(thread_id, k, parallel_slab_bound(k, nSlabs, extent, granularity),
+                            parallel_slab_bound(k+1, nSlabs, extent, granularity));
+        });
+}
+
+template<class Shape, class F>
+inline void parallel_foreach_slab(
+    ParallelOptions const & options,
+    Shape const & shape,
+    int axis,
+    F && f,
+    std::ptrdiff_t granularity = 1)
+{
+    parallel_foreach_slab(options, shape[axis],
+        [&](size_t thread_id, std::ptrdiff_t k, std::ptrdiff_t begin, std::ptrdiff_t end)
+        {
+            Shape start = Shape(), stop(shape);
+            start[axis] = begin;
+            stop[axis]  = end;
+            f(thread_id, k, start, stop);
+        },
+        granularity);
+}
+
+template<class Shape, class F>
+inline void parallel_foreach_lines(
+    ParallelOptions const & options,
+    Shape const & shape,
+    int d,
+    F && f,
+    std::ptrdiff_t granularity = 16)
+{
+    int axis = (int)shape.size() - 1;
+    while(axis >= 0 && (axis == d || shape[axis] < 2))
+        --axis;
+    if(axis < 0)
+    {
+        f(0, Shape(), shape);
+        return;
+    }
+    parallel_foreach_slab(options, shape, axis,
+        [&](size_t thread_id, std::ptrdiff_t, Shape const & start, Shape const & stop)
+        {
+            f(thread_id, start, stop);
+        },
+        axis == 0 ? granularity : 1);
+}
+
 //@}
 
 } // namespace vigra
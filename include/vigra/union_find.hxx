@@ -39,12 +39,15 @@
 
 /*std*/
 #include <map>
+#include <algorithm>
+#include <memory>
 
 /*vigra*/
 #include "config.hxx"
 #include "error.hxx"
 #include "array_vector.hxx"
 #include "iteratoradapter.hxx"
+#include "threading.hxx"
 
 namespace vigra {
 
@@ -321,6 +324,128 @@ class UnionFindArray
     }
 };
 
+/** \brief Union-find array that can be modified by several threads concurrently.
+
+    Each element of the array refers to its parent, and the roots of the trees
+    refer to themselves. In contrast to \ref UnionFindArray, the set of indices
+    is fixed at construction (e.g. one index per pixel), and all modifications
+    use atomic operations: makeUnion() links the larger root below the smaller one
+    by means of a compare-and-swap and retries when another thread modified
+    the root in the meantime, and findIndex() shortens the paths it traverses
+    (path halving). Since parents always have smaller indices than their children,
+    the root of each tree is its smallest index, regardless of the order in which
+    the unions were performed.
+
+    When it is known that no other thread accesses certain trees at the same time
+    (e.g. because every thread works on a separate part of the array first),
+    findIndexExclusive() and makeUnionExclusive() can be used for these trees.
+    They produce the same trees, but avoid the synchronization overhead.
+
+    The elements are not initialized by the constructor. Each index must be
+    made a singleton set by makeSet() before it is used.
+
+    <b>\#include</b> \<vigra/union_find.hxx\><br>
+    Namespace: vigra
+*/
+template <class T>
+class ConcurrentUnionFindArray
+{
+    std::unique_ptr<threading::atomic<T>[]> parents_;
+    std::size_t size_;
+
+  public:
+    explicit ConcurrentUnionFindArray(std::size_t size)
+    : parents_(new threading::atomic<T>[size])
+    , size_(size)
+    {}
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    void makeSet(T index)
+    {
+        parents_[index].store(index, threading::memory_order_relaxed);
+    }
+
+    T parent(T index) const
+    {
+        return parents_[index].load(threading::memory_order_relaxed);
+    }
+
+        // overwrite the entry of 'index', e.g. to store the final label of a root
+    void setParent(T index, T value)
+    {
+        parents_[index].store(value, threading::memory_order_relaxed);
+    }
+
+    bool isRoot(T index) const
+    {
+        return parent(index) == index;
+    }
+
+    T findIndex(T index) const
+    {
+        for(;;)
+        {
+            T p = parent(index);
+            if(p == index)
+                return index;
+            T gp = parent(p);
+            if(gp == p)
+                return p;
+            // path halving: may fail when another thread already shortened the path
+            parents_[index].compare_exchange_weak(p, gp, threading::memory_order_relaxed);
+            index = gp;
+        }
+    }
+
+    T findIndexExclusive(T index)
+    {
+        T root = index;
+        for(T p = parent(root); p != root; p = parent(root))
+            root = p;
+        // path compression
+        while(index != root)
+        {
+            T next = parent(index);
+            setParent(index, root);
+            index = next;
+        }
+        return root;
+    }
+
+    T makeUnionExclusive(T l1, T l2)
+    {
+        T i1 = findIndexExclusive(l1);
+        T i2 = findIndexExclusive(l2);
+        if(i1 < i2)
+            std::swap(i1, i2);
+        setParent(i1, i2);
+        return i2;
+    }
+
+    T makeUnion(T l1, T l2)
+    {
+        for(;;)
+        {
+            T i1 = findIndex(l1);
+            T i2 = findIndex(l2);
+            if(i1 == i2)
+                return i1;
+            if(i1 < i2)
+                std::swap(i1, i2);
+            // link i1 below i2, unless i1 is no longer a root
+            T expected = i1;
+            if(parents_[i1].compare_exchange_strong(expected, i2))
+                return i2;
+            l1 = i1;
+            l2 = i2;
+        }
+    }
+};
+
 } // namespace vigra
 
 #endif // VIGRA_UNION_FIND_HXX
@@ -299,6 +299,8 @@ void for_each_in_tuple(TPL && t, FUNCTOR && f)
          <BR>&nbsp;&nbsp;&nbsp;<em>typesafe storage of arbitrary values</em>
     <LI> \ref vigra::BucketQueue and \ref vigra::MappedBucketQueue
          <BR>&nbsp;&nbsp;&nbsp;<em>efficient priority queues for integer priorities</em>
+    <LI> \ref vigra::RadixPriorityQueue
+         <BR>&nbsp;&nbsp;&nbsp;<em>efficient monotone priority queue for integer and floating point priorities</em>
     <LI> \ref RangesAndPoints
          <BR>&nbsp;&nbsp;&nbsp;<em>2-D and N-D positions, extents, and boxes</em>
     <LI> \ref PixelNeighborhood
@@ -39,6 +39,7 @@
 #include <vector>
 #include <set>
 #include <functional>
+#include <iterator>
 #include "array_vector.hxx"
 #include "multi_array.hxx"
 #include "accessor.hxx"
@@ -97,23 +98,22 @@ partialSquaredMagnitude(const VEC& vec, MultiArrayIndex dim, ARRAY const & pixel
     return sqMag;
 }
 
+    // '_stack' is passed by the caller, so that its memory can be reused for many lines
 template <class SrcIterator,
-          class Array>
+          class Array, class Influence>
 void
 vectorialDistParabola(MultiArrayIndex dimension,
                       SrcIterator is, SrcIterator iend,
-                      Array const & pixel_pitch )
+                      Array const & pixel_pitch,
+                      std::vector<Influence> & _stack)
 {
-    typedef typename SrcIterator::value_type SrcType;
-    typedef VectorialDistParabolaStackEntry<SrcType, double> Influence;
-
     double sigma = pixel_pitch[dimension],
            sigma2 = sq(sigma);
     double w = iend - is; //width of the scanline
 
     SrcIterator id = is;
 
-    std::vector<Influence> _stack; //stack of influence parabolas
+    _stack.clear(); //stack of influence parabolas
     double apex_height = partialSquaredMagnitude(*is, dimension, pixel_pitch);
     _stack.push_back(Influence(*is, apex_height, 0.0, 0.0, w));
     ++is;
@@ -156,6 +156,18 @@ vectorialDistParabola(MultiArrayIndex dimension,
     }
 }
 
+template <class SrcIterator,
+          class Array>
+inline void
+vectorialDistParabola(MultiArrayIndex dimension,
+                      SrcIterator is, SrcIterator iend,
+                      Array const & pixel_pitch )
+{
+    typedef typename std::iterator_traits<SrcIterator>::value_type SrcType;
+    std::vector<VectorialDistParabolaStackEntry<SrcType, double> > stack;
+    vectorialDistParabola(dimension, is, iend, pixel_pitch, stack);
+}
+
 template <class DestIterator,
           class LabelIterator,
           class Array1, class Array2>
@@ -334,13 +346,24 @@ struct Error_output_pixel_type_must_be_TinyVector_of_appropriate_length
             separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
                                     MultiArrayView<N, T2, S2> dest,
                                     bool background,
-                                    Array const & pixelPitch=TinyVector<double, N>(1));
+                                    Array const & pixelPitch=TinyVector<double, N>(1),
+                                    ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads));
+
+            template <unsigned int N, class T1, class S1,
+                      class T2, class S2>
+            void
+            separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
+                                    MultiArrayView<N, T2, S2> dest,
+                                    bool background,
+                                    ParallelOptions const & options);
         }
         \endcode
 
         This function works like \ref separableMultiDistance() (see there for details),
         but returns in each pixel the <i>vector</i> to the nearest background pixel
         rather than the scalar distance. This enables much more powerful applications.
+        The lines of each axis are processed in parallel according to <tt>options</tt>,
+        as in \ref separableMultiDistSquared().
 
         <b> Usage:</b>
 
@@ -367,11 +390,14 @@ void
 separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
                         MultiArrayView<N, T2, S2> dest,
                         bool background,
-                        Array const & pixelPitch)
+                        Array const & pixelPitch,
+                        ParallelOptions const & options = ParallelOptions().numThreads(ParallelOptions::NoThreads))
 {
     using namespace vigra::functor;
+    typedef typename MultiArrayShape<N>::type Shape;
     typedef typename MultiArrayView<N, T2, S2>::traverser Traverser;
     typedef MultiArrayNavigator<Traverser, N> Navigator;
+    typedef StandardValueAccessor<T2> Accessor;
 
     VIGRA_STATIC_ASSERT((Error_output_pixel_type_must_be_TinyVector_of_appropriate_length<N == T2::static_size>));
     vigra_precondition(source.shape() == dest.shape(),
@@ -381,19 +407,40 @@ separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
 
     T2 maxDist(2*sum(source.shape()*pixelPitch)), rzero;
     if(background == true)
-        transformMultiArray( source, dest,
-                                ifThenElse( Arg1() == Param(0), Param(maxDist), Param(rzero) ));
+        detail::internalParallelDistTransform(source.traverser_begin(), source.shape(), StandardConstValueAccessor<T1>(),
+                                              dest.traverser_begin(), Accessor(),
+                                              ifThenElse( Arg1() == Param(0), Param(maxDist), Param(rzero) ),
+                                              options);
     else
-        transformMultiArray( source, dest,
-                                ifThenElse( Arg1() != Param(0), Param(maxDist), Param(rzero) ));
+        detail::internalParallelDistTransform(source.traverser_begin(), source.shape(), StandardConstValueAccessor<T1>(),
+                                              dest.traverser_begin(), Accessor(),
+                                              ifThenElse( Arg1() != Param(0), Param(maxDist), Param(rzero) ),
+                                              options);
 
     for(unsigned d = 0; d < N; ++d )
     {
-        Navigator nav( dest.traverser_begin(), dest.shape(), d);
-        for( ; nav.hasMore(); nav++ )
-        {
-             detail::vectorialDistParabola(d, nav.begin(), nav.end(), pixelPitch);
-        }
+        parallel_foreach_lines(options, dest.shape(), d,
+            [&](size_t /* thread_id */, Shape const & start, Shape const & stop)
+            {
+                Navigator nav( dest.traverser_begin(), start, stop, d);
+                std::vector<detail::VectorialDistParabolaStackEntry<T2, double> > stack;
+                if(d == 0)
+                {
+                    for( ; nav.hasMore(); nav++ )
+                    {
+                         detail::vectorialDistParabola(d, nav.begin(), nav.end(), pixelPitch, stack);
+                    }
+                }
+                else
+                {
+                    ArrayVector<T2> buffer;
+                    detail::internalDistPanels(nav, dest.shape(d), Accessor(), buffer,
+                        [&](T2 * begin, T2 * end)
+                        {
+                            detail::vectorialDistParabola(d, begin, end, pixelPitch, stack);
+                        });
+                }
+            });
     }
 }
 
@@ -408,6 +455,18 @@ separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
     separableVectorDistance(source, dest, background, pixelPitch);
 }
 
+template <unsigned int N, class T1, class S1,
+          class T2, class S2>
+inline void
+separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
+                        MultiArrayView<N, T2, S2> dest,
+                        bool background,
+                        ParallelOptions const & options)
+{
+    TinyVector<double, N> pixelPitch(1.0);
+    separableVectorDistance(source, dest, background, pixelPitch, options);
+}
+
 
     /** \brief Compute the vector distance transform to the implicit boundaries of a
                multi-dimensional label array.
@@ -34,171 +34,481 @@
 /************************************************************************/
 
 #include <algorithm>
+#include <cstring>
 #include "vigra/compression.hxx"
+#include "vigra/sized_int.hxx"
+#include "vigra/metaprogramming.hxx"
 #include "lz4.h"
 
 #ifdef HasZLIB
 #include <zlib.h>
 #endif
 
+#ifdef HasZSTD
+#include <zstd.h>
+#endif
+
 namespace vigra {
 
-std::size_t compressImpl(char const * source, std::size_t srcSize, 
-                         ArrayVector<char> & buffer,
-                         CompressionMethod method)
+namespace {
+
+class NoCompressionCodec
+: public CompressionCodec
 {
-    switch(method)
+  public:
+    virtual std::string name() const
+    {
+        return "NO_COMPRESSION";
+    }
+
+    virtual std::size_t compressBound(std::size_t size) const
+    {
+        return size;
+    }
+
+    virtual std::size_t compress(char const * source, std::size_t size,
+                                 char * dest, std::size_t) const
+    {
+        std::copy(source, source+size, dest);
+        return size;
+    }
+
+    virtual void uncompress(char const * source, std::size_t srcSize,
+                            char * dest, std::size_t) const
+    {
+        std::copy(source, source+srcSize, dest);
+    }
+};
+
+class ZlibCodec
+: public CompressionCodec
+{
+  public:
+    ZlibCodec(int level)
+    : level_(level)
+    {}
+
+    virtual std::string name() const
+    {
+        switch(level_)
+        {
+          case ZLIB_NONE:
+            return "ZLIB_NONE";
+          case ZLIB_FAST:
+            return "ZLIB_FAST";
+          case ZLIB:
+            return "ZLIB";
+          case ZLIB_BEST:
+            return "ZLIB_BEST";
+          default:
+            return std::string("ZLIB_") + char('0' + level_);
+        }
+    }
+
+    virtual std::size_t compressBound(std::size_t size) const
     {
-      case NO_COMPRESSION:
-      {
-        ArrayVector<char>(source, source+srcSize).swap(buffer);
-        return srcSize;
-      }
-      case ZLIB:
-      case ZLIB_NONE:
-      case ZLIB_FAST:
-      case ZLIB_BEST:
-      {
     #ifdef HasZLIB
-        uLong destSize = ::compressBound(srcSize);
-        buffer.resize(destSize);
-        int res = ::compress2((Bytef *)buffer.data(), &destSize, (Bytef *)source, srcSize, method);
-        vigra_postcondition(res == Z_OK, "compress(): zlib compression failed.");                    
+        return ::compressBound(size);
+    #else
+        return size;
+    #endif
+    }
+
+    virtual std::size_t compress(char const * source, std::size_t size,
+                                 char * dest, std::size_t destCapacity) const
+    {
+    #ifdef HasZLIB
+        uLong destSize = destCapacity;
+        int res = ::compress2((Bytef *)dest, &destSize, (Bytef *)source, size, level_);
+        vigra_postcondition(res == Z_OK, "compress(): zlib compression failed.");
         return destSize;
     #else
+        ignore_argument(source, size, dest, destCapacity);
         vigra_precondition(false, "compress(): VIGRA was compiled without ZLIB compression.");
         return 0;
     #endif
-      }
-      case DEFAULT_COMPRESSION:
-      case LZ4:
-      {
-        std::size_t destSize = ::LZ4_compressBound(srcSize);
-        buffer.resize(destSize);
-        destSize = ::LZ4_compress(source, buffer.data(), srcSize);
+    }
+
+    virtual void uncompress(char const * source, std::size_t srcSize,
+                            char * dest, std::size_t destSize) const
+    {
+    #ifdef HasZLIB
+        uLong destLen = destSize;
+        int res = ::uncompress((Bytef *)dest, &destLen, (Bytef *)source, srcSize);
+        vigra_postcondition(res == Z_OK, "uncompress(): zlib decompression failed.");
+    #else
+        ignore_argument(source, srcSize, dest, destSize);
+        vigra_precondition(false, "uncompress(): VIGRA was compiled without ZLIB compression.");
+    #endif
+    }
+
+    int level_;
+};
+
+class LZ4Codec
+: public CompressionCodec
+{
+  public:
+    virtual std::string name() const
+    {
+        return "LZ4";
+    }
+
+    virtual std::size_t compressBound(std::size_t size) const
+    {
+        return ::LZ4_compressBound(size);
+    }
+
+    virtual std::size_t compress(char const * source, std::size_t size,
+                                 char * dest, std::size_t destCapacity) const
+    {
+        int destSize = ::LZ4_compress_default(source, dest, size, destCapacity);
         vigra_postcondition(destSize > 0, "compress(): lz4 compression failed.");
         return destSize;
-      }
-
-#if 0  // currently unsupported
-      case SNAPPY:
-      {
-    #ifdef HasSNAPPY
-        std::size_t destSize = snappy::MaxCompressedLength(srcSize);
-        buffer.resize(destSize);
-        snappy::RawCompress(source, srcSize, buffer.data(), &destSize);
-        return destSize;
+    }
+
+    virtual void uncompress(char const * source, std::size_t srcSize,
+                            char * dest, std::size_t destSize) const
+    {
+        int sourceLen = ::LZ4_decompress_fast(source, dest, destSize);
+        vigra_postcondition(sourceLen >= 0 && static_cast<unsigned>(sourceLen) == srcSize, "uncompress(): lz4 decompression failed.");
+    }
+};
+
+class ZstdCodec
+: public CompressionCodec
+{
+  public:
+    ZstdCodec(CompressionMethod method)
+    : method_(method)
+    {}
+
+    virtual std::string name() const
+    {
+        switch(method_)
+        {
+          case ZSTD_FAST:
+            return "ZSTD_FAST";
+          case ZSTD_BEST:
+            return "ZSTD_BEST";
+          default:
+            return "ZSTD";
+        }
+    }
+
+    virtual std::size_t compressBound(std::size_t size) const
+    {
+    #ifdef HasZSTD
+        return ::ZSTD_compressBound(size);
     #else
-        vigra_precondition(false, "compress(): VIGRA was compiled without SNAPPY compression.");
-        return 0;
+        return size;
     #endif
-      }
-      case LZO:
-      {
-    #ifdef HasLZO
-        static const int workmemSize = 
-                  (LZO1X_1_MEM_COMPRESS + sizeof(lzo_align_t) - 1) / sizeof(lzo_align_t);
-        ArrayVector<lzo_align_t> wrkmem(workmemSize);
-        
-        lzo_uint destSize = srcSize + srcSize / 16 + 64 + 3;
-        buffer.resize(destSize);
-        int res = ::lzo1x_1_compress((const lzo_bytep)source, srcSize, 
-                                     (lzo_bytep)buffer.data(), &destSize, 
-                                     wrkmem.data());
+    }
+
+    virtual std::size_t compress(char const * source, std::size_t size,
+                                 char * dest, std::size_t destCapacity) const
+    {
+    #ifdef HasZSTD
+        int level = method_ == ZSTD_FAST
+                        ? 1
+                        : method_ == ZSTD_BEST
+                              ? 19
+                              : 3;
+        std::size_t destSize = ::ZSTD_compress(dest, destCapacity, source, size, level);
+        vigra_postcondition(!::ZSTD_isError(destSize), "compress(): zstd compression failed.");
         return destSize;
     #else
-        vigra_precondition(false, "compress(): VIGRA was compiled without LZO compression.");
+        ignore_argument(source, size, dest, destCapacity);
+        vigra_precondition(false, "compress(): VIGRA was compiled without ZSTD compression.");
         return 0;
     #endif
-      }
-#endif
+    }
+
+    virtual void uncompress(char const * source, std::size_t srcSize,
+                            char * dest, std::size_t destSize) const
+    {
+    #ifdef HasZSTD
+        std::size_t res = ::ZSTD_decompress(dest, destSize, source, srcSize);
+        vigra_postcondition(!::ZSTD_isError(res) && res == destSize,
+                            "uncompress(): zstd decompression failed.");
+    #else
+        ignore_argument(source, srcSize, dest, destSize);
+        vigra_precondition(false, "uncompress(): VIGRA was compiled without ZSTD compression.");
+    #endif
+    }
+
+    CompressionMethod method_;
+};
+
+// Codecs are indexed by compressionCodecMethod(method), NO_COMPRESSION
+// uses the last slot.
+static const int codecRegistrySize = USER_COMPRESSION + 64;
+
+struct CodecRegistry
+{
+    VIGRA_SHARED_PTR<CompressionCodec> codecs[codecRegistrySize];
+
+    CodecRegistry()
+    {
+        for(int level=ZLIB_NONE; level<=ZLIB_BEST; ++level)
+            codecs[level].reset(new ZlibCodec(level));
+        codecs[LZ4].reset(new LZ4Codec());
+        codecs[ZSTD_FAST].reset(new ZstdCodec(ZSTD_FAST));
+        codecs[ZSTD].reset(new ZstdCodec(ZSTD));
+        codecs[ZSTD_BEST].reset(new ZstdCodec(ZSTD_BEST));
+        codecs[codecRegistrySize-1].reset(new NoCompressionCodec());
+    }
+};
+
+VIGRA_SHARED_PTR<CompressionCodec> * codecRegistry()
+{
+    static CodecRegistry registry;
+    return registry.codecs;
+}
+
+int codecIndex(CompressionMethod method)
+{
+    switch(method)
+    {
+      case NO_COMPRESSION:
+        return codecRegistrySize-1;
+      case DEFAULT_COMPRESSION:
+        return LZ4;
       default:
-        vigra_precondition(false, "compress(): Unknown compression method.");
+        return compressionCodecMethod(method);
     }
-    return 0;
 }
 
-void compress(char const * source, std::size_t size, ArrayVector<char> & dest, CompressionMethod method)
+// Transpose the 8x8 bit matrix whose rows are the bytes of 'x'.
+inline UInt64 transposeBits8x8(UInt64 x)
 {
-    ArrayVector<char> buffer;
-    std::size_t destSize = compressImpl(source, size, buffer, method);
-    dest.resize(destSize);
-    std::copy(buffer.data(), buffer.data() + destSize, dest.begin());
+    UInt64 t;
+    t = (x ^ (x >> 7))  & 0x00AA00AA00AA00AAULL;
+    x = x ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+    x = x ^ t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+    x = x ^ t ^ (t << 28);
+    return x;
 }
 
-void compress(char const * source, std::size_t size, std::vector<char> & dest, CompressionMethod method)
+// Store byte k of all 'count' elements contiguously (as byte plane k).
+// The common element sizes are fixed at compile time, so that the compiler
+// can unroll (and vectorize) the loop over the planes.
+template <int ELEMENT_SIZE>
+void byteShuffleImpl(char const * source, char * dest, std::size_t count, std::size_t elementSize)
 {
-    ArrayVector<char> buffer;
-    std::size_t destSize = compressImpl(source, size, buffer, method);
-    dest.insert(dest.begin(), buffer.data(), buffer.data() + destSize);
+    std::size_t const size = ELEMENT_SIZE > 0 ? ELEMENT_SIZE : elementSize;
+    for(std::size_t i=0; i<count; ++i, source += size)
+        for(std::size_t k=0; k<size; ++k)
+            dest[k*count + i] = source[k];
 }
 
-void uncompress(char const * source, std::size_t srcSize, 
-                char * dest, std::size_t destSize, CompressionMethod method)
+template <int ELEMENT_SIZE>
+void byteUnshuffleImpl(char const * source, char * dest, std::size_t count, std::size_t elementSize)
 {
-    switch(method)
+    std::size_t const size = ELEMENT_SIZE > 0 ? ELEMENT_SIZE : elementSize;
+    for(std::size_t i=0; i<count; ++i, dest += size)
+        for(std::size_t k=0; k<size; ++k)
+            dest[k] = source[k*count + i];
+}
+
+void byteShuffle(char const * source, char * dest, std::size_t count, std::size_t elementSize)
+{
+    switch(elementSize)
     {
-      case NO_COMPRESSION:
-      {
-        std::copy(source, source+srcSize, dest);
+      case 2:
+        byteShuffleImpl<2>(source, dest, count, elementSize);
         break;
-      }
-      case ZLIB:
-      case ZLIB_NONE:
-      case ZLIB_FAST:
-      case ZLIB_BEST:
-      {
-    #ifdef HasZLIB
-        uLong destLen = destSize;
-        int res = ::uncompress((Bytef *)dest, &destLen, (Bytef *)source, srcSize);
-        vigra_postcondition(res == Z_OK, "uncompress(): zlib decompression failed.");
-    #else
-        vigra_precondition(false, "uncompress(): VIGRA was compiled without ZLIB compression.");
-    #endif
+      case 4:
+        byteShuffleImpl<4>(source, dest, count, elementSize);
         break;
-      }
-      case DEFAULT_COMPRESSION:
-      case LZ4:
-      {
-        int sourceLen = ::LZ4_decompress_fast(source, dest, destSize);
-        vigra_postcondition(sourceLen >= 0 && static_cast<unsigned>(sourceLen) == srcSize, "uncompress(): lz4 decompression failed.");
+      case 8:
+        byteShuffleImpl<8>(source, dest, count, elementSize);
         break;
-      }
-      
-#if 0 // currently unsupported
-      case SNAPPY:
-      {
-    #ifdef HasSNAPPY
-        snappy::RawUncompress(source, srcSize, dest);
-    #else
-        vigra_precondition(false, "compress(): VIGRA was compiled without SNAPPY compression.");
-    #endif
+      default:
+        byteShuffleImpl<0>(source, dest, count, elementSize);
+    }
+}
+
+void byteUnshuffle(char const * source, char * dest, std::size_t count, std::size_t elementSize)
+{
+    switch(elementSize)
+    {
+      case 2:
+        byteUnshuffleImpl<2>(source, dest, count, elementSize);
         break;
-      }
-      case LZO:
-      {
-    #ifdef HasLZO
-        lzo_uint destLen = destSize;
-        int res = ::lzo1x_decompress((const lzo_bytep)source, srcSize,
-                                     (lzo_bytep)dest, &destLen, NULL);
-        vigra_postcondition(res == LZO_E_OK, "uncompress(): lzo decompression failed.");
-    #else
-        vigra_precondition(false, "compress(): VIGRA was compiled without LZO compression.");
-    #endif
+      case 4:
+        byteUnshuffleImpl<4>(source, dest, count, elementSize);
         break;
-      }
-#endif
+      case 8:
+        byteUnshuffleImpl<8>(source, dest, count, elementSize);
+        break;
+      default:
+        byteUnshuffleImpl<0>(source, dest, count, elementSize);
+    }
+}
+
+// Split each byte plane of 'count' bytes (count is a multiple of 8)
+// into 8 bit planes of count/8 bytes.
+void bitShufflePlanes(char const * source, char * dest, std::size_t count, std::size_t elementSize)
+{
+    std::size_t groups = count / 8;
+    for(std::size_t k=0; k<elementSize; ++k, source += count, dest += count)
+    {
+        for(std::size_t g=0; g<groups; ++g)
+        {
+            UInt64 x;
+            std::memcpy(&x, source + 8*g, 8);
+            x = transposeBits8x8(x);
+            for(int b=0; b<8; ++b)
+                dest[b*groups + g] = (char)(x >> (8*b));
+        }
+    }
+}
+
+void bitUnshufflePlanes(char const * source, char * dest, std::size_t count, std::size_t elementSize)
+{
+    std::size_t groups = count / 8;
+    for(std::size_t k=0; k<elementSize; ++k, source += count, dest += count)
+    {
+        for(std::size_t g=0; g<groups; ++g)
+        {
+            UInt64 x = 0;
+            for(int b=0; b<8; ++b)
+                x |= UInt64((unsigned char)source[b*groups + g]) << (8*b);
+            x = transposeBits8x8(x);
+            std::memcpy(dest + 8*g, &x, 8);
+        }
+    }
+}
+
+// Apply the pre-filter. Trailing bytes that don't form a complete
+// element (or, for BITSHUFFLE, a complete group of 8 elements) are copied.
+void applyFilter(int filter, char const * source, char * dest,
+                 std::size_t size, std::size_t elementSize)
+{
+    std::size_t count = size / elementSize;
+    if(filter == BITSHUFFLE)
+    {
+        count &= ~std::size_t(7);
+        ArrayVector<char> planes(count*elementSize);
+        byteShuffle(source, planes.data(), count, elementSize);
+        bitShufflePlanes(planes.data(), dest, count, elementSize);
+    }
+    else
+    {
+        byteShuffle(source, dest, count, elementSize);
+    }
+    std::copy(source + count*elementSize, source + size, dest + count*elementSize);
+}
+
+void revertFilter(int filter, char const * source, char * dest,
+                  std::size_t size, std::size_t elementSize)
+{
+    std::size_t count = size / elementSize;
+    if(filter == BITSHUFFLE)
+    {
+        count &= ~std::size_t(7);
+        ArrayVector<char> planes(count*elementSize);
+        bitUnshufflePlanes(source, planes.data(), count, elementSize);
+        byteUnshuffle(planes.data(), dest, count, elementSize);
+    }
+    else
+    {
+        byteUnshuffle(source, dest, count, elementSize);
+    }
+    std::copy(source + count*elementSize, source + size, dest + count*elementSize);
+}
+
+} // anonymous namespace
+
+void registerCompressionCodec(CompressionMethod method,
+                              VIGRA_SHARED_PTR<CompressionCodec> codec)
+{
+    vigra_precondition(method >= USER_COMPRESSION && method < codecRegistrySize - 1,
+        "registerCompressionCodec(): method must be in [USER_COMPRESSION, USER_COMPRESSION+62].");
+    codecRegistry()[method] = codec;
+}
+
+CompressionCodec const & getCompressionCodec(CompressionMethod method)
+{
+    int index = codecIndex(method);
+    vigra_precondition(index >= 0 && index < codecRegistrySize && codecRegistry()[index],
+        "getCompressionCodec(): Unknown compression method.");
+    return *codecRegistry()[index];
+}
+
+std::string compressionMethodName(CompressionMethod method)
+{
+    std::string res = getCompressionCodec(method).name();
+    switch(compressionFilter(method))
+    {
+      case SHUFFLE:
+        return res + "|SHUFFLE";
+      case BITSHUFFLE:
+        return res + "|BITSHUFFLE";
       default:
-        vigra_precondition(false, "uncompress(): Unknown compression method.");
+        return res;
     }
 }
 
-/** Uncompress a data buffer when the uncompressed size is unknown.
+static std::size_t
+compressImpl(char const * source, std::size_t srcSize,
+             ArrayVector<char> & buffer,
+             CompressionMethod method, std::size_t elementSize)
+{
+    CompressionCodec const & codec = getCompressionCodec(method);
+    int filter = compressionFilter(method);
+    vigra_precondition(filter != (SHUFFLE | BITSHUFFLE),
+        "compress(): SHUFFLE and BITSHUFFLE are mutually exclusive.");
+
+    ArrayVector<char> filtered;
+    if(filter && elementSize*(filter == BITSHUFFLE ? 8 : 1) > 1)
+    {
+        filtered.resize(srcSize);
+        applyFilter(filter, source, filtered.data(), srcSize, elementSize);
+        source = filtered.data();
+    }
+
+    buffer.resize(codec.compressBound(srcSize));
+    return codec.compress(source, srcSize, buffer.data(), buffer.size());
+}
 
-    The destination array will be resized as required.
-*/
-void uncompress(char const * source, std::size_t size, ArrayVector<char> & dest, CompressionMethod method);
-void uncompress(char const * source, std::size_t size, std::vector<char> & dest, CompressionMethod method);
+void compress(char const * source, std::size_t size, ArrayVector<char> & dest,
+              CompressionMethod method, std::size_t elementSize)
+{
+    ArrayVector<char> buffer;
+    std::size_t destSize = compressImpl(source, size, buffer, method, elementSize);
+    dest.resize(destSize);
+    std::copy(buffer.data(), buffer.data() + destSize, dest.begin());
+}
 
+void compress(char const * source, std::size_t size, std::vector<char> & dest,
+              CompressionMethod method, std::size_t elementSize)
+{
+    ArrayVector<char> buffer;
+    std::size_t destSize = compressImpl(source, size, buffer, method, elementSize);
+    dest.insert(dest.begin(), buffer.data(), buffer.data() + destSize);
+}
+
+void uncompress(char const * source, std::size_t srcSize,
+                char * dest, std::size_t destSize, CompressionMethod method,
+                std::size_t elementSize)
+{
+    CompressionCodec const & codec = getCompressionCodec(method);
+    int filter = compressionFilter(method);
+
+    if(filter && elementSize*(filter == BITSHUFFLE ? 8 : 1) > 1)
+    {
+        ArrayVector<char> filtered(destSize);
+        codec.uncompress(source, srcSize, filtered.data(), destSize);
+        revertFilter(filter, filtered.data(), dest, destSize, elementSize);
+    }
+    else
+    {
+        codec.uncompress(source, srcSize, dest, destSize);
+    }
+}
 
 } // namespace vigra
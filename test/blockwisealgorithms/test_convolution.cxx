@@ -69,6 +69,112 @@ struct BlockwiseConvolutionTest
         }
     }
 
+    void chunkedFilterTest()
+    {
+        typedef MultiArray<3, float> Array;
+        typedef Array::difference_type Shape;
+
+        Shape shape(45, 50, 40), chunk_shape(16);
+        Array data(shape);
+        fillRandom(data.begin(), data.end(), 2000);
+
+        ChunkedArrayLazy<3, float> source(shape, chunk_shape);
+        source.commitSubarray(Shape(0), data);
+
+        BlockwiseConvolutionOptions<3> opt;
+        opt.stdDev(1.5).innerScale(1.0).outerScale(2.0);
+
+        {
+            // destination chunks are swapped out to disk while we go
+            ChunkedArrayTmpFile<3, float> dest(shape, chunk_shape, ChunkedArrayOptions().cacheMax(2));
+            gaussianSmoothMultiArray(source, dest, opt);
+            shouldEqual(dest.cacheSize(), 2);
+
+            Array res(shape), resB(shape);
+            gaussianSmoothMultiArray(data, res, opt);
+            dest.checkoutSubarray(Shape(0), resB);
+            shouldEqualSequenceTolerance(res.begin(), res.end(), resB.begin(), 1e-5);
+        }
+        {
+            ChunkedArrayLazy<3, TinyVector<float, 3> > dest(shape, chunk_shape);
+            hessianOfGaussianEigenvaluesMultiArray(source, dest, opt);
+
+            MultiArray<3, TinyVector<float, 3> > res(shape), resB(shape);
+            // compare with the in-memory version using the same blocks
+            BlockwiseConvolutionOptions<3> memOpt(opt);
+            memOpt.blockShape(chunk_shape);
+            hessianOfGaussianEigenvaluesMultiArray(data, res, memOpt);
+            dest.checkoutSubarray(Shape(0), resB);
+            MultiArrayView<4, float> e = res.expandElements(0), eB = resB.expandElements(0);
+            shouldEqualSequenceTolerance(e.begin(), e.end(), eB.begin(), 1e-5);
+        }
+        {
+            // block shape not aligned with the chunks
+            ChunkedArrayLazy<3, TinyVector<float, 6> > dest(shape, chunk_shape);
+            opt.blockShape(Shape(20, 10, 13));
+            structureTensorMultiArray(source, dest, opt);
+
+            MultiArray<3, TinyVector<float, 6> > res(shape), resB(shape);
+            structureTensorMultiArray(data, MultiArrayView<3, TinyVector<float, 6> >(res), opt);
+            dest.checkoutSubarray(Shape(0), resB);
+            MultiArrayView<4, float> e = res.expandElements(0), eB = resB.expandElements(0);
+            shouldEqualSequenceTolerance(e.begin(), e.end(), eB.begin(), 1e-5);
+        }
+    }
+
+    void testBlockSchedule()
+    {
+        typedef MultiBlocking<3> Blocking;
+        typedef Blocking::Shape Shape;
+        typedef Blocking::Block Block;
+
+        Shape shape(50, 40, 70), border(4);
+        Blocking blocking(shape, Shape(16));
+        shouldEqual(blocking.blocksPerAxis(), Shape(4, 3, 5));
+
+        for(int fusion = 1; fusion <= 6; ++fusion)
+        {
+            std::vector<Blocking::BlockWithBorder> blocks = blocking.blocksWithBorderZOrder(border, fusion);
+            shouldEqual(blocks.size(), (std::size_t)(4*3*((5 + fusion - 1) / fusion)));
+
+            // the cores must cover the array exactly once
+            MultiArray<3, int> count(shape);
+            for(std::size_t k=0; k<blocks.size(); ++k)
+            {
+                Block expected = blocks[k].core();
+                expected.addBorder(border);
+                expected &= Block(shape);
+                shouldEqual(blocks[k].border(), expected);
+                count.subarray(blocks[k].core().begin(), blocks[k].core().end()) += 1;
+            }
+            should(count.all());
+            shouldEqual(count.sum<int>(), prod(shape));
+        }
+
+        // Z-order: the first blocks form a cube
+        std::vector<Blocking::BlockWithBorder> blocks = blocking.blocksWithBorderZOrder(border);
+        Block first;
+        for(int k=0; k<8; ++k)
+            first |= blocks[k].core();
+        shouldEqual(first, Block(Shape(0), Shape(32)));
+
+        // the result must not depend on block fusion
+        MultiArray<3, float> data(shape), res(shape), resB(shape);
+        fillRandom(data.begin(), data.end(), 2000);
+
+        BlockwiseConvolutionOptions<3> opt;
+        opt.stdDev(3.0);
+        opt.blockShape(Shape(16));
+        opt.blockFusion(1);
+        gaussianSmoothMultiArray(data, res, opt);
+        for(int fusion = 0; fusion <= 5; ++fusion)
+        {
+            opt.blockFusion(fusion);
+            gaussianSmoothMultiArray(data, resB, opt);
+            shouldEqualSequenceTolerance(res.begin(), res.end(), resB.begin(), 1e-5);
+        }
+    }
+
     void testParallel()
     {
         double sigma = 1.0;
@@ -114,6 +220,8 @@ struct BlockwiseConvolutionTestSuite
     {
         add(testCase(&BlockwiseConvolutionTest::simpleTest));
         add(testCase(&BlockwiseConvolutionTest::chunkedTest));
+        add(testCase(&BlockwiseConvolutionTest::chunkedFilterTest));
+        add(testCase(&BlockwiseConvolutionTest::testBlockSchedule));
         add(testCase(&BlockwiseConvolutionTest::testParallel));
     }
 };
@@ -0,0 +1,137 @@
+/************************************************************************/
+/*                                                                      */
+/*     Copyright 2014 by Ullrich Koethe                                 */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+
+#define VIGRA_CHECK_BOUNDS
+
+#include <vigra/blockwise_distance.hxx>
+
+#include <vigra/multi_array.hxx>
+#include <vigra/multi_distance.hxx>
+#include <vigra/unittest.hxx>
+
+#include <iostream>
+
+#include "utils.hxx"
+
+using namespace std;
+using namespace vigra;
+
+struct BlockwiseDistanceTest
+{
+    template <unsigned int N, class T2, class Array>
+    void testOnShape(typename MultiArrayShape<N>::type const & shape,
+                     typename MultiArrayShape<N>::type const & chunk_shape,
+                     Array const & pixelPitch, int density)
+    {
+        typedef typename MultiArrayShape<N>::type Shape;
+
+        MultiArray<N, UInt8> oldschool_data(shape);
+        for(auto & v : oldschool_data)
+            v = (rand() % density == 0) ? 1 : 0;
+
+        ChunkedArrayLazy<N, UInt8> data(shape, chunk_shape);
+        data.commitSubarray(Shape(0), oldschool_data);
+
+        for(int background = 0; background < 2; ++background)
+        {
+            MultiArray<N, T2> correct(shape), tested(shape);
+            ChunkedArrayLazy<N, T2> res(shape, chunk_shape);
+
+            separableMultiDistance(oldschool_data, correct, background == 1, pixelPitch);
+            separableMultiDistanceBlockwise(data, res, background == 1, pixelPitch);
+            res.checkoutSubarray(Shape(0), tested);
+            shouldEqualSequence(tested.begin(), tested.end(), correct.begin());
+
+            separableMultiDistSquared(oldschool_data, correct, background == 1, pixelPitch);
+            separableMultiDistSquaredBlockwise(data, res, background == 1, pixelPitch,
+                                               ParallelOptions().numThreads(2));
+            res.checkoutSubarray(Shape(0), tested);
+            shouldEqualSequence(tested.begin(), tested.end(), correct.begin());
+        }
+    }
+
+    void chunkedTest()
+    {
+        // shapes which are not multiples of the chunk shape
+        testOnShape<3, float>(Shape3(45, 38, 21), Shape3(16, 8, 8), TinyVector<double, 3>(1.0), 200);
+        testOnShape<3, double>(Shape3(45, 38, 21), Shape3(16, 8, 8), TinyVector<double, 3>(1.0, 2.5, 0.7), 500);
+        // integer results are computed in a temporary array only when needed
+        testOnShape<3, UInt16>(Shape3(33, 17, 40), Shape3(8, 16, 8), TinyVector<double, 3>(1.0), 300);
+        testOnShape<3, UInt8>(Shape3(33, 17, 40), Shape3(8, 16, 8), TinyVector<double, 3>(2.0, 1.0, 1.0), 300);
+        testOnShape<2, float>(Shape2(100, 77), Shape2(32, 16), TinyVector<double, 2>(1.0), 100);
+        testOnShape<4, float>(Shape4(12, 9, 10, 7), Shape4(4, 4, 4, 2), TinyVector<double, 4>(1.0), 50);
+    }
+
+    void cacheTest()
+    {
+        // a tiny cache must not change the results
+        Shape3 shape(70, 50, 40), chunk_shape(16);
+        MultiArray<3, UInt8> oldschool_data(shape);
+        fillRandom(oldschool_data.begin(), oldschool_data.end(), 2);
+        oldschool_data.bindOuter(20) = 0;
+
+        ChunkedArrayCompressed<3, UInt8> data(shape, chunk_shape, ChunkedArrayOptions().cacheMax(2));
+        data.commitSubarray(Shape3(0), oldschool_data);
+        ChunkedArrayCompressed<3, float> res(shape, chunk_shape, ChunkedArrayOptions().cacheMax(2));
+
+        MultiArray<3, float> correct(shape), tested(shape);
+        separableMultiDistance(oldschool_data, correct, false);
+        separableMultiDistanceBlockwise(data, res, false);
+        res.checkoutSubarray(Shape3(0), tested);
+        shouldEqualSequence(tested.begin(), tested.end(), correct.begin());
+    }
+};
+
+struct BlockwiseDistanceTestSuite
+  : public test_suite
+{
+    BlockwiseDistanceTestSuite()
+      : test_suite("blockwise distance test")
+    {
+        add(testCase(&BlockwiseDistanceTest::chunkedTest));
+        add(testCase(&BlockwiseDistanceTest::cacheTest));
+    }
+};
+
+int main(int argc, char** argv)
+{
+    BlockwiseDistanceTestSuite test;
+    int failed = test.run(testsToBeExecuted(argc, argv));
+
+    cout << test.report() << endl;
+
+    return failed != 0;
+}
@@ -336,6 +336,72 @@ struct ConvolutionTest
 
     }
 
+    void kernelSymmetryTest()
+    {
+        vigra::Kernel1D<double> k;
+        k.initGaussian(1.5);
+        shouldEqual(k.symmetry(), vigra::SymmetricKernel);
+        k.initGaussianDerivative(1.5, 1);
+        shouldEqual(k.symmetry(), vigra::AntisymmetricKernel);
+        k.initGaussianDerivative(1.5, 2);
+        shouldEqual(k.symmetry(), vigra::SymmetricKernel);
+        k.initExplicitly(-1,1) = 1, 2, 3;
+        shouldEqual(k.symmetry(), vigra::AsymmetricKernel);
+        k.initExplicitly(-1,2) = 1, 2, 1, 0;
+        shouldEqual(k.symmetry(), vigra::AsymmetricKernel);
+
+        // symmetric and antisymmetric kernels are folded, compare with
+        // the same kernel padded by a zero, which is not folded
+        vigra::BorderTreatmentMode modes[] = { vigra::BORDER_TREATMENT_REFLECT, vigra::BORDER_TREATMENT_REPEAT,
+                                               vigra::BORDER_TREATMENT_WRAP, vigra::BORDER_TREATMENT_ZEROPAD };
+        vigra::ArrayVector<double> src(20), res(20), ref(20);
+        vigra::StandardValueAccessor<double> acc;
+        for(int i = 0; i < 20; ++i)
+            src[i] = (i*i*7919) % 97;
+        for(int order = 0; order < 3; ++order)
+        {
+            for(double sigma = 0.3; sigma < 3.0; sigma += 0.4)
+            {
+                vigra::Kernel1D<double> folded, padded;
+                folded.initGaussianDerivative(sigma, order);
+                padded.initExplicitly(folded.left()-1, folded.right()) = 0.0;
+                for(int i = folded.left(); i <= folded.right(); ++i)
+                    padded[i] = folded[i];
+                shouldEqual(folded.symmetry(), order == 1 ? vigra::AntisymmetricKernel : vigra::SymmetricKernel);
+
+                for(int m = 0; m < 4; ++m)
+                {
+                    folded.setBorderTreatment(modes[m]);
+                    padded.setBorderTreatment(modes[m]);
+                    convolveLine(srcIterRange(src.begin(), src.end(), acc), destIter(res.begin(), acc), kernel1d(folded));
+                    convolveLine(srcIterRange(src.begin(), src.end(), acc), destIter(ref.begin(), acc), kernel1d(padded));
+                    shouldEqualSequenceTolerance(ref.begin(), ref.end(), res.begin(), 1e-12);
+
+                    // subrange
+                    convolveLine(srcIterRange(src.begin(), src.end(), acc), destIter(res.begin(), acc), kernel1d(folded), 3, 17);
+                    shouldEqualSequenceTolerance(ref.begin()+3, ref.begin()+17, res.begin(), 1e-12);
+                }
+            }
+        }
+
+        // the folded taps must not overflow the source type
+        vigra::ArrayVector<vigra::UInt32> isrc(8), ires(8);
+        vigra::StandardValueAccessor<vigra::UInt32> iacc;
+        for(int i = 0; i < 8; ++i)
+            isrc[i] = i + 3;
+        vigra::Kernel1D<double> diff;
+        diff.initSymmetricDifference();
+        convolveLine(srcIterRange(isrc.begin(), isrc.end(), iacc), destIter(ires.begin(), iacc), kernel1d(diff));
+        vigra::UInt32 idiff[] = { 0, 1, 1, 1, 1, 1, 1, 0 };
+        shouldEqualSequence(ires.begin(), ires.end(), idiff);
+
+        std::fill(isrc.begin(), isrc.end(), 4000000000u);
+        vigra::Kernel1D<double> gauss;
+        gauss.initGaussian(1.0);
+        convolveLine(srcIterRange(isrc.begin(), isrc.end(), iacc), destIter(ires.begin(), iacc), kernel1d(gauss));
+        shouldEqualSequence(ires.begin(), ires.end(), isrc.begin());
+    }
+
     void simpleSharpeningTest()
     {
         Image dest_lenna(lenna);
@@ -953,6 +1019,83 @@ struct ConvolutionTest
         should(acc(i1) == 2.75);
     }
 
+    template <class T1, class T2>
+    static double maxDifference(MultiArrayView<2, T1> const & a, MultiArrayView<2, T2> const & b)
+    {
+        double res = 0.0;
+        for(int k = 0; k < a.size(); ++k)
+            res = std::max(res, std::abs((double)a[k] - (double)b[k]));
+        return res;
+    }
+
+    void separableFixedPointTest()
+    {
+        typedef FixedPoint16<1> FP;
+
+        MultiArray<2, UInt8> src(lenna.width(), lenna.height());
+        src = View(lenna);
+
+        BorderTreatmentMode borders[] = { BORDER_TREATMENT_REFLECT, BORDER_TREATMENT_REPEAT,
+                                          BORDER_TREATMENT_WRAP, BORDER_TREATMENT_ZEROPAD,
+                                          BORDER_TREATMENT_CLIP };
+        for(int b = 0; b < 5; ++b)
+        {
+            Kernel1D<double> gauss;
+            gauss.initGaussian(2.0);
+            gauss.setBorderTreatment(borders[b]);
+            Kernel1D<FP> fixedGauss(gauss);
+
+            // error bound documented in convolveLine()
+            double bound = 0.5 + 0.5 * gauss.size() * 255.0 / FP::ONE;
+            shouldEqualTolerance(bound, 0.6, 0.01);
+
+            MultiArray<2, double> ref(src.shape()), exact(src.shape());
+            MultiArray<2, UInt8> res(src.shape());
+
+            separableConvolveX(src, ref, gauss);
+            separableConvolveX(src, res, fixedGauss);
+            should(maxDifference(ref, res) <= bound);
+
+            // with a real destination, the result is exact
+            separableConvolveX(src, ref, Kernel1D<double>(fixedGauss));
+            separableConvolveX(src, exact, fixedGauss);
+            should(maxDifference(ref, exact) < 1e-12);
+
+            separableConvolveY(src, ref, gauss);
+            separableConvolveY(src, res, fixedGauss);
+            should(maxDifference(ref, res) <= bound);
+        }
+
+        // derivative filters with signed result, saturation
+        Kernel1D<double> grad;
+        grad.initGaussianDerivative(1.0, 1);
+        grad.setBorderTreatment(BORDER_TREATMENT_REFLECT);
+        Kernel1D<FP> fixedGrad(grad);
+        double bound = 0.5 + 0.5 * grad.size() * 255.0 / FP::ONE;
+
+        MultiArray<2, double> ref(src.shape());
+        MultiArray<2, Int16> signedRes(src.shape());
+        MultiArray<2, UInt8> unsignedRes(src.shape());
+        separableConvolveX(src, ref, grad);
+        separableConvolveX(src, signedRes, fixedGrad);
+        separableConvolveX(src, unsignedRes, fixedGrad);
+        should(maxDifference(ref, signedRes) <= bound);
+        should(*std::min_element(ref.begin(), ref.end()) < -10.0);
+        for(int k = 0; k < src.size(); ++k)
+            should(std::abs(clip(ref[k], 0.0, 255.0) - unsignedRes[k]) <= bound);
+
+        // 16-bit input
+        MultiArray<2, UInt16> src16(src.shape());
+        for(int k = 0; k < src.size(); ++k)
+            src16[k] = (UInt16)(src[k] * 257);
+        Kernel1D<double> gauss;
+        gauss.initGaussian(1.5);
+        MultiArray<2, UInt16> res16(src.shape());
+        separableConvolveY(src16, ref, gauss);
+        separableConvolveY(src16, res16, Kernel1D<FP>(gauss));
+        should(maxDifference(ref, res16) <= 0.5 + 0.5 * gauss.size() * 65535.0 / FP::ONE);
+    }
+
     void gaussianSmoothingTest()
     {
         double scale = 1.0;
@@ -2455,6 +2598,7 @@ struct ConvolutionTestSuite
 
 #if 1
         add( testCase( &ConvolutionTest::initExplicitlyTest));
+        add( testCase( &ConvolutionTest::kernelSymmetryTest));
 
         add( testCase( &ConvolutionTest::simpleSharpeningTest));
         add( testCase( &ConvolutionTest::gaussianSharpeningTest));
@@ -2476,6 +2620,7 @@ struct ConvolutionTestSuite
         add( testCase( &ConvolutionTest::separableSmoothClipTest));
         add( testCase( &ConvolutionTest::separableSmoothZeropadTest));
         add( testCase( &ConvolutionTest::separableSmoothWrapTest));
+        add( testCase( &ConvolutionTest::separableFixedPointTest));
         add( testCase( &ConvolutionTest::gaussianSmoothingTest));
         add( testCase( &ConvolutionTest::optimalSmoothing3Test));
         add( testCase( &ConvolutionTest::optimalSmoothing5Test));
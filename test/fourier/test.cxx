@@ -691,6 +691,115 @@ struct MultiFFTTest
         shouldEqualSequenceTolerance(out2.data(), out2.data()+out2.size(),
                                      out4.data(), 1e-15);
     }
+
+    static void convolveReference(MultiArrayView<3, double> const & in,
+                                  MultiArrayView<3, double> const & kernel,
+                                  MultiArrayView<3, double> out)
+    {
+        Shape3 s(in.shape()), center(div(kernel.shape(), MultiArrayIndex(2)));
+        for(MultiCoordinateIterator<3> x(s), xend = x.getEndIterator(); x != xend; ++x)
+        {
+            double sum = 0.0;
+            for(MultiCoordinateIterator<3> m(kernel.shape()), mend = m.getEndIterator(); m != mend; ++m)
+            {
+                Shape3 p = *x + center - *m;
+                for(int d=0; d<3; ++d)
+                {
+                    if(p[d] < 0)
+                        p[d] = -p[d];
+                    if(p[d] >= s[d])
+                        p[d] = 2*(s[d] - 1) - p[d];
+                }
+                sum += kernel[*m] * in[p];
+            }
+            out[*x] = sum;
+        }
+    }
+
+    static double maxDifference(MultiArrayView<3, double> const & a,
+                                MultiArrayView<3, double> const & b)
+    {
+        double res = 0.0;
+        for(int k=0; k<a.size(); ++k)
+            res = std::max(res, std::abs(a[k] - b[k]));
+        return res;
+    }
+
+    void testConvolveMultiArray()
+    {
+        typedef ConvolveMultiArrayOptions Options;
+        typedef MultiArrayView<2, double> MV;
+
+        ImageImportInfo info("ghouse.gif");
+        Shape2 s(info.width(), info.height());
+        DArray2 in(s), ref(s), out(s);
+        importImage(info, destImage(in));
+
+        double scale = 2.0;
+        gaussianSmoothing(srcImageRange(in), destImage(ref), scale);
+
+        Kernel2D<double> gauss;
+        gauss.initGaussian(scale);
+        MV kernel(Shape2(gauss.width(), gauss.height()), &gauss[gauss.upperLeft()]);
+
+        convolveMultiArray(in, kernel, out, Options().method(Options::DirectConvolution));
+        shouldEqualSequenceTolerance(out.data(), out.data()+out.size(),
+                                     ref.data(), 1e-12);
+
+        // single tile
+        out = 0.0;
+        convolveMultiArray(in, kernel, out, Options().method(Options::FFTConvolution));
+        shouldEqualSequenceTolerance(out.data(), out.data()+out.size(),
+                                     ref.data(), 1e-12);
+
+        // overlap-save with many tiles in parallel
+        out = 0.0;
+        convolveMultiArray(in, kernel, out, Options().method(Options::FFTConvolution)
+                                                     .maxTileSize(1024)
+                                                     .parallelOptions(ParallelOptions().numThreads(4)));
+        shouldEqualSequenceTolerance(out.data(), out.data()+out.size(),
+                                     ref.data(), 1e-12);
+
+        // in-place, automatic method selection
+        out = in;
+        convolveMultiArray(out, kernel, out);
+        shouldEqualSequenceTolerance(out.data(), out.data()+out.size(),
+                                     ref.data(), 1e-12);
+
+        // non-separable, asymmetric kernel with even and odd sizes, tiles at the borders
+        // which are smaller than the kernel halo (the results are compared with an absolute
+        // tolerance, because the kernel's positive and negative coefficients cancel)
+        Shape3 s3(23, 17, 9);
+        MultiArray<3, double> in3(s3), ref3(s3), out3(s3), kernel3(Shape3(6, 3, 5));
+        MultiArray<3, UInt8> in8(s3);
+        for(int k=0; k<in3.size(); ++k)
+        {
+            in8[k] = (k * 7919) % 251;
+            in3[k] = in8[k];
+        }
+        for(int k=0; k<kernel3.size(); ++k)
+            kernel3[k] = std::sin(1.0 + k);
+        convolveReference(in3, kernel3, ref3);
+
+        Options::Method methods[] = { Options::DirectConvolution, Options::FFTConvolution };
+        for(int m=0; m<2; ++m)
+        {
+            convolveMultiArray(in3, kernel3, out3, Options().method(methods[m]));
+            should(maxDifference(out3, ref3) < 1e-9);
+
+            out3 = 0.0;
+            convolveMultiArray(in8, kernel3, out3, Options().method(methods[m])
+                                                            .maxTileSize(400)
+                                                            .parallelOptions(ParallelOptions().numThreads(3)));
+            should(maxDifference(out3, ref3) < 1e-9);
+        }
+
+        // integer output is rounded
+        MultiArray<3, Int32> out32(s3);
+        convolveMultiArray(in8, kernel3, out32);
+        for(int k=0; k<out32.size(); ++k)
+            shouldEqual(out32[k], (Int32)roundi(ref3[k]));
+    }
 };
 
 struct FFTWTestSuite
@@ -715,6 +824,7 @@ struct FFTWTestSuite
         add( testCase(&MultiFFTTest::testConvolveFFT));
         add( testCase(&MultiFFTTest::testConvolveFFTComplex));
         add( testCase(&MultiFFTTest::testConvolveFourierKernel));
+        add( testCase(&MultiFFTTest::testConvolveMultiArray));
     }
 };
 
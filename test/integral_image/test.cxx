@@ -42,6 +42,8 @@
 #include "vigra/unittest.hxx"
 
 #include <vigra/integral_image.hxx>
+#include <vigra/random.hxx>
+#include <numeric>
 
 using namespace vigra;
 
@@ -227,6 +229,140 @@ struct IntegralImageTest
             }
         }
     }
+
+    void test_parallel()
+    {
+        // the lines and hyperplanes are split among threads, the results
+        // must be identical to the sequential version
+        Image3 in(Shape3(45, 33, 27));
+        for(int k = 0; k < in.size(); ++k)
+            in[k] = randomMT19937().uniformInt(100);
+
+        Image3 ref(in.shape()), res(in.shape());
+        cumulativeSum(in, ref, 0, functor::Identity());
+        cumulativeSum(ref, ref, 1, functor::Identity());
+        cumulativeSum(ref, ref, 2, functor::Identity());
+
+        integralMultiArray(in, res);
+        should(res == ref);
+
+        res = 0;
+        integralMultiArray(in, res, ParallelOptions().numThreads(4));
+        should(res == ref);
+
+        // in-place
+        res = in;
+        integralMultiArray(res, res, ParallelOptions().numThreads(4));
+        should(res == ref);
+
+        // strided views
+        Image3 transposed(in.transpose()), tres(transposed.shape());
+        integralMultiArray(in.transpose(), tres, ParallelOptions().numThreads(3));
+        Image3 tref(transposed.shape());
+        integralMultiArray(transposed, tref);
+        should(tres == tref);
+
+        // squares, multiband
+        Image3 squares(in.shape());
+        integralMultiArraySquared(in, ref);
+        integralMultiArraySquared(in, squares, ParallelOptions().numThreads(4));
+        should(squares == ref);
+        Image4 in4(Shape4(20, 15, 10, 2)), ref4(in4.shape()), res4(in4.shape());
+        for(int k = 0; k < in4.size(); ++k)
+            in4[k] = randomMT19937().uniformInt(100);
+        integralMultiArray(in4.multiband(), ref4.multiband());
+        integralMultiArray(in4.multiband(), res4.multiband(), ParallelOptions().numThreads(4));
+        should(res4 == ref4);
+
+        // a single line is scanned in tiles
+        MultiArray<1, int> line(Shape1(1001)), lref(line.shape()), lres(line.shape());
+        for(int k = 0; k < line.size(); ++k)
+            line[k] = randomMT19937().uniformInt(100);
+        std::partial_sum(line.begin(), line.end(), lref.begin());
+        integralMultiArray(line, lres, ParallelOptions().numThreads(4));
+        should(lres == lref);
+        Image2 row(Shape2(1001, 1)), rres(row.shape());
+        row.bindOuter(0) = line;
+        integralMultiArray(row, rres, ParallelOptions().numThreads(4));
+        should(rres.bindOuter(0) == lref);
+    }
+
+    template <unsigned int N, class T>
+    void boxReference(MultiArrayView<N, T> const & in,
+                      typename MultiArrayShape<N>::type const & radius,
+                      MultiArrayView<N, double> mean, MultiArrayView<N, double> variance)
+    {
+        typedef typename MultiArrayShape<N>::type Shape;
+        MultiCoordinateIterator<N> i(in.shape()), end(i.getEndIterator());
+        for(; i != end; ++i)
+        {
+            Shape lo(max(*i - radius, Shape())),
+                  hi(min(*i + radius + Shape(1), in.shape()));
+            MultiArrayView<N, T> window(in.subarray(lo, hi));
+            double m = 0.0, v = 0.0;
+            for(int k = 0; k < window.size(); ++k)
+                m += window[k];
+            m /= window.size();
+            for(int k = 0; k < window.size(); ++k)
+                v += sq(window[k] - m);
+            mean[*i] = m;
+            variance[*i] = v / window.size();
+        }
+    }
+
+    void test_boxFilter()
+    {
+        {
+            MultiArray<2, UInt8> in(Shape2(37, 29));
+            for(int k = 0; k < in.size(); ++k)
+                in[k] = randomMT19937().uniformInt(256);
+
+            Shape2 radius(5, 2);
+            MultiArray<2, double> refMean(in.shape()), refVariance(in.shape()),
+                                  mean(in.shape()), variance(in.shape()), mean2(in.shape());
+            boxReference(in, radius, refMean, refVariance);
+
+            boxFilterMultiArray(in, mean, radius);
+            shouldEqualSequenceTolerance(mean.begin(), mean.end(), refMean.begin(), 1e-10);
+
+            localVarianceMultiArray(in, variance, mean2, radius, ParallelOptions().numThreads(4));
+            shouldEqualSequenceTolerance(variance.begin(), variance.end(), refVariance.begin(), 1e-8);
+            shouldEqualSequenceTolerance(mean2.begin(), mean2.end(), refMean.begin(), 1e-10);
+
+            // integer results are rounded
+            MultiArray<2, UInt8> rounded(in.shape());
+            boxFilterMultiArray(in, rounded, radius, ParallelOptions().numThreads(4));
+            for(int k = 0; k < in.size(); ++k)
+                shouldEqual((int)rounded[k], roundi(refMean[k]));
+
+            // windows larger than the array give the global mean
+            boxFilterMultiArray(in, mean, 100);
+            for(int k = 0; k < in.size(); ++k)
+                shouldEqualTolerance(mean[k], in.sum<double>() / in.size(), 1e-10);
+
+            // radius zero (up to round-off in the integral arrays)
+            localVarianceMultiArray(in, variance, 0);
+            for(int k = 0; k < in.size(); ++k)
+                should(variance[k] < 1e-8);
+        }
+        {
+            MultiArray<3, float> in(Shape3(19, 17, 13));
+            for(int k = 0; k < in.size(); ++k)
+                in[k] = 1000.0f + (float)randomMT19937().uniform();
+
+            Shape3 radius(3, 4, 2);
+            MultiArray<3, double> refMean(in.shape()), refVariance(in.shape()),
+                                  mean(in.shape()), variance(in.shape());
+            boxReference(in, radius, refMean, refVariance);
+
+            boxFilterMultiArray(in, mean, radius, ParallelOptions().numThreads(3));
+            shouldEqualSequenceTolerance(mean.begin(), mean.end(), refMean.begin(), 1e-9);
+
+            // the large offset is removed before squaring
+            localVarianceMultiArray(in, variance, radius, ParallelOptions().numThreads(3));
+            shouldEqualSequenceTolerance(variance.begin(), variance.end(), refVariance.begin(), 1e-9);
+        }
+    }
 };
 
 
@@ -240,6 +376,8 @@ struct IntegralImageTestSuite
         add( testCase( &IntegralImageTest::test_3d));
         add( testCase( &IntegralImageTest::test_4d));
         add( testCase( &IntegralImageTest::test_vector));
+        add( testCase( &IntegralImageTest::test_parallel));
+        add( testCase( &IntegralImageTest::test_boxFilter));
     }
 };
 
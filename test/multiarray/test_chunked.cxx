@@ -489,6 +489,29 @@ public:
             shouldEqualSequence(c.begin(), c.end(), vr.begin());
             shouldEqualIndexing(3, c, vr);
         }
+
+        {
+            Shape3 start(9,10,17), stop(17,21,22); // outside the first chunk along all axes
+            MultiArrayView <3, T, ChunkedArrayTag> v(array->subarray(start, stop));
+            MultiArrayView <3, T, StridedArrayTag> vr = ref.subarray(start, stop);
+
+            shouldEqual(v.shape(), vr.shape());
+            should(v == vr);
+            shouldEqualSequence(v.begin(), v.end(), vr.begin());
+            shouldEqualIndexing(3, v, vr);
+        }
+
+        if(array->cacheMaxSize() > 0)
+        {
+            // only the chunks covered by the ROI are released
+            array->setCacheMaxSize(27);
+            array->subarray(Shape3(), shape);
+            array->releaseChunks(Shape3(8), shape);
+            MultiCoordinateIterator<3> c(array->chunkArrayShape()), cend(c.getEndIterator());
+            for(; c != cend; ++c)
+                shouldEqual(array->lookupHandle(*c)->chunk_state_.load() < 0, allLessEqual(Shape3(1), *c));
+            shouldEqualSequence(array->cbegin(), array->cend(), ref.begin());
+        }
     }
 
     void test_iterator ()
@@ -739,6 +762,114 @@ public:
         shouldEqualSequence(array->cbegin(), array->cend(), ref.begin());
     }
 
+    void testPrefetch()
+    {
+        // only backends with a cache have chunks that need loading
+        bool usesCache = array->cacheMaxSize() > 0;
+
+        // send all chunks asleep and load some of them in the background
+        array->releaseChunks(Shape3(), shape);
+        array->prefetch(Shape3(8), shape);
+        array->waitPrefetch();
+        if(usesCache)
+            shouldEqual(array->cacheSize(), 8);
+        shouldEqualSequence(array->cbegin(), array->cend(), ref.begin());
+
+        // an ROI that doesn't begin in the first chunk loads exactly its own chunks
+        array->releaseChunks(Shape3(), shape);
+        array->prefetch(Shape3(9, 0, 17), Shape3(20, 9, 22));
+        array->waitPrefetch();
+        if(usesCache)
+        {
+            shouldEqual(array->cacheSize(), 4);
+            MultiCoordinateIterator<3> c(array->chunkArrayShape()), cend(c.getEndIterator());
+            for(; c != cend; ++c)
+            {
+                bool inROI = (*c)[0] >= 1 && (*c)[1] <= 1 && (*c)[2] == 2;
+                shouldEqual(array->lookupHandle(*c)->chunk_state_.load() >= 0, inROI);
+            }
+        }
+        shouldEqualSequence(array->cbegin(), array->cend(), ref.begin());
+
+        // read-ahead along the scan order of a chunk iterator
+        array->releaseChunks(Shape3(), shape);
+        array->setReadAhead(2);
+        shouldEqual(array->readAhead(), 2);
+        BaseArray const & carray = *array;
+        typename BaseArray::chunk_const_iterator i = carray.chunk_cbegin(Shape3(1), shape);
+        array->waitPrefetch();
+        if(usesCache)
+            shouldEqual(array->cacheSize(), 3);
+        for(; i.isValid(); ++i)
+            should(*i == ref.subarray(i.chunkStart(), i.chunkStop()));
+        array->waitPrefetch();
+        array->setReadAhead(0);
+        shouldEqualSequence(array->cbegin(), array->cend(), ref.begin());
+    }
+
+    void testCache()
+    {
+        // only backends with a cache send chunks asleep
+        if(array->cacheMaxSize() == 0)
+            return;
+
+        array->releaseChunks(Shape3(), shape);
+        shouldEqual(array->cacheSize(), 0);
+        shouldEqual(array->cacheBytes(), 0u);
+        array->setCacheMaxSize(4);
+        array->resetCacheStatistics();
+
+        // a pass over all chunks keeps only the last four chunks in the cache
+        {
+            BaseArray const & carray = *array;
+            typename BaseArray::chunk_const_iterator i = carray.chunk_cbegin(Shape3(), shape);
+            for(; i.isValid(); ++i)
+                should(*i == ref.subarray(i.chunkStart(), i.chunkStop()));
+        }
+        shouldEqual(array->cacheMisses(), 27u);
+        shouldEqual(array->cacheEvictions(), 23u);
+        shouldEqual(array->cacheHits(), 0u);
+        shouldEqual(array->cacheSize(), 4);
+        shouldEqual(array->getItem(shape - Shape3(1)), ref[shape - Shape3(1)]);
+        shouldEqual(array->cacheHits(), 1u);
+
+        // limit the cache by the number of bytes
+        std::size_t bytes = array->cacheBytes();
+        should(bytes > 0);
+        array->setCacheMaxSize(27);
+        array->setCacheMaxBytes(bytes / 2);
+        should(array->cacheBytes() <= bytes / 2);
+        should(array->cacheSize() < 4);
+        array->setCacheMaxBytes(0);
+
+        // in contrast to a FIFO cache, a chunk that is used repeatedly
+        // stays in the cache while all other chunks are loaded once
+        array->releaseChunks(Shape3(), shape);
+        array->setCacheMaxSize(4);
+        array->resetCacheStatistics();
+        MultiCoordinateIterator<3> c(Shape3(3)), end(c.getEndIterator());
+        for(++c; c != end; ++c)
+        {
+            array->subarray(Shape3(), Shape3(1));
+            array->subarray(*c * chunk_shape, *c * chunk_shape + Shape3(1));
+        }
+        shouldEqual(array->cacheMisses(), 27u);
+        shouldEqual(array->cacheHits(), 25u);
+        shouldEqual(array->cacheEvictions(), 23u);
+        shouldEqual(array->cacheSize(), 4);
+        shouldEqualSequence(array->cbegin(), array->cend(), ref.begin());
+
+        // threads of a parallel commit evict (and unload) chunks concurrently
+        array->releaseChunks(Shape3(), shape);
+        array->setCacheMaxSize(4);
+        array->resetCacheStatistics();
+        array->commitSubarray(Shape3(), ref, ParallelOptions().numThreads(4));
+        shouldEqual(array->cacheMisses(), 27u);
+        shouldEqual(array->cacheEvictions() + array->cacheSize(), 27u);
+        should(array->cacheSize() <= 4);
+        shouldEqualSequence(array->cbegin(), array->cend(), ref.begin());
+    }
+
     static void testMultiThreadedRun(BaseArray * v, int startIndex, int d,
                                      threading::atomic_long * go)
     {
@@ -1510,6 +1641,189 @@ public:
         std::string t = TOCS;
         std::cerr << "    indexing:  " << t << " (cache: " << array->cacheSize() << ")\n";
     }
+
+    void testSubarraySpeed()
+    {
+        std::cerr << "############ subarray speed (serial / parallel) #############\n";
+        MultiArray<3, T> a(shape), b(shape);
+        linearSequence(a.begin(), a.end());
+        double gb = shape[0]*shape[1]*shape[2]*sizeof(T) / 1e9;
+
+        ParallelOptions serial = ParallelOptions().numThreads(ParallelOptions::NoThreads),
+                        parallel;
+        for(int k=0; k<2; ++k)
+        {
+            ParallelOptions const & options = k == 0 ? serial : parallel;
+            array.reset(0);
+            array = createArray(shape, (Array *)0);
+            array->setCacheMaxSize(prod(array->chunkArrayShape()));
+
+            USETICTOC;
+            TIC;
+            array->commitSubarray(Shape3(), a, options);
+            double commit = TOCN;
+            TIC;
+            array->releaseChunks(Shape3(), shape, false, options);
+            double release = TOCN;
+            TIC;
+            array->checkoutSubarray(Shape3(), b, options);
+            double checkout = TOCN;
+            should(a == b);
+
+            std::cerr << (k == 0 ? "    serial:   " : "    parallel: ")
+                      << "commit " << gb / commit * 1000.0 << " GB/s, "
+                      << "release " << gb / release * 1000.0 << " GB/s, "
+                      << "checkout " << gb / checkout * 1000.0 << " GB/s\n";
+        }
+    }
+};
+
+struct ChunkedArrayMappedFileTest
+{
+    typedef ChunkedArrayMappedFile<3, int> Array;
+
+    Shape3 shape;
+    MultiArray<3, int> ref;
+    std::string file_name;
+    static const std::size_t header = 100; // deliberately not aligned to page boundaries
+
+    ChunkedArrayMappedFileTest()
+    : shape(20, 21, 22)
+    , ref(shape)
+    , file_name("test_chunked_mapped.raw")
+    {
+        linearSequence(ref.begin(), ref.end());
+
+        FILE * f = fopen(file_name.c_str(), "wb");
+        std::vector<char> h(header, 'x');
+        fwrite(h.data(), 1, header, f);
+        fwrite(ref.data(), sizeof(int), ref.size(), f);
+        fclose(f);
+    }
+
+    ~ChunkedArrayMappedFileTest()
+    {
+        remove(file_name.c_str());
+    }
+
+    void testReadOnly()
+    {
+        Array const array(file_name, shape, Shape3(8), Array::ReadOnly, header);
+
+        should(array.isReadOnly());
+        shouldEqual(array.shape(), shape);
+        shouldEqual(array.chunkArrayShape(), Shape3(3));
+        shouldEqual(array.cacheMaxSize(), 0u);
+        ChunkedArray<3, int> const & base = array;
+        shouldEqual(base.dataBytes(), ref.size()*sizeof(int));
+
+        shouldEqual(array.getItem(Shape3(0)), 0);
+        shouldEqual(array.getItem(Shape3(19, 20, 21)), ref[Shape3(19, 20, 21)]);
+        shouldEqual(array.getItem(Shape3(9, 3, 17)), ref[Shape3(9, 3, 17)]);
+
+        MultiArray<3, int> roi(Shape3(11, 12, 13));
+        array.checkoutSubarray(Shape3(3, 4, 5), roi);
+        should(roi == ref.subarray(Shape3(3, 4, 5), Shape3(14, 16, 18)));
+
+        Array::const_view_type view = array.subarray(Shape3(7), Shape3(19));
+        shouldEqualIndexing(3, view, ref.subarray(Shape3(7), Shape3(19)));
+
+        array.prefetch(Shape3(0), shape);
+        shouldEqualSequence(array.begin(), array.end(), ref.begin());
+
+        try
+        {
+            const_cast<Array &>(array).setItem(Shape3(1), 0);
+            failTest("setItem() on read-only array failed to throw exception");
+        }
+        catch(PreconditionViolation & e)
+        {
+            std::string expected("\nPrecondition violation!\nChunkedArray::setItem(): array is read-only.\n"),
+                        actual(e.what());
+            shouldEqual(actual.substr(0, expected.size()), expected);
+        }
+
+        try
+        {
+            Array too_large(file_name, shape + Shape3(1), Shape3(8), Array::ReadOnly, header);
+            failTest("mapping beyond the end of file failed to throw exception");
+        }
+        catch(PreconditionViolation & e)
+        {
+            std::string expected("\nPrecondition violation!\nChunkedArrayMappedFile(): file is too small for the given shape and offset.\n"),
+                        actual(e.what());
+            shouldEqual(actual.substr(0, expected.size()), expected);
+        }
+    }
+
+    void testReadAhead()
+    {
+        Array const array(file_name, shape, Shape3(4), Array::ReadOnly, header,
+                          ChunkedArrayOptions().readAhead(3));
+        shouldEqual(array.readAhead(), 3);
+
+        Array::chunk_const_iterator i = array.chunk_begin(Shape3(2), shape),
+                                    end = array.chunk_end(Shape3(2), shape);
+        int count = 0;
+        for(; i != end; ++i, ++count)
+        {
+            should(*i == ref.subarray(i.chunkStart(), i.chunkStop()));
+        }
+        shouldEqual(count, 5*6*6);
+    }
+
+    void testCopyOnWrite()
+    {
+        {
+            Array array(file_name, shape, Shape3(8), Array::CopyOnWrite, header);
+            should(!array.isReadOnly());
+
+            array.setItem(Shape3(1, 2, 3), -1);
+            shouldEqual(array.getItem(Shape3(1, 2, 3)), -1);
+
+            MultiArray<3, int> zeros(Shape3(10));
+            array.commitSubarray(Shape3(5), zeros);
+
+            MultiArray<3, int> expected(ref);
+            expected[Shape3(1, 2, 3)] = -1;
+            expected.subarray(Shape3(5), Shape3(15)) = 0;
+            shouldEqualSequence(array.cbegin(), array.cend(), expected.begin());
+        }
+
+        // the file remains unchanged
+        Array array(file_name, shape, Shape3(8), Array::ReadOnly, header);
+        shouldEqualSequence(array.cbegin(), array.cend(), ref.begin());
+    }
+
+#ifdef HasHDF5
+    void testHDF5()
+    {
+        std::string hdf5_file_name("test_chunked_mapped.h5");
+        {
+            HDF5File file(hdf5_file_name, HDF5File::New);
+            file.write("data", ref);
+
+            MultiArray<3, int> chunked_data(shape);
+            file.write("chunked", chunked_data, Shape3(8), 0);
+            try
+            {
+                file.getDatasetFileOffset("chunked");
+                failTest("getDatasetFileOffset() on chunked dataset failed to throw exception");
+            }
+            catch(PreconditionViolation &)
+            {}
+        }
+
+        HDF5File file(hdf5_file_name, HDF5File::ReadOnly);
+        ArrayVector<hsize_t> s = file.getDatasetShape("data");
+        Array array(hdf5_file_name, Shape3(s[0], s[1], s[2]), Shape3(8), Array::ReadOnly,
+                    file.getDatasetFileOffset("data"));
+        shouldEqual(array.shape(), shape);
+        shouldEqualSequence(array.cbegin(), array.cend(), ref.begin());
+        file.close();
+        remove(hdf5_file_name.c_str());
+    }
+#endif
 };
 
 struct ChunkedMultiArrayTestSuite
@@ -1526,6 +1840,8 @@ struct ChunkedMultiArrayTestSuite
         add( testCase( &ChunkedMultiArrayTest<Array>::test_subarray ) );
         add( testCase( &ChunkedMultiArrayTest<Array>::test_iterator ) );
         add( testCase( &ChunkedMultiArrayTest<Array>::testChunkIterator ) );
+        add( testCase( &ChunkedMultiArrayTest<Array>::testPrefetch ) );
+        add( testCase( &ChunkedMultiArrayTest<Array>::testCache ) );
         add( testCase( &ChunkedMultiArrayTest<Array>::testMultiThreaded ) );
     }
 
@@ -1537,6 +1853,7 @@ struct ChunkedMultiArrayTestSuite
         add( testCase( (&ChunkedMultiArraySpeedTest<ChunkedArrayLazy<3, T> >::testNestedLoopSpeed )));
         add( testCase( (&ChunkedMultiArraySpeedTest<ChunkedArrayLazy<3, T> >::testIteratorSpeed )));
         add( testCase( (&ChunkedMultiArraySpeedTest<ChunkedArrayCompressed<3, T> >::testIteratorSpeed )));
+        add( testCase( (&ChunkedMultiArraySpeedTest<ChunkedArrayCompressed<3, T> >::testSubarraySpeed )));
         add( testCase( (&ChunkedMultiArraySpeedTest<ChunkedArrayTmpFile<3, T> >::testIteratorSpeed )));
         add( testCase( (&ChunkedMultiArraySpeedTest<ChunkedArrayTmpFile<3, T> >::testIteratorSpeed_LargeCache )));
 #ifdef HasHDF5
@@ -1577,6 +1894,13 @@ struct ChunkedMultiArrayTestSuite
         testImpl<ChunkedArrayHDF5<3, TinyVector<float, 3> > >();
 #endif
 
+        add( testCase( &ChunkedArrayMappedFileTest::testReadOnly ) );
+        add( testCase( &ChunkedArrayMappedFileTest::testReadAhead ) );
+        add( testCase( &ChunkedArrayMappedFileTest::testCopyOnWrite ) );
+#ifdef HasHDF5
+        add( testCase( &ChunkedArrayMappedFileTest::testHDF5 ) );
+#endif
+
         testSpeedImpl<unsigned char>();
         testSpeedImpl<float>();
         testSpeedImpl<double>();
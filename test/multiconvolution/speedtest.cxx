@@ -4,10 +4,13 @@
 #include "vigra/unittest.hxx"
 #include "vigra/multi_array.hxx"
 #include "vigra/multi_pointoperators.hxx"
-//#include "vigra/multi_convolution.hxx"
+#include "vigra/multi_convolution.hxx"
+#include "vigra/multi_feature_bank.hxx"
+#include "vigra/timing.hxx"
 #include "vigra/basicimageview.hxx"
 #include "vigra/convolution.hxx" 
 #include "vigra/navigator.hxx"
+#include "vigra/random.hxx"
 #include "vigra/functorexpression.hxx"
 
 #include <ctime>
@@ -331,6 +334,161 @@ struct MultiArraySepConvSpeedTest
   }
 
 
+  void testPanels()
+  {
+    // separableConvolveMultiArray() convolves the outer axes in panels of
+    // neighboring lines, in contrast to the line-by-line reference testCpySrc()
+    USETICTOC;
+    TIC;
+    testCpySrc(img, dst1);
+    std::cout << "Timed function: line-by-line " << TOCS << std::endl;
+    TIC;
+    separableConvolveMultiArray(img, dst2, kernels.begin());
+    std::cout << "Timed function: panels       " << TOCS << std::endl;
+    shouldEqualSequenceTolerance(dst1.begin(), dst1.end(), dst2.begin(), 1e-5);
+  }
+
+
+  void testFeatureBank()
+  {
+    // the features of a typical pixel classifier, computed by individual
+    // calls and by GaussianFeatureBank
+    typedef GaussianFeatureBank<3> Bank;
+    const double scales[] = { 0.7, 1.0, 1.6, 3.5, 5.0, 10.0 };
+    const int channels = 6*(3 + 3 + 3);
+
+    // the volume must be larger than the kernels at scale 10
+    Size3 volumeShape(64, 64, 64);
+    Image3D volume(volumeShape);
+    makeBox(volume);
+
+    Shape4 shape(64, 64, 64, channels);
+    MultiArray<4, PixelType> naive(shape), fused(shape);
+    MultiArray<3, TinyVector<PixelType, 6> > tensor(volumeShape);
+    MultiArray<3, TinyVector<PixelType, 3> > eigenvalues(volumeShape);
+
+    USETICTOC;
+    TIC;
+    int c = 0;
+    for(int k = 0; k < 6; ++k)
+    {
+        gaussianSmoothMultiArray(volume, naive.bindOuter(c++), scales[k]);
+        gaussianGradientMagnitude(volume, naive.bindOuter(c++), scales[k]);
+        laplacianOfGaussianMultiArray(volume, naive.bindOuter(c++), scales[k]);
+        hessianOfGaussianMultiArray(volume, tensor, scales[k]);
+        tensorEigenvaluesMultiArray(tensor, eigenvalues);
+        for(int d = 0; d < 3; ++d)
+            naive.bindOuter(c++) = eigenvalues.bindElementChannel(d);
+        structureTensorMultiArray(volume, tensor, scales[k], 0.5*scales[k]);
+        tensorEigenvaluesMultiArray(tensor, eigenvalues);
+        for(int d = 0; d < 3; ++d)
+            naive.bindOuter(c++) = eigenvalues.bindElementChannel(d);
+    }
+    std::cout << "Timed function: individual features " << TOCS << std::endl;
+
+    Bank bank;
+    for(int k = 0; k < 6; ++k)
+    {
+        bank.add(Bank::GaussianSmoothing, scales[k]);
+        bank.add(Bank::GaussianGradientMagnitude, scales[k]);
+        bank.add(Bank::LaplacianOfGaussian, scales[k]);
+        bank.add(Bank::HessianOfGaussianEigenvalues, scales[k]);
+        bank.add(Bank::StructureTensorEigenvalues, scales[k], 0.5*scales[k]);
+    }
+    bank.cascadeScales(false);
+    TIC;
+    bank.compute(volume, fused);
+    std::cout << "Timed function: feature bank       " << TOCS << std::endl;
+    // differences are due to round-off, which is amplified by nearly
+    // equal eigenvalues
+    double difference = 0.0, largest = 0.0;
+    for(int k = 0; k < naive.size(); ++k)
+    {
+        difference = std::max(difference, (double)std::abs(naive[k] - fused[k]));
+        largest = std::max(largest, (double)std::abs(naive[k]));
+    }
+    should(difference < 1e-4*largest);
+
+    bank.cascadeScales(true);
+    TIC;
+    bank.compute(volume, fused);
+    std::cout << "Timed function: cascaded bank      " << TOCS << std::endl;
+  }
+
+
+  void testRecursiveGaussian()
+  {
+    // sampled kernels vs. recursive filters for the Gaussian and its gradient
+    typedef ConvolutionOptions<3> Options;
+    Size3 volumeShape(96, 96, 96);
+    Image3D volume(volumeShape), fir(volumeShape), iir(volumeShape);
+    MultiArray<3, TinyVector<PixelType, 3> > gradientFIR(volumeShape), gradientIIR(volumeShape);
+    makeBox(volume);
+
+    Options recursive;
+    recursive.filterMode(Options::RecursiveFilter);
+
+    const double scales[] = { 2.0, 4.0, 8.0, 12.0 };
+    for(int k = 0; k < 4; ++k)
+    {
+        USETICTOC;
+        std::cout << "sigma = " << scales[k] << std::endl;
+        TIC;
+        gaussianSmoothMultiArray(volume, fir, scales[k]);
+        std::cout << "Timed function: smoothing, sampled kernels   " << TOCS << std::endl;
+        TIC;
+        gaussianSmoothMultiArray(volume, iir, scales[k], recursive);
+        std::cout << "Timed function: smoothing, recursive filters " << TOCS << std::endl;
+        TIC;
+        gaussianGradientMultiArray(volume, gradientFIR, scales[k]);
+        std::cout << "Timed function: gradient, sampled kernels    " << TOCS << std::endl;
+        TIC;
+        gaussianGradientMultiArray(volume, gradientIIR, scales[k], recursive);
+        std::cout << "Timed function: gradient, recursive filters  " << TOCS << std::endl;
+
+        double smoothError = 0.0, smoothMax = 0.0, gradientError = 0.0, gradientMax = 0.0;
+        for(int i = 0; i < volume.size(); ++i)
+        {
+            smoothError   = std::max(smoothError, (double)std::abs(fir[i] - iir[i]));
+            smoothMax     = std::max(smoothMax, (double)std::abs(fir[i]));
+            gradientError = std::max(gradientError, (double)norm(gradientFIR[i] - gradientIIR[i]));
+            gradientMax   = std::max(gradientMax, (double)norm(gradientFIR[i]));
+        }
+        std::cout << "   relative error: smoothing " << smoothError / smoothMax
+                  << ", gradient " << gradientError / gradientMax << std::endl;
+        should(smoothError < 0.01*smoothMax);
+        should(gradientError < 0.02*gradientMax);
+    }
+  }
+
+
+  void testFixedPoint()
+  {
+    // 8-bit volume smoothed with floating-point vs. fixed-point kernels
+    Size3 volumeShape(128, 128, 128);
+    MultiArray<3, UInt8> volume(volumeShape), real(volumeShape), fixed(volumeShape);
+    for(int k = 0; k < volume.size(); ++k)
+        volume[k] = (UInt8)randomMT19937().uniformInt(256);
+
+    Kernel1D<double> gauss;
+    gauss.initGaussian(2.0);
+    Kernel1D<FixedPoint16<1> > fixedGauss(gauss);
+
+    USETICTOC;
+    TIC;
+    separableConvolveMultiArray(volume, real, gauss);
+    std::cout << "Timed function: UInt8, double kernel      " << TOCS << std::endl;
+    TIC;
+    separableConvolveMultiArray(volume, fixed, fixedGauss);
+    std::cout << "Timed function: UInt8, fixed-point kernel " << TOCS << std::endl;
+
+    int maxError = 0;
+    for(int k = 0; k < volume.size(); ++k)
+        maxError = std::max(maxError, std::abs((int)real[k] - (int)fixed[k]));
+    should(maxError <= 1);
+  }
+
+
   void makeBox( Image3D &image )
   {
     const int b = 8;
@@ -370,6 +528,10 @@ struct MultiArraySepConvSpeedTestSuite
         add( testCase( &MultiArraySepConvSpeedTest::test3 ) );
         add( testCase( &MultiArraySepConvSpeedTest::test1 ) );
         add( testCase( &MultiArraySepConvSpeedTest::test2 ) );
+        add( testCase( &MultiArraySepConvSpeedTest::testPanels ) );
+        add( testCase( &MultiArraySepConvSpeedTest::testFeatureBank ) );
+        add( testCase( &MultiArraySepConvSpeedTest::testRecursiveGaussian ) );
+        add( testCase( &MultiArraySepConvSpeedTest::testFixedPoint ) );
         add( testCase( &MultiArraySepConvSpeedTest::testCorrectness ) );
     }
 };
@@ -47,6 +47,8 @@
 #include "vigra/unittest.hxx"
 #include "vigra/multi_array.hxx"
 #include "vigra/multi_convolution.hxx"
+#include "vigra/multi_feature_bank.hxx"
+#include "vigra/multi_tensorutilities.hxx"
 #include "vigra/basicimageview.hxx"
 #include "vigra/convolution.hxx" 
 #include "vigra/navigator.hxx"
@@ -545,6 +547,423 @@ struct MultiArraySeparableConvolutionTest
     }
 
 
+    void test_borderTreatment()
+    {
+        // the outer axes are convolved in panels of neighboring lines,
+        // compare with line-by-line convolution
+        Size3 shape(19, 11, 9);
+        Image3D src(shape);
+        makeRandom(src);
+
+        BorderTreatmentMode modes[] = { BORDER_TREATMENT_REFLECT, BORDER_TREATMENT_REPEAT,
+                                        BORDER_TREATMENT_WRAP, BORDER_TREATMENT_ZEROPAD,
+                                        BORDER_TREATMENT_CLIP };
+        for(int m = 0; m < 5; ++m)
+        {
+            Kernel1D<double> kernel;
+            kernel.initExplicitly(-3, 2) = 0.1, 0.2, 0.4, 0.15, 0.1, 0.05;
+            kernel.setBorderTreatment(modes[m]);
+            ArrayVector<Kernel1D<double> > kernels(3, kernel);
+
+            Image3D ref(src), tmp;
+            for(int d = 0; d < 3; ++d)
+            {
+                tmp = ref;
+                typedef MultiArrayNavigator<Image3D::traverser, 3> Navigator;
+                Navigator snav(tmp.traverser_begin(), shape, d),
+                          dnav(ref.traverser_begin(), shape, d);
+                for(; snav.hasMore(); ++snav, ++dnav)
+                    convolveLine(srcIterRange(snav.begin(), snav.end(), StandardConstValueAccessor<PixelType>()),
+                                 destIter(dnav.begin(), StandardValueAccessor<PixelType>()),
+                                 kernel1d(kernel));
+            }
+
+            Image3D res(shape);
+            separableConvolveMultiArray(src, res, kernels.begin());
+            shouldEqualSequenceTolerance(ref.begin(), ref.end(), res.begin(), 1e-5f);
+
+            // (the subarray version only loads the ROI's neighborhood,
+            //  so it cannot wrap around)
+            if(modes[m] == BORDER_TREATMENT_WRAP)
+                continue;
+            Size3 start(3, 2, 1), stop(17, 10, 5);
+            Image3D sub(stop - start);
+            separableConvolveMultiArray(src, sub, kernels.begin(), start, stop);
+            Image3D refsub(ref.subarray(start, stop));
+            shouldEqualSequenceTolerance(refsub.begin(), refsub.end(), sub.begin(), 1e-5f);
+        }
+
+        // the folded taps of the panels must not overflow the pixel type
+        MultiArray<2, UInt32> usrc(Shape2(20, 8)), ures(Shape2(20, 8));
+        for(int y = 0; y < 8; ++y)
+            usrc.bindOuter(y) = UInt32(y + 3);
+        ArrayVector<Kernel1D<double> > ukernels(2);
+        ukernels[0].initExplicitly(0, 0) = 1.0;
+        ukernels[1].initSymmetricDifference();
+        separableConvolveMultiArray(usrc, ures, ukernels.begin());
+        UInt32 udiff[] = { 0, 1, 1, 1, 1, 1, 1, 0 };
+        for(int x = 0; x < 20; ++x)
+            shouldEqualSequence(ures.bindInner(x).begin(), ures.bindInner(x).end(), udiff);
+
+        usrc = 4000000000u;
+        ukernels[0].initGaussian(1.0);
+        ukernels[1].initGaussian(1.0);
+        separableConvolveMultiArray(usrc, ures, ukernels.begin());
+        shouldEqualSequence(ures.begin(), ures.end(), usrc.begin());
+    }
+
+    void test_parallel()
+    {
+        // the lines of each axis are split among threads, the results
+        // must be identical to the sequential version
+        Size3 shape(37, 23, 19);
+        Image3D src(shape);
+        makeRandom(src);
+
+        ConvolutionOptions<3> opt;
+        opt.stdDev(1.5);
+        ConvolutionOptions<3> popt(opt);
+        popt.parallelOptions(ParallelOptions().numThreads(4));
+        shouldEqual(opt.getParallelOptions().getNumThreads(), 0);
+        shouldEqual(popt.getParallelOptions().getNumThreads(), 4);
+
+        Image3D ref(shape), res(shape);
+        gaussianSmoothMultiArray(src, ref, opt);
+        gaussianSmoothMultiArray(src, res, popt);
+        should(ref == res);
+
+        // in-place
+        res = src;
+        gaussianSmoothMultiArray(res, res, popt);
+        should(ref == res);
+
+        // result type requiring a temporary array
+        MultiArray<3, int> iref(shape), ires(shape);
+        gaussianSmoothMultiArray(src, iref, opt);
+        gaussianSmoothMultiArray(src, ires, popt);
+        should(iref == ires);
+
+        MultiArray<3, TinyVector<PixelType, 3> > gref(shape), gres(shape);
+        gaussianGradientMultiArray(src, gref, opt);
+        gaussianGradientMultiArray(src, gres, popt);
+        should(gref == gres);
+
+        MultiArray<3, TinyVector<PixelType, 6> > href(shape), hres(shape);
+        hessianOfGaussianMultiArray(src, href, opt);
+        hessianOfGaussianMultiArray(src, hres, popt);
+        should(href == hres);
+
+        // subarray
+        Size3 start(3, 2, 1), stop(30, 20, 15);
+        opt.subarray(start, stop);
+        popt.subarray(start, stop);
+        Image3D sref(stop - start), sres(stop - start);
+        gaussianSmoothMultiArray(src, sref, opt);
+        gaussianSmoothMultiArray(src, sres, popt);
+        should(sref == sres);
+
+        // in 2D, the lines along axis 1 are split along axis 0 at multiples of the
+        // panel width, and a singleton axis is skipped when choosing the split axis
+        MultiArray<2, PixelType> src2(Shape2(83, 41)), ref2(src2.shape()), res2(src2.shape());
+        makeRandom(src2);
+        gaussianSmoothMultiArray(src2, ref2, 1.5);
+        gaussianSmoothMultiArray(src2, res2, 1.5,
+               ConvolutionOptions<2>().parallelOptions(ParallelOptions().numThreads(4)));
+        should(ref2 == res2);
+
+        Image3D flat(Size3(83, 41, 1)), fref(flat.shape()), fres(flat.shape());
+        flat.bindOuter(0) = src2;
+        ArrayVector<Kernel1D<double> > kernels(3);
+        kernels[0].initGaussian(1.5);
+        kernels[1].initGaussian(1.5);
+        kernels[2].initExplicitly(0, 0) = 1.0;
+        separableConvolveMultiArray(flat, fref, kernels.begin());
+        separableConvolveMultiArray(flat.traverser_begin(), flat.shape(), StandardConstValueAccessor<PixelType>(),
+                                    fres.traverser_begin(), StandardValueAccessor<PixelType>(),
+                                    kernels.begin(), Size3(), Size3(),
+                                    ParallelOptions().numThreads(4));
+        should(fref == fres);
+        MultiArray<1, PixelType> src1(Shape1(50)), ref1(Shape1(50)), res1(Shape1(50));
+        for(int k = 0; k < 50; ++k)
+            src1[k] = k % 7;
+        gaussianSmoothMultiArray(src1, ref1, 2.0);
+        gaussianSmoothMultiArray(src1, res1, 2.0,
+               ConvolutionOptions<1>().parallelOptions(ParallelOptions().numThreads(4)));
+        should(ref1 == res1);
+    }
+
+    template <unsigned int N>
+    void featureBankReference(MultiArrayView<N, PixelType> const & src,
+                              MultiArrayView<N+1, PixelType> ref,
+                              ArrayVector<double> const & scales)
+    {
+        MultiArray<N, TinyVector<PixelType, int(N*(N+1)/2)> > tensor(src.shape());
+        MultiArray<N, TinyVector<PixelType, int(N)> > ev(src.shape());
+        int c = 0;
+        for(unsigned int k = 0; k < scales.size(); ++k)
+        {
+            double s = scales[k];
+            gaussianSmoothMultiArray(src, ref.bindOuter(c++), s);
+            gaussianGradientMagnitude(src, ref.bindOuter(c++), s);
+            laplacianOfGaussianMultiArray(src, ref.bindOuter(c++), s);
+            hessianOfGaussianMultiArray(src, tensor, s);
+            tensorEigenvaluesMultiArray(tensor, ev);
+            for(unsigned int d = 0; d < N; ++d)
+                ref.bindOuter(c++) = ev.bindElementChannel(d);
+            structureTensorMultiArray(src, tensor, s, 0.5*s);
+            tensorEigenvaluesMultiArray(tensor, ev);
+            for(unsigned int d = 0; d < N; ++d)
+                ref.bindOuter(c++) = ev.bindElementChannel(d);
+        }
+    }
+
+    template <unsigned int N>
+    void featureBankRequests(GaussianFeatureBank<N> & bank, ArrayVector<double> const & scales)
+    {
+        typedef GaussianFeatureBank<N> Bank;
+        for(unsigned int k = 0; k < scales.size(); ++k)
+        {
+            double s = scales[k];
+            bank.add(Bank::GaussianSmoothing, s);
+            bank.add(Bank::GaussianGradientMagnitude, s);
+            bank.add(Bank::LaplacianOfGaussian, s);
+            bank.add(Bank::HessianOfGaussianEigenvalues, s);
+            bank.add(Bank::StructureTensorEigenvalues, s, 0.5*s);
+        }
+    }
+
+    template <unsigned int N>
+    double maxDifference(MultiArrayView<N, PixelType> const & a, MultiArrayView<N, PixelType> const & b)
+    {
+        double res = 0.0;
+        for(int k = 0; k < a.size(); ++k)
+            res = std::max(res, (double)std::abs(a[k] - b[k]));
+        return res;
+    }
+
+    void test_featureBank()
+    {
+        typedef GaussianFeatureBank<3> Bank;
+
+        // use an own generator so that the data don't depend on the other tests
+        RandomMT19937 random(42);
+
+        Size3 shape(31, 27, 23);
+        Image3D src(shape);
+        for(int k = 0; k < src.size(); ++k)
+            src[k] = (PixelType)random.uniform();
+        gaussianSmoothMultiArray(src, src, 1.0);
+
+        ArrayVector<double> scales;
+        scales.push_back(3.5);
+        scales.push_back(0.7);
+        scales.push_back(1.0);
+        scales.push_back(1.6);
+
+        Bank bank;
+        featureBankRequests(bank, scales);
+        shouldEqual(bank.size(), 20u);
+        shouldEqual(bank.channelCount(), 36u);
+        shouldEqual(Bank::channelCount(Bank::HessianOfGaussianEigenvalues), 3u);
+
+        MultiArray<4, PixelType> ref(Shape4(31, 27, 23, 36)), res(Shape4(31, 27, 23, 36));
+        featureBankReference<3>(src, ref, scales);
+
+        bank.cascadeScales(false);
+        // 19 passes for the derivatives and 18 for the structure tensor per scale
+        shouldEqual(bank.convolutionCount(), 4u*(19u + 18u));
+        bank.compute(src, res);
+        // the eigenvalues agree up to round-off
+        should(maxDifference<4>(ref, res) < 1e-4);
+
+        // 1.6 and 3.5 are computed from 0.7 and 1.6 respectively, which needs
+        // no additional passes since the smoothed results are computed anyway
+        bank.cascadeScales(true);
+        shouldEqual(bank.convolutionCount(), 4u*(19u + 18u));
+        res.init(0.0);
+        bank.compute(src, res);
+        should(maxDifference<4>(ref, res) < 2e-3);
+
+        // a single feature only computes the necessary derivatives:
+        // x-axis: orders 0 and 1, y-axis: (0,0), (0,1), (1,0),
+        // z-axis: (0,0,1), (0,1,0), (1,0,0)
+        Bank gradient;
+        gradient.add(Bank::GaussianGradientMagnitude, 2.0);
+        shouldEqual(gradient.convolutionCount(), 2u + 3u + 3u);
+
+        // 2D with anisotropic step size
+        MultiArray<2, PixelType> src2(Shape2(40, 30));
+        for(int k = 0; k < src2.size(); ++k)
+            src2[k] = (PixelType)random.uniform();
+        gaussianSmoothMultiArray(src2, src2, 1.0);
+        ConvolutionOptions<2> opt2;
+        opt2.stepSize(TinyVector<double, 2>(1.0, 0.5));
+        GaussianFeatureBank<2> bank2(opt2);
+        bank2.add(GaussianFeatureBank<2>::GaussianGradientMagnitude, 1.5);
+        bank2.add(GaussianFeatureBank<2>::HessianOfGaussianEigenvalues, 1.5);
+        bank2.add(GaussianFeatureBank<2>::GaussianSmoothing, 0.5);
+        MultiArray<3, PixelType> res2(Shape3(40, 30, 4)), ref2(Shape3(40, 30, 4)),
+                                 cascaded2(Shape3(40, 30, 4));
+        bank2.compute(src2, cascaded2);
+        bank2.cascadeScales(false);
+        bank2.compute(src2, res2);
+
+        gaussianGradientMagnitude(src2, ref2.bindOuter(0), 1.5, opt2);
+        MultiArray<2, TinyVector<PixelType, 3> > hessian2(src2.shape());
+        MultiArray<2, TinyVector<PixelType, 2> > ev2(src2.shape());
+        hessianOfGaussianMultiArray(src2, hessian2, 1.5, opt2);
+        tensorEigenvaluesMultiArray(hessian2, ev2);
+        ref2.bindOuter(1) = ev2.bindElementChannel(0);
+        ref2.bindOuter(2) = ev2.bindElementChannel(1);
+        gaussianSmoothMultiArray(src2, ref2.bindOuter(3), 0.5, opt2);
+        should(maxDifference<3>(ref2, res2) < 1e-5);
+        // 1.5 is computed from 0.5
+        should(maxDifference<3>(ref2, cascaded2) < 2e-3);
+    }
+
+    template <unsigned int N, class T>
+    double maxNorm(MultiArrayView<N, T> const & a)
+    {
+        double res = 0.0;
+        for(int k = 0; k < a.size(); ++k)
+            res = std::max(res, (double)norm(a[k]));
+        return res;
+    }
+
+    template <unsigned int N, class T>
+    double maxNormDifference(MultiArrayView<N, T> const & a, MultiArrayView<N, T> const & b)
+    {
+        double res = 0.0;
+        for(int k = 0; k < a.size(); ++k)
+            res = std::max(res, (double)norm(a[k] - b[k]));
+        return res;
+    }
+
+    void test_recursiveGaussian()
+    {
+        typedef ConvolutionOptions<3> Options;
+
+        Size3 shape(40, 35, 30);
+        Image3D src(shape);
+        makeRandom(src);
+        gaussianSmoothMultiArray(src, src, 1.0);
+
+        Options fir, iir;
+        fir.stepSize(1.0, 1.0, 0.8);
+        iir.stepSize(1.0, 1.0, 0.8).filterMode(Options::RecursiveFilter);
+
+        double sigma = 4.0;
+        Image3D smoothFIR(shape), smoothIIR(shape);
+        gaussianSmoothMultiArray(src, smoothFIR, sigma, fir);
+        gaussianSmoothMultiArray(src, smoothIIR, sigma, iir);
+        should(maxNormDifference<3>(smoothFIR, smoothIIR) < 0.01*maxNorm<3>(smoothFIR));
+
+        Image3x3 gradientFIR(shape), gradientIIR(shape);
+        gaussianGradientMultiArray(src, gradientFIR, sigma, fir);
+        gaussianGradientMultiArray(src, gradientIIR, sigma, iir);
+        should(maxNormDifference<3>(gradientFIR, gradientIIR) < 0.02*maxNorm<3>(gradientFIR));
+
+        MultiArray<3, TinyVector<PixelType, 6> > hessianFIR(shape), hessianIIR(shape);
+        hessianOfGaussianMultiArray(src, hessianFIR, sigma, fir);
+        hessianOfGaussianMultiArray(src, hessianIIR, sigma, iir);
+        should(maxNormDifference<3>(hessianFIR, hessianIIR) < 0.02*maxNorm<3>(hessianFIR));
+
+        Image3D laplacianFIR(shape), laplacianIIR(shape);
+        laplacianOfGaussianMultiArray(src, laplacianFIR, sigma, fir);
+        laplacianOfGaussianMultiArray(src, laplacianIIR, sigma, iir);
+        should(maxNormDifference<3>(laplacianFIR, laplacianIIR) < 0.02*maxNorm<3>(laplacianFIR));
+
+        // in-place operation
+        Image3D inplace(src);
+        gaussianSmoothMultiArray(inplace, inplace, sigma, iir);
+        should(inplace == smoothIIR);
+
+        // the automatic mode uses the recursive filter only above the threshold
+        Options automatic(fir);
+        automatic.filterMode(Options::AutomaticFilter, 3.0);
+        Image3D smoothAuto(shape);
+        gaussianSmoothMultiArray(src, smoothAuto, 2.0, automatic);
+        gaussianSmoothMultiArray(src, smoothFIR, 2.0, fir);
+        should(smoothAuto == smoothFIR);
+        gaussianSmoothMultiArray(src, smoothAuto, sigma, automatic);
+        should(smoothAuto == smoothIIR);
+
+        // subarrays are always computed with sampled kernels
+        Size3 from(5, 6, 7), to(30, 25, 20);
+        Image3D subFIR(to - from), subIIR(to - from);
+        gaussianSmoothMultiArray(src, subFIR, sigma, Options(fir).subarray(from, to));
+        gaussianSmoothMultiArray(src, subIIR, sigma, Options(iir).subarray(from, to));
+        should(subFIR == subIIR);
+    }
+
+    void test_fixedPoint()
+    {
+        typedef FixedPoint16<1> FP;
+
+        Size3 shape(37, 23, 19);
+        MultiArray<3, UInt8> src(shape);
+        makeRandom(src);
+
+        ArrayVector<Kernel1D<double> > kernels(3);
+        kernels[0].initGaussian(1.5);
+        kernels[1].initGaussianDerivative(1.0, 1);
+        kernels[2].initGaussian(2.0);
+        kernels[2].setBorderTreatment(BORDER_TREATMENT_REPEAT);
+        ArrayVector<Kernel1D<FP> > fixedKernels(kernels.begin(), kernels.end());
+
+        // the kernel quantization errors of all passes add up (see convolveLine())
+        double quantization = 0.0;
+        for(int k = 0; k < 3; ++k)
+            quantization += 0.5 * kernels[k].size() / FP::ONE;
+
+        MultiArray<3, double> ref(shape);
+        MultiArray<3, Int16> res(shape);
+        separableConvolveMultiArray(src, ref, kernels.begin());
+        separableConvolveMultiArray(src, res, fixedKernels.begin());
+        double maxError = 0.0, meanError = 0.0;
+        for(int k = 0; k < res.size(); ++k)
+        {
+            double error = std::abs(ref[k] - res[k]);
+            maxError = std::max(maxError, error);
+            meanError += error / res.size();
+        }
+        should(maxError <= 0.5 + 255.0 * quantization);
+        should(meanError < 0.26);
+
+        // parallel and in-place operation give identical results
+        MultiArray<3, Int16> pres(shape);
+        separableConvolveMultiArray(src.traverser_begin(), shape, StandardConstValueAccessor<UInt8>(),
+                                    pres.traverser_begin(), StandardValueAccessor<Int16>(),
+                                    fixedKernels.begin(), Size3(), Size3(),
+                                    ParallelOptions().numThreads(4));
+        should(res == pres);
+
+        Kernel1D<FP> gauss(kernels[0]);
+        MultiArray<3, UInt8> smooth(shape), inplace(src);
+        separableConvolveMultiArray(src, smooth, gauss);
+        separableConvolveMultiArray(inplace, inplace, gauss);
+        should(smooth == inplace);
+
+        // 16-bit input
+        MultiArray<3, UInt16> src16(shape), res16(shape);
+        for(int k = 0; k < src.size(); ++k)
+            src16[k] = (UInt16)(src[k] * 257);
+        separableConvolveMultiArray(src16, ref, kernels[0]);
+        separableConvolveMultiArray(src16, res16, gauss);
+        maxError = 0.0;
+        for(int k = 0; k < res16.size(); ++k)
+            maxError = std::max(maxError, std::abs(ref[k] - res16[k]));
+        should(maxError <= 0.5 + 65535.0 * 1.5 * kernels[0].size() / FP::ONE);
+
+        // subarrays are computed with the equivalent floating-point kernels
+        Size3 start(3, 2, 1), stop(30, 20, 15);
+        MultiArray<3, Int16> sub(stop - start), realSub(stop - start);
+        ArrayVector<Kernel1D<double> > realKernels(fixedKernels.begin(), fixedKernels.end());
+        separableConvolveMultiArray(src, sub, fixedKernels.begin(), start, stop);
+        separableConvolveMultiArray(src, realSub, realKernels.begin(), start, stop);
+        should(sub == realSub);
+    }
+
     void test_Valid1() 
     {
         test_1DValidity( srcImage, kernelSize );
@@ -598,6 +1017,11 @@ struct MultiArraySeparableConvolutionTestSuite
                 add( testCase( &MultiArraySeparableConvolutionTest::test_hessian ) );
                 add( testCase( &MultiArraySeparableConvolutionTest::test_structureTensor ) );
                 add( testCase( &MultiArraySeparableConvolutionTest::test_gradient_magnitude ) );
+                add( testCase( &MultiArraySeparableConvolutionTest::test_borderTreatment ) );
+                add( testCase( &MultiArraySeparableConvolutionTest::test_parallel ) );
+                add( testCase( &MultiArraySeparableConvolutionTest::test_featureBank ) );
+                add( testCase( &MultiArraySeparableConvolutionTest::test_recursiveGaussian ) );
+                add( testCase( &MultiArraySeparableConvolutionTest::test_fixedPoint ) );
     }
 }; // struct MultiArraySeparableConvolutionTestSuite
 
@@ -0,0 +1,140 @@
+// -*- c++ -*-
+// $Id$
+
+#include "vigra/unittest.hxx"
+#include "vigra/multi_array.hxx"
+#include "vigra/multi_distance.hxx"
+#include "vigra/vector_distance.hxx"
+#include "vigra/navigator.hxx"
+#include "vigra/timing.hxx"
+#include "vigra/random.hxx"
+
+#include <iostream>
+
+using namespace vigra;
+
+namespace Impls
+{
+
+    // the line-by-line distance transform without panels and threads,
+    // as a reference for the timings
+template <unsigned int N, class T1, class S1, class T2, class S2>
+void
+distanceLineByLine(MultiArrayView<N, T1, S1> const & source,
+                   MultiArrayView<N, T2, S2> dest)
+{
+    typedef typename MultiArrayView<N, T2, S2>::traverser Traverser;
+    typedef MultiArrayNavigator<Traverser, N> Navigator;
+
+    double dmax = squaredNorm(source.shape());
+    for(int k = 0; k < source.size(); ++k)
+        dest[k] = source[k] == 0 ? dmax : 0.0;
+
+    ArrayVector<T2> tmp;
+    for(unsigned int d = 0; d < N; ++d)
+    {
+        tmp.resize(source.shape(d));
+        for(Navigator nav(dest.traverser_begin(), dest.shape(), d); nav.hasMore(); nav++)
+        {
+            std::copy(nav.begin(), nav.end(), tmp.begin());
+            detail::distParabola(srcIterRange(tmp.begin(), tmp.end(), StandardConstValueAccessor<T2>()),
+                                 destIter(nav.begin(), StandardValueAccessor<T2>()), 1.0);
+        }
+    }
+    for(int k = 0; k < dest.size(); ++k)
+        dest[k] = std::sqrt(dest[k]);
+}
+
+} // namespace Impls
+
+struct MultiDistanceSpeedTest
+{
+    typedef MultiArray<3, UInt8> Mask;
+    typedef MultiArray<3, float> Volume;
+
+    Mask mask;
+    MultiArray<3, UInt32> labels;
+
+    MultiDistanceSpeedTest()
+    : mask(Shape3(200, 200, 200)),
+      labels(mask.shape())
+    {
+        RandomMT19937 random;
+        for(int k = 0; k < 2000; ++k)
+            mask(random.uniformInt(mask.shape(0)), random.uniformInt(mask.shape(1)),
+                 random.uniformInt(mask.shape(2))) = 1;
+        for(int k = 0; k < labels.size(); ++k)
+            labels[k] = random.uniformInt(2) + (k % 40 < 20 ? 0 : 2);
+    }
+
+    void testScaling()
+    {
+        USETICTOC;
+        Volume reference(mask.shape()), res(mask.shape());
+
+        TIC;
+        Impls::distanceLineByLine(mask, reference);
+        std::cout << "Timed function: line-by-line reference " << TOCS << std::endl;
+
+        TIC;
+        separableMultiDistance(mask, res, true);
+        std::cout << "Timed function: separableMultiDistance, sequential " << TOCS << std::endl;
+        shouldEqualSequenceTolerance(res.begin(), res.end(), reference.begin(), 1e-5);
+
+        ParallelOptions options;
+        res.init(0.0f);
+        TIC;
+        separableMultiDistance(mask, res, true, options);
+        std::cout << "Timed function: separableMultiDistance, "
+                  << options.getActualNumThreads() << " thread(s) " << TOCS << std::endl;
+        shouldEqualSequenceTolerance(res.begin(), res.end(), reference.begin(), 1e-5);
+    }
+
+    void testBoundaryScaling()
+    {
+        USETICTOC;
+        Volume seq(labels.shape()), res(labels.shape());
+        boundaryMultiDistance(labels, seq);
+
+        ParallelOptions options;
+        TIC;
+        boundaryMultiDistance(labels, res, false, InterpixelBoundary, options);
+        std::cout << "Timed function: boundaryMultiDistance, "
+                  << options.getActualNumThreads() << " thread(s) " << TOCS << std::endl;
+        shouldEqualSequence(res.begin(), res.end(), seq.begin());
+    }
+
+    void testVectorScaling()
+    {
+        USETICTOC;
+        MultiArray<3, TinyVector<float, 3> > seq(mask.shape()), res(mask.shape());
+        separableVectorDistance(mask, seq, true);
+
+        ParallelOptions options;
+        TIC;
+        separableVectorDistance(mask, res, true, options);
+        std::cout << "Timed function: separableVectorDistance, "
+                  << options.getActualNumThreads() << " thread(s) " << TOCS << std::endl;
+        shouldEqualSequence(res.begin(), res.end(), seq.begin());
+    }
+};
+
+struct MultiDistanceSpeedTestSuite
+: public vigra::test_suite
+{
+    MultiDistanceSpeedTestSuite()
+    : vigra::test_suite("MultiDistanceSpeedTestSuite")
+    {
+        add( testCase( &MultiDistanceSpeedTest::testScaling ) );
+        add( testCase( &MultiDistanceSpeedTest::testBoundaryScaling ) );
+        add( testCase( &MultiDistanceSpeedTest::testVectorScaling ) );
+    }
+};
+
+int main()
+{
+  MultiDistanceSpeedTestSuite test;
+  int failed = test.run();
+  std::cout << test.report() << std::endl;
+  return (failed != 0);
+}
@@ -46,6 +46,7 @@
 #include <vigra/vector_distance.hxx>
 #include <vigra/skeleton.hxx>
 #include <vigra/timing.hxx>
+#include <vigra/random.hxx>
 
 
 #include "test_data.hxx"
@@ -644,6 +645,106 @@ struct BoundaryMultiDistanceTest
     }
 };
 
+struct ParallelDistanceTest
+{
+    typedef MultiArray<3, UInt8> MaskVolume;
+
+    MaskVolume mask;
+    MultiArray<3, UInt32> labels;
+
+    ParallelDistanceTest()
+    : mask(Shape3(23, 19, 17)),
+      labels(mask.shape())
+    {
+        RandomMT19937 random;
+        for(int k = 0; k < 12; ++k)
+            mask(random.uniformInt(mask.shape(0)), random.uniformInt(mask.shape(1)),
+                 random.uniformInt(mask.shape(2))) = 1;
+        // blocks of different labels with an irregular boundary
+        for(MultiCoordinateIterator<3> i(mask.shape()), end(i.getEndIterator()); i != end; ++i)
+            labels[*i] = ((*i)[0] + 2*(*i)[1] + 3*(*i)[2]) / 11
+                         + random.uniformInt(2);
+    }
+
+    template <class Array>
+    double bruteForceDistSquared(Shape3 const & p, Array const & pitch)
+    {
+        double res = NumericTraits<double>::max();
+        for(MultiCoordinateIterator<3> i(mask.shape()), end(i.getEndIterator()); i != end; ++i)
+            if(mask[*i] != 0)
+                res = std::min(res, squaredNorm(pitch*(*i - p)));
+        return res;
+    }
+
+    void testSeparableDistance()
+    {
+        ParallelOptions sequential = ParallelOptions().numThreads(ParallelOptions::NoThreads),
+                        parallel   = ParallelOptions().numThreads(4);
+        TinyVector<double, 3> pitch(1.0, 2.0, 1.5);
+
+        MultiArray<3, int> seqInt(mask.shape()), parInt(mask.shape());
+        separableMultiDistSquared(mask, seqInt, true);
+        separableMultiDistSquared(mask, parInt, true, parallel);
+        shouldEqualSequence(seqInt.begin(), seqInt.end(), parInt.begin());
+
+        MultiArray<3, double> seq(mask.shape()), par(mask.shape());
+        separableMultiDistSquared(mask, seq, true, pitch, sequential);
+        separableMultiDistSquared(mask, par, true, pitch, parallel);
+        shouldEqualSequence(seq.begin(), seq.end(), par.begin());
+        for(MultiCoordinateIterator<3> i(mask.shape()), end(i.getEndIterator()); i != end; ++i)
+        {
+            shouldEqual(seqInt[*i], bruteForceDistSquared(*i, TinyVector<double, 3>(1.0)));
+            shouldEqualTolerance(par[*i], bruteForceDistSquared(*i, pitch), 1e-10);
+        }
+
+        separableMultiDistance(mask, seq, false, pitch);
+        separableMultiDistance(mask, par, false, pitch, parallel);
+        shouldEqualSequence(seq.begin(), seq.end(), par.begin());
+
+        // a transposed view exercises the panels with non-unit innermost stride
+        MultiArray<3, double> parT(mask.shape());
+        separableMultiDistance(mask.transpose(), parT.transpose(), false,
+                               pitch.template subarray<0,3>(), parallel);
+        separableMultiDistance(mask.transpose(), seq.transpose(), false,
+                               pitch.template subarray<0,3>());
+        shouldEqualSequence(seq.begin(), seq.end(), parT.begin());
+    }
+
+    void testBoundaryDistance()
+    {
+        ParallelOptions parallel = ParallelOptions().numThreads(4);
+
+        MultiArray<3, double> seq(labels.shape()), par(labels.shape());
+        BoundaryDistanceTag tags[] = { OuterBoundary, InterpixelBoundary, InnerBoundary };
+        for(int k = 0; k < 3; ++k)
+        {
+            for(int active = 0; active < 2; ++active)
+            {
+                boundaryMultiDistance(labels, seq, active == 1, tags[k]);
+                boundaryMultiDistance(labels, par, active == 1, tags[k], parallel);
+                shouldEqualSequence(seq.begin(), seq.end(), par.begin());
+            }
+        }
+    }
+
+    void testVectorDistance()
+    {
+        ParallelOptions parallel = ParallelOptions().numThreads(4);
+        TinyVector<double, 3> pitch(1.0, 2.0, 1.5);
+
+        MultiArray<3, TinyVector<double, 3> > seq(mask.shape()), par(mask.shape());
+        separableVectorDistance(mask, seq, true, pitch);
+        separableVectorDistance(mask, par, true, pitch, parallel);
+        shouldEqualSequence(seq.begin(), seq.end(), par.begin());
+        for(MultiCoordinateIterator<3> i(mask.shape()), end(i.getEndIterator()); i != end; ++i)
+            shouldEqualTolerance(squaredNorm(pitch*par[*i]), bruteForceDistSquared(*i, pitch), 1e-10);
+
+        separableVectorDistance(mask, seq, false);
+        separableVectorDistance(mask, par, false, parallel);
+        shouldEqualSequence(seq.begin(), seq.end(), par.begin());
+    }
+};
+
 struct EccentricityTest
 {
     void testEccentricityCenters()
@@ -866,6 +967,9 @@ struct DistanceTransformTestSuite
         add( testCase( &BoundaryMultiDistanceTest::distanceTest1D));
         add( testCase( &BoundaryMultiDistanceTest::testDistanceVolumes));
         add( testCase( &BoundaryMultiDistanceTest::vectorDistanceTest1D));
+        add( testCase( &ParallelDistanceTest::testSeparableDistance));
+        add( testCase( &ParallelDistanceTest::testBoundaryDistance));
+        add( testCase( &ParallelDistanceTest::testVectorDistance));
         add( testCase( &EccentricityTest::testEccentricityCenters));
         add( testCase( &SkeletonTest::testSkeleton));
         add( testCase( &SkeletonTest::testSkeletonFeatures));
@@ -0,0 +1,79 @@
+// -*- c++ -*-
+// $Id$
+
+#include <iostream>
+#include "vigra/unittest.hxx"
+#include "vigra/multi_array.hxx"
+#include "vigra/multi_convolution.hxx"
+#include "vigra/slic.hxx"
+#include "vigra/timing.hxx"
+#include "vigra/random.hxx"
+
+using namespace vigra;
+
+struct SlicSpeedTest
+{
+    MultiArray<2, RGBValue<float> > image;
+    MultiArray<3, TinyVector<float, 3> > volume;
+
+    SlicSpeedTest()
+    : image(Shape2(1000, 1000)),
+      volume(Shape3(120, 120, 120))
+    {
+        RandomMT19937 random;
+        for(auto & v: image)
+            v = RGBValue<float>(100.0f*random.uniform(), 100.0f*random.uniform(), 100.0f*random.uniform());
+        gaussianSmoothMultiArray(image, image, 2.0);
+        for(auto & v: volume)
+            v = TinyVector<float, 3>(100.0f*random.uniform(), 100.0f*random.uniform(), 100.0f*random.uniform());
+        gaussianSmoothMultiArray(volume, volume, 2.0);
+    }
+
+    template <unsigned int N, class T>
+    void timeSlic(MultiArray<N, T> const & data, unsigned int seedDistance, const char * name)
+    {
+        USETICTOC;
+        MultiArray<N, UInt32> seq(data.shape()), res(data.shape());
+
+        TIC;
+        int seqMax = slicSuperpixels(data, seq, 2.0, seedDistance);
+        std::cout << "Timed function: slicSuperpixels " << name << ", sequential " << TOCS << std::endl;
+
+        ParallelOptions options;
+        TIC;
+        int resMax = slicSuperpixels(data, res, 2.0, seedDistance, SlicOptions(), options);
+        std::cout << "Timed function: slicSuperpixels " << name << ", "
+                  << options.getActualNumThreads() << " thread(s) " << TOCS << std::endl;
+        shouldEqual(resMax, seqMax);
+        should(res == seq);
+    }
+
+    void testSlic2D()
+    {
+        timeSlic(image, 10, "2D RGB");
+    }
+
+    void testSlic3D()
+    {
+        timeSlic(volume, 8, "3D vector");
+    }
+};
+
+struct SlicSpeedTestSuite
+: public vigra::test_suite
+{
+    SlicSpeedTestSuite()
+    : vigra::test_suite("SlicSpeedTestSuite")
+    {
+        add( testCase( &SlicSpeedTest::testSlic2D ) );
+        add( testCase( &SlicSpeedTest::testSlic3D ) );
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    SlicSpeedTestSuite test;
+    int failed = test.run(testsToBeExecuted(argc, argv));
+    std::cout << test.report() << std::endl;
+    return (failed != 0);
+}
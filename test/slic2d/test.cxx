@@ -35,6 +35,7 @@
 
 #include <iostream>
 #include <functional>
+#include <algorithm>
 #include <cmath>
 #include <stdlib.h>
 #include <time.h>
@@ -120,6 +121,78 @@ struct SlicTest
 
         should(labels == labels_ref);
     }
+
+    void test_slic_parallel()
+    {
+        IArray labels_ref(lennaImage.shape());
+        importImage(ImageImportInfo("slic.xv"), destImage(labels_ref));
+
+        MultiArray<N, TinyVector<float, 3> > vectorImage(lennaImage.shape());
+        FArray scalarImage(lennaImage.shape());
+        for(int k = 0; k < lennaImage.size(); ++k)
+        {
+            vectorImage[k] = lennaImage[k];
+            scalarImage[k] = lennaImage[k][0];
+        }
+
+        IArray scalarLabels_ref(lennaImage.shape()), transposedLabels_ref(lennaImage.transpose().shape());
+        int scalarMaxlabel = slicSuperpixels(scalarImage, scalarLabels_ref, 20.0, 8, SlicOptions().iterations(10));
+        int transposedMaxlabel = slicSuperpixels(lennaImage.transpose(), transposedLabels_ref, 20.0, 8,
+                                                 SlicOptions().iterations(10));
+
+        int threads[] = { 1, 2, 4 };
+        for(int k = 0; k < 3; ++k)
+        {
+            ParallelOptions parallel = ParallelOptions().numThreads(threads[k]);
+
+            IArray labels(lennaImage.shape());
+            int maxlabel = slicSuperpixels(lennaImage, labels, 20.0, 8, SlicOptions().minSize(0).iterations(40), parallel);
+            shouldEqual(maxlabel, 245);
+            should(labels == labels_ref);
+
+            // dedicated kernel for TinyVector<float, 3>
+            labels.init(0);
+            maxlabel = slicSuperpixels(vectorImage, labels, 20.0, 8, SlicOptions().minSize(0).iterations(40), parallel);
+            shouldEqual(maxlabel, 245);
+            should(labels == labels_ref);
+
+            // generic kernel
+            labels.init(0);
+            maxlabel = slicSuperpixels(scalarImage, labels, 20.0, 8, SlicOptions().iterations(10), parallel);
+            shouldEqual(maxlabel, scalarMaxlabel);
+            should(labels == scalarLabels_ref);
+
+            // strided data
+            IArray transposedLabels(lennaImage.transpose().shape());
+            maxlabel = slicSuperpixels(lennaImage.transpose(), transposedLabels, 20.0, 8,
+                                       SlicOptions().iterations(10), parallel);
+            shouldEqual(maxlabel, transposedMaxlabel);
+            should(transposedLabels == transposedLabels_ref);
+        }
+    }
+
+    void test_slic3d()
+    {
+        MultiArray<3, TinyVector<float, 3> > volume(Shape3(40, 35, 30));
+        for(int k = 0; k < volume.size(); ++k)
+            volume[k] = TinyVector<float, 3>(100.0f*(std::rand() % 100), 100.0f*(std::rand() % 100), 100.0f*(std::rand() % 100));
+        gaussianSmoothMultiArray(volume, volume, 2.0);
+
+        MultiArray<3, unsigned int> labels_ref(volume.shape()), labels(volume.shape());
+        int maxlabel_ref = slicSuperpixels(volume, labels_ref, 20.0, 6, SlicOptions().iterations(10));
+        should(maxlabel_ref > 1);
+        shouldEqual(maxlabel_ref, (int)*std::max_element(labels_ref.begin(), labels_ref.end()));
+
+        int threads[] = { 1, 2, 4 };
+        for(int k = 0; k < 3; ++k)
+        {
+            labels.init(0);
+            int maxlabel = slicSuperpixels(volume, labels, 20.0, 6, SlicOptions().iterations(10),
+                                           ParallelOptions().numThreads(threads[k]));
+            shouldEqual(maxlabel, maxlabel_ref);
+            should(labels == labels_ref);
+        }
+    }
 };
 
 
@@ -131,6 +204,8 @@ struct Slic2dTestSuite
     {
         add( testCase( &SlicTest<2>::test_seeding));
         add( testCase( &SlicTest<2>::test_slic));
+        add( testCase( &SlicTest<2>::test_slic_parallel));
+        add( testCase( &SlicTest<2>::test_slic3d));
     }
 };
 
@@ -0,0 +1,257 @@
+/************************************************************************/
+/*                                                                      */
+/*        Copyright 2014-2015 by Ullrich Koethe and Philip Schill       */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#include <vigra/unittest.hxx>
+#include <vigra/threading.hxx>
+#include <vigra/threadpool.hxx>
+#include <vigra/timing.hxx>
+#include <queue>
+#include <iomanip>
+
+using namespace vigra;
+
+namespace Impls
+{
+
+// The previous ThreadPool implementation (a single task queue guarded by
+// one mutex), kept here as a baseline for the work-stealing scheduler.
+class SingleQueuePool
+{
+  public:
+    SingleQueuePool(int n)
+    : stop(false), busy(0)
+    {
+        for(int ti = 0; ti < n; ++ti)
+        {
+            workers.emplace_back(
+                [ti, this]
+                {
+                    for(;;)
+                    {
+                        std::function<void(int)> task;
+                        threading::unique_lock<threading::mutex> lock(queue_mutex);
+                        worker_condition.wait(lock, [this]{ return stop || !tasks.empty(); });
+                        if(tasks.empty())
+                            return;
+                        ++busy;
+                        task = std::move(tasks.front());
+                        tasks.pop();
+                        lock.unlock();
+                        task(ti);
+                        lock.lock();
+                        --busy;
+                        finish_condition.notify_one();
+                    }
+                });
+        }
+    }
+
+    ~SingleQueuePool()
+    {
+        {
+            threading::unique_lock<threading::mutex> lock(queue_mutex);
+            stop = true;
+        }
+        worker_condition.notify_all();
+        for(auto & w: workers)
+            w.join();
+    }
+
+    template <class F>
+    threading::future<void> enqueue(F && f)
+    {
+        auto task = std::make_shared<threading::packaged_task<void(int)> >(f);
+        auto res = task->get_future();
+        {
+            threading::unique_lock<threading::mutex> lock(queue_mutex);
+            tasks.emplace(
+                [task](int tid)
+                {
+                    (*task)(std::move(tid));
+                });
+        }
+        worker_condition.notify_one();
+        return res;
+    }
+
+    void waitFinished()
+    {
+        threading::unique_lock<threading::mutex> lock(queue_mutex);
+        finish_condition.wait(lock, [this](){ return tasks.empty() && busy == 0; });
+    }
+
+  private:
+    std::vector<threading::thread> workers;
+    std::queue<std::function<void(int)> > tasks;
+    threading::mutex queue_mutex;
+    threading::condition_variable worker_condition, finish_condition;
+    bool stop;
+    int busy;
+};
+
+} // namespace Impls
+
+struct ThreadPoolSpeedTest
+{
+    static const int nTasks = 200000;
+    static const int nSpawners = 64;
+
+    std::vector<int> threadCounts() const
+    {
+        std::vector<int> res;
+        int maxThreads = std::max<int>(4, threading::thread::hardware_concurrency());
+        for(int n = 1; n < maxThreads; n *= 2)
+            res.push_back(n);
+        res.push_back(maxThreads);
+        return res;
+    }
+
+    template <class POOL>
+    double externalSubmission(POOL & pool, std::vector<long> & work)
+    {
+        USETICTOC;
+        TIC;
+        for(int i = 0; i < nTasks; ++i)
+        {
+            pool.enqueue(
+                [&work](int thread_id)
+                {
+                    ++work[thread_id*16];
+                });
+        }
+        pool.waitFinished();
+        return nTasks / TOCN;
+    }
+
+    template <class POOL>
+    double nestedSubmission(POOL & pool, std::vector<long> & work)
+    {
+        USETICTOC;
+        TIC;
+        for(int i = 0; i < nSpawners; ++i)
+        {
+            pool.enqueue(
+                [&pool, &work](int)
+                {
+                    for(int k = 0; k < nTasks / nSpawners; ++k)
+                        pool.enqueue(
+                            [&work](int thread_id)
+                            {
+                                ++work[thread_id*16];
+                            });
+                });
+        }
+        pool.waitFinished();
+        return nTasks / TOCN;
+    }
+
+    void testTaskThroughput()
+    {
+        std::cout << "task throughput (tasks per msec):\n"
+                  << "  threads   single queue (external / nested)   work stealing (external / nested)\n";
+        for(int n: threadCounts())
+        {
+            std::vector<long> work(16*n, 0);
+            double se, sn, we, wn;
+            {
+                Impls::SingleQueuePool pool(n);
+                se = externalSubmission(pool, work);
+                sn = nestedSubmission(pool, work);
+            }
+            {
+                ThreadPool pool(n);
+                we = externalSubmission(pool, work);
+                wn = nestedSubmission(pool, work);
+            }
+            std::cout << std::setw(9) << n
+                      << std::setw(20) << std::fixed << std::setprecision(0) << se
+                      << std::setw(10) << sn
+                      << std::setw(25) << we
+                      << std::setw(10) << wn << "\n";
+
+            long total = 0;
+            for(long w: work)
+                total += w;
+            shouldEqual(total, 4L*nTasks);
+        }
+    }
+
+    void testParallelForeach()
+    {
+        // many small work items, as in blockwise processing with small blocks
+        int const nItems = 1000000;
+        std::cout << "parallel_foreach over " << nItems << " items:\n";
+        for(int n: threadCounts())
+        {
+            std::vector<long> work(16*n, 0);
+            ThreadPool pool(n);
+            USETICTOC;
+            TIC;
+            parallel_foreach(pool, nItems,
+                [&work](int thread_id, int)
+                {
+                    ++work[thread_id*16];
+                });
+            std::cout << std::setw(9) << n << " threads: " << TOCS << "\n";
+
+            long total = 0;
+            for(long w: work)
+                total += w;
+            shouldEqual(total, (long)nItems);
+        }
+    }
+};
+
+struct ThreadPoolSpeedTestSuite : public test_suite
+{
+    ThreadPoolSpeedTestSuite()
+        :
+        test_suite("ThreadPool speed test")
+    {
+#if !defined(USE_BOOST_THREAD) || \
+    defined(BOOST_THREAD_PROVIDES_VARIADIC_THREAD)
+        add(testCase(&ThreadPoolSpeedTest::testTaskThroughput));
+        add(testCase(&ThreadPoolSpeedTest::testParallelForeach));
+#endif
+    }
+};
+
+int main(int argc, char** argv)
+{
+    ThreadPoolSpeedTestSuite threadpool_test;
+    int failed = threadpool_test.run(testsToBeExecuted(argc, argv));
+    std::cout << threadpool_test.report() << std::endl;
+    return (failed != 0);
+}
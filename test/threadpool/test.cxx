@@ -37,7 +37,9 @@
 #include <vigra/threading.hxx>
 #include <vigra/threadpool.hxx>
 #include <vigra/timing.hxx>
+#include <vigra/tinyvector.hxx>
 #include <numeric>
+#include <algorithm>
 
 using namespace vigra;
 
@@ -103,6 +105,171 @@ struct ThreadPoolTests
         should(caught);
     }
 
+    void test_threadpool_nested_enqueue()
+    {
+        // tasks enqueued from inside a worker go to that worker's own deque,
+        // idle workers must steal them from there
+        size_t const n = 100, m = 1000;
+        threading::atomic_long count(0);
+        ThreadPool pool(4);
+        for (size_t i = 0; i < n; ++i)
+        {
+            pool.enqueue(
+                [&pool, &count, m](size_t /*thread_id*/)
+                {
+                    for (size_t k = 0; k < m; ++k)
+                        pool.enqueue(
+                            [&count](size_t /*thread_id*/)
+                            {
+                                ++count;
+                            }
+                        );
+                }
+            );
+        }
+        pool.waitFinished();
+        shouldEqual(count.load(), (long)(n*m));
+    }
+
+    void test_threadpool_wait_in_task()
+    {
+        // waitFinished() from inside a task must not wait for itself
+        threading::atomic_long count(0);
+        ThreadPool pool(2);
+        for (size_t i = 0; i < 4; ++i)
+        {
+            pool.enqueue(
+                [&pool, &count](size_t /*thread_id*/)
+                {
+                    for (size_t k = 0; k < 100; ++k)
+                        pool.enqueue(
+                            [&count](size_t /*thread_id*/)
+                            {
+                                ++count;
+                            }
+                        );
+                    pool.waitFinished();
+                }
+            );
+        }
+        pool.waitFinished();
+        shouldEqual(count.load(), 400L);
+    }
+
+    void test_threadpool_wait_for_subtasks()
+    {
+        // a task that enqueues a subtask as its last action must not let
+        // waitFinished() return before the subtask has run
+        ThreadPool pool(2);
+        for (int round = 0; round < 2000; ++round)
+        {
+            threading::atomic_long count(0);
+            pool.enqueue(
+                [&pool, &count](size_t /*thread_id*/)
+                {
+                    pool.enqueue(
+                        [&count](size_t /*thread_id*/)
+                        {
+                            ++count;
+                        }
+                    );
+                }
+            );
+            pool.waitFinished();
+            shouldEqual(count.load(), 1L);
+        }
+    }
+
+    static long recursiveSum(ThreadPool & pool, std::vector<long> const & v, size_t begin, size_t end)
+    {
+        if (end - begin < 100)
+            return std::accumulate(v.begin()+begin, v.begin()+end, 0L);
+
+        size_t middle = (begin + end) / 2;
+        long left = 0;
+        TaskGroup group(pool);
+        group.run(
+            [&](size_t /*thread_id*/)
+            {
+                left = recursiveSum(pool, v, begin, middle);
+            }
+        );
+        long right = recursiveSum(pool, v, middle, end);
+        group.wait();
+        return left + right;
+    }
+
+    void test_task_group()
+    {
+        size_t const n = 100000;
+        std::vector<long> v(n);
+        std::iota(v.begin(), v.end(), 0);
+        {
+            ThreadPool pool(4);
+            shouldEqual(recursiveSum(pool, v, 0, n), (long)(n*(n-1)/2));
+        }
+        {
+            ThreadPool pool(ParallelOptions::NoThreads);
+            shouldEqual(recursiveSum(pool, v, 0, n), (long)(n*(n-1)/2));
+        }
+    }
+
+    void test_task_group_exception()
+    {
+        ThreadPool pool(4);
+        std::string exception_string = "the test exception";
+        std::vector<int> v(1000, 0);
+        bool caught = false;
+        TaskGroup group(pool);
+        for (size_t i = 0; i < v.size(); ++i)
+        {
+            group.run(
+                [&v, &exception_string, i](size_t /*thread_id*/)
+                {
+                    if (i % 100 == 5)
+                        throw std::runtime_error(exception_string);
+                    v[i] = 1;
+                }
+            );
+        }
+        try
+        {
+            group.wait();
+        }
+        catch (std::runtime_error & ex)
+        {
+            if (ex.what() == exception_string)
+                caught = true;
+        }
+        should(caught);
+        // all other tasks must have finished when wait() throws
+        shouldEqual(std::accumulate(v.begin(), v.end(), 0), 990);
+    }
+
+    void test_parallel_foreach_nested()
+    {
+        // with blocking waits, all workers would wait for inner tasks
+        // that no one executes
+        size_t const n = 50, m = 200;
+        std::vector<int> v_out(n*m, 0);
+        ThreadPool pool(4);
+        parallel_foreach(pool, n,
+            [&pool, &v_out, m](size_t /*thread_id*/, size_t i)
+            {
+                parallel_foreach(pool, m,
+                    [&v_out, i, m](size_t /*thread_id*/, size_t k)
+                    {
+                        v_out[i*m+k] = i*m+k;
+                    }
+                );
+            }
+        );
+
+        std::vector<int> v_expected(n*m);
+        std::iota(v_expected.begin(), v_expected.end(), 0);
+        shouldEqualSequence(v_out.begin(), v_out.end(), v_expected.begin());
+    }
+
     void test_parallel_foreach()
     {
         size_t const n = 10000;
@@ -209,6 +376,133 @@ struct ThreadPoolTests
         shouldEqual(sum, (n*(n-1))/2);
     }
 
+    void test_global_pool()
+    {
+        ThreadPool & pool = ThreadPool::global();
+        should(&pool == &ThreadPool::global());
+        shouldEqual((int)pool.nThreads(), ThreadPool::globalConcurrency());
+
+        // thread indices must be smaller than the requested number of threads,
+        // even though the global pool may have more workers
+        size_t const n_threads = 2;
+        size_t const n = 10000;
+        std::vector<size_t> results(n_threads, 0);
+        threading::atomic_long bad_ids(0);
+        parallel_foreach(n_threads, n,
+            [&results, &bad_ids](size_t thread_id, size_t x)
+            {
+                if (thread_id >= n_threads)
+                    ++bad_ids;
+                else
+                    results[thread_id] += x;
+            }
+        );
+        shouldEqual(bad_ids.load(), 0L);
+        shouldEqual(std::accumulate(results.begin(), results.end(), (size_t)0), (n*(n-1))/2);
+
+        // the global pool can only be configured before its first use
+        try
+        {
+            ThreadPool::setGlobalConcurrency(2);
+            failTest("no exception thrown");
+        }
+        catch (PreconditionViolation &)
+        {}
+    }
+
+    void test_parallel_options_pool()
+    {
+        ThreadPool pool(3);
+        ParallelOptions options;
+        options.pool(pool);
+        should(options.getPool() == &pool);
+        shouldEqual(options.getNumThreads(), 3);
+
+        size_t const n = 2000;
+        std::vector<size_t> results(options.getNumThreads(), 0);
+        parallel_foreach(options, n,
+            [&results](size_t thread_id, size_t x)
+            {
+                results[thread_id] += x;
+            }
+        );
+        shouldEqual(std::accumulate(results.begin(), results.end(), (size_t)0), (n*(n-1))/2);
+
+        options.numThreads(2);
+        should(options.getPool() == 0);
+        shouldEqual(options.getNumThreads(), 2);
+    }
+
+    void test_parallel_foreach_slab()
+    {
+        // the slabs partition the range, and their bounds are multiples of the granularity
+        ParallelOptions options = ParallelOptions().numThreads(3);
+        for(std::ptrdiff_t extent = 0; extent < 100; extent += 7)
+        {
+            for(std::ptrdiff_t granularity = 1; granularity <= 16; granularity *= 4)
+            {
+                std::ptrdiff_t nSlabs = parallel_slab_count(options, extent, granularity);
+                should(nSlabs >= 1 && nSlabs <= 12);
+                should(nSlabs == 1 || nSlabs <= extent / granularity);
+                for(std::ptrdiff_t k = 0; k < nSlabs; ++k)
+                {
+                    shouldEqual(parallel_slab_bound(k, nSlabs, extent, granularity) % granularity, 0);
+                    should(parallel_slab_bound(k, nSlabs, extent, granularity) <
+                           parallel_slab_bound(k+1, nSlabs, extent, granularity) || extent == 0);
+                }
+
+                std::vector<int> covered(extent, 0), calls(nSlabs, 0);
+                std::vector<std::ptrdiff_t> begins(nSlabs, -1);
+                parallel_foreach_slab(options, extent,
+                    [&](size_t, std::ptrdiff_t k, std::ptrdiff_t begin, std::ptrdiff_t end)
+                    {
+                        ++calls[k];
+                        begins[k] = begin;
+                        for(std::ptrdiff_t i = begin; i < end; ++i)
+                            ++covered[i];
+                    },
+                    granularity);
+                shouldEqual(std::count(calls.begin(), calls.end(), 1), nSlabs);
+                shouldEqual(std::count(covered.begin(), covered.end(), 1), extent);
+                for(std::ptrdiff_t k = 0; k < nSlabs; ++k)
+                    shouldEqual(begins[k], parallel_slab_bound(k, nSlabs, extent, granularity));
+            }
+        }
+
+        // lines along axis 2 are cut along axis 0, since axis 1 is a singleton,
+        // and the bounds along axis 0 are aligned to the default granularity
+        typedef TinyVector<std::ptrdiff_t, 3> Shape;
+        Shape shape(70, 1, 5);
+        std::vector<int> covered(shape[0], 0);
+        threading::atomic_long slabs(0);
+        parallel_foreach_lines(options, shape, 2,
+            [&](size_t, Shape const & start, Shape const & stop)
+            {
+                ++slabs;
+                shouldEqual(start[0] % 16, 0);
+                shouldEqual(start[1], 0);
+                shouldEqual(start[2], 0);
+                shouldEqual(stop[1], 1);
+                shouldEqual(stop[2], 5);
+                for(std::ptrdiff_t i = start[0]; i < stop[0]; ++i)
+                    ++covered[i];
+            });
+        shouldEqual(slabs.load(), 4L);
+        shouldEqual(std::count(covered.begin(), covered.end(), 1), shape[0]);
+
+        // without another axis to cut, the lines are processed as a whole
+        slabs = 0;
+        parallel_foreach_lines(options, Shape(1, 1, 40), 2,
+            [&](size_t thread_id, Shape const & start, Shape const & stop)
+            {
+                ++slabs;
+                shouldEqual(thread_id, 0u);
+                shouldEqual(start, Shape());
+                shouldEqual(stop, Shape(1, 1, 40));
+            });
+        shouldEqual(slabs.load(), 1L);
+    }
+
     void test_parallel_foreach_timing()
     {
         size_t const n_threads = 4;
@@ -241,6 +535,11 @@ struct ThreadPoolTestSuite : public test_suite
     {
         add(testCase(&ThreadPoolTests::test_threadpool));
         add(testCase(&ThreadPoolTests::test_threadpool_exception));
+        add(testCase(&ThreadPoolTests::test_threadpool_nested_enqueue));
+        add(testCase(&ThreadPoolTests::test_threadpool_wait_in_task));
+        add(testCase(&ThreadPoolTests::test_threadpool_wait_for_subtasks));
+        add(testCase(&ThreadPoolTests::test_task_group));
+        add(testCase(&ThreadPoolTests::test_task_group_exception));
         add(testCase(&ThreadPoolTests::test_parallel_foreach));
         add(testCase(&ThreadPoolTests::test_parallel_foreach_exception));
         add(testCase(&ThreadPoolTests::test_parallel_foreach_sum_serial));
@@ -248,6 +547,10 @@ struct ThreadPoolTestSuite : public test_suite
     defined(BOOST_THREAD_PROVIDES_VARIADIC_THREAD)
         add(testCase(&ThreadPoolTests::test_parallel_foreach_sum));
         add(testCase(&ThreadPoolTests::test_parallel_foreach_sum_auto));
+        add(testCase(&ThreadPoolTests::test_parallel_foreach_nested));
+        add(testCase(&ThreadPoolTests::test_global_pool));
+        add(testCase(&ThreadPoolTests::test_parallel_options_pool));
+        add(testCase(&ThreadPoolTests::test_parallel_foreach_slab));
         add(testCase(&ThreadPoolTests::test_parallel_foreach_timing));
 #endif
     }
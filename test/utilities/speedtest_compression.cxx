@@ -0,0 +1,157 @@
+/************************************************************************/
+/*                                                                      */
+/*                 Copyright 2015 by Ullrich Koethe                     */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#include <vigra/unittest.hxx>
+#include <vigra/compression.hxx>
+#include <vigra/multi_array.hxx>
+#include <vigra/multi_convolution.hxx>
+#include <vigra/random.hxx>
+#include <vigra/timing.hxx>
+#include <iomanip>
+
+using namespace vigra;
+
+struct CompressionSpeedTest
+{
+    typedef MultiArrayShape<3>::type Shape;
+
+    Shape shape;
+    MultiArray<3, UInt16> microscopy;
+    MultiArray<3, UInt32> labels;
+    MultiArray<3, float>  smooth;
+
+    CompressionSpeedTest()
+    : shape(128, 128, 64)
+    , microscopy(shape)
+    , labels(shape)
+    , smooth(shape)
+    {
+        // blurred random structures plus shot noise, as in fluorescence microscopy
+        RandomMT19937 random(42);
+        MultiArray<3, float> tmp(shape);
+        for(int k=0; k<2000; ++k)
+            tmp[Shape(random.uniformInt(shape[0]), random.uniformInt(shape[1]),
+                      random.uniformInt(shape[2]))] = 20000.0f;
+        gaussianSmoothMultiArray(tmp, smooth, 2.0);
+        for(int k=0; k<microscopy.size(); ++k)
+            microscopy[k] = UInt16(std::min(100.0 + 3.0*smooth[k] + 10.0*random.normal(), 65535.0));
+
+        // piecewise constant regions, as in segmentations
+        for(int k=0; k<labels.size(); ++k)
+        {
+            Shape p(labels.scanOrderIndexToCoordinate(k));
+            labels[k] = 1 + p[0] / 16 + 8*(p[1] / 16) + 64*(p[2] / 16);
+        }
+    }
+
+    template <class T>
+    void measure(MultiArrayView<3, T> const & data, std::string const & name)
+    {
+        CompressionMethod methods[] = {
+            LZ4, LZ4_SHUFFLE, LZ4_BITSHUFFLE,
+            ZLIB_FAST, ZLIB_FAST | SHUFFLE, ZLIB_BEST,
+        #ifdef HasZSTD
+            ZSTD_FAST, ZSTD, ZSTD_SHUFFLE, ZSTD | BITSHUFFLE, ZSTD_BEST,
+        #endif
+        };
+        std::size_t size = data.size()*sizeof(T);
+        char const * source = (char const *)data.data();
+        int const repetitions = 3;
+
+        std::cout << name << " (" << size / 1024 << " kB):\n"
+                  << "    method                ratio    compress MB/s   uncompress MB/s\n";
+        for(std::size_t m=0; m<sizeof(methods)/sizeof(CompressionMethod); ++m)
+        {
+        #ifndef HasZLIB
+            if(compressionCodecMethod(methods[m]) <= ZLIB_BEST)
+                continue;
+        #endif
+            ArrayVector<char> compressed, decompressed(size);
+            USETICTOC;
+            TIC;
+            for(int k=0; k<repetitions; ++k)
+                compress(source, size, compressed, methods[m], sizeof(T));
+            double compress_time = TOCN;
+            TIC;
+            for(int k=0; k<repetitions; ++k)
+                uncompress(compressed.data(), compressed.size(), decompressed.data(), size,
+                           methods[m], sizeof(T));
+            double uncompress_time = TOCN;
+            shouldEqualSequence(source, source+size, decompressed.begin());
+
+            double mb = repetitions*size / 1048576.0;
+            std::cout << "    " << std::left << std::setw(20) << compressionMethodName(methods[m])
+                      << std::right << std::fixed
+                      << std::setw(6) << std::setprecision(1) << 100.0*compressed.size() / size << "%"
+                      << std::setw(16) << std::setprecision(0) << mb / compress_time * 1000.0
+                      << std::setw(18) << mb / uncompress_time * 1000.0 << "\n";
+        }
+    }
+
+    void testMicroscopy()
+    {
+        measure(microscopy, "16-bit microscopy volume");
+    }
+
+    void testLabels()
+    {
+        measure(labels, "32-bit label volume");
+    }
+
+    void testFloat()
+    {
+        measure(smooth, "smooth float volume");
+    }
+};
+
+struct CompressionSpeedTestSuite : public test_suite
+{
+    CompressionSpeedTestSuite()
+        :
+        test_suite("Compression speed test")
+    {
+        add(testCase(&CompressionSpeedTest::testMicroscopy));
+        add(testCase(&CompressionSpeedTest::testLabels));
+        add(testCase(&CompressionSpeedTest::testFloat));
+    }
+};
+
+int main(int argc, char** argv)
+{
+    CompressionSpeedTestSuite test;
+    int failed = test.run(testsToBeExecuted(argc, argv));
+    std::cout << test.report() << std::endl;
+    return (failed != 0);
+}
@@ -37,6 +37,7 @@
 #include <iostream>
 #include <iterator>
 #include <algorithm>
+#include <limits>
 #include <queue>
 #include <set>
 
@@ -47,6 +48,7 @@
 #include "vigra/sized_int.hxx"
 
 #include "vigra/priority_queue.hxx"
+#include "vigra/random.hxx"
 #include "vigra/algorithm.hxx"
 #include "vigra/compression.hxx"
 #include "vigra/multi_blocking.hxx"
@@ -403,6 +405,116 @@ struct BucketQueueTest
         shouldEqual(0u, bqueue.size());
         shouldEqual(true, bqueue.empty());
     }
+
+    template <class T>
+    void checkRadix(T low, T step, int n)
+    {
+        // compare with a sorted set, where the insertion counter
+        // ensures FIFO order among equal priorities
+        typedef std::set<std::pair<T, int> > Reference;
+
+        RandomMT19937 random(17);
+        RadixPriorityQueue<int, T> queue;
+        Reference reference;
+        int count = 0;
+
+        // initial elements in arbitrary order
+        for(int k = 0; k < 50; ++k, ++count)
+        {
+            T priority = T(low + random.uniformInt(n) * step);
+            queue.push(count, priority);
+            reference.insert(std::make_pair(priority, count));
+        }
+        shouldEqual(queue.size(), 50u);
+
+        T lastTop = low;
+        for(int k = 0; k < 5000; ++k)
+        {
+            if(random.uniformInt(2) == 0 && !queue.empty())
+            {
+                shouldEqual(queue.top(), reference.begin()->second);
+                shouldEqual(queue.topPriority(), reference.begin()->first);
+                lastTop = queue.topPriority();
+                queue.pop();
+                reference.erase(reference.begin());
+                if(queue.empty())
+                    lastTop = low;
+            }
+            else
+            {
+                // priorities must not decrease below the last top element
+                T priority = std::max(lastTop, T(low + random.uniformInt(n) * step));
+                queue.push(count, priority);
+                reference.insert(std::make_pair(priority, count++));
+            }
+            shouldEqual(queue.size(), reference.size());
+        }
+
+        for(; !queue.empty(); queue.pop(), reference.erase(reference.begin()))
+        {
+            shouldEqual(queue.top(), reference.begin()->second);
+            shouldEqual(queue.topPriority(), reference.begin()->first);
+        }
+        should(reference.empty());
+    }
+
+    void testRadix()
+    {
+        checkRadix<float>(-4.0f, 0.125f, 64);
+        checkRadix<double>(-1.0e6, 1.0e4, 200);
+        checkRadix<int>(-50, 1, 100);
+        checkRadix<signed char>(-60, 1, 120);
+        checkRadix<UInt16>(0, 500, 130);
+        checkRadix<Int64>(-((Int64)1 << 40), (Int64)1 << 34, 128);
+
+        // both zeros are equal and keep their FIFO order, NaNs come last
+        RadixPriorityQueue<int, float> zqueue;
+        zqueue.push(0, 0.0f);
+        zqueue.push(1, -0.0f);
+        zqueue.push(2, std::numeric_limits<float>::quiet_NaN());
+        zqueue.push(3, -std::numeric_limits<float>::quiet_NaN());
+        zqueue.push(4, std::numeric_limits<float>::infinity());
+        zqueue.push(5, -1.0f);
+        shouldEqual(zqueue.top(), 5);
+        zqueue.pop();
+        shouldEqual(zqueue.top(), 0);
+        zqueue.pop();
+        zqueue.push(6, -0.0f);
+        shouldEqual(zqueue.top(), 1);
+        zqueue.pop();
+        zqueue.push(7, 0.0f);
+        int order[] = { 6, 7, 4, 2, 3 };
+        for(int k = 0; k < 5; ++k, zqueue.pop())
+            shouldEqual(zqueue.top(), order[k]);
+        should(zqueue.empty());
+
+        RadixPriorityQueue<int, double> dqueue;
+        dqueue.push(0, -0.0);
+        dqueue.push(1, 0.0);
+        shouldEqual(dqueue.top(), 0);
+        dqueue.pop();
+        dqueue.push(2, -0.0);
+        shouldEqual(dqueue.top(), 1);
+        dqueue.pop();
+        shouldEqual(dqueue.top(), 2);
+
+        // same order as BucketQueue
+        RadixPriorityQueue<double, int> rqueue;
+        BucketQueue<double, true> bqueue;
+        for(unsigned int k=0; k<data.size(); ++k)
+        {
+            rqueue.push(data[k], idata[k]);
+            bqueue.push(data[k], idata[k]);
+        }
+        for(unsigned int k=0; k<data.size(); ++k)
+        {
+            shouldEqual(rqueue.top(), bqueue.top());
+            shouldEqual(rqueue.topPriority(), bqueue.topPriority());
+            rqueue.pop();
+            bqueue.pop();
+        }
+        should(rqueue.empty());
+    }
 };
 
 
@@ -1279,6 +1391,167 @@ struct CompressionTest
 
         shouldEqualSequence(data.begin(), data.end(), decompressed.begin());
     }
+
+    void testFilters()
+    {
+        // smooth 16-bit data with a little noise, as in microscopy images
+        ArrayVector<UInt16> image(100001);
+        for(std::size_t k=0; k<image.size(); ++k)
+            image[k] = UInt16(1000 + (k / 97) % 300 + ((k * 2654435761u) >> 29));
+        char const * source = (char const *)image.data();
+        // an odd number of bytes tests the handling of incomplete elements
+        std::size_t size = image.size()*sizeof(UInt16) - 1;
+
+        CompressionMethod methods[] = { LZ4 | SHUFFLE, LZ4 | BITSHUFFLE,
+                                        ZLIB_NONE | SHUFFLE, ZLIB_NONE | BITSHUFFLE };
+        std::size_t elementSizes[] = { 1, 2, 4, 12 };
+        for(int m=0; m<4; ++m)
+        {
+        #ifndef HasZLIB
+            if(compressionCodecMethod(methods[m]) == ZLIB_NONE)
+                continue;
+        #endif
+            for(int e=0; e<4; ++e)
+            {
+                ArrayVector<char> compressed;
+                compress(source, size, compressed, methods[m], elementSizes[e]);
+
+                ArrayVector<char> decompressed(size);
+                uncompress(compressed.begin(), compressed.size(),
+                           decompressed.begin(), decompressed.size(), methods[m], elementSizes[e]);
+                shouldEqualSequence(source, source+size, decompressed.begin());
+            }
+        }
+
+    #ifdef HasZLIB
+        {
+            // zlib level 0 only stores the data, so the shuffled bytes are
+            // visible in the output
+            ArrayVector<char> stored, shuffled;
+            compress(source, size, stored, ZLIB_NONE, 2);
+            compress(source, size, shuffled, ZLIB_NONE | SHUFFLE, 2);
+            shouldEqual(stored.size(), shuffled.size());
+            should(!std::equal(stored.begin(), stored.end(), shuffled.begin()));
+        }
+    #endif
+
+        ArrayVector<char> plain, shuffled, bitshuffled;
+        compress(source, size, plain, LZ4, 2);
+        compress(source, size, shuffled, LZ4_SHUFFLE, 2);
+        compress(source, size, bitshuffled, LZ4_BITSHUFFLE, 2);
+        should(shuffled.size() < plain.size() / 2);
+        should(bitshuffled.size() < plain.size() / 2);
+
+        shouldEqual(compressionMethodName(LZ4), "LZ4");
+        shouldEqual(compressionMethodName(LZ4_SHUFFLE), "LZ4|SHUFFLE");
+        shouldEqual(compressionMethodName(ZLIB_FAST | BITSHUFFLE), "ZLIB_FAST|BITSHUFFLE");
+        shouldEqual(compressionMethodName(DEFAULT_COMPRESSION), "LZ4");
+        shouldEqual(compressionCodecMethod(ZSTD_SHUFFLE), ZSTD);
+        shouldEqual(compressionFilter(ZSTD_SHUFFLE), (int)SHUFFLE);
+    }
+
+    struct ReverseCodec
+    : public CompressionCodec
+    {
+        std::string name() const
+        {
+            return "REVERSE";
+        }
+
+        std::size_t compressBound(std::size_t size) const
+        {
+            return size;
+        }
+
+        std::size_t compress(char const * source, std::size_t size,
+                             char * dest, std::size_t) const
+        {
+            std::reverse_copy(source, source+size, dest);
+            return size;
+        }
+
+        void uncompress(char const * source, std::size_t srcSize,
+                        char * dest, std::size_t) const
+        {
+            std::reverse_copy(source, source+srcSize, dest);
+        }
+    };
+
+    void testRegistry()
+    {
+        CompressionMethod reverse = CompressionMethod(USER_COMPRESSION + 1);
+        try
+        {
+            getCompressionCodec(reverse);
+            failTest("unknown compression method did not throw exception.");
+        }
+        catch(ContractViolation & c)
+        {
+            std::string expected("\nPrecondition violation!\ngetCompressionCodec(): Unknown compression method.");
+            std::string message(c.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+
+        registerCompressionCodec(reverse, VIGRA_SHARED_PTR<CompressionCodec>(new ReverseCodec));
+        shouldEqual(getCompressionCodec(reverse).name(), "REVERSE");
+        shouldEqual(compressionMethodName(reverse | SHUFFLE), "REVERSE|SHUFFLE");
+
+        ArrayVector<char> compressed;
+        compress(data.begin(), data.size(), compressed, reverse);
+        shouldEqual(compressed.size(), data.size());
+        shouldEqualSequence(data.begin(), data.end(), compressed.rbegin());
+
+        ArrayVector<char> decompressed(data.size());
+        uncompress(compressed.begin(), compressed.size(),
+                   decompressed.begin(), decompressed.size(), reverse);
+        shouldEqualSequence(data.begin(), data.end(), decompressed.begin());
+
+        try
+        {
+            registerCompressionCodec(LZ4, VIGRA_SHARED_PTR<CompressionCodec>(new ReverseCodec));
+            failTest("overriding a built-in codec did not throw exception.");
+        }
+        catch(ContractViolation &)
+        {}
+    }
+
+    void testZSTD()
+    {
+        ArrayVector<char> compressed;
+    #ifdef HasZSTD
+        compress(data.begin(), data.size(), compressed, ZSTD);
+        should(compressed.size() < data.size() / 100);
+
+        ArrayVector<char> decompressed(data.size());
+        uncompress(compressed.begin(), compressed.size(),
+                   decompressed.begin(), decompressed.size(), ZSTD);
+        shouldEqualSequence(data.begin(), data.end(), decompressed.begin());
+
+        CompressionMethod methods[] = { ZSTD_FAST, ZSTD_BEST, ZSTD_SHUFFLE, ZSTD | BITSHUFFLE };
+        for(int m=0; m<4; ++m)
+        {
+            compress(data.begin(), data.size(), compressed, methods[m], 4);
+            should(compressed.size() < data.size() / 10);
+
+            decompressed.init(0);
+            uncompress(compressed.begin(), compressed.size(),
+                       decompressed.begin(), decompressed.size(), methods[m], 4);
+            shouldEqualSequence(data.begin(), data.end(), decompressed.begin());
+        }
+    #else
+        try
+        {
+            compress(data.begin(), data.size(), compressed, ZSTD);
+            failTest("missing ZSTD did not throw exception.");
+        }
+        catch(ContractViolation & c)
+        {
+            std::string expected("\nPrecondition violation!\ncompress(): VIGRA was compiled without ZSTD compression.");
+            std::string message(c.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    #endif
+    }
 };
 
 
@@ -1534,6 +1807,7 @@ struct UtilitiesTestSuite
         add( testCase( &BucketQueueTest::testAscending));
         add( testCase( &BucketQueueTest::testDescendingMapped));
         add( testCase( &BucketQueueTest::testAscendingMapped));
+        add( testCase( &BucketQueueTest::testRadix));
         add( testCase( &ChangeablePriorityQueueTest::testMinQueue));
         add( testCase( &ChangeablePriorityQueueTest::testMaxQueue));
         add( testCase( &SizedIntTest::testSizedInt));
@@ -1545,6 +1819,9 @@ struct UtilitiesTestSuite
         add( testCase( &CompressionTest::testZLIB));
         add( testCase( &CompressionTest::testLZ4));
         add( testCase( &CompressionTest::testNoCompression));
+        add( testCase( &CompressionTest::testFilters));
+        add( testCase( &CompressionTest::testRegistry));
+        add( testCase( &CompressionTest::testZSTD));
 
         add( testCase( &AnyTest::test));
     }
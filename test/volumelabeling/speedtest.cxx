@@ -0,0 +1,129 @@
+// -*- c++ -*-
+// $Id$
+
+#include "vigra/unittest.hxx"
+#include "vigra/multi_array.hxx"
+#include "vigra/multi_labeling.hxx"
+#include "vigra/timing.hxx"
+#include "vigra/random.hxx"
+
+#include <iostream>
+
+using namespace vigra;
+
+struct VolumeLabelingSpeedTest
+{
+    MultiArray<3, UInt8> volume, sparse;
+
+    VolumeLabelingSpeedTest()
+    : volume(Shape3(250, 250, 250)),
+      sparse(volume.shape())
+    {
+        // blobs of 5^3 voxels with 5% noise
+        RandomMT19937 random;
+        MultiArray<3, UInt8> coarse(volume.shape() / 5);
+        for(auto & v: coarse)
+            v = random.uniformInt(2);
+        for(auto i = volume.begin(); i != volume.end(); ++i)
+            *i = random.uniformInt(20) == 0
+                     ? random.uniformInt(2)
+                     : coarse(i.point()[0] / 5, i.point()[1] / 5, i.point()[2] / 5);
+
+        // about 2% foreground in random boxes
+        for(int k = 0; k < 2000; ++k)
+        {
+            Shape3 start(random.uniformInt(220), random.uniformInt(245), random.uniformInt(245)),
+                   size(10 + random.uniformInt(20), 1 + random.uniformInt(4), 1 + random.uniformInt(4));
+            sparse.subarray(start, start + size) = 1;
+        }
+    }
+
+    void testScaling(NeighborhoodType neighborhood, bool withBackground)
+    {
+        USETICTOC;
+        MultiArray<3, UInt32> seq(volume.shape()), res(volume.shape());
+        LabelOptions options;
+        options.neighborhood(neighborhood);
+        if(withBackground)
+            options.ignoreBackgroundValue(0);
+        std::string name = std::string(neighborhood == DirectNeighborhood ? "direct" : "indirect") +
+                           (withBackground ? ", with background" : "");
+
+        TIC;
+        UInt32 count = labelMultiArray(volume, seq, options);
+        std::cout << "Timed function: labelMultiArray, " << name << ", sequential " << TOCS << std::endl;
+
+        // the new algorithm on the calling thread, and on all cores
+        ParallelOptions parallelOptions[] = { ParallelOptions().numThreads(ParallelOptions::NoThreads),
+                                              ParallelOptions() };
+        for(int k = 0; k < 2; ++k)
+        {
+            ParallelOptions const & parallel = parallelOptions[k];
+            res.init(0);
+            TIC;
+            shouldEqual(count, labelMultiArray(volume, res, options, parallel));
+            std::cout << "Timed function: labelMultiArray, " << name << ", "
+                      << parallel.getActualNumThreads() << " thread(s) " << TOCS << std::endl;
+            shouldEqualSequence(res.begin(), res.end(), seq.begin());
+        }
+    }
+
+    void testDirect()
+    {
+        testScaling(DirectNeighborhood, false);
+        testScaling(DirectNeighborhood, true);
+    }
+
+    void testIndirect()
+    {
+        testScaling(IndirectNeighborhood, false);
+        testScaling(IndirectNeighborhood, true);
+    }
+
+    void testRunLength()
+    {
+        USETICTOC;
+        MultiArray<3, UInt32> seq(sparse.shape()), res(sparse.shape());
+        NeighborhoodType neighborhoods[] = { DirectNeighborhood, IndirectNeighborhood };
+        for(int n = 0; n < 2; ++n)
+        {
+            std::string name = neighborhoods[n] == DirectNeighborhood ? "direct" : "indirect";
+
+            TIC;
+            UInt32 count = labelMultiArrayWithBackground(sparse, seq, neighborhoods[n]);
+            std::cout << "Timed function: labelMultiArrayWithBackground, sparse, " << name << " " << TOCS << std::endl;
+
+            res.init(0);
+            TIC;
+            shouldEqual(count, labelMultiArrayRunLength(sparse, res, neighborhoods[n]));
+            std::cout << "Timed function: labelMultiArrayRunLength, sparse, " << name << " " << TOCS << std::endl;
+            shouldEqualSequence(res.begin(), res.end(), seq.begin());
+
+            RunLengthLabels<3, UInt32> runs;
+            TIC;
+            shouldEqual(count, labelMultiArrayRunLength(sparse, runs, neighborhoods[n]));
+            std::cout << "Timed function: labelMultiArrayRunLength, sparse, " << name << ", "
+                      << runs.numberOfRuns() << " runs " << TOCS << std::endl;
+        }
+    }
+};
+
+struct VolumeLabelingSpeedTestSuite
+: public vigra::test_suite
+{
+    VolumeLabelingSpeedTestSuite()
+    : vigra::test_suite("VolumeLabelingSpeedTestSuite")
+    {
+        add( testCase( &VolumeLabelingSpeedTest::testDirect ) );
+        add( testCase( &VolumeLabelingSpeedTest::testIndirect ) );
+        add( testCase( &VolumeLabelingSpeedTest::testRunLength ) );
+    }
+};
+
+int main()
+{
+  VolumeLabelingSpeedTestSuite test;
+  int failed = test.run();
+  std::cout << test.report() << std::endl;
+  return (failed != 0);
+}
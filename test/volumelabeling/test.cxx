@@ -40,6 +40,7 @@
 
 #include "vigra/labelvolume.hxx"
 #include "vigra/multi_labeling.hxx"
+#include "vigra/random.hxx"
 
 using namespace vigra;
 
@@ -463,6 +464,252 @@ struct VolumeLabelingTest
 
 
 
+    // non-transitive predicate: neighboring values may differ by one
+struct SimilarValues
+{
+    bool operator()(int a, int b) const
+    {
+        return std::abs(a - b) <= 1;
+    }
+};
+
+struct ParallelLabelingTest
+{
+    template <unsigned int N, class Equal>
+    void checkLabeling(MultiArrayView<N, int> const & data, Equal equal)
+    {
+        NeighborhoodType neighborhoods[] = { DirectNeighborhood, IndirectNeighborhood };
+        int threads[] = { ParallelOptions::NoThreads, 2, 4, 7 };
+        MultiArray<N, int> ref(data.shape()), res(data.shape());
+
+        for(int n = 0; n < 2; ++n)
+        {
+            for(int b = 0; b < 2; ++b)
+            {
+                LabelOptions options;
+                options.neighborhood(neighborhoods[n]);
+                if(b == 1)
+                    options.ignoreBackgroundValue(0);
+                int count = labelMultiArray(data, ref, options, equal);
+
+                for(int k = 0; k < 4; ++k)
+                {
+                    res.init(-1);
+                    shouldEqual(count, labelMultiArray(data, res, options, equal,
+                                                       ParallelOptions().numThreads(threads[k])));
+                    shouldEqualSequence(res.begin(), res.end(), ref.begin());
+                }
+            }
+        }
+    }
+
+    template <unsigned int N>
+    void checkLabeling(MultiArrayView<N, int> const & data)
+    {
+        checkLabeling(data, std::equal_to<int>());
+    }
+
+    void testRandom()
+    {
+        RandomMT19937 random(42);
+
+        MultiArray<2, int> noise2(Shape2(53, 47));
+        for(auto & v: noise2)
+            v = random.uniformInt(2);
+        checkLabeling<2>(noise2);
+        checkLabeling<2>(noise2.transpose());
+
+        MultiArray<3, int> noise3(Shape3(23, 19, 29));
+        for(auto & v: noise3)
+            v = random.uniformInt(2);
+        checkLabeling<3>(noise3);
+        checkLabeling<3>(noise3.transpose());
+
+        // larger regions with many labels
+        MultiArray<3, int> coarse(Shape3(8, 7, 9)),
+                           blocks(Shape3(31, 27, 33));
+        for(auto & v: coarse)
+            v = random.uniformInt(4);
+        for(auto i = blocks.begin(); i != blocks.end(); ++i)
+            *i = random.uniformInt(10) == 0
+                     ? random.uniformInt(4)
+                     : coarse(i.point()[0] / 4, i.point()[1] / 4, i.point()[2] / 4);
+        checkLabeling<3>(blocks);
+        checkLabeling<3>(blocks, SimilarValues());
+
+        MultiArray<4, int> noise4(Shape4(9, 8, 7, 11));
+        for(auto & v: noise4)
+            v = random.uniformInt(3);
+        checkLabeling<4>(noise4);
+
+        MultiArray<1, int> noise1(Shape1(101));
+        for(auto & v: noise1)
+            v = random.uniformInt(2);
+        checkLabeling<1>(noise1);
+    }
+
+    void testComb()
+    {
+        // a single region that touches all slabs, and separate teeth within each slab
+        MultiArray<3, int> comb(Shape3(20, 10, 40));
+        comb.bind<2>(0).bind<1>(1) = 1;
+        for(int z = 0; z < 40; ++z)
+        {
+            for(int x = 0; x < 20; x += 2)
+                comb(x, 0, z) = 1;
+            comb(z / 2, 5, z) = 2;
+        }
+        checkLabeling<3>(comb);
+
+        MultiArray<3, int> labels(comb.shape());
+        shouldEqual(2, labelMultiArray(comb, labels,
+                                       LabelOptions().neighborhood(IndirectNeighborhood)
+                                                     .ignoreBackgroundValue(0),
+                                       ParallelOptions().numThreads(4)));
+        shouldEqual(labels(0, 0, 39), 1);
+        shouldEqual(labels(18, 0, 39), 1);
+        shouldEqual(labels(0, 5, 0), 2);
+        shouldEqual(labels(19, 5, 39), 2);
+    }
+
+    void testConcurrentUnionFind()
+    {
+        ConcurrentUnionFindArray<UInt32> regions(1000);
+        parallel_foreach(ParallelOptions().numThreads(4), 1000,
+            [&](size_t, std::ptrdiff_t k)
+            {
+                regions.makeSet(UInt32(k));
+            });
+        // unite all even and all odd indices in random order
+        ArrayVector<int> order(998);
+        for(int k = 0; k < 998; ++k)
+            order[k] = k;
+        RandomMT19937 random(1);
+        for(int k = 997; k > 0; --k)
+            std::swap(order[k], order[random.uniformInt(k+1)]);
+        parallel_foreach(ParallelOptions().numThreads(4), 998,
+            [&](size_t, std::ptrdiff_t k)
+            {
+                regions.makeUnion(UInt32(order[k]), UInt32(order[k] + 2));
+            });
+        for(UInt32 k = 0; k < 1000; ++k)
+            shouldEqual(regions.findIndex(k), k % 2);
+        should(regions.isRoot(0) && regions.isRoot(1) && !regions.isRoot(2));
+    }
+};
+
+struct RunLengthLabelingTest
+{
+    template <unsigned int N>
+    void checkLabeling(MultiArrayView<N, int> const & data)
+    {
+        typedef typename MultiArrayShape<N>::type Shape;
+
+        NeighborhoodType neighborhoods[] = { DirectNeighborhood, IndirectNeighborhood };
+        MultiArray<N, int> ref(data.shape()), res(data.shape());
+
+        for(int n = 0; n < 2; ++n)
+        {
+            int count = labelMultiArrayWithBackground(data, ref, neighborhoods[n]);
+
+            res.init(-1);
+            shouldEqual(count, labelMultiArrayRunLength(data, res, neighborhoods[n]));
+            shouldEqualSequence(res.begin(), res.end(), ref.begin());
+
+            RunLengthLabels<N, int> runs;
+            shouldEqual(count, labelMultiArrayRunLength(data, runs, neighborhoods[n]));
+            shouldEqual(runs.shape(), data.shape());
+            for(auto i = ref.begin(); i != ref.end(); ++i)
+                shouldEqual(runs[i.point()], *i);
+
+            // runs are maximal, sorted, and don't cover the background
+            MultiArrayIndex covered = 0;
+            for(auto r = runs.begin(); r != runs.end(); ++r)
+            {
+                covered += r->end - r->begin;
+                should(r->label > 0);
+                if(r != runs.begin() && (r-1)->line == r->line)
+                    should((r-1)->end <= r->begin);
+            }
+            shouldEqual(covered, (MultiArrayIndex)(data.size() - std::count(data.begin(), data.end(), 0)));
+
+            Shape start = data.shape() / 4,
+                  stop = data.shape() - data.shape() / 3;
+            MultiArray<N, int> sub(stop - start, -1);
+            runs.checkoutSubarray(start, sub);
+            shouldEqualSequence(sub.begin(), sub.end(), ref.subarray(start, stop).begin());
+        }
+    }
+
+    void testRandom()
+    {
+        RandomMT19937 random(42);
+
+        // sparse runs of two foreground values
+        MultiArray<3, int> sparse(Shape3(47, 23, 19));
+        for(auto i = sparse.begin(); i != sparse.end(); ++i)
+            if(random.uniformInt(8) == 0)
+                *i = 1 + random.uniformInt(2);
+            else if(i.point()[0] > 0 && random.uniformInt(4) > 0)
+                *i = *(i - 1);
+        checkLabeling<3>(sparse);
+        checkLabeling<3>(sparse.transpose());
+
+        MultiArray<2, int> noise2(Shape2(53, 47));
+        for(auto & v: noise2)
+            v = random.uniformInt(3);
+        checkLabeling<2>(noise2);
+        checkLabeling<2>(noise2.transpose());
+
+        MultiArray<3, int> noise3(Shape3(23, 19, 29));
+        for(auto & v: noise3)
+            v = random.uniformInt(2);
+        checkLabeling<3>(noise3);
+
+        MultiArray<4, int> noise4(Shape4(9, 8, 7, 11));
+        for(auto & v: noise4)
+            v = random.uniformInt(3);
+        checkLabeling<4>(noise4);
+
+        MultiArray<1, int> noise1(Shape1(101));
+        for(auto & v: noise1)
+            v = random.uniformInt(2);
+        checkLabeling<1>(noise1);
+    }
+
+    void testSpecialCases()
+    {
+        MultiArray<3, int> volume(Shape3(10, 8, 6));
+        checkLabeling<3>(volume);
+        volume = 5;
+        checkLabeling<3>(volume);
+
+        // diagonally touching runs are only connected in the indirect neighborhood
+        MultiArray<2, int> diagonal(Shape2(12, 4));
+        diagonal.subarray(Shape2(0, 0), Shape2(4, 1)) = 1;
+        diagonal.subarray(Shape2(4, 1), Shape2(8, 2)) = 1;
+        diagonal.subarray(Shape2(8, 2), Shape2(12, 3)) = 1;
+        checkLabeling<2>(diagonal);
+
+        RunLengthLabels<2, UInt8> runs;
+        shouldEqual(labelMultiArrayRunLength(diagonal, runs), (UInt8)3);
+        shouldEqual(runs.numberOfRuns(), 3);
+        shouldEqual(labelMultiArrayRunLength(diagonal, runs, IndirectNeighborhood), (UInt8)1);
+        shouldEqual(runs.lineEnd(1) - runs.lineBegin(1), 1);
+        shouldEqual(runs.lineBegin(2)->begin, 8);
+        shouldEqual(runs.lineBegin(2)->end, 12);
+        should(runs.lineBegin(3) == runs.end());
+
+        // foreground and background values other than 0
+        MultiArray<2, int> other(diagonal.shape(), -1);
+        other.subarray(Shape2(2, 1), Shape2(6, 3)) = 0;
+        MultiArray<2, int> ref(other.shape()), res(other.shape());
+        shouldEqual(labelMultiArrayWithBackground(other, ref, DirectNeighborhood, -1),
+                    labelMultiArrayRunLength(other, res, DirectNeighborhood, -1));
+        shouldEqualSequence(res.begin(), res.end(), ref.begin());
+    }
+};
+
 struct VolumeLabelingTestSuite
 : public vigra::test_suite
 {
@@ -479,6 +726,13 @@ struct VolumeLabelingTestSuite
         add( testCase( &VolumeLabelingTest::labelingTwentySixTest3));
         add( testCase( &VolumeLabelingTest::labelingTwentySixWithBackgroundTest1));
         add( testCase( &VolumeLabelingTest::labelingAllTest));
+
+        add( testCase( &ParallelLabelingTest::testRandom));
+        add( testCase( &ParallelLabelingTest::testComb));
+        add( testCase( &ParallelLabelingTest::testConcurrentUnionFind));
+
+        add( testCase( &RunLengthLabelingTest::testRandom));
+        add( testCase( &RunLengthLabelingTest::testSpecialCases));
     }
 };
 
@@ -0,0 +1,106 @@
+// -*- c++ -*-
+// $Id$
+
+#include <iostream>
+#include "vigra/unittest.hxx"
+#include "vigra/multi_array.hxx"
+#include "vigra/multi_convolution.hxx"
+#include "vigra/multi_watersheds.hxx"
+#include "vigra/seededregiongrowing3d.hxx"
+#include "vigra/timing.hxx"
+#include "vigra/random.hxx"
+
+using namespace vigra;
+
+struct Watersheds3dSpeedTest
+{
+    MultiArray<3, float> data;
+
+    Watersheds3dSpeedTest()
+    : data(Shape3(120, 120, 120))
+    {
+        RandomMT19937 random;
+        MultiArray<3, float> noise(data.shape());
+        for(auto & v: noise)
+            v = random.uniform();
+        gaussianSmoothMultiArray(noise, data, 2.0);
+        data -= *argMin(data.begin(), data.end());
+        data *= 250.0f / *argMax(data.begin(), data.end());
+    }
+
+    template <class T>
+    void timeWatersheds(const char * name, MultiArray<3, UInt32> & labels)
+    {
+        USETICTOC;
+        MultiArray<3, T> tdata(data);
+        labels.init(0);
+        TIC;
+        watershedsMultiArray(tdata, labels, IndirectNeighborhood, WatershedOptions().regionGrowing());
+        std::cout << "Timed function: watershedsMultiArray, " << name << " " << TOCS << std::endl;
+    }
+
+    void testRegionGrowing()
+    {
+        MultiArray<3, UInt32> res8(data.shape()), res(data.shape());
+        timeWatersheds<UInt8>("UInt8", res8);
+        timeWatersheds<UInt16>("UInt16", res);
+        should(res == res8);
+        timeWatersheds<float>("float", res);
+        timeWatersheds<double>("double", res);
+    }
+
+    template <class T>
+    void timeParallelWatersheds(const char * name)
+    {
+        USETICTOC;
+        MultiArray<3, T> tdata(data);
+        MultiArray<3, UInt32> reference(data.shape()), labels(data.shape());
+        watershedsMultiArray(tdata, reference, IndirectNeighborhood);
+
+        ParallelOptions options;
+        TIC;
+        watershedsMultiArray(tdata, labels, IndirectNeighborhood, WatershedOptions(), options);
+        std::cout << "Timed function: watershedsMultiArray, " << name << ", "
+                  << options.getActualNumThreads() << " thread(s) " << TOCS << std::endl;
+        should(labels == reference);
+    }
+
+    void testParallelRegionGrowing()
+    {
+        timeParallelWatersheds<UInt16>("UInt16");
+        timeParallelWatersheds<float>("float");
+    }
+
+    void testSeededRegionGrowing3D()
+    {
+        USETICTOC;
+        MultiArray<3, int> seeds(data.shape()), labels(data.shape());
+        int count = generateWatershedSeeds(data, seeds, DirectNeighborhood);
+        ArrayOfRegionStatistics<SeedRgDirectValueFunctor<float> > stats(count);
+
+        TIC;
+        seededRegionGrowing3D(srcMultiArrayRange(data), srcMultiArray(seeds),
+                              destMultiArray(labels), stats, CompleteGrow);
+        std::cout << "Timed function: seededRegionGrowing3D " << TOCS << std::endl;
+    }
+};
+
+struct Watersheds3dSpeedTestSuite
+: public vigra::test_suite
+{
+    Watersheds3dSpeedTestSuite()
+    : vigra::test_suite("Watersheds3dSpeedTestSuite")
+    {
+        add( testCase( &Watersheds3dSpeedTest::testRegionGrowing ) );
+        add( testCase( &Watersheds3dSpeedTest::testParallelRegionGrowing ) );
+        add( testCase( &Watersheds3dSpeedTest::testSeededRegionGrowing3D ) );
+    }
+};
+
+int main()
+{
+  Watersheds3dSpeedTestSuite test;
+  int failed = test.run();
+  std::cout << test.report() << std::endl;
+  return (failed != 0);
+}
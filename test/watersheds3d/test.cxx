@@ -41,6 +41,8 @@
 #include "vigra/watersheds3d.hxx"
 #include "vigra/multi_array.hxx"
 #include "vigra/multi_watersheds.hxx"
+#include "vigra/multi_convolution.hxx"
+#include "vigra/random.hxx"
 #include "list"
 
 #include <stdlib.h>
@@ -557,6 +559,124 @@ struct Watersheds3dTest
         shouldEqual(8, max_region_label);
         should(labelVolume == labelVolume2);
     }
+
+    template <class T>
+    void checkRegionGrowing(MultiArray<3, int> const & data, MultiArray<3, int> const & reference,
+                            WatershedOptions const & options)
+    {
+        MultiArray<3, T> tdata(data);
+        MultiArray<3, int> labels(data.shape());
+        shouldEqual(watershedsMultiArray(tdata, labels, IndirectNeighborhood, options),
+                    *argMax(reference.begin(), reference.end()));
+        should(labels == reference);
+    }
+
+    void testRegionGrowingPriorityTypes()
+    {
+        // plateaus of random height, so that the result depends on the
+        // order in which the queue returns elements of equal priority
+        MultiArray<3, int> coarse(Shape3(10, 9, 7)), data(Shape3(30, 27, 21));
+        RandomMT19937 random(11);
+        for(auto & v: coarse)
+            v = random.uniformInt(50);
+        for(auto i = data.begin(); i != data.end(); ++i)
+            *i = coarse(i.point()[0] / 3, i.point()[1] / 3, i.point()[2] / 3) + random.uniformInt(3);
+
+        WatershedOptions options[] = { WatershedOptions().regionGrowing(),
+                                       WatershedOptions().regionGrowing().keepContours() };
+        for(int k = 0; k < 2; ++k)
+        {
+            // 8-bit data use a BucketQueue, all other types a RadixPriorityQueue,
+            // which are both FIFO for equal priorities
+            MultiArray<3, UInt8> bdata(data);
+            MultiArray<3, int> reference(data.shape());
+            watershedsMultiArray(bdata, reference, IndirectNeighborhood, options[k]);
+
+            checkRegionGrowing<UInt16>(data, reference, options[k]);
+            checkRegionGrowing<Int32>(data, reference, options[k]);
+            checkRegionGrowing<Int64>(data, reference, options[k]);
+            checkRegionGrowing<float>(data, reference, options[k]);
+            checkRegionGrowing<double>(data, reference, options[k]);
+        }
+
+        // -0.0 and +0.0 form a single plateau
+        float plateau[] = { 0.0f, 0.0f, -0.0f, -0.0f, 1.0f, 0.0f };
+        int desired[] = { 1, 1, 1, 1, 2, 2 };
+        MultiArray<2, float> zdata(Shape2(6, 1), plateau);
+        MultiArray<2, int> zlabels(zdata.shape());
+        zlabels(0, 0) = 1;
+        zlabels(5, 0) = 2;
+        shouldEqual(watershedsMultiArray(zdata, zlabels, DirectNeighborhood,
+                                         WatershedOptions().regionGrowing()), 2);
+        shouldEqualSequence(zlabels.begin(), zlabels.end(), desired);
+    }
+
+    template <class T>
+    void checkParallelRegionGrowing(MultiArray<3, T> const & data, MultiArray<3, int> const & seeds,
+                                    NeighborhoodType neighborhood, WatershedOptions const & options)
+    {
+        MultiArray<3, int> reference(seeds), labels(data.shape());
+        int count = watershedsMultiArray(data, reference, neighborhood, options);
+
+        int threads[] = { 1, 2, 4 };
+        for(int k = 0; k < 3; ++k)
+        {
+            labels = seeds;
+            shouldEqual(watershedsMultiArray(data, labels, neighborhood, options,
+                                             ParallelOptions().numThreads(threads[k])),
+                        count);
+            should(labels == reference);
+        }
+    }
+
+    template <class T>
+    void checkParallelRegionGrowing(MultiArray<3, T> const & data, MultiArray<3, int> const & seeds)
+    {
+        NeighborhoodType neighborhoods[] = { DirectNeighborhood, IndirectNeighborhood };
+        for(int n = 0; n < 2; ++n)
+        {
+            checkParallelRegionGrowing(data, seeds, neighborhoods[n], WatershedOptions());
+            checkParallelRegionGrowing(data, seeds, neighborhoods[n],
+                                       WatershedOptions().stopAtThreshold(20.0));
+            checkParallelRegionGrowing(data, seeds, neighborhoods[n],
+                                       WatershedOptions().biasLabel(3, 0.8));
+            checkParallelRegionGrowing(data, seeds, neighborhoods[n],
+                                       WatershedOptions().keepContours());
+        }
+    }
+
+    void testParallelRegionGrowing()
+    {
+        // plateaus, where the result depends on the order of equal priorities,
+        // and smooth data, where the batches are often truncated
+        MultiArray<3, int> coarse(Shape3(10, 9, 7)), plateaus(Shape3(30, 27, 21));
+        MultiArray<3, double> noise(plateaus.shape()), smooth(plateaus.shape());
+        RandomMT19937 random(17);
+        for(auto & v: coarse)
+            v = random.uniformInt(50);
+        for(auto i = plateaus.begin(); i != plateaus.end(); ++i)
+            *i = coarse(i.point()[0] / 3, i.point()[1] / 3, i.point()[2] / 3) + random.uniformInt(3);
+        for(auto & v: noise)
+            v = random.uniform(0.0, 50.0);
+        gaussianSmoothMultiArray(noise, smooth, 1.5);
+
+        MultiArray<3, int> seeds(plateaus.shape());
+        for(int k = 0; k < 60; ++k)
+            seeds(random.uniformInt(30), random.uniformInt(27), random.uniformInt(21)) = k / 2 + 1;
+
+        checkParallelRegionGrowing(MultiArray<3, UInt8>(plateaus), seeds);
+        checkParallelRegionGrowing(MultiArray<3, UInt16>(plateaus), seeds);
+        checkParallelRegionGrowing(MultiArray<3, Int32>(plateaus), seeds);
+        checkParallelRegionGrowing(MultiArray<3, float>(smooth), seeds);
+        checkParallelRegionGrowing(smooth, seeds);
+        // long double has no radix keys and falls back to the sequential algorithm
+        checkParallelRegionGrowing(MultiArray<3, long double>(smooth), seeds);
+
+        // automatic seeds
+        MultiArray<3, int> none(plateaus.shape());
+        checkParallelRegionGrowing(MultiArray<3, float>(smooth), none,
+                                   IndirectNeighborhood, WatershedOptions());
+    }
 };
 
 
@@ -572,6 +692,8 @@ struct Watershed3DTestSuite
         add( testCase( &Watersheds3dTest::testWatersheds3dSix2));
         add( testCase( &Watersheds3dTest::testWatersheds3dGradient1));
         add( testCase( &Watersheds3dTest::testWatersheds3dGradient2));
+        add( testCase( &Watersheds3dTest::testRegionGrowingPriorityTypes));
+        add( testCase( &Watersheds3dTest::testParallelRegionGrowing));
     }
 };
 
@@ -938,12 +938,20 @@ void defineChunkedArray()
          "   ``Compression.ZLIB_NONE:``\n      ZLIB no compression (level = 0)\n"
          "   ``Compression.ZLIB_FAST:``\n      ZLIB fast compression (level = 1)\n"
          "   ``Compression.ZLIB_BEST:``\n      ZLIB best compression (level = 9)\n"
-         "   ``Compression.LZ4:``\n      LZ4 compression (very fast)\n\n")
+         "   ``Compression.LZ4:``\n      LZ4 compression (very fast)\n"
+         "   ``Compression.LZ4_SHUFFLE:``\n      LZ4 compression after byte shuffling (for multi-byte types)\n"
+         "   ``Compression.LZ4_BITSHUFFLE:``\n      LZ4 compression after bit shuffling\n"
+         "   ``Compression.ZSTD:``\n      Zstandard compression (if VIGRA was compiled with libzstd)\n"
+         "   ``Compression.ZSTD_SHUFFLE:``\n      Zstandard compression after byte shuffling\n\n")
         .value("ZLIB", vigra::ZLIB)
         .value("ZLIB_NONE", vigra::ZLIB_NONE)
         .value("ZLIB_FAST", vigra::ZLIB_FAST)
         .value("ZLIB_BEST", vigra::ZLIB_BEST)
         .value("LZ4", vigra::LZ4)
+        .value("LZ4_SHUFFLE", vigra::LZ4_SHUFFLE)
+        .value("LZ4_BITSHUFFLE", vigra::LZ4_BITSHUFFLE)
+        .value("ZSTD", vigra::ZSTD)
+        .value("ZSTD_SHUFFLE", vigra::ZSTD_SHUFFLE)
     ;
 
 #ifdef HasHDF5